@@ -46,13 +46,50 @@
     
     [self.window makeKeyAndVisible];
 
-    [BLMDataManager initializeWithCompletion:^{
-        [projectMenuController loadProjectData];
+    [BLMProjectDetailController prewarmImageCache];
+
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleArchiveRestoreFailed:) name:BLMDataManagerArchiveRestoreFailedNotification object:nil];
+
+    [BLMDataManager initializeWithPhaseHandler:^(BLMDataManagerRestorePhase phase, NSTimeInterval duration) {
+        NSLog(@"[%@ %@]> Restore phase %@ took %.3fs", NSStringFromClass([self class]), NSStringFromSelector(_cmd), @(phase), duration);
+
+        if (phase == BLMDataManagerRestorePhaseProjects) {
+            [projectMenuController loadProjectData];
+        }
+    } completion:^{
+        [projectMenuController finishLoadingProjectData];
     }];
     
     return YES;
 }
 
+
+- (void)applicationDidEnterBackground:(UIApplication *)application {
+    BLMDataManager *dataManager = [BLMDataManager sharedManager];
+
+    if (dataManager.isRestoringArchive) {
+        return;
+    }
+
+    __block UIBackgroundTaskIdentifier backgroundTask = [application beginBackgroundTaskWithName:@"Flush Archive" expirationHandler:^{
+        [application endBackgroundTask:backgroundTask];
+        backgroundTask = UIBackgroundTaskInvalid;
+    }];
+
+    [dataManager flushArchiveWithCompletion:^(NSError *error) { // Pending changes would otherwise wait out the latency window, by which point the app may be suspended
+        if (backgroundTask != UIBackgroundTaskInvalid) {
+            [application endBackgroundTask:backgroundTask];
+            backgroundTask = UIBackgroundTaskInvalid;
+        }
+    }];
+}
+
+#pragma mark Event Handling
+
+- (void)handleArchiveRestoreFailed:(NSNotification *)notification {
+    NSLog(@"[%@ %@]> %@", NSStringFromClass([self class]), NSStringFromSelector(_cmd), notification.userInfo[BLMDataManagerArchiveErrorUserInfoKey]);
+}
+
 #pragma mark UISplitViewControllerDelegate
 
 - (void)splitViewController:(UISplitViewController *)svc willChangeToDisplayMode:(UISplitViewControllerDisplayMode)displayMode {
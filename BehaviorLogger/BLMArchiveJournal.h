@@ -0,0 +1,76 @@
+//
+//  BLMArchiveJournal.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/2/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+extern unsigned long long const BLMArchiveJournalDefaultCompactionThreshold;
+
+
+typedef NS_ENUM(NSInteger, BLMArchiveEntityKind) {
+    BLMArchiveEntityKindProject,
+    BLMArchiveEntityKindBehavior,
+    BLMArchiveEntityKindSession,
+    BLMArchiveEntityKindSessionConfiguration,
+    BLMArchiveEntityKindCount
+};
+
+
+#pragma mark
+
+@interface BLMArchiveMutation : NSObject <NSCoding>
+
+@property (nonatomic, assign, readonly) BLMArchiveEntityKind kind;
+@property (nonatomic, strong, readonly) NSUUID *UUID;
+@property (nullable, nonatomic, strong, readonly) id<NSCoding> object; // nil for deletions
+
+- (instancetype)initWithKind:(BLMArchiveEntityKind)kind UUID:(NSUUID *)UUID object:(nullable id<NSCoding>)object;
+
+@end
+
+
+#pragma mark
+
+/*
+ ` An archive is a checkpoint file holding a full snapshot of every entity, plus an append-only journal
+ ` of mutation batches recorded since that checkpoint was written. Restoring replays the journal on top
+ ` of the checkpoint, and compaction folds the journal back into a new checkpoint. Both files hold
+ ` BLMBinaryArchive data; keyed archives written by earlier versions are migrated the first time they
+ ` are restored. A journal whose header isn't recognized is moved aside rather than overwritten, so
+ ` the changes it holds can still be recovered, and so is a file holding a record that can't be decoded.
+ ` A checkpoint that can't be read is left where it is. Either way nothing is written until a later
+ ` restore succeeds, so a partial restore is never compacted over what is on disk.
+ `
+ ` The journal is not thread safe; every message must be sent from its owner's serial archive queue.
+ */
+
+@interface BLMArchiveJournal : NSObject
+
+@property (nonatomic, copy, readonly) NSString *checkpointPath;
+@property (nonatomic, copy, readonly) NSString *journalPath;
+@property (nonatomic, assign, readonly) unsigned long long journalLength;
+@property (nonatomic, assign) unsigned long long compactionThreshold;
+@property (nonatomic, assign, readonly) BOOL needsCompaction;
+@property (nonatomic, assign, readonly) BOOL hasArchive; // YES if either file exists on disk
+@property (nullable, nonatomic, strong, readonly) NSError *restoreError; // Set when the last restore found a checkpoint or journal it could not read; the file is kept at the error's NSFilePathErrorKey, and nothing is written until a restore succeeds
+
+- (instancetype)initWithDirectory:(NSString *)directory name:(NSString *)name;
+
+- (NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)restoreObjectByUUIDByKind; // @(BLMArchiveEntityKind) -> UUID -> object
+- (NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)restoreObjectByUUIDByKindInPhases:(NSArray<NSIndexSet *> *)phases phaseHandler:(nullable void(^)(NSUInteger phaseIndex, NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind))phaseHandler; // Kinds in the same phase are decoded concurrently; the handler runs on the calling thread once each phase's kinds are complete
+- (BOOL)appendMutations:(NSArray<BLMArchiveMutation *> *)mutations;
+- (BOOL)compact;
+- (void)discard; // Deletes both files
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,574 @@
+//
+//  BLMArchiveJournal.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/2/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMArchiveJournal.h"
+#import "BLMBinaryArchive.h"
+#import "BLMUtils.h"
+
+
+#pragma mark Constants
+
+unsigned long long const BLMArchiveJournalDefaultCompactionThreshold = (512 * 1024);
+
+
+static NSString *const ArchiveVersionKey = @"ArchiveVersionKey";
+static NSString *const CheckpointFileExtension = @"dat";
+static NSString *const JournalFileExtension = @"journal";
+static NSString *const UnreadableFileExtension = @"unreadable";
+
+static uint32_t const JournalMagic = 0x4A4D4C42; // "BLMJ"
+
+
+typedef NS_ENUM(NSInteger, ArchiveVersion) { // Keyed archives predating BLMBinaryArchive; only ever decoded to migrate them
+    ArchiveVersionUnknown,
+    ArchiveVersionLatest
+};
+
+
+typedef NS_ENUM(uint32_t, JournalVersion) {
+    JournalVersionUnknown,
+    JournalVersionKeyedArchive, // Payloads are keyed archives of BLMArchiveMutation arrays
+    JournalVersionBinaryArchive, // Payloads are BLMBinaryArchive data
+    JournalVersionLatest = JournalVersionBinaryArchive
+};
+
+
+typedef struct JournalFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+} JournalFileHeader;
+
+
+typedef struct JournalRecordHeader {
+    uint32_t Length; // Byte length of the payload that immediately follows the header
+    uint32_t Checksum; // FNV-1a hash of the payload bytes
+} JournalRecordHeader;
+
+
+static NSString *CheckpointKeyForKind(BLMArchiveEntityKind kind) {
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            return @"projectByUUID";
+
+        case BLMArchiveEntityKindBehavior:
+            return @"behaviorByUUID";
+
+        case BLMArchiveEntityKindSession:
+            return @"sessionByUUID";
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            return @"sessionConfigurationByUUID";
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+}
+
+
+#pragma mark
+
+@implementation BLMArchiveMutation
+
+- (instancetype)initWithKind:(BLMArchiveEntityKind)kind UUID:(NSUUID *)UUID object:(id<NSCoding>)object {
+    assert((kind >= 0) && (kind < BLMArchiveEntityKindCount));
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _kind = kind;
+    _UUID = UUID;
+    _object = object;
+
+    return self;
+}
+
+#pragma mark NSCoding
+
+- (nullable instancetype)initWithCoder:(NSCoder *)decoder {
+    return [self initWithKind:[decoder decodeIntegerForKey:@"kind"]
+                         UUID:[decoder decodeObjectForKey:@"UUID"]
+                       object:[decoder decodeObjectForKey:@"object"]];
+}
+
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeInteger:self.kind forKey:@"kind"];
+    [coder encodeObject:self.UUID forKey:@"UUID"];
+    [coder encodeObject:self.object forKey:@"object"];
+    [coder encodeInteger:ArchiveVersionLatest forKey:ArchiveVersionKey];
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMArchiveJournal ()
+
+@property (nonatomic, copy, readonly) NSString *directory;
+@property (nonatomic, assign, getter=isRestored) BOOL restored;
+@property (nonatomic, assign, getter=isJournalLocked) BOOL journalLocked; // Nothing is written until a restore reads everything on disk, so an unreadable checkpoint, or a journal that couldn't be moved aside, is never written over
+
+@end
+
+
+@implementation BLMArchiveJournal
+
+- (instancetype)initWithDirectory:(NSString *)directory name:(NSString *)name {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _directory = [directory copy];
+    _checkpointPath = [[directory stringByAppendingPathComponent:name] stringByAppendingPathExtension:CheckpointFileExtension];
+    _journalPath = [[directory stringByAppendingPathComponent:name] stringByAppendingPathExtension:JournalFileExtension];
+    _compactionThreshold = BLMArchiveJournalDefaultCompactionThreshold;
+
+    return self;
+}
+
+
+- (BOOL)needsCompaction {
+    return (self.journalLength > self.compactionThreshold);
+}
+
+
+- (BOOL)hasArchive {
+    return ([[NSFileManager defaultManager] fileExistsAtPath:self.checkpointPath] || [[NSFileManager defaultManager] fileExistsAtPath:self.journalPath]);
+}
+
+#pragma mark Restoration
+
+- (NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)restoreObjectByUUIDByKind {
+    return [self restoreObjectByUUIDByKindInPhases:@[[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, BLMArchiveEntityKindCount)]] phaseHandler:nil];
+}
+
+
+- (NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)restoreObjectByUUIDByKindInPhases:(NSArray<NSIndexSet *> *)phases phaseHandler:(void(^)(NSUInteger, NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *))phaseHandler {
+    NSMutableDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [NSMutableDictionary dictionary];
+
+    _restoreError = nil;
+    self.journalLocked = NO;
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        objectByUUIDByKind[@(kind)] = [NSMutableDictionary dictionary];
+    }
+
+    NSData *checkpointData = [self readCheckpointData];
+    JournalVersion journalVersion = JournalVersionUnknown;
+    NSArray<NSData *> *journalPayloads = [self readJournalPayloadsWithVersion:&journalVersion];
+
+    if (((checkpointData.length > 0) && ![BLMBinaryArchive isBinaryArchiveData:checkpointData]) || (journalVersion == JournalVersionKeyedArchive)) { // Superseded formats are decoded in a single pass and then rewritten
+        NSString *malformedPath = [self decodeSupersededCheckpointData:checkpointData journalPayloads:journalPayloads journalVersion:journalVersion intoObjectByUUIDByKind:objectByUUIDByKind];
+
+        if (malformedPath != nil) {
+            [self setAsideMalformedFileAtPath:malformedPath];
+        }
+
+        if (!self.isJournalLocked && [self writeCheckpointWithObjectByUUIDByKind:objectByUUIDByKind]) { // The journal is emptied so new records never follow a keyed archive header
+            [self truncateJournal];
+        }
+
+        [phases enumerateObjectsUsingBlock:^(NSIndexSet *__nonnull kinds, NSUInteger phaseIndex, BOOL *__nonnull stop) {
+            if (phaseHandler != nil) {
+                phaseHandler(phaseIndex, objectByUUIDByKind);
+            }
+        }];
+    } else {
+        __block BOOL checkpointMalformed = NO;
+        __block BOOL journalMalformed = NO;
+
+        [phases enumerateObjectsUsingBlock:^(NSIndexSet *__nonnull kinds, NSUInteger phaseIndex, BOOL *__nonnull stop) {
+            NSMutableArray<NSNumber *> *phaseKinds = [NSMutableArray array];
+
+            [kinds enumerateIndexesUsingBlock:^(NSUInteger kind, BOOL *__nonnull stopKindEnumeration) {
+                [phaseKinds addObject:@(kind)];
+            }];
+
+            dispatch_apply(phaseKinds.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t index) { // Each kind has its own record tables and its own dictionary, so kinds decode independently
+                NSNumber *kind = phaseKinds[index];
+                NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDForKind = @{ kind:objectByUUIDByKind[kind] };
+                NSIndexSet *kindIndexSet = [NSIndexSet indexSetWithIndex:kind.unsignedIntegerValue];
+
+                if ((checkpointData.length > 0) && ![BLMBinaryArchive applyData:checkpointData toObjectByUUIDByKind:objectByUUIDForKind kinds:kindIndexSet]) {
+                    @synchronized (objectByUUIDByKind) {
+                        checkpointMalformed = YES;
+                    }
+                }
+
+                for (NSData *payload in journalPayloads) {
+                    if (![BLMBinaryArchive applyData:payload toObjectByUUIDByKind:objectByUUIDForKind kinds:kindIndexSet]) { // Later records may build on this one, so none of them are applied either
+                        @synchronized (objectByUUIDByKind) {
+                            journalMalformed = YES;
+                        }
+                        break;
+                    }
+                }
+            });
+
+            if (phaseHandler != nil) {
+                phaseHandler(phaseIndex, objectByUUIDByKind);
+            }
+        }];
+
+        if (checkpointMalformed) {
+            [self setAsideMalformedFileAtPath:self.checkpointPath];
+        }
+
+        if (journalMalformed) {
+            [self setAsideMalformedFileAtPath:self.journalPath];
+        }
+    }
+
+    self.restored = YES;
+
+    return objectByUUIDByKind;
+}
+
+
+- (NSData *)readCheckpointData {
+    if (![[NSFileManager defaultManager] fileExistsAtPath:self.checkpointPath]) {
+        return nil;
+    }
+
+    NSError *error = nil;
+    NSDictionary<NSFileAttributeKey, id> *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:self.checkpointPath error:&error];
+
+    if (attributes == nil) {
+        [self lockArchiveForUnreadableCheckpointWithError:error];
+        return nil;
+    }
+
+    if (attributes.fileSize == 0) { // Only a file known to be empty is removed; one that merely failed to read still holds the user's data
+        [[NSFileManager defaultManager] removeItemAtPath:self.checkpointPath error:NULL];
+        return nil;
+    }
+
+    NSData *checkpointData = [NSData dataWithContentsOfFile:self.checkpointPath options:NSDataReadingMappedAlways error:&error];
+
+    if (checkpointData == nil) { // Protected data is unreadable while the device is locked, so the next restore may well succeed
+        [self lockArchiveForUnreadableCheckpointWithError:error];
+    }
+
+    return checkpointData;
+}
+
+
+- (void)lockArchiveForUnreadableCheckpointWithError:(NSError *)error {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:@{ NSFilePathErrorKey:self.checkpointPath, NSLocalizedFailureReasonErrorKey:@"The archive checkpoint could not be read" }];
+    userInfo[NSUnderlyingErrorKey] = error;
+
+    _restoreError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadUnknownError userInfo:userInfo];
+    self.journalLocked = YES;
+}
+
+
+- (NSArray<NSData *> *)readJournalPayloadsWithVersion:(JournalVersion *)version {
+    NSData *journalData = [NSData dataWithContentsOfFile:self.journalPath options:NSDataReadingMappedIfSafe error:NULL];
+    NSMutableArray<NSData *> *payloads = [NSMutableArray array];
+    uint8_t const *bytes = journalData.bytes;
+    unsigned long long validLength = 0;
+
+    *version = JournalVersionUnknown;
+
+    if (journalData.length >= sizeof(JournalFileHeader)) {
+        JournalFileHeader fileHeader;
+        memcpy(&fileHeader, bytes, sizeof(JournalFileHeader));
+
+        if ((fileHeader.Magic == JournalMagic) && ((fileHeader.Version == JournalVersionKeyedArchive) || (fileHeader.Version == JournalVersionBinaryArchive))) {
+            *version = fileHeader.Version;
+            validLength = sizeof(JournalFileHeader);
+        } else { // Written by a newer version, or damaged; truncating it would lose every change since the last checkpoint
+            [self setAsideUnreadableJournal];
+            _journalLength = 0;
+
+            return payloads;
+        }
+    }
+
+    while ((validLength > 0) && ((validLength + sizeof(JournalRecordHeader)) <= journalData.length)) {
+        JournalRecordHeader recordHeader;
+        memcpy(&recordHeader, (bytes + validLength), sizeof(JournalRecordHeader));
+
+        unsigned long long payloadOffset = (validLength + sizeof(JournalRecordHeader));
+
+        if (recordHeader.Length > (journalData.length - payloadOffset)) { // A torn final record is left behind when the app is terminated mid-append
+            break;
+        }
+
+        if ([BLMUtils checksumForBytes:(bytes + payloadOffset) length:recordHeader.Length] != recordHeader.Checksum) { // A complete record that was damaged on disk; the records after it may still be intact
+            if (![self setAsideUnreadableJournalTail:[journalData subdataWithRange:NSMakeRange((NSUInteger)validLength, (NSUInteger)(journalData.length - validLength))]]) {
+                _journalLength = validLength;
+                return payloads;
+            }
+
+            break;
+        }
+
+        [payloads addObject:[journalData subdataWithRange:NSMakeRange((NSUInteger)payloadOffset, recordHeader.Length)]];
+
+        validLength = (payloadOffset + recordHeader.Length);
+    }
+
+    if (validLength < journalData.length) { // Discard everything after the last complete record so the next append starts on a record boundary
+        NSFileHandle *journalFile = [NSFileHandle fileHandleForWritingAtPath:self.journalPath];
+
+        [journalFile truncateFileAtOffset:validLength];
+        [journalFile closeFile];
+    }
+
+    _journalLength = validLength;
+
+    return payloads;
+}
+
+
+- (NSString *)unreadablePathForPath:(NSString *)path {
+    return [[path stringByAppendingPathExtension:[NSString stringWithFormat:@"%llu", (unsigned long long)[NSDate date].timeIntervalSince1970]] stringByAppendingPathExtension:UnreadableFileExtension];
+}
+
+
+- (void)setAsideMalformedFileAtPath:(NSString *)path { // The restored objects may be missing whatever the file held, so nothing is written for the rest of this restore, least of all a checkpoint built from them
+    NSString *unreadablePath = [self unreadablePathForPath:path];
+    NSError *moveError = nil;
+
+    self.journalLocked = YES;
+
+    if (![[NSFileManager defaultManager] moveItemAtPath:path toPath:unreadablePath error:&moveError]) {
+        _restoreError = moveError;
+        return;
+    }
+
+    if ([path isEqualToString:self.journalPath]) {
+        _journalLength = 0;
+    }
+
+    _restoreError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:@{ NSFilePathErrorKey:unreadablePath, NSLocalizedFailureReasonErrorKey:@"The archive holds a record that could not be decoded" }];
+}
+
+
+- (BOOL)setAsideUnreadableJournalTail:(NSData *)tailData { // NO if the tail couldn't be saved, in which case the journal is locked rather than truncated
+    NSString *unreadablePath = [self unreadablePathForPath:self.journalPath];
+    NSError *writeError = nil;
+
+    if (![tailData writeToFile:unreadablePath options:(NSDataWritingAtomic | NSDataWritingFileProtectionNone) error:&writeError]) {
+        _restoreError = writeError;
+        self.journalLocked = YES;
+        return NO;
+    }
+
+    _restoreError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:@{ NSFilePathErrorKey:unreadablePath, NSLocalizedFailureReasonErrorKey:@"The archive journal holds a record whose checksum doesn't match; it and every record after it were moved aside" }];
+
+    return YES;
+}
+
+
+- (void)setAsideUnreadableJournal {
+    NSString *unreadablePath = [self unreadablePathForPath:self.journalPath];
+    NSError *moveError = nil;
+
+    if (![[NSFileManager defaultManager] moveItemAtPath:self.journalPath toPath:unreadablePath error:&moveError]) {
+        _restoreError = moveError;
+        self.journalLocked = YES;
+        return;
+    }
+
+    _restoreError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:@{ NSFilePathErrorKey:unreadablePath, NSLocalizedFailureReasonErrorKey:@"The archive journal has an unrecognized header" }];
+}
+
+
+- (NSString *)decodeSupersededCheckpointData:(NSData *)checkpointData journalPayloads:(NSArray<NSData *> *)journalPayloads journalVersion:(JournalVersion)journalVersion intoObjectByUUIDByKind:(NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)objectByUUIDByKind { // The path of the first file that couldn't be decoded, if any
+    if ([BLMBinaryArchive isBinaryArchiveData:checkpointData]) {
+        if (![BLMBinaryArchive applyData:checkpointData toObjectByUUIDByKind:objectByUUIDByKind]) {
+            return self.checkpointPath;
+        }
+    } else if (checkpointData.length > 0) {
+        NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:checkpointData];
+
+        switch ((ArchiveVersion)[unarchiver decodeIntegerForKey:ArchiveVersionKey]) {
+            case ArchiveVersionUnknown:
+                [unarchiver finishDecoding];
+                return self.checkpointPath;
+
+            case ArchiveVersionLatest: {
+                for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+                    NSDictionary *objectByUUID = [unarchiver decodeObjectForKey:CheckpointKeyForKind(kind)];
+
+                    if (objectByUUID != nil) {
+                        [objectByUUIDByKind[@(kind)] addEntriesFromDictionary:objectByUUID];
+                    }
+                }
+                break;
+            }
+        }
+
+        [unarchiver finishDecoding];
+    }
+
+    for (NSData *payload in journalPayloads) {
+        switch (journalVersion) {
+            case JournalVersionUnknown:
+                assert(NO);
+                return self.journalPath;
+
+            case JournalVersionKeyedArchive: {
+                NSArray<BLMArchiveMutation *> *mutations = [NSKeyedUnarchiver unarchiveObjectWithData:payload];
+
+                if (![mutations isKindOfClass:[NSArray class]]) {
+                    return self.journalPath;
+                }
+
+                for (BLMArchiveMutation *mutation in mutations) {
+                    if (mutation.object != nil) {
+                        objectByUUIDByKind[@(mutation.kind)][mutation.UUID] = mutation.object;
+                    } else {
+                        [objectByUUIDByKind[@(mutation.kind)] removeObjectForKey:mutation.UUID];
+                    }
+                }
+                break;
+            }
+
+            case JournalVersionBinaryArchive: {
+                if (![BLMBinaryArchive applyData:payload toObjectByUUIDByKind:objectByUUIDByKind]) {
+                    return self.journalPath;
+                }
+                break;
+            }
+        }
+    }
+
+    return nil;
+}
+
+#pragma mark Writing
+
+- (BOOL)appendMutations:(NSArray<BLMArchiveMutation *> *)mutations {
+    if (mutations.count == 0) {
+        return YES;
+    }
+
+    if (!self.isRestored) { // Appending to an archive that was never restored; restoring finds the end of its last complete record and migrates it if needed
+        [self restoreObjectByUUIDByKind];
+    }
+
+    if (self.isJournalLocked) {
+        return NO;
+    }
+
+    if (![self createArchiveDirectoryIfNeeded]) {
+        return NO;
+    }
+
+    if (![[NSFileManager defaultManager] fileExistsAtPath:self.journalPath]
+        && ![[NSFileManager defaultManager] createFileAtPath:self.journalPath contents:nil attributes:@{ NSFileProtectionKey : NSFileProtectionNone }]) {
+        assert(NO);
+        return NO;
+    }
+
+    NSMutableData *recordData = [NSMutableData data];
+
+    if (self.journalLength == 0) {
+        JournalFileHeader fileHeader = { .Magic = JournalMagic, .Version = JournalVersionLatest };
+        [recordData appendBytes:&fileHeader length:sizeof(JournalFileHeader)];
+    }
+
+    NSData *payload = [BLMBinaryArchive dataWithMutations:mutations]; // All mutations in a batch share one record, so a torn write discards the whole batch rather than part of it
+    JournalRecordHeader recordHeader = { .Length = (uint32_t)payload.length, .Checksum = [BLMUtils checksumForBytes:payload.bytes length:payload.length] };
+
+    [recordData appendBytes:&recordHeader length:sizeof(JournalRecordHeader)];
+    [recordData appendData:payload];
+
+    NSFileHandle *journalFile = [NSFileHandle fileHandleForWritingAtPath:self.journalPath];
+
+    [journalFile truncateFileAtOffset:self.journalLength]; // Also positions the file pointer at the end of the last complete record
+    [journalFile writeData:recordData];
+    [journalFile closeFile];
+
+    _journalLength += recordData.length;
+
+    return YES;
+}
+
+
+- (BOOL)compact {
+
+    NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [self restoreObjectByUUIDByKind]; // Rebuilt from disk so compaction never needs a snapshot from the main thread
+
+    if (self.isJournalLocked || ![self writeCheckpointWithObjectByUUIDByKind:objectByUUIDByKind]) {
+        return NO;
+    }
+
+    [self truncateJournal]; // Replaying a mutation onto a checkpoint that already contains it is a no-op, so terminating before this truncation is harmless
+
+    return YES;
+}
+
+
+- (void)truncateJournal {
+    NSFileHandle *journalFile = [NSFileHandle fileHandleForWritingAtPath:self.journalPath];
+
+    [journalFile truncateFileAtOffset:0];
+    [journalFile closeFile];
+
+    _journalLength = 0;
+}
+
+
+- (void)discard {
+    [[NSFileManager defaultManager] removeItemAtPath:self.checkpointPath error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:self.journalPath error:NULL];
+
+    _journalLength = 0;
+    self.restored = YES; // Nothing left on disk to recover
+}
+
+
+- (BOOL)writeCheckpointWithObjectByUUIDByKind:(NSDictionary<NSNumber *, NSDictionary<NSUUID *, id> *> *)objectByUUIDByKind {
+    if (![self createArchiveDirectoryIfNeeded]) {
+        return NO;
+    }
+
+    NSData *checkpointData = [BLMBinaryArchive dataWithObjectByUUIDByKind:objectByUUIDByKind];
+
+    if (![checkpointData writeToFile:self.checkpointPath options:(NSDataWritingAtomic | NSDataWritingFileProtectionNone) error:NULL]) {
+        assert(NO);
+        return NO;
+    }
+
+    return YES;
+}
+
+
+- (BOOL)createArchiveDirectoryIfNeeded {
+    BOOL isDirectory = NO;
+
+    if (![[NSFileManager defaultManager] fileExistsAtPath:self.directory isDirectory:&isDirectory]) {
+        if ([[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:NULL]) {
+            isDirectory = YES;
+        } else {
+            assert(NO);
+            return NO;
+        }
+    }
+
+    if (!isDirectory) {
+        assert(NO);
+        return NO;
+    }
+
+    return YES;
+}
+
+@end
@@ -0,0 +1,62 @@
+//
+//  BLMArchiveScheduler.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/3/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMArchiveJournal.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+extern NSTimeInterval const BLMArchiveSchedulerDefaultLatencyWindow;
+
+
+@class BLMArchiveScheduler;
+
+
+@protocol BLMArchiveSchedulerDataSource <NSObject>
+
+- (nullable id<NSCoding>)archiveScheduler:(BLMArchiveScheduler *)scheduler objectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // nil if the entity has been deleted
+- (nullable BLMArchiveJournal *)archiveScheduler:(BLMArchiveScheduler *)scheduler journalForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // nil drops the change
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Tracks which entities have changed since the last write and coalesces every change made within the
+ ` latency window into a single record per journal. The current value of each dirty entity, and the
+ ` journal it belongs in, are read from the data source at flush time, so an entity edited many times in
+ ` a burst is only encoded once. Records for other journals are written before the primary journal's.
+ ` Changes whose journal can't be written are marked dirty again, so they go out with the next flush.
+ `
+ ` All messages must be sent from the main thread.
+ */
+
+@interface BLMArchiveScheduler : NSObject
+
+@property (nonatomic, assign) NSTimeInterval latencyWindow;
+@property (nonatomic, assign, readonly) BOOL hasPendingChanges;
+
+@property (nonatomic, assign, readonly) NSUInteger markCount; // Number of times an entity was marked dirty
+@property (nonatomic, assign, readonly) NSUInteger writeCount; // Number of flushes that wrote at least one record
+@property (nonatomic, assign, readonly) NSUInteger coalescedWriteCount; // Number of marks that were folded into a write triggered by another mark
+
+- (instancetype)initWithPrimaryJournal:(BLMArchiveJournal *)primaryJournal queue:(NSOperationQueue *)queue dataSource:(id<BLMArchiveSchedulerDataSource>)dataSource;
+
+- (void)markDirtyUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind;
+- (void)discardJournal:(BLMArchiveJournal *)journal; // Deletes the journal's files on the next flush, after any changes already routed to it
+- (BOOL)isDirtyUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // YES until a write of the entity's current value succeeds; an entity that is dirty must not be unloaded
+- (void)flushWithCompletion:(nullable void(^)(NSError *__nullable error))completion; // Writes pending changes immediately; completion runs on the main thread once every previously scheduled write has finished, with the error of the first journal that couldn't be written; that journal's changes stay pending
+
+@end
+
+
+NS_ASSUME_NONNULL_END
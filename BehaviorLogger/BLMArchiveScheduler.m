@@ -0,0 +1,197 @@
+//
+//  BLMArchiveScheduler.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/3/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMArchiveScheduler.h"
+
+
+#pragma mark Constants
+
+NSTimeInterval const BLMArchiveSchedulerDefaultLatencyWindow = 0.5;
+
+
+#pragma mark
+
+@interface BLMArchiveScheduler ()
+
+@property (nonatomic, strong, readonly) BLMArchiveJournal *primaryJournal; // Only accessed from queue
+@property (nonatomic, strong, readonly) NSOperationQueue *queue;
+@property (nonatomic, weak, readonly) id<BLMArchiveSchedulerDataSource> dataSource;
+@property (nonatomic, copy, readonly) NSArray<NSMutableSet<NSUUID *> *> *dirtyUUIDsByKind;
+@property (nonatomic, strong, readonly) NSMutableArray<BLMArchiveJournal *> *discardedJournals;
+@property (nonatomic, assign) NSUInteger pendingMarkCount;
+@property (nonatomic, assign) NSUInteger flushGeneration;
+@property (nonatomic, assign, getter=isFlushScheduled) BOOL flushScheduled;
+
+@end
+
+
+@implementation BLMArchiveScheduler
+
+- (instancetype)initWithPrimaryJournal:(BLMArchiveJournal *)primaryJournal queue:(NSOperationQueue *)queue dataSource:(id<BLMArchiveSchedulerDataSource>)dataSource {
+    assert(queue.maxConcurrentOperationCount == 1);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    NSMutableArray *dirtyUUIDsByKind = [NSMutableArray array];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        [dirtyUUIDsByKind addObject:[NSMutableSet set]];
+    }
+
+    _primaryJournal = primaryJournal;
+    _queue = queue;
+    _dataSource = dataSource;
+    _dirtyUUIDsByKind = dirtyUUIDsByKind;
+    _discardedJournals = [NSMutableArray array];
+    _latencyWindow = BLMArchiveSchedulerDefaultLatencyWindow;
+
+    return self;
+}
+
+
+- (BOOL)hasPendingChanges {
+    assert([NSThread isMainThread]);
+    return (self.pendingMarkCount > 0);
+}
+
+
+- (void)markDirtyUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    assert((kind >= 0) && (kind < BLMArchiveEntityKindCount));
+
+    [self.dirtyUUIDsByKind[kind] addObject:UUID];
+
+    self.pendingMarkCount += 1;
+    _markCount += 1;
+
+    if (self.isFlushScheduled) {
+        return;
+    }
+
+    self.flushScheduled = YES;
+
+    NSUInteger flushGeneration = self.flushGeneration;
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.latencyWindow * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if (flushGeneration == self.flushGeneration) { // Otherwise an explicit flush already wrote these changes
+            [self flushWithCompletion:nil];
+        }
+    });
+}
+
+
+- (BOOL)isDirtyUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    return [self.dirtyUUIDsByKind[kind] containsObject:UUID];
+}
+
+
+- (void)discardJournal:(BLMArchiveJournal *)journal {
+    assert([NSThread isMainThread]);
+    assert(journal != self.primaryJournal);
+
+    [self.discardedJournals addObject:journal];
+
+    if (!self.isFlushScheduled) {
+        [self flushWithCompletion:nil];
+    }
+}
+
+
+- (void)flushWithCompletion:(void(^)(NSError *error))completion {
+    assert([NSThread isMainThread]);
+
+    NSMapTable<BLMArchiveJournal *, NSMutableArray<BLMArchiveMutation *> *> *mutationsByJournal = [NSMapTable strongToStrongObjectsMapTable];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (NSUUID *UUID in self.dirtyUUIDsByKind[kind]) {
+            BLMArchiveJournal *journal = [self.dataSource archiveScheduler:self journalForUUID:UUID kind:kind];
+
+            if (journal == nil) {
+                continue;
+            }
+
+            NSMutableArray<BLMArchiveMutation *> *mutations = [mutationsByJournal objectForKey:journal];
+
+            if (mutations == nil) {
+                mutations = [NSMutableArray array];
+                [mutationsByJournal setObject:mutations forKey:journal];
+            }
+
+            id<NSCoding> object = [self.dataSource archiveScheduler:self objectForUUID:UUID kind:kind];
+            [mutations addObject:[[BLMArchiveMutation alloc] initWithKind:kind UUID:UUID object:object]];
+        }
+
+        [self.dirtyUUIDsByKind[kind] removeAllObjects];
+    }
+
+    if (self.pendingMarkCount > 0) {
+        _writeCount += 1;
+        _coalescedWriteCount += (self.pendingMarkCount - 1);
+    }
+
+    NSArray<BLMArchiveJournal *> *discardedJournals = [self.discardedJournals copy];
+    [self.discardedJournals removeAllObjects];
+
+    self.pendingMarkCount = 0;
+    self.flushGeneration += 1;
+    self.flushScheduled = NO;
+
+    [self.queue addOperationWithBlock:^{ // Enqueued even when nothing is dirty so the completion still waits for writes already in flight
+        NSArray<BLMArchiveMutation *> *primaryMutations = [mutationsByJournal objectForKey:self.primaryJournal];
+        NSMutableArray<BLMArchiveMutation *> *failedMutations = [NSMutableArray array];
+        __block NSError *error = nil;
+
+        void (^appendMutations)(BLMArchiveJournal *, NSArray<BLMArchiveMutation *> *) = ^(BLMArchiveJournal *journal, NSArray<BLMArchiveMutation *> *mutations) {
+            if (![journal appendMutations:mutations]) {
+                [failedMutations addObjectsFromArray:mutations];
+
+                if (error == nil) {
+                    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:@{ NSFilePathErrorKey:journal.journalPath }];
+                    userInfo[NSUnderlyingErrorKey] = journal.restoreError;
+
+                    error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:userInfo];
+                }
+            } else if (journal.needsCompaction) {
+                [journal compact]; // The records are already on disk, so a compaction that fails loses nothing
+            }
+        };
+
+        [mutationsByJournal removeObjectForKey:self.primaryJournal];
+
+        for (BLMArchiveJournal *journal in mutationsByJournal) { // The primary journal is written last so that anything it references is already on disk
+            appendMutations(journal, [mutationsByJournal objectForKey:journal]);
+        }
+
+        if (primaryMutations.count > 0) {
+            appendMutations(self.primaryJournal, primaryMutations);
+        }
+
+        for (BLMArchiveJournal *journal in discardedJournals) {
+            [journal discard];
+        }
+
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{ // Failed changes are dirty again before the completion runs, so it never sees them as written
+            for (BLMArchiveMutation *mutation in failedMutations) {
+                [self.dirtyUUIDsByKind[mutation.kind] addObject:mutation.UUID];
+            }
+
+            self.pendingMarkCount += failedMutations.count;
+
+            if (completion != nil) {
+                completion(error);
+            }
+        }];
+    }];
+}
+
+@end
@@ -35,9 +35,12 @@ typedef NS_ENUM(NSInteger, BLMBehaviorProperty) {
 @property (nonatomic, strong, readonly) NSUUID *UUID;
 @property (nonatomic, copy, readonly) NSString *name;
 @property (nonatomic, assign, readonly, getter=isContinuous) BOOL continuous;
+@property (nonatomic, assign, readonly) NSUInteger referenceCount; // Archived session configurations using the behavior, whether or not their shard is loaded; NSNotFound if archived before counts were kept, until the next restore computes it
 
-- (instancetype)initWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous;
+- (instancetype)initWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous; // Unreferenced
+- (instancetype)initWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous referenceCount:(NSUInteger)referenceCount;
 - (instancetype)copyWithUpdatedValuesByProperty:(NSDictionary<NSNumber *, id> *)valuesByProperty;
+- (instancetype)copyWithReferenceCount:(NSUInteger)referenceCount;
 
 @end
 
@@ -36,6 +36,11 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 @implementation BLMBehavior
 
 - (instancetype)initWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous {
+    return [self initWithUUID:UUID name:name continuous:continuous referenceCount:0];
+}
+
+
+- (instancetype)initWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous referenceCount:(NSUInteger)referenceCount {
     self = [super init];
 
     if (self == nil) {
@@ -45,6 +50,7 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
     _UUID = UUID;
     _name = [name copy];
     _continuous = continuous;
+    _referenceCount = referenceCount;
 
     return self;
 }
@@ -53,7 +59,13 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 - (instancetype)copyWithUpdatedValuesByProperty:(NSDictionary<NSNumber *, id> *)valuesByProperty {
     return [[BLMBehavior alloc] initWithUUID:self.UUID
                                         name:[BLMUtils objectFromDictionary:valuesByProperty forKey:@(BLMBehaviorPropertyName) nullValue:nil defaultValue:self.name]
-                                  continuous:[BLMUtils boolFromDictionary:valuesByProperty forKey:@(BLMBehaviorPropertyContinuous) defaultValue:self.isContinuous]];
+                                  continuous:[BLMUtils boolFromDictionary:valuesByProperty forKey:@(BLMBehaviorPropertyContinuous) defaultValue:self.isContinuous]
+                              referenceCount:self.referenceCount];
+}
+
+
+- (instancetype)copyWithReferenceCount:(NSUInteger)referenceCount {
+    return [[BLMBehavior alloc] initWithUUID:self.UUID name:self.name continuous:self.isContinuous referenceCount:referenceCount];
 }
 
 #pragma mark NSCoding
@@ -61,7 +73,8 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 - (nullable instancetype)initWithCoder:(NSCoder *)decoder {
     return [self initWithUUID:[decoder decodeObjectForKey:@"UUID"]
                          name:[decoder decodeObjectForKey:@"name"]
-                   continuous:[decoder decodeBoolForKey:@"continuous"]];
+                   continuous:[decoder decodeBoolForKey:@"continuous"]
+               referenceCount:([decoder containsValueForKey:@"referenceCount"] ? (NSUInteger)[decoder decodeIntegerForKey:@"referenceCount"] : NSNotFound)];
 }
 
 
@@ -69,6 +82,7 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
     [coder encodeObject:self.UUID forKey:@"UUID"];
     [coder encodeObject:self.name forKey:@"name"];
     [coder encodeBool:self.isContinuous forKey:@"continuous"];
+    [coder encodeInteger:(NSInteger)self.referenceCount forKey:@"referenceCount"];
     [coder encodeInteger:ArchiveVersionLatest forKey:ArchiveVersionKey];
 }
 
@@ -88,7 +102,7 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 
     return ([BLMUtils isObject:self.UUID equalToObject:other.UUID]
             && [BLMUtils isString:self.name equalToString:other.name]
-            && (self.isContinuous == other.isContinuous));
+            && (self.isContinuous == other.isContinuous)); // The reference count is bookkeeping that changes without observers being told, so it isn't compared
 }
 
 @end
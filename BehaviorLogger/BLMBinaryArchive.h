@@ -0,0 +1,52 @@
+//
+//  BLMBinaryArchive.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/5/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMArchiveJournal.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/*
+ ` ### Binary Archive Layout
+ `
+ ` *------------------------------* <- Header: magic, version, and the offset/count of every table below
+ ` |            Header            |
+ ` *------------------------------*
+ ` |     String Table Entries     | <- (offset, length) into the string data; every distinct string is stored once
+ ` |         String Data          | <- UTF-8 bytes
+ ` *------------------------------*
+ ` |          UUID Table          | <- 16-byte UUIDs referenced by the (index, count) lists in records
+ ` *------------------------------*
+ ` |       Deletion Records       | <- (UUID, kind) for mutations that delete an entity
+ ` *------------------------------*
+ ` |   Fixed-Layout Record Table  | <- One table per BLMArchiveEntityKind
+ ` |             ...              |
+ ` *------------------------------*
+ `
+ ` Every table starts on an 8-byte boundary and all integers are little-endian, so the file can be read in
+ ` place from a memory-mapped NSData. Only Foundation and the model classes are required, so archives can
+ ` be decoded outside the app.
+ */
+
+@interface BLMBinaryArchive : NSObject
+
++ (BOOL)isBinaryArchiveData:(NSData *)data;
+
++ (NSData *)dataWithObjectByUUIDByKind:(NSDictionary<NSNumber *, NSDictionary<NSUUID *, id> *> *)objectByUUIDByKind;
++ (NSData *)dataWithMutations:(NSArray<BLMArchiveMutation *> *)mutations;
+
++ (BOOL)applyData:(NSData *)data toObjectByUUIDByKind:(NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)objectByUUIDByKind; // Inserts or replaces every encoded object and removes every deleted one; NO if the data is malformed, in which case nothing is changed
++ (BOOL)applyData:(NSData *)data toObjectByUUIDByKind:(NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)objectByUUIDByKind kinds:(NSIndexSet *)kinds; // Only touches the dictionaries for the given kinds, so different kinds can be applied concurrently
+
+@end
+
+
+NS_ASSUME_NONNULL_END
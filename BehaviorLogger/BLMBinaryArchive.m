@@ -0,0 +1,628 @@
+//
+//  BLMBinaryArchive.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/5/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMBehavior.h"
+#import "BLMBinaryArchive.h"
+#import "BLMProject.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+
+#import <uuid/uuid.h>
+
+
+#pragma mark Constants
+
+static uint32_t const BinaryArchiveMagic = 0x424D4C42; // "BLMB"
+static uint32_t const BinaryArchiveNilIndex = UINT32_MAX;
+static uint32_t const BinaryArchiveUntrackedCount = UINT32_MAX;
+
+
+typedef NS_ENUM(uint32_t, BinaryArchiveVersion) {
+    BinaryArchiveVersionUnknown,
+    BinaryArchiveVersionInitial,
+    BinaryArchiveVersionBehaviorReferenceCounts, // Behavior records end with their reference count
+    BinaryArchiveVersionLatest = BinaryArchiveVersionBehaviorReferenceCounts
+};
+
+
+typedef struct BinaryArchiveHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t StringCount;
+    uint32_t StringTableOffset;
+    uint32_t StringDataOffset;
+    uint32_t StringDataLength;
+    uint32_t UUIDCount;
+    uint32_t UUIDTableOffset;
+    uint32_t DeletionCount;
+    uint32_t DeletionTableOffset;
+    uint32_t RecordCount[BLMArchiveEntityKindCount];
+    uint32_t RecordTableOffset[BLMArchiveEntityKindCount];
+} BinaryArchiveHeader;
+
+
+typedef struct BinaryStringEntry {
+    uint32_t Offset; // Relative to StringDataOffset
+    uint32_t Length;
+} BinaryStringEntry;
+
+
+typedef struct BinaryUUIDList {
+    uint32_t Index; // Into the UUID table, or BinaryArchiveNilIndex for a nil list
+    uint32_t Count;
+} BinaryUUIDList;
+
+
+typedef struct BinaryDeletionRecord {
+    uuid_t UUID;
+    uint32_t Kind;
+    uint32_t Reserved;
+} BinaryDeletionRecord;
+
+
+typedef struct BinaryProjectRecord {
+    uuid_t UUID;
+    uuid_t SessionConfigurationUUID;
+    uint32_t Name; // String indexes are BinaryArchiveNilIndex for nil
+    uint32_t Client;
+    BinaryUUIDList SessionUUIDs;
+} BinaryProjectRecord;
+
+
+typedef struct BinaryBehaviorRecord {
+    uuid_t UUID;
+    uint32_t Name;
+    uint32_t Continuous;
+    uint32_t ReferenceCount; // BinaryArchiveUntrackedCount for behaviors archived before counts were kept
+} BinaryBehaviorRecord;
+
+
+typedef struct BinarySessionRecord {
+    uuid_t UUID;
+    uuid_t ConfigurationUUID;
+    double CreationDate; // Seconds since the reference date, NAN for nil
+    double StartDate;
+    double EndDate;
+    uint32_t Name;
+    uint32_t Reserved;
+} BinarySessionRecord;
+
+
+typedef struct BinarySessionConfigurationRecord {
+    uuid_t UUID;
+    int64_t TimeLimit;
+    int64_t TimeLimitOptions;
+    uint32_t Condition;
+    uint32_t Location;
+    uint32_t Therapist;
+    uint32_t Observer;
+    BinaryUUIDList BehaviorUUIDs;
+} BinarySessionConfigurationRecord;
+
+
+static size_t RecordSizeForKind(BLMArchiveEntityKind kind, BinaryArchiveVersion version) {
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            return sizeof(BinaryProjectRecord);
+
+        case BLMArchiveEntityKindBehavior:
+            return ((version == BinaryArchiveVersionInitial) ? offsetof(BinaryBehaviorRecord, ReferenceCount) : sizeof(BinaryBehaviorRecord));
+
+        case BLMArchiveEntityKindSession:
+            return sizeof(BinarySessionRecord);
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            return sizeof(BinarySessionConfigurationRecord);
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            return 0;
+        }
+    }
+}
+
+
+static inline BOOL IsTableInBounds(uint32_t offset, uint32_t count, size_t elementSize, NSUInteger length) {
+    return (((uint64_t)offset + ((uint64_t)count * elementSize)) <= length);
+}
+
+
+static inline void AppendAlignmentPadding(NSMutableData *data) {
+    [data increaseLengthBy:((8 - (data.length % 8)) % 8)];
+}
+
+
+static inline double TimeIntervalForDate(NSDate *date) {
+    return ((date == nil) ? NAN : date.timeIntervalSinceReferenceDate);
+}
+
+
+static inline NSDate *DateForTimeInterval(double timeInterval) {
+    return (isnan(timeInterval) ? nil : [NSDate dateWithTimeIntervalSinceReferenceDate:timeInterval]);
+}
+
+
+#pragma mark
+
+@interface BinaryArchiveWriter : NSObject
+
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSString *, NSNumber *> *stringIndexByString;
+@property (nonatomic, strong, readonly) NSMutableData *stringTableData;
+@property (nonatomic, strong, readonly) NSMutableData *stringData;
+@property (nonatomic, strong, readonly) NSMutableData *UUIDTableData;
+@property (nonatomic, strong, readonly) NSMutableData *deletionTableData;
+@property (nonatomic, copy, readonly) NSArray<NSMutableData *> *recordTableDataByKind;
+
+@end
+
+
+@implementation BinaryArchiveWriter
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    NSMutableArray *recordTableDataByKind = [NSMutableArray array];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        [recordTableDataByKind addObject:[NSMutableData data]];
+    }
+
+    _stringIndexByString = [NSMutableDictionary dictionary];
+    _stringTableData = [NSMutableData data];
+    _stringData = [NSMutableData data];
+    _UUIDTableData = [NSMutableData data];
+    _deletionTableData = [NSMutableData data];
+    _recordTableDataByKind = recordTableDataByKind;
+
+    return self;
+}
+
+
+- (uint32_t)indexForString:(NSString *)string {
+    if (string == nil) {
+        return BinaryArchiveNilIndex;
+    }
+
+    NSNumber *index = self.stringIndexByString[string];
+
+    if (index == nil) {
+        NSData *bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+        BinaryStringEntry entry = { .Offset = (uint32_t)self.stringData.length, .Length = (uint32_t)bytes.length };
+
+        index = @(self.stringIndexByString.count);
+        self.stringIndexByString[string] = index;
+
+        [self.stringTableData appendBytes:&entry length:sizeof(BinaryStringEntry)];
+        [self.stringData appendData:bytes];
+    }
+
+    return index.unsignedIntValue;
+}
+
+
+- (BinaryUUIDList)listForUUIDs:(NSOrderedSet<NSUUID *> *)UUIDs {
+    if (UUIDs == nil) {
+        return (BinaryUUIDList){ .Index = BinaryArchiveNilIndex, .Count = 0 };
+    }
+
+    BinaryUUIDList list = { .Index = (uint32_t)(self.UUIDTableData.length / sizeof(uuid_t)), .Count = (uint32_t)UUIDs.count };
+
+    for (NSUUID *UUID in UUIDs) {
+        uuid_t bytes;
+        [UUID getUUIDBytes:bytes];
+        [self.UUIDTableData appendBytes:bytes length:sizeof(uuid_t)];
+    }
+
+    return list;
+}
+
+
+- (void)addDeletionOfUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    BinaryDeletionRecord record;
+    memset(&record, 0, sizeof(BinaryDeletionRecord));
+
+    [UUID getUUIDBytes:record.UUID];
+    record.Kind = (uint32_t)kind;
+
+    [self.deletionTableData appendBytes:&record length:sizeof(BinaryDeletionRecord)];
+}
+
+
+- (void)addObject:(id)object kind:(BLMArchiveEntityKind)kind {
+    NSMutableData *recordTableData = self.recordTableDataByKind[kind];
+
+    switch (kind) {
+        case BLMArchiveEntityKindProject: {
+            BLMProject *project = object;
+            BinaryProjectRecord record;
+            memset(&record, 0, sizeof(BinaryProjectRecord));
+
+            [project.UUID getUUIDBytes:record.UUID];
+            [project.sessionConfigurationUUID getUUIDBytes:record.SessionConfigurationUUID];
+            record.Name = [self indexForString:project.name];
+            record.Client = [self indexForString:project.client];
+            record.SessionUUIDs = [self listForUUIDs:project.sessionUUIDs];
+
+            [recordTableData appendBytes:&record length:sizeof(BinaryProjectRecord)];
+            break;
+        }
+
+        case BLMArchiveEntityKindBehavior: {
+            BLMBehavior *behavior = object;
+            BinaryBehaviorRecord record;
+            memset(&record, 0, sizeof(BinaryBehaviorRecord));
+
+            [behavior.UUID getUUIDBytes:record.UUID];
+            record.Name = [self indexForString:behavior.name];
+            record.Continuous = (behavior.isContinuous ? 1 : 0);
+            record.ReferenceCount = ((behavior.referenceCount == NSNotFound) ? BinaryArchiveUntrackedCount : (uint32_t)behavior.referenceCount);
+
+            [recordTableData appendBytes:&record length:sizeof(BinaryBehaviorRecord)];
+            break;
+        }
+
+        case BLMArchiveEntityKindSession: {
+            BLMSession *session = object;
+            BinarySessionRecord record;
+            memset(&record, 0, sizeof(BinarySessionRecord));
+
+            [session.UUID getUUIDBytes:record.UUID];
+            [session.configurationUUID getUUIDBytes:record.ConfigurationUUID];
+            record.CreationDate = TimeIntervalForDate(session.creationDate);
+            record.StartDate = TimeIntervalForDate(session.startDate);
+            record.EndDate = TimeIntervalForDate(session.endDate);
+            record.Name = [self indexForString:session.name];
+
+            [recordTableData appendBytes:&record length:sizeof(BinarySessionRecord)];
+            break;
+        }
+
+        case BLMArchiveEntityKindSessionConfiguration: {
+            BLMSessionConfiguration *sessionConfiguration = object;
+            BinarySessionConfigurationRecord record;
+            memset(&record, 0, sizeof(BinarySessionConfigurationRecord));
+
+            [sessionConfiguration.UUID getUUIDBytes:record.UUID];
+            record.TimeLimit = sessionConfiguration.timeLimit;
+            record.TimeLimitOptions = sessionConfiguration.timeLimitOptions;
+            record.Condition = [self indexForString:sessionConfiguration.condition];
+            record.Location = [self indexForString:sessionConfiguration.location];
+            record.Therapist = [self indexForString:sessionConfiguration.therapist];
+            record.Observer = [self indexForString:sessionConfiguration.observer];
+            record.BehaviorUUIDs = [self listForUUIDs:sessionConfiguration.behaviorUUIDs];
+
+            [recordTableData appendBytes:&record length:sizeof(BinarySessionConfigurationRecord)];
+            break;
+        }
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+
+- (NSData *)data {
+    BinaryArchiveHeader header;
+    memset(&header, 0, sizeof(BinaryArchiveHeader));
+
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(BinaryArchiveHeader)];
+    AppendAlignmentPadding(data);
+
+    header.Magic = BinaryArchiveMagic;
+    header.Version = BinaryArchiveVersionLatest;
+
+    header.StringCount = (uint32_t)self.stringIndexByString.count;
+    header.StringTableOffset = (uint32_t)data.length;
+    [data appendData:self.stringTableData];
+    AppendAlignmentPadding(data);
+
+    header.StringDataOffset = (uint32_t)data.length;
+    header.StringDataLength = (uint32_t)self.stringData.length;
+    [data appendData:self.stringData];
+    AppendAlignmentPadding(data);
+
+    header.UUIDCount = (uint32_t)(self.UUIDTableData.length / sizeof(uuid_t));
+    header.UUIDTableOffset = (uint32_t)data.length;
+    [data appendData:self.UUIDTableData];
+    AppendAlignmentPadding(data);
+
+    header.DeletionCount = (uint32_t)(self.deletionTableData.length / sizeof(BinaryDeletionRecord));
+    header.DeletionTableOffset = (uint32_t)data.length;
+    [data appendData:self.deletionTableData];
+    AppendAlignmentPadding(data);
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        NSData *recordTableData = self.recordTableDataByKind[kind];
+
+        header.RecordCount[kind] = (uint32_t)(recordTableData.length / RecordSizeForKind(kind, BinaryArchiveVersionLatest));
+        header.RecordTableOffset[kind] = (uint32_t)data.length;
+        [data appendData:recordTableData];
+        AppendAlignmentPadding(data);
+    }
+
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(BinaryArchiveHeader)) withBytes:&header];
+
+    return data;
+}
+
+@end
+
+
+#pragma mark
+
+@implementation BLMBinaryArchive
+
++ (BOOL)isBinaryArchiveData:(NSData *)data {
+    if (data.length < sizeof(BinaryArchiveHeader)) {
+        return NO;
+    }
+
+    uint32_t magic = 0;
+    memcpy(&magic, data.bytes, sizeof(uint32_t));
+
+    return (magic == BinaryArchiveMagic);
+}
+
+
++ (NSData *)dataWithObjectByUUIDByKind:(NSDictionary<NSNumber *, NSDictionary<NSUUID *, id> *> *)objectByUUIDByKind {
+    assert(NSHostByteOrder() == NS_LittleEndian);
+
+    BinaryArchiveWriter *writer = [[BinaryArchiveWriter alloc] init];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (id object in objectByUUIDByKind[@(kind)].objectEnumerator) {
+            [writer addObject:object kind:kind];
+        }
+    }
+
+    return writer.data;
+}
+
+
++ (NSData *)dataWithMutations:(NSArray<BLMArchiveMutation *> *)mutations {
+    assert(NSHostByteOrder() == NS_LittleEndian);
+
+    BinaryArchiveWriter *writer = [[BinaryArchiveWriter alloc] init];
+
+    for (BLMArchiveMutation *mutation in mutations) {
+        if (mutation.object == nil) {
+            [writer addDeletionOfUUID:mutation.UUID kind:mutation.kind];
+        } else {
+            [writer addObject:mutation.object kind:mutation.kind];
+        }
+    }
+
+    return writer.data;
+}
+
+
++ (BOOL)applyData:(NSData *)data toObjectByUUIDByKind:(NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)objectByUUIDByKind {
+    return [self applyData:data toObjectByUUIDByKind:objectByUUIDByKind kinds:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, BLMArchiveEntityKindCount)]];
+}
+
+
++ (BOOL)applyData:(NSData *)data toObjectByUUIDByKind:(NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)objectByUUIDByKind kinds:(NSIndexSet *)kinds {
+    assert(NSHostByteOrder() == NS_LittleEndian);
+
+    if (![self isBinaryArchiveData:data]) {
+        return NO;
+    }
+
+    uint8_t const *bytes = data.bytes;
+    BinaryArchiveHeader header;
+    memcpy(&header, bytes, sizeof(BinaryArchiveHeader));
+
+    if (header.Version > BinaryArchiveVersionLatest) { // Written by a newer build, whose records this one can't size
+        return NO;
+    }
+
+    switch ((BinaryArchiveVersion)header.Version) {
+        case BinaryArchiveVersionUnknown:
+            return NO;
+
+        case BinaryArchiveVersionInitial:
+        case BinaryArchiveVersionBehaviorReferenceCounts:
+            break;
+    }
+
+    if (!IsTableInBounds(header.StringTableOffset, header.StringCount, sizeof(BinaryStringEntry), data.length)
+        || !IsTableInBounds(header.StringDataOffset, header.StringDataLength, sizeof(uint8_t), data.length)
+        || !IsTableInBounds(header.UUIDTableOffset, header.UUIDCount, sizeof(uuid_t), data.length)
+        || !IsTableInBounds(header.DeletionTableOffset, header.DeletionCount, sizeof(BinaryDeletionRecord), data.length)) {
+        return NO;
+    }
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        if (!IsTableInBounds(header.RecordTableOffset[kind], header.RecordCount[kind], RecordSizeForKind(kind, header.Version), data.length)) {
+            return NO;
+        }
+    }
+
+    __block BOOL malformed = NO;
+    NSMutableArray *stringByIndex = [NSMutableArray arrayWithCapacity:header.StringCount]; // Strings are only decoded once no matter how many records share them
+
+    for (uint32_t index = 0; index < header.StringCount; index += 1) {
+        [stringByIndex addObject:[NSNull null]];
+    }
+
+    NSString *(^stringForIndex)(uint32_t) = ^NSString *(uint32_t index) {
+        if (index == BinaryArchiveNilIndex) {
+            return nil;
+        }
+
+        if (index >= header.StringCount) {
+            malformed = YES;
+            return nil;
+        }
+
+        id string = stringByIndex[index];
+
+        if (string == [NSNull null]) {
+            BinaryStringEntry entry;
+            memcpy(&entry, (bytes + header.StringTableOffset + (index * sizeof(BinaryStringEntry))), sizeof(BinaryStringEntry));
+
+            if (((uint64_t)entry.Offset + entry.Length) > header.StringDataLength) {
+                malformed = YES;
+                return nil;
+            }
+
+            string = [[NSString alloc] initWithBytes:(bytes + header.StringDataOffset + entry.Offset) length:entry.Length encoding:NSUTF8StringEncoding];
+
+            if (string == nil) {
+                malformed = YES;
+                return nil;
+            }
+
+            stringByIndex[index] = string;
+        }
+
+        return string;
+    };
+
+    NSOrderedSet<NSUUID *> *(^UUIDsForList)(BinaryUUIDList) = ^NSOrderedSet<NSUUID *> *(BinaryUUIDList list) {
+        if (list.Index == BinaryArchiveNilIndex) {
+            return nil;
+        }
+
+        if (((uint64_t)list.Index + list.Count) > header.UUIDCount) {
+            malformed = YES;
+            return nil;
+        }
+
+        NSMutableOrderedSet<NSUUID *> *UUIDs = [NSMutableOrderedSet orderedSetWithCapacity:list.Count];
+        uint8_t const *UUIDBytes = (bytes + header.UUIDTableOffset + (list.Index * sizeof(uuid_t)));
+
+        for (uint32_t index = 0; index < list.Count; index += 1) {
+            [UUIDs addObject:[[NSUUID alloc] initWithUUIDBytes:(UUIDBytes + (index * sizeof(uuid_t)))]];
+        }
+
+        return UUIDs;
+    };
+
+    NSMutableDictionary<NSNumber *, NSMutableArray<NSUUID *> *> *deletedUUIDsByKind = [NSMutableDictionary dictionary]; // Everything is decoded before any of it is applied, so malformed data leaves the dictionaries untouched
+    NSMutableDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *decodedObjectByUUIDByKind = [NSMutableDictionary dictionary];
+
+    for (uint32_t index = 0; index < header.DeletionCount; index += 1) {
+        BinaryDeletionRecord record;
+        memcpy(&record, (bytes + header.DeletionTableOffset + (index * sizeof(BinaryDeletionRecord))), sizeof(BinaryDeletionRecord));
+
+        if (record.Kind >= BLMArchiveEntityKindCount) {
+            return NO;
+        }
+
+        if (![kinds containsIndex:record.Kind]) {
+            continue;
+        }
+
+        NSMutableArray<NSUUID *> *deletedUUIDs = deletedUUIDsByKind[@(record.Kind)];
+
+        if (deletedUUIDs == nil) {
+            deletedUUIDs = [NSMutableArray array];
+            deletedUUIDsByKind[@(record.Kind)] = deletedUUIDs;
+        }
+
+        [deletedUUIDs addObject:[[NSUUID alloc] initWithUUIDBytes:record.UUID]];
+    }
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        if (![kinds containsIndex:kind]) {
+            continue;
+        }
+
+        NSMutableDictionary<NSUUID *, id> *objectByUUID = [NSMutableDictionary dictionaryWithCapacity:header.RecordCount[kind]];
+        decodedObjectByUUIDByKind[@(kind)] = objectByUUID;
+
+        uint8_t const *recordBytes = (bytes + header.RecordTableOffset[kind]);
+        size_t recordSize = RecordSizeForKind(kind, header.Version);
+
+        for (uint32_t index = 0; index < header.RecordCount[kind]; index += 1) {
+            uint8_t const *record = (recordBytes + (index * recordSize));
+            NSUUID *UUID = [[NSUUID alloc] initWithUUIDBytes:record]; // Every record starts with its UUID
+            id object = nil;
+
+            switch (kind) {
+                case BLMArchiveEntityKindProject: {
+                    BinaryProjectRecord projectRecord;
+                    memcpy(&projectRecord, record, sizeof(BinaryProjectRecord));
+
+                    object = [[BLMProject alloc] initWithUUID:UUID
+                                                         name:stringForIndex(projectRecord.Name)
+                                                       client:stringForIndex(projectRecord.Client)
+                                     sessionConfigurationUUID:[[NSUUID alloc] initWithUUIDBytes:projectRecord.SessionConfigurationUUID]
+                                                 sessionUUIDs:UUIDsForList(projectRecord.SessionUUIDs)];
+                    break;
+                }
+
+                case BLMArchiveEntityKindBehavior: {
+                    BinaryBehaviorRecord behaviorRecord = { .ReferenceCount = BinaryArchiveUntrackedCount }; // Left as is by records that predate the count
+                    memcpy(&behaviorRecord, record, recordSize);
+
+                    object = [[BLMBehavior alloc] initWithUUID:UUID
+                                                          name:stringForIndex(behaviorRecord.Name)
+                                                    continuous:(behaviorRecord.Continuous != 0)
+                                                referenceCount:((behaviorRecord.ReferenceCount == BinaryArchiveUntrackedCount) ? NSNotFound : behaviorRecord.ReferenceCount)];
+                    break;
+                }
+
+                case BLMArchiveEntityKindSession: {
+                    BinarySessionRecord sessionRecord;
+                    memcpy(&sessionRecord, record, sizeof(BinarySessionRecord));
+
+                    object = [[BLMSession alloc] initWithUUID:UUID
+                                                         name:stringForIndex(sessionRecord.Name)
+                                            configurationUUID:[[NSUUID alloc] initWithUUIDBytes:sessionRecord.ConfigurationUUID]
+                                                 creationDate:DateForTimeInterval(sessionRecord.CreationDate)
+                                                    startDate:DateForTimeInterval(sessionRecord.StartDate)
+                                                      endDate:DateForTimeInterval(sessionRecord.EndDate)];
+                    break;
+                }
+
+                case BLMArchiveEntityKindSessionConfiguration: {
+                    BinarySessionConfigurationRecord sessionConfigurationRecord;
+                    memcpy(&sessionConfigurationRecord, record, sizeof(BinarySessionConfigurationRecord));
+
+                    object = [[BLMSessionConfiguration alloc] initWithUUID:UUID
+                                                                 condition:stringForIndex(sessionConfigurationRecord.Condition)
+                                                                  location:stringForIndex(sessionConfigurationRecord.Location)
+                                                                 therapist:stringForIndex(sessionConfigurationRecord.Therapist)
+                                                                  observer:stringForIndex(sessionConfigurationRecord.Observer)
+                                                                 timeLimit:(BLMTimeInterval)sessionConfigurationRecord.TimeLimit
+                                                          timeLimitOptions:(BLMTimeLimitOptions)sessionConfigurationRecord.TimeLimitOptions
+                                                             behaviorUUIDs:UUIDsForList(sessionConfigurationRecord.BehaviorUUIDs)];
+                    break;
+                }
+
+                case BLMArchiveEntityKindCount: {
+                    assert(NO);
+                    return NO;
+                }
+            }
+
+            if (malformed) {
+                return NO;
+            }
+
+            objectByUUID[UUID] = object;
+        }
+    }
+
+    [kinds enumerateIndexesUsingBlock:^(NSUInteger kind, BOOL *__nonnull stop) { // Deletions first, as they were recorded before any object in the same data
+        [objectByUUIDByKind[@(kind)] removeObjectsForKeys:(deletedUUIDsByKind[@(kind)] ?: @[])];
+        [objectByUUIDByKind[@(kind)] addEntriesFromDictionary:decodedObjectByUUIDByKind[@(kind)]];
+    }];
+
+    return YES;
+}
+
+@end
@@ -7,6 +7,7 @@
 //
 
 #import "BLMButtonCell.h"
+#import "BLMTextMeasurer.h"
 #import "BLMViewUtils.h"
 
 
@@ -42,13 +43,6 @@ static CGFloat ButtonTitleTopPadding = 5.0;
 }
 
 
-- (void)layoutSubviews {
-    [super layoutSubviews];
-
-    [self updateButtonInsets]; // Must call after finishing layoutSubviews because setting the button's insets requires knowledge about the bounds of its titleLabel and imageView
-}
-
-
 - (void)prepareForReuse {
     [super prepareForReuse];
 
@@ -78,19 +72,26 @@ static CGFloat ButtonTitleTopPadding = 5.0;
 }
 
 
-- (void)updateButtonInsets {
-    if ((self.button.titleLabel.text.length == 0) || (self.button.currentImage == nil)) {
+- (void)updateButtonInsets { // Sized from the title's measurement and the image itself, so the insets don't wait on a layout pass of the button's subviews
+    NSAttributedString *title = self.button.currentAttributedTitle;
+    UIImage *image = self.button.currentImage;
+
+    if ((title.length == 0) || (image == nil)) {
         return;
     }
 
+    assert([title attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL] != nil); // Otherwise the title would be measured with a different font than the button draws it with
+
+    CGSize titleSize = [[BLMTextMeasurer sharedMeasurer] sizeForAttributedText:title width:BLMTextMeasurerUnboundedWidth];
+
     self.button.imageEdgeInsets = (UIEdgeInsets) {
-        .top = -(CGRectGetHeight(self.button.titleLabel.bounds) + ButtonTitleTopPadding),
-        .right = -CGRectGetWidth(self.button.titleLabel.bounds)
+        .top = -(titleSize.height + ButtonTitleTopPadding),
+        .right = -titleSize.width
     };
 
     self.button.titleEdgeInsets = (UIEdgeInsets) {
-        .left = -CGRectGetWidth(self.button.imageView.bounds),
-        .bottom = -(CGRectGetHeight(self.button.imageView.bounds) + ButtonTitleTopPadding)
+        .left = -image.size.width,
+        .bottom = -(image.size.height + ButtonTitleTopPadding)
     };
 }
 
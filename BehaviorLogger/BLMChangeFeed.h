@@ -0,0 +1,59 @@
+//
+//  BLMChangeFeed.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/22/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMArchiveJournal.h"
+#import "BLMDataManagerTransaction.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class BLMChangeFeed;
+
+
+@protocol BLMChangeFeedObserver <NSObject>
+
+- (void)changeFeed:(BLMChangeFeed *)changeFeed didDeliverChangeSet:(BLMChangeSet *)changeSet; // Holds only the changes the observer registered for
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Delivers the data manager's changes to the observers that registered for them, by UUID or by kind.
+ ` Changes are coalesced until the main run loop is about to wait, ahead of Core Animation's commit, so
+ ` views are laid out only after every observer has seen them. Each interested observer then receives
+ ` a single change set with just its changes; finding those observers costs a lookup per changed
+ ` object, however many observers are registered.
+ `
+ ` Changes recorded while a change set is being delivered are delivered in a following pass of the same
+ ` turn. Observers are held weakly, but must remove themselves before they are deallocated.
+ ` All messages must be sent from the main thread.
+ */
+
+@interface BLMChangeFeed : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger deliveredCallbackCount; // Change sets delivered to observers
+@property (nonatomic, assign, readonly) NSUInteger suppressedCallbackCount; // Callbacks a per-object broadcast to every observer would have made beyond those delivered
+
+- (void)addObserver:(id<BLMChangeFeedObserver>)observer forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind;
+- (void)addObserver:(id<BLMChangeFeedObserver>)observer forKind:(BLMArchiveEntityKind)kind; // Every object of the kind
+- (void)removeObserver:(id<BLMChangeFeedObserver>)observer forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind;
+- (void)removeObserver:(id<BLMChangeFeedObserver>)observer; // From every registration
+
+- (void)recordChangeForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind original:(nullable id)original updated:(nullable id)updated; // nil original for created objects, nil updated for deleted ones
+- (void)recordChangeSet:(BLMChangeSet *)changeSet;
+- (void)deliverPendingChanges; // Delivers now rather than when the run loop is about to wait; does nothing while a delivery is underway
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,278 @@
+//
+//  BLMChangeFeed.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/22/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMChangeFeed.h"
+
+
+#pragma mark Constants
+
+static CFIndex const RunLoopObserverOrder = 0; // Ahead of Core Animation's commit observer, so views are laid out after delivery
+
+
+#pragma mark
+
+@interface ObserverRegistration : NSObject // Everything one observer registered for, so it can be removed from all of it at once
+
+@property (nonatomic, strong, readonly) NSMutableIndexSet *kinds;
+@property (nonatomic, strong, readonly) NSArray<NSMutableSet<NSUUID *> *> *UUIDsByKind;
+
+@end
+
+
+@implementation ObserverRegistration
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    NSMutableArray *UUIDsByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        [UUIDsByKind addObject:[NSMutableSet set]];
+    }
+
+    _kinds = [NSMutableIndexSet indexSet];
+    _UUIDsByKind = UUIDsByKind;
+
+    return self;
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMChangeFeed ()
+
+@property (nonatomic, assign, readwrite) NSUInteger deliveredCallbackCount;
+@property (nonatomic, assign, readwrite) NSUInteger suppressedCallbackCount;
+@property (nonatomic, strong, readonly) NSArray<NSMutableDictionary<NSUUID *, NSHashTable *> *> *observersByUUIDByKind;
+@property (nonatomic, strong, readonly) NSArray<NSHashTable *> *observersByKind;
+@property (nonatomic, strong, readonly) NSMapTable<id<BLMChangeFeedObserver>, ObserverRegistration *> *registrationByObserver; // Weak keys
+@property (nonatomic, strong) BLMChangeSet *pendingChangeSet;
+@property (nonatomic, assign) NSUInteger pendingRecordCount; // Before coalescing, for suppressedCallbackCount
+@property (nonatomic, assign, getter=isDelivering) BOOL delivering;
+@property (nonatomic, assign, readonly) CFRunLoopObserverRef runLoopObserver;
+
+@end
+
+
+@implementation BLMChangeFeed
+
+- (instancetype)init {
+    assert([NSThread isMainThread]);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    NSMutableArray *observersByUUIDByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+    NSMutableArray *observersByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        [observersByUUIDByKind addObject:[NSMutableDictionary dictionary]];
+        [observersByKind addObject:[NSHashTable weakObjectsHashTable]];
+    }
+
+    _observersByUUIDByKind = observersByUUIDByKind;
+    _observersByKind = observersByKind;
+    _registrationByObserver = [NSMapTable weakToStrongObjectsMapTable];
+    _pendingChangeSet = [[BLMChangeSet alloc] init];
+
+    __weak BLMChangeFeed *weakSelf = self;
+
+    _runLoopObserver = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, (kCFRunLoopBeforeWaiting | kCFRunLoopExit), true, RunLoopObserverOrder, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+        [weakSelf deliverPendingChanges];
+    });
+
+    CFRunLoopAddObserver(CFRunLoopGetMain(), _runLoopObserver, kCFRunLoopCommonModes);
+
+    return self;
+}
+
+
+- (void)dealloc {
+    CFRunLoopObserverInvalidate(_runLoopObserver);
+    CFRelease(_runLoopObserver);
+}
+
+#pragma mark Registration
+
+- (void)addObserver:(id<BLMChangeFeedObserver>)observer forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    assert(kind < BLMArchiveEntityKindCount);
+
+    NSHashTable *observers = self.observersByUUIDByKind[kind][UUID];
+
+    if (observers == nil) {
+        observers = [NSHashTable weakObjectsHashTable];
+        self.observersByUUIDByKind[kind][UUID] = observers;
+    }
+
+    [observers addObject:observer];
+    [[self registrationForObserver:observer].UUIDsByKind[kind] addObject:UUID];
+}
+
+
+- (void)addObserver:(id<BLMChangeFeedObserver>)observer forKind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    assert(kind < BLMArchiveEntityKindCount);
+
+    [self.observersByKind[kind] addObject:observer];
+    [[self registrationForObserver:observer].kinds addIndex:kind];
+}
+
+
+- (void)removeObserver:(id<BLMChangeFeedObserver>)observer forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    assert(kind < BLMArchiveEntityKindCount);
+
+    ObserverRegistration *registration = [self.registrationByObserver objectForKey:observer];
+
+    if (![registration.UUIDsByKind[kind] containsObject:UUID]) {
+        return;
+    }
+
+    [registration.UUIDsByKind[kind] removeObject:UUID];
+    [self removeObserver:observer fromObserversForUUID:UUID kind:kind];
+}
+
+
+- (void)removeObserver:(id<BLMChangeFeedObserver>)observer {
+    assert([NSThread isMainThread]);
+
+    ObserverRegistration *registration = [self.registrationByObserver objectForKey:observer];
+
+    if (registration == nil) {
+        return;
+    }
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (NSUUID *UUID in registration.UUIDsByKind[kind]) {
+            [self removeObserver:observer fromObserversForUUID:UUID kind:kind];
+        }
+    }
+
+    [registration.kinds enumerateIndexesUsingBlock:^(NSUInteger kind, BOOL *__nonnull stop) {
+        [self.observersByKind[kind] removeObject:observer];
+    }];
+
+    [self.registrationByObserver removeObjectForKey:observer];
+}
+
+
+- (ObserverRegistration *)registrationForObserver:(id<BLMChangeFeedObserver>)observer {
+    ObserverRegistration *registration = [self.registrationByObserver objectForKey:observer];
+
+    if (registration == nil) {
+        registration = [[ObserverRegistration alloc] init];
+        [self.registrationByObserver setObject:registration forKey:observer];
+    }
+
+    return registration;
+}
+
+
+- (void)removeObserver:(id<BLMChangeFeedObserver>)observer fromObserversForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    NSHashTable *observers = self.observersByUUIDByKind[kind][UUID];
+    [observers removeObject:observer];
+
+    if (observers.count == 0) { // Dropped so the table only holds UUIDs someone is still interested in
+        [self.observersByUUIDByKind[kind] removeObjectForKey:UUID];
+    }
+}
+
+#pragma mark Delivery
+
+- (void)recordChangeForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind original:(id)original updated:(id)updated {
+    assert([NSThread isMainThread]);
+
+    [self.pendingChangeSet addChangeForUUID:UUID kind:kind original:original updated:updated];
+    self.pendingRecordCount += 1;
+}
+
+
+- (void)recordChangeSet:(BLMChangeSet *)changeSet {
+    assert([NSThread isMainThread]);
+
+    [self.pendingChangeSet addChangesFromChangeSet:changeSet];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        self.pendingRecordCount += [changeSet UUIDsForKind:kind].count;
+    }
+}
+
+
+- (void)deliverPendingChanges {
+    assert([NSThread isMainThread]);
+
+    if (self.isDelivering) { // The pass underway picks up whatever its observers record
+        return;
+    }
+
+    self.delivering = YES;
+
+    while (!self.pendingChangeSet.isEmpty) {
+        BLMChangeSet *changeSet = self.pendingChangeSet;
+        NSUInteger recordCount = self.pendingRecordCount;
+
+        self.pendingChangeSet = [[BLMChangeSet alloc] init];
+        self.pendingRecordCount = 0;
+
+        NSMapTable<id<BLMChangeFeedObserver>, BLMChangeSet *> *changeSetByObserver = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality) valueOptions:NSPointerFunctionsStrongMemory]; // Keeps observers alive until the pass ends
+        NSMutableArray<id<BLMChangeFeedObserver>> *observers = [NSMutableArray array]; // In the order of their first change
+
+        for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+            for (NSUUID *UUID in [changeSet UUIDsForKind:kind]) {
+                NSHashTable *interestedObservers = [self.observersByKind[kind] copy];
+                NSHashTable *UUIDObservers = self.observersByUUIDByKind[kind][UUID];
+
+                if (UUIDObservers != nil) {
+                    [interestedObservers unionHashTable:UUIDObservers];
+                }
+
+                for (id<BLMChangeFeedObserver> observer in interestedObservers) {
+                    BLMChangeSet *observerChangeSet = [changeSetByObserver objectForKey:observer];
+
+                    if (observerChangeSet == nil) {
+                        observerChangeSet = [[BLMChangeSet alloc] init];
+
+                        [changeSetByObserver setObject:observerChangeSet forKey:observer];
+                        [observers addObject:observer];
+                    }
+
+                    [observerChangeSet addChangeForUUID:UUID kind:kind original:[changeSet originalObjectForUUID:UUID kind:kind] updated:[changeSet updatedObjectForUUID:UUID kind:kind]];
+                }
+            }
+        }
+
+        NSUInteger broadcastCallbackCount = (recordCount * self.registrationByObserver.count);
+        NSUInteger deliveredCallbackCount = 0;
+
+        for (id<BLMChangeFeedObserver> observer in observers) {
+            if ([self.registrationByObserver objectForKey:observer] == nil) { // Removed by an earlier observer's callback
+                continue;
+            }
+
+            [observer changeFeed:self didDeliverChangeSet:[changeSetByObserver objectForKey:observer]];
+            deliveredCallbackCount += 1;
+        }
+
+        self.deliveredCallbackCount += deliveredCallbackCount;
+        self.suppressedCallbackCount += ((broadcastCallbackCount > deliveredCallbackCount) ? (broadcastCallbackCount - deliveredCallbackCount) : 0);
+    }
+
+    self.delivering = NO;
+}
+
+@end
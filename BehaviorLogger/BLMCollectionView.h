@@ -8,6 +8,8 @@
 
 #import <UIKit/UIKit.h>
 
+#import "BLMTextMeasurer.h"
+
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -85,7 +87,9 @@ extern BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 
 @interface BLMSectionHeaderView : UICollectionReusableView
 
-@property (nonatomic, strong, readonly) UILabel *label;
+@property (nonatomic, strong, readonly) BLMMeasuredLabel *label;
+
++ (UIFont *)labelFont;
 
 @end
 
@@ -132,7 +136,7 @@ extern BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 @interface BLMCollectionViewCell : UICollectionViewCell <BLMCollectionViewCellLayoutDelegate>
 
 @property (nonatomic, weak) id<BLMCollectionViewCellDataSource> dataSource;
-@property (nonatomic, strong, readonly) UILabel *label;
+@property (nonatomic, strong, readonly) BLMMeasuredLabel *label;
 @property (nonatomic, strong, readonly) NSIndexPath *indexPath;
 
 @property (nonatomic, assign) NSInteger section;
@@ -142,6 +146,7 @@ extern BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 - (void)updateLabelSubviewsPreferredMaxLayoutWidthWithLayoutRequired:(BOOL *)layoutRequired;
 
 + (UIColor *)errorColor;
++ (UIFont *)labelFont;
 
 @end
 
@@ -155,6 +160,9 @@ extern BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 
 - (BLMCollectionViewSectionLayout)collectionView:(BLMCollectionView *)collectionView layoutForSection:(NSUInteger)section;
 
+@optional
+- (void)collectionView:(BLMCollectionView *)collectionView prefetchTextMeasurementsForSection:(NSUInteger)section; // Sent when the section's data changes, before the layout pass that follows, so the text its views will display can be measured off the main thread before they are configured; the data source is already up to date, but the collection view's item counts may not be
+
 @end
 
 
@@ -164,6 +172,25 @@ extern BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 
 @property (nullable, nonatomic, weak) id<BLMCollectionViewLayoutDelegate> delegate;
 
+- (void)prefetchTextMeasurementsForSections:(NSIndexSet *)sections; // Sent automatically for reloaded sections and inserted or reloaded items; call it once the data source is first set
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Records which sections need their attributes recomputed. Sections after them only have their origins moved
+ ` by however much the recomputed sections grew or shrank, and the delegate is only asked again for the layouts
+ ` of the recomputed sections. Data source count changes recompute just the sections whose item counts changed.
+ */
+
+@interface BLMCollectionViewLayoutInvalidationContext : UICollectionViewLayoutInvalidationContext
+
+@property (nonatomic, copy, readonly) NSIndexSet *invalidatedSections;
+
+- (void)invalidateSections:(NSIndexSet *)sections;
+
 @end
 
 
@@ -173,6 +200,8 @@ extern BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 
 @property (nullable, nonatomic, readonly) BLMCollectionView *collectionView;
 
+- (void)invalidateLayoutForSections:(NSIndexSet *)sections; // For sections whose delegate layout or data has changed; BLMCollectionView sends it for reloaded sections
+
 @end
 
 
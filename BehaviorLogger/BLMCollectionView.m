@@ -26,6 +26,7 @@ BLMCollectionViewSectionLayout const BLMCollectionViewSectionLayoutNull;
 
 
 static CGFloat const HeaderFontSize = 18.0;
+static CGFloat const CellLabelFontSize = 17.0;
 
 
 #pragma mark
@@ -62,7 +63,7 @@ static CGFloat const HeaderFontSize = 18.0;
     self.backgroundColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeDefaultBackground];
     self.clipsToBounds = NO;
 
-    _label = [[UILabel alloc] initWithFrame:CGRectZero];
+    _label = [[BLMMeasuredLabel alloc] initWithFrame:CGRectZero];
 
     [self.label setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisVertical];
     [self.label setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisHorizontal];
@@ -72,7 +73,7 @@ static CGFloat const HeaderFontSize = 18.0;
 
     self.label.backgroundColor = self.backgroundColor;
     self.label.textColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeBlack];
-    self.label.font = [UIFont boldSystemFontOfSize:HeaderFontSize];
+    self.label.font = [BLMSectionHeaderView labelFont];
     self.label.translatesAutoresizingMaskIntoConstraints = NO;
 
     [self addSubview:self.label];
@@ -86,14 +87,16 @@ static CGFloat const HeaderFontSize = 18.0;
 - (void)layoutSubviews {
     [super layoutSubviews];
 
-    CGFloat preferredMaxLayoutWidth = CGRectGetWidth([self.label alignmentRectForFrame:self.label.frame]);
-
-    if (preferredMaxLayoutWidth != self.label.preferredMaxLayoutWidth) {
-        self.label.preferredMaxLayoutWidth = preferredMaxLayoutWidth;
+    if ([self.label updatePreferredMaxLayoutWidth]) {
         [super layoutSubviews];
     }
 }
 
+
++ (UIFont *)labelFont {
+    return [UIFont boldSystemFontOfSize:HeaderFontSize];
+}
+
 @end
 
 
@@ -132,7 +135,7 @@ static CGFloat const HeaderFontSize = 18.0;
         return nil;
     }
 
-    _label = [[UILabel alloc] initWithFrame:CGRectZero];
+    _label = [[BLMMeasuredLabel alloc] initWithFrame:CGRectZero];
 
     [self.label setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisVertical];
     [self.label setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisHorizontal];
@@ -140,6 +143,7 @@ static CGFloat const HeaderFontSize = 18.0;
     [self.label setContentCompressionResistancePriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisVertical];
     [self.label setContentCompressionResistancePriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisHorizontal];
 
+    self.label.font = [BLMCollectionViewCell labelFont];
     self.label.translatesAutoresizingMaskIntoConstraints = NO;
 
     [self.contentView addSubview:self.label];
@@ -197,10 +201,7 @@ static CGFloat const HeaderFontSize = 18.0;
 
 
 - (void)updateLabelSubviewsPreferredMaxLayoutWidthWithLayoutRequired:(BOOL *)layoutRequired {
-    CGFloat preferredMaxLayoutWidth = CGRectGetWidth([self.label alignmentRectForFrame:self.label.frame]);
-
-    if (preferredMaxLayoutWidth != self.label.preferredMaxLayoutWidth) {
-        self.label.preferredMaxLayoutWidth = preferredMaxLayoutWidth;
+    if ([self.label updatePreferredMaxLayoutWidth]) {
         *layoutRequired = YES;
     }
 }
@@ -210,6 +211,11 @@ static CGFloat const HeaderFontSize = 18.0;
     return [BLMViewUtils colorForHexCode:BLMColorHexCodeRed];
 }
 
+
++ (UIFont *)labelFont {
+    return [UIFont systemFontOfSize:CellLabelFontSize];
+}
+
 #pragma mark BLMCollectionViewCellLayoutDelegate
 
 - (NSArray<NSLayoutConstraint *> *)uniqueVerticalPositionConstraintsForSubview:(UIView *)subview {
@@ -256,6 +262,54 @@ static CGFloat const HeaderFontSize = 18.0;
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
 
+#pragma mark Updates
+
+- (void)prefetchTextMeasurementsForSections:(NSIndexSet *)sections {
+    if (![self.delegate respondsToSelector:@selector(collectionView:prefetchTextMeasurementsForSection:)]) {
+        return;
+    }
+
+    [sections enumerateIndexesUsingBlock:^(NSUInteger section, BOOL *__nonnull stop) {
+        [self.delegate collectionView:self prefetchTextMeasurementsForSection:section];
+    }];
+}
+
+
++ (NSIndexSet *)sectionsForIndexPaths:(NSArray<NSIndexPath *> *)indexPaths {
+    NSMutableIndexSet *sections = [NSMutableIndexSet indexSet];
+
+    for (NSIndexPath *indexPath in indexPaths) {
+        [sections addIndex:indexPath.section];
+    }
+
+    return sections;
+}
+
+
+- (void)reloadData {
+    [self prefetchTextMeasurementsForSections:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, [self.dataSource numberOfSectionsInCollectionView:self])]];
+    [super reloadData];
+}
+
+
+- (void)reloadSections:(NSIndexSet *)sections {
+    [self prefetchTextMeasurementsForSections:sections];
+    [(BLMCollectionViewLayout *)self.collectionViewLayout invalidateLayoutForSections:sections]; // Recomputed even if their item counts are unchanged
+    [super reloadSections:sections];
+}
+
+
+- (void)insertItemsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths {
+    [self prefetchTextMeasurementsForSections:[BLMCollectionView sectionsForIndexPaths:indexPaths]];
+    [super insertItemsAtIndexPaths:indexPaths];
+}
+
+
+- (void)reloadItemsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths {
+    [self prefetchTextMeasurementsForSections:[BLMCollectionView sectionsForIndexPaths:indexPaths]];
+    [super reloadItemsAtIndexPaths:indexPaths];
+}
+
 #pragma mark Event Handling
 
 - (void)handleKeyboardWillShow:(NSNotification *)notification {
@@ -312,14 +366,169 @@ static CGFloat const HeaderFontSize = 18.0;
 @end
 
 
+#pragma mark
+
+@implementation BLMCollectionViewLayoutInvalidationContext
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _invalidatedSections = [NSIndexSet indexSet];
+
+    return self;
+}
+
+
+- (void)invalidateSections:(NSIndexSet *)sections {
+    NSMutableIndexSet *invalidatedSections = [self.invalidatedSections mutableCopy];
+    [invalidatedSections addIndexes:sections];
+
+    _invalidatedSections = invalidatedSections;
+}
+
+@end
+
+
+#pragma mark
+
+@interface SectionAttributes : NSObject <NSCopying> // One section's attributes, with cells in item order so visible rows can be found arithmetically
+
+@property (nonatomic, assign) CGFloat originY; // Every frame below is relative to it, so moving the section leaves its attributes untouched
+@property (nonatomic, assign) CGRect frame;
+@property (nonatomic, strong) UICollectionViewLayoutAttributes *header;
+@property (nonatomic, strong) UICollectionViewLayoutAttributes *itemAreaBackground;
+@property (nonatomic, strong) UICollectionViewLayoutAttributes *footer;
+@property (nonatomic, copy) NSArray<UICollectionViewLayoutAttributes *> *items;
+@property (nonatomic, assign) CGFloat itemGridMinY;
+@property (nonatomic, assign) CGFloat rowPitch; // Row height plus row spacing
+@property (nonatomic, assign) NSInteger columnCount;
+@property (nonatomic, assign, readonly) CGFloat minY; // In collection view coordinates
+@property (nonatomic, assign, readonly) CGFloat maxY;
+
+@end
+
+
+@implementation SectionAttributes
+
+- (id)copyWithZone:(NSZone *)zone {
+    SectionAttributes *copy = [[SectionAttributes alloc] init];
+
+    copy.originY = self.originY;
+    copy.frame = self.frame;
+    copy.header = self.header;
+    copy.itemAreaBackground = self.itemAreaBackground;
+    copy.footer = self.footer;
+    copy.items = self.items;
+    copy.itemGridMinY = self.itemGridMinY;
+    copy.rowPitch = self.rowPitch;
+    copy.columnCount = self.columnCount;
+
+    return copy;
+}
+
+
+- (SectionAttributes *)sectionAttributesWithOriginY:(CGFloat)originY { // The receiver is left untouched, as the previous attributes for animations; the attributes themselves are shared
+    SectionAttributes *moved = [self copy];
+    moved.originY = originY;
+
+    return moved;
+}
+
+
+- (CGFloat)minY {
+    return (self.originY + CGRectGetMinY(self.frame));
+}
+
+
+- (CGFloat)maxY {
+    return (self.originY + CGRectGetMaxY(self.frame));
+}
+
+
+- (UICollectionViewLayoutAttributes *)positionedAttributes:(UICollectionViewLayoutAttributes *)attributes { // A copy moved to the section's origin, since the cached attributes may be shared with earlier layout passes
+    if (attributes == nil) {
+        return nil;
+    }
+
+    UICollectionViewLayoutAttributes *positionedAttributes = [attributes copy];
+    positionedAttributes.frame = CGRectPixelAlign(CGRectOffset(attributes.frame, 0.0, self.originY));
+
+    return positionedAttributes;
+}
+
+
+- (NSArray<UICollectionViewLayoutAttributes *> *)supplementaryAttributes {
+    NSMutableArray<UICollectionViewLayoutAttributes *> *supplementaryAttributes = [NSMutableArray arrayWithCapacity:3];
+
+    if (self.header != nil) {
+        [supplementaryAttributes addObject:self.header];
+    }
+
+    if (self.itemAreaBackground != nil) {
+        [supplementaryAttributes addObject:self.itemAreaBackground];
+    }
+
+    if (self.footer != nil) {
+        [supplementaryAttributes addObject:self.footer];
+    }
+
+    return supplementaryAttributes;
+}
+
+
+- (UICollectionViewLayoutAttributes *)supplementaryAttributesOfKind:(NSString *)kind {
+    if ([kind isEqualToString:BLMCollectionViewKindHeader]) {
+        return self.header;
+    }
+
+    if ([kind isEqualToString:BLMCollectionViewKindItemAreaBackground]) {
+        return self.itemAreaBackground;
+    }
+
+    if ([kind isEqualToString:BLMCollectionViewKindFooter]) {
+        return self.footer;
+    }
+
+    assert(NO);
+    return nil;
+}
+
+
+- (NSRange)itemRangeForRowsBetweenMinY:(CGFloat)minY maxY:(CGFloat)maxY { // Every item in a row that may intersect [minY, maxY], relative to originY
+    if (self.items.count == 0) {
+        return NSMakeRange(0, 0);
+    }
+
+    NSInteger lastRow = (((NSInteger)self.items.count - 1) / self.columnCount);
+    NSInteger firstVisibleRow = MAX(0, (NSInteger)floor((minY - self.itemGridMinY - 1.0) / self.rowPitch)); // A point of slack for pixel alignment
+    NSInteger lastVisibleRow = MIN(lastRow, (NSInteger)floor((maxY - self.itemGridMinY + 1.0) / self.rowPitch));
+
+    if (lastVisibleRow < firstVisibleRow) {
+        return NSMakeRange(0, 0);
+    }
+
+    NSUInteger location = (firstVisibleRow * self.columnCount);
+    return NSMakeRange(location, (MIN(((lastVisibleRow + 1) * self.columnCount), (NSInteger)self.items.count) - location));
+}
+
+@end
+
+
 #pragma mark
 
 @interface BLMCollectionViewLayout ()
 
 @property (nonatomic, assign) CGSize collectionViewContentSize;
-@property (nonatomic, copy, readonly) NSMutableArray<NSValue *> *sectionFrameList;
-@property (nonatomic, copy, readonly) NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, UICollectionViewLayoutAttributes *> *> *attributesByIndexPathByKind;
-@property (nonatomic, copy, readonly) NSMutableDictionary<NSString *, NSMutableDictionary<NSIndexPath *, UICollectionViewLayoutAttributes *> *> *previousAttributesByIndexPathByKind;
+@property (nonatomic, assign) CGFloat sectionWidth; // The width every cached section was laid out for
+@property (nonatomic, copy, readonly) NSMutableArray<SectionAttributes *> *sectionAttributesList;
+@property (nonatomic, copy) NSArray<SectionAttributes *> *previousSectionAttributesList; // As the last layout pass found them
+@property (nonatomic, copy, readonly) NSMutableIndexSet *invalidatedSections;
+@property (nonatomic, assign) BOOL needsFullLayout;
+@property (nonatomic, assign) BOOL needsItemCountCheck;
 @property (nonatomic, copy, readonly) NSMutableDictionary<NSIndexPath *, NSIndexPath *> *reloadedIndexPathByOriginalIndexPath;
 @property (nonatomic, copy, readonly) NSMutableArray<NSIndexPath *> *deletedIndexPaths;
 @property (nonatomic, copy, readonly) NSMutableArray<NSIndexPath *> *insertedIndexPaths;
@@ -338,9 +547,10 @@ static CGFloat const HeaderFontSize = 18.0;
         return nil;
 
     _collectionViewContentSize = CGSizeZero;
-    _sectionFrameList = [NSMutableArray array];
-    _attributesByIndexPathByKind = [NSMutableDictionary dictionary];
-    _previousAttributesByIndexPathByKind = [NSMutableDictionary dictionary];
+    _sectionAttributesList = [NSMutableArray array];
+    _previousSectionAttributesList = @[];
+    _invalidatedSections = [NSMutableIndexSet indexSet];
+    _needsFullLayout = YES;
     _reloadedIndexPathByOriginalIndexPath = [NSMutableDictionary dictionary];
     _deletedIndexPaths = [NSMutableArray array];
     _insertedIndexPaths = [NSMutableArray array];
@@ -349,195 +559,262 @@ static CGFloat const HeaderFontSize = 18.0;
 }
 
 
++ (Class)invalidationContextClass {
+    return [BLMCollectionViewLayoutInvalidationContext class];
+}
+
+#pragma mark Invalidation
+
+- (void)invalidateLayoutForSections:(NSIndexSet *)sections {
+    BLMCollectionViewLayoutInvalidationContext *context = [[BLMCollectionViewLayoutInvalidationContext alloc] init];
+    [context invalidateSections:sections];
+
+    [self invalidateLayoutWithContext:context];
+}
+
+
+- (void)invalidateLayoutWithContext:(UICollectionViewLayoutInvalidationContext *)context {
+    [super invalidateLayoutWithContext:context];
+
+    if (context.invalidateEverything) {
+        self.needsFullLayout = YES;
+    } else if (context.invalidateDataSourceCounts) {
+        self.needsItemCountCheck = YES;
+    }
+
+    if ([context isKindOfClass:[BLMCollectionViewLayoutInvalidationContext class]]) {
+        [self.invalidatedSections addIndexes:((BLMCollectionViewLayoutInvalidationContext *)context).invalidatedSections];
+    }
+}
+
+#pragma mark Layout
+
 - (void)prepareLayout {
     [super prepareLayout];
 
-    [self.sectionFrameList removeAllObjects];
-    [self.previousAttributesByIndexPathByKind removeAllObjects];
+    CGFloat sectionWidth = CGRectGetWidth(self.collectionView.bounds);
+    NSUInteger sectionCount = self.collectionView.numberOfSections;
+
+    self.previousSectionAttributesList = self.sectionAttributesList;
 
-    for (NSString *kind in @[BLMCollectionViewKindHeader, BLMCollectionViewKindItemAreaBackground, BLMCollectionViewKindItemCell, BLMCollectionViewKindFooter]) {
-        self.previousAttributesByIndexPathByKind[kind] = (self.attributesByIndexPathByKind[kind] ?: [NSMutableDictionary dictionary]);
-        self.attributesByIndexPathByKind[kind] = [NSMutableDictionary dictionary];
+    if (self.needsFullLayout || (sectionWidth != self.sectionWidth) || (sectionCount != self.sectionAttributesList.count)) { // Section indexes may no longer line up with the cached ones, so every section is recomputed
+        [self.sectionAttributesList removeAllObjects];
+        self.sectionWidth = sectionWidth;
+    } else if (self.needsItemCountCheck) {
+        for (NSUInteger section = 0; section < sectionCount; section += 1) {
+            if ([self.collectionView numberOfItemsInSection:section] != (NSInteger)self.sectionAttributesList[section].items.count) {
+                [self.invalidatedSections addIndex:section];
+            }
+        }
     }
 
-    CGFloat sectionWidth = CGRectGetWidth(self.collectionView.bounds);
+    CGFloat originY = 0.0;
 
-    CGRect contentFrame = {
-        .origin = CGPointZero,
+    for (NSUInteger section = 0; section < sectionCount; section += 1) {
+        if ((section >= self.sectionAttributesList.count) || [self.invalidatedSections containsIndex:section]) {
+            [self addAttributesForSection:section originY:originY];
+        } else if (self.sectionAttributesList[section].originY != originY) { // Only the origin moves, so shifting a section costs the same however many items it has
+            self.sectionAttributesList[section] = [self.sectionAttributesList[section] sectionAttributesWithOriginY:originY];
+        }
+
+        originY = self.sectionAttributesList[section].maxY;
+    }
+
+    [self.invalidatedSections removeAllIndexes];
+
+    self.needsFullLayout = NO;
+    self.needsItemCountCheck = NO;
+    self.collectionViewContentSize = CGSizeMake(sectionWidth, originY);
+}
+
+
+- (void)addAttributesForSection:(NSUInteger)section originY:(CGFloat)originY { // Replaces the section's cached attributes, or appends them for a new section; the only place the delegate is asked for a section's layout
+    BLMCollectionViewSectionLayout const Layout = [self.collectionView.delegate collectionView:self.collectionView layoutForSection:section];
+
+    CGFloat sectionWidth = self.sectionWidth;
+    SectionAttributes *sectionAttributes = [[SectionAttributes alloc] init];
+
+    CGRect sectionFrame = { // Relative to originY
+        .origin = {
+            .x = 0.0,
+            .y = 0.0
+        },
         .size = {
             .width = sectionWidth,
             .height = 0.0
         }
     };
 
-    for (NSUInteger section = 0; section < self.collectionView.numberOfSections; section += 1) {
-        BLMCollectionViewSectionLayout const Layout = [self.collectionView.delegate collectionView:self.collectionView layoutForSection:section];
+    if (Layout.Header.Height > 0) {
+        NSIndexPath *indexPath = [NSIndexPath indexPathForItem:0 inSection:section];
+        UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForSupplementaryViewOfKind:BLMCollectionViewKindHeader withIndexPath:indexPath];
+
+        attributes.frame = CGRectPixelAlign((CGRect) {
+            .origin = {
+                .x = (CGRectGetMinX(sectionFrame) + Layout.Header.Insets.left),
+                .y = (CGRectGetMaxY(sectionFrame) + Layout.Header.Insets.top) // Positioned at the top of the section, which starts at the bottom edge of the previous section
+            },
+            .size = {
+                .width = (sectionWidth - Layout.Header.Insets.left - Layout.Header.Insets.right),
+                .height = Layout.Header.Height
+            }
+        });
+
+        sectionAttributes.header = attributes;
+
+        sectionFrame.size.height += (Layout.Header.Height + Layout.Header.Insets.top + Layout.Header.Insets.bottom); // Extend section frame to include the header and its insets
+    }
 
-        CGRect sectionFrame = {
+    NSInteger itemCount = [self.collectionView numberOfItemsInSection:section];
+    NSMutableArray<UICollectionViewLayoutAttributes *> *items = [NSMutableArray arrayWithCapacity:itemCount];
+
+    if (itemCount > 0) {
+        NSInteger rowCount = ceilf(itemCount / (CGFloat)Layout.ItemArea.Grid.ColumnCount);
+        CGFloat itemGridHeight = ((rowCount * Layout.ItemArea.Grid.RowHeight) + (Layout.ItemArea.Grid.RowSpacing * (rowCount - 1))); // Space enough for the item grid rows plus the total amount of inter-row spacing
+
+        CGRect itemAreaFrame = {
             .origin = {
-                .x = CGRectGetMinX(contentFrame),
-                .y = CGRectGetMaxY(contentFrame)
+                .x = (CGRectGetMinX(sectionFrame) + Layout.ItemArea.Insets.left),
+                .y = (CGRectGetMaxY(sectionFrame) + Layout.ItemArea.Insets.top)
             },
             .size = {
-                .width = sectionWidth,
-                .height = 0.0
+                .width = (sectionWidth - Layout.ItemArea.Insets.left - Layout.ItemArea.Insets.right),
+                .height = (itemGridHeight + Layout.ItemArea.Grid.Insets.top + Layout.ItemArea.Grid.Insets.bottom) // Include the splace necessary to account for the item grid top/bottom insets
             }
         };
 
-        if (Layout.Header.Height > 0) {
+        if (Layout.ItemArea.HasBackground) {
             NSIndexPath *indexPath = [NSIndexPath indexPathForItem:0 inSection:section];
-            UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForSupplementaryViewOfKind:BLMCollectionViewKindHeader withIndexPath:indexPath];
-
-            attributes.frame = CGRectPixelAlign((CGRect) {
-                .origin = {
-                    .x = (CGRectGetMinX(sectionFrame) + Layout.Header.Insets.left),
-                    .y = (CGRectGetMaxY(sectionFrame) + Layout.Header.Insets.top) // Positioned below previous section at the bottom edge of collectionViewContentSize
-                },
-                .size = {
-                    .width = (sectionWidth - Layout.Header.Insets.left - Layout.Header.Insets.right),
-                    .height = Layout.Header.Height
-                }
-            });
+            UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForSupplementaryViewOfKind:BLMCollectionViewKindItemAreaBackground withIndexPath:indexPath];
 
-            self.attributesByIndexPathByKind[BLMCollectionViewKindHeader][indexPath] = attributes;
+            attributes.zIndex = -1;
+            attributes.frame = CGRectPixelAlign(itemAreaFrame);
 
-            sectionFrame.size.height += (Layout.Header.Height + Layout.Header.Insets.top + Layout.Header.Insets.bottom); // Extend section frame to include the header and its insets
+            sectionAttributes.itemAreaBackground = attributes;
         }
 
-        NSInteger itemCount = [self.collectionView numberOfItemsInSection:section];
+        CGRect itemGridFrame = {
+            .origin = {
+                .x = (CGRectGetMinX(itemAreaFrame) + Layout.ItemArea.Grid.Insets.left),
+                .y = (CGRectGetMinY(itemAreaFrame) + Layout.ItemArea.Grid.Insets.top)
+            },
+            .size = {
+                .width = (CGRectGetWidth(itemAreaFrame) - Layout.ItemArea.Grid.Insets.left - Layout.ItemArea.Grid.Insets.right),
+                .height = itemGridHeight
+            }
+        };
+
+        sectionAttributes.itemGridMinY = CGRectGetMinY(itemGridFrame);
+        sectionAttributes.rowPitch = (Layout.ItemArea.Grid.RowHeight + Layout.ItemArea.Grid.RowSpacing);
+        sectionAttributes.columnCount = Layout.ItemArea.Grid.ColumnCount;
 
-        if (itemCount > 0) {
-            NSInteger rowCount = ceilf(itemCount / (CGFloat)Layout.ItemArea.Grid.ColumnCount);
-            CGFloat itemGridHeight = ((rowCount * Layout.ItemArea.Grid.RowHeight) + (Layout.ItemArea.Grid.RowSpacing * (rowCount - 1))); // Space enough for the item grid rows plus the total amount of inter-row spacing
+        CGFloat itemWidth = ((CGRectGetWidth(itemGridFrame) // To find the width of item cells in this section, start with the item area width...
+                              - (Layout.ItemArea.Grid.ColumnSpacing // ...then subtract the horizontal inter-column space...
+                                 * (Layout.ItemArea.Grid.ColumnCount - 1))) // ...multiplied by the total number of inter-column spaces...
+                             / Layout.ItemArea.Grid.ColumnCount); // ...then divide the remaining space by the number of columns...
 
-            CGRect itemAreaFrame = {
+        for (NSInteger item = 0; item < itemCount; item += 1) {
+            NSIndexPath *indexPath = [NSIndexPath indexPathForItem:item inSection:section];
+            UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForCellWithIndexPath:indexPath];
+
+            attributes.frame = CGRectPixelAlign((CGRect) {
                 .origin = {
-                    .x = (CGRectGetMinX(sectionFrame) + Layout.ItemArea.Insets.left),
-                    .y = (CGRectGetMaxY(sectionFrame) + Layout.ItemArea.Insets.top)
+                    .x = (CGRectGetMinX(itemGridFrame) // Starting at the left edge...
+                          + ((itemWidth + Layout.ItemArea.Grid.ColumnSpacing) // ...then move over by the width of a column and its horizontal spacing...
+                             * (item % Layout.ItemArea.Grid.ColumnCount))), // ...multiplied by the column number for this item.
+                    .y = (CGRectGetMinY(itemGridFrame)  // Starting at the top edge...
+                          + ((Layout.ItemArea.Grid.RowHeight + Layout.ItemArea.Grid.RowSpacing) // ...then move down by the height of a row and its vertical spacing...
+                             * (item / Layout.ItemArea.Grid.ColumnCount))) // ...multiplied by the row number for this item.
                 },
                 .size = {
-                    .width = (sectionWidth - Layout.ItemArea.Insets.left - Layout.ItemArea.Insets.right),
-                    .height = (itemGridHeight + Layout.ItemArea.Grid.Insets.top + Layout.ItemArea.Grid.Insets.bottom) // Include the splace necessary to account for the item grid top/bottom insets
+                    .width = itemWidth,
+                    .height = Layout.ItemArea.Grid.RowHeight
                 }
-            };
+            });
 
-            if (Layout.ItemArea.HasBackground) {
-                NSIndexPath *indexPath = [NSIndexPath indexPathForItem:0 inSection:section];
-                UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForSupplementaryViewOfKind:BLMCollectionViewKindItemAreaBackground withIndexPath:indexPath];
+            [items addObject:attributes];
+        }
 
-                attributes.zIndex = -1;
-                attributes.frame = CGRectPixelAlign(itemAreaFrame);
+        sectionFrame.size.height += (CGRectGetHeight(itemAreaFrame) + Layout.ItemArea.Insets.top + Layout.ItemArea.Insets.bottom); // Extend section frame to include the item area and its insets
+    }
 
-                self.attributesByIndexPathByKind[BLMCollectionViewKindItemAreaBackground][indexPath] = attributes;
-            }
+    if (Layout.Footer.Height > 0) {
+        NSIndexPath *indexPath = [NSIndexPath indexPathForItem:0 inSection:section];
+        UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForSupplementaryViewOfKind:BLMCollectionViewKindFooter withIndexPath:indexPath];
 
-            CGRect itemGridFrame = {
-                .origin = {
-                    .x = (CGRectGetMinX(itemAreaFrame) + Layout.ItemArea.Grid.Insets.left),
-                    .y = (CGRectGetMinY(itemAreaFrame) + Layout.ItemArea.Grid.Insets.top)
-                },
-                .size = {
-                    .width = (CGRectGetWidth(itemAreaFrame) - Layout.ItemArea.Grid.Insets.left - Layout.ItemArea.Grid.Insets.right),
-                    .height = itemGridHeight
-                }
-            };
-
-            CGFloat itemWidth = ((CGRectGetWidth(itemGridFrame) // To find the width of item cells in this section, start with the item area width...
-                                  - (Layout.ItemArea.Grid.ColumnSpacing // ...then subtract the horizontal inter-column space...
-                                     * (Layout.ItemArea.Grid.ColumnCount - 1))) // ...multiplied by the total number of inter-column spaces...
-                                 / Layout.ItemArea.Grid.ColumnCount); // ...then divide the remaining space by the number of columns...
-
-            for (NSInteger item = 0; item < itemCount; item += 1) {
-                NSIndexPath *indexPath = [NSIndexPath indexPathForItem:item inSection:section];
-                UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForCellWithIndexPath:indexPath];
-
-                attributes.frame = CGRectPixelAlign((CGRect) {
-                    .origin = {
-                        .x = (CGRectGetMinX(itemGridFrame) // Starting at the left edge...
-                              + ((itemWidth + Layout.ItemArea.Grid.ColumnSpacing) // ...then move over by the width of a column and its horizontal spacing...
-                                 * (item % Layout.ItemArea.Grid.ColumnCount))), // ...multiplied by the column number for this item.
-                        .y = (CGRectGetMinY(itemGridFrame)  // Starting at the top edge...
-                              + ((Layout.ItemArea.Grid.RowHeight + Layout.ItemArea.Grid.RowSpacing) // ...then move down by the height of a row and its vertical spacing...
-                                 * (item / Layout.ItemArea.Grid.ColumnCount))) // ...multiplied by the row number for this item.
-                    },
-                    .size = {
-                        .width = itemWidth,
-                        .height = Layout.ItemArea.Grid.RowHeight
-                    }
-                });
-
-                self.attributesByIndexPathByKind[BLMCollectionViewKindItemCell][indexPath] = attributes;
+        attributes.frame = CGRectPixelAlign((CGRect) {
+            .origin = {
+                .x = (CGRectGetMinX(sectionFrame) + Layout.Footer.Insets.left),
+                .y = (CGRectGetMaxY(sectionFrame) + Layout.Footer.Insets.top)
+            },
+            .size = {
+                .width = (sectionWidth - Layout.Footer.Insets.left - Layout.Footer.Insets.right),
+                .height = Layout.Footer.Height
             }
+        });
 
-            sectionFrame.size.height += (CGRectGetHeight(itemAreaFrame) + Layout.ItemArea.Insets.top + Layout.ItemArea.Insets.bottom); // Extend section frame to include the item area and its insets
-        }
+        sectionAttributes.footer = attributes;
 
-        if (Layout.Footer.Height > 0) {
-            NSIndexPath *indexPath = [NSIndexPath indexPathForItem:0 inSection:section];
-            UICollectionViewLayoutAttributes *attributes = [UICollectionViewLayoutAttributes layoutAttributesForSupplementaryViewOfKind:BLMCollectionViewKindFooter withIndexPath:indexPath];
+        sectionFrame.size.height += (Layout.Footer.Height + Layout.Footer.Insets.top + Layout.Footer.Insets.bottom); // Extend section frame to include the footer and its insets
+    }
 
-            attributes.frame = CGRectPixelAlign((CGRect) {
-                .origin = {
-                    .x = (CGRectGetMinX(sectionFrame) + Layout.Footer.Insets.left),
-                    .y = (CGRectGetMaxY(sectionFrame) + Layout.Footer.Insets.top)
-                },
-                .size = {
-                    .width = (sectionWidth - Layout.Footer.Insets.left - Layout.Footer.Insets.right),
-                    .height = Layout.Footer.Height
-                }
-            });
+    sectionAttributes.originY = originY;
+    sectionAttributes.frame = sectionFrame;
+    sectionAttributes.items = items;
 
-            self.attributesByIndexPathByKind[BLMCollectionViewKindFooter][indexPath] = attributes;
+    if (section < self.sectionAttributesList.count) {
+        self.sectionAttributesList[section] = sectionAttributes;
+    } else {
+        assert(section == self.sectionAttributesList.count);
+        [self.sectionAttributesList addObject:sectionAttributes];
+    }
+}
 
-            sectionFrame.size.height += (Layout.Footer.Height + Layout.Footer.Insets.top + Layout.Footer.Insets.bottom); // Extend section frame to include the footer and its insets
-        }
 
-        [self.sectionFrameList addObject:[NSValue valueWithCGRect:sectionFrame]];
+- (NSUInteger)indexOfFirstSectionEndingBelowY:(CGFloat)y { // Binary search, since sections are laid out top to bottom
+    NSUInteger low = 0;
+    NSUInteger high = self.sectionAttributesList.count;
+
+    while (low < high) {
+        NSUInteger middle = (low + ((high - low) / 2));
 
-        contentFrame = CGRectUnion(contentFrame, sectionFrame);
+        if (self.sectionAttributesList[middle].maxY <= y) {
+            low = (middle + 1);
+        } else {
+            high = middle;
+        }
     }
 
-    self.collectionViewContentSize = contentFrame.size;
+    return low;
 }
 
+#pragma mark Queries
 
 - (NSArray *)layoutAttributesForElementsInRect:(CGRect)rect {
     NSMutableArray<UICollectionViewLayoutAttributes *> *attributesForRect = [NSMutableArray array];
-    BOOL scannedPastRectMaxY = NO;
 
-    for (NSUInteger section = 0; ((section < self.collectionView.numberOfSections) && !scannedPastRectMaxY); section += 1) {
-        CGRect sectionFrame = self.sectionFrameList[section].CGRectValue;
+    for (NSUInteger section = [self indexOfFirstSectionEndingBelowY:CGRectGetMinY(rect)]; section < self.sectionAttributesList.count; section += 1) {
+        SectionAttributes *sectionAttributes = self.sectionAttributesList[section];
 
-        if (CGRectGetMinY(sectionFrame) > CGRectGetMaxY(rect)) {
-            scannedPastRectMaxY = YES;
+        if (sectionAttributes.minY > CGRectGetMaxY(rect)) {
             break;
         }
 
-        if (!CGRectIntersectsRect(sectionFrame, rect)) {
-            continue;
-        }
+        CGRect sectionRect = CGRectOffset(rect, 0.0, -sectionAttributes.originY); // Tested against the cached attributes, so only the ones returned are copied into position
 
-        for (NSString *kind in @[BLMCollectionViewKindHeader, BLMCollectionViewKindItemAreaBackground, BLMCollectionViewKindFooter]) {
-            [self.attributesByIndexPathByKind[kind] enumerateKeysAndObjectsUsingBlock:^(NSIndexPath *key, UICollectionViewLayoutAttributes *attributes, BOOL *stop) {
-                if (CGRectIntersectsRect(attributes.frame, rect)) {
-                    [attributesForRect addObject:attributes];
-                }
-            }];
+        for (UICollectionViewLayoutAttributes *attributes in sectionAttributes.supplementaryAttributes) {
+            if (CGRectIntersectsRect(attributes.frame, sectionRect)) {
+                [attributesForRect addObject:[sectionAttributes positionedAttributes:attributes]];
+            }
         }
 
-        NSInteger itemCount = [self.collectionView numberOfItemsInSection:section];
+        NSRange itemRange = [sectionAttributes itemRangeForRowsBetweenMinY:CGRectGetMinY(sectionRect) maxY:CGRectGetMaxY(sectionRect)];
 
-        for (NSInteger item = 0; item < itemCount; item += 1) {
-            NSIndexPath *indexPath = [NSIndexPath indexPathForItem:item inSection:section];
-            UICollectionViewLayoutAttributes *attributes = self.attributesByIndexPathByKind[BLMCollectionViewKindItemCell][indexPath];
+        for (NSUInteger item = itemRange.location; item < NSMaxRange(itemRange); item += 1) {
+            UICollectionViewLayoutAttributes *attributes = sectionAttributes.items[item];
 
-            if (CGRectGetMinY(attributes.frame) > CGRectGetMaxY(rect)) {
-                scannedPastRectMaxY = YES;
-                break;
-            }
-
-            if (CGRectIntersectsRect(attributes.frame, rect)) {
-                [attributesForRect addObject:attributes];
+            if (CGRectIntersectsRect(attributes.frame, sectionRect)) {
+                [attributesForRect addObject:[sectionAttributes positionedAttributes:attributes]];
             }
         }
     }
@@ -547,16 +824,32 @@ static CGFloat const HeaderFontSize = 18.0;
 
 
 - (UICollectionViewLayoutAttributes *)layoutAttributesForItemAtIndexPath:(NSIndexPath *)indexPath {
-    assert(self.attributesByIndexPathByKind[BLMCollectionViewKindItemCell][indexPath] != nil);
-    return self.attributesByIndexPathByKind[BLMCollectionViewKindItemCell][indexPath];
+    SectionAttributes *sectionAttributes = self.sectionAttributesList[indexPath.section];
+    assert(indexPath.item < (NSInteger)sectionAttributes.items.count);
+
+    return [sectionAttributes positionedAttributes:sectionAttributes.items[indexPath.item]];
 }
 
 
 - (UICollectionViewLayoutAttributes *)layoutAttributesForSupplementaryViewOfKind:(NSString *)elementKind atIndexPath:(NSIndexPath *)indexPath {
-    assert(self.attributesByIndexPathByKind[elementKind][indexPath] != nil);
-    return self.attributesByIndexPathByKind[elementKind][indexPath];
+    SectionAttributes *sectionAttributes = self.sectionAttributesList[indexPath.section];
+    UICollectionViewLayoutAttributes *attributes = [sectionAttributes supplementaryAttributesOfKind:elementKind];
+    assert(attributes != nil);
+
+    return [sectionAttributes positionedAttributes:attributes];
+}
+
+
+- (UICollectionViewLayoutAttributes *)previousLayoutAttributesForItemAtIndexPath:(NSIndexPath *)indexPath {
+    if (indexPath.section >= (NSInteger)self.previousSectionAttributesList.count) {
+        return nil;
+    }
+
+    SectionAttributes *sectionAttributes = self.previousSectionAttributesList[indexPath.section];
+    return ((indexPath.item < (NSInteger)sectionAttributes.items.count) ? [sectionAttributes positionedAttributes:sectionAttributes.items[indexPath.item]] : nil);
 }
 
+#pragma mark Updates
 
 - (nullable UICollectionViewLayoutAttributes *)initialLayoutAttributesForAppearingItemAtIndexPath:(NSIndexPath *)indexPath {
     UICollectionViewLayoutAttributes *attributes = [super initialLayoutAttributesForAppearingItemAtIndexPath:indexPath];
@@ -566,7 +859,7 @@ static CGFloat const HeaderFontSize = 18.0;
     } else {
         for (NSIndexPath *originalIndexPath in self.reloadedIndexPathByOriginalIndexPath) {
             if ([BLMUtils isObject:self.reloadedIndexPathByOriginalIndexPath[originalIndexPath] equalToObject:indexPath]) {
-                attributes = self.previousAttributesByIndexPathByKind[BLMCollectionViewKindItemCell][originalIndexPath];
+                attributes = [self previousLayoutAttributesForItemAtIndexPath:originalIndexPath];
                 break;
             }
         }
@@ -594,7 +887,8 @@ static CGFloat const HeaderFontSize = 18.0;
 
 
 - (nullable UICollectionViewLayoutAttributes *)initialLayoutAttributesForAppearingSupplementaryElementOfKind:(NSString *)elementKind atIndexPath:(NSIndexPath *)indexPath {
-    return self.attributesByIndexPathByKind[elementKind][indexPath];
+    SectionAttributes *sectionAttributes = self.sectionAttributesList[indexPath.section];
+    return [sectionAttributes positionedAttributes:[sectionAttributes supplementaryAttributesOfKind:elementKind]];
 }
 
 
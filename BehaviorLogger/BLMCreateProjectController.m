@@ -119,6 +119,8 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
     [self.view addSubview:self.collectionView];
     [self.view addConstraints:[BLMViewUtils constraintsForItem:self.collectionView equalToItem:self.view]];
+
+    [self.collectionView prefetchTextMeasurementsForSections:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, SectionCount)]];
 }
 
 
@@ -246,6 +248,75 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
                                                                  }];
 }
 
+
+- (NSString *)headerTitleForSection:(Section)section {
+    switch (section) {
+        case SectionProjectProperties:
+            return @"Basic Info";
+
+        case SectionSessionConfigurationProperties:
+            return @"Session Properties";
+
+        case SectionActionButtons:
+        case SectionCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+}
+
+
+- (NSString *)labelTextForItem:(NSInteger)item inSection:(Section)section {
+    switch (section) {
+        case SectionProjectProperties: {
+            switch ((ProjectProperty)item) {
+                case ProjectPropertyName:
+                    return @"Project:";
+
+                case ProjectPropertyClient:
+                    return @"Client:";
+
+                case ProjectPropertyCount: {
+                    assert(NO);
+                    break;
+                }
+            }
+        }
+
+        case SectionSessionConfigurationProperties: {
+            switch ((SessionConfigurationProperty)item) {
+                case SessionConfigurationPropertyCondition:
+                    return @"Condition:";
+
+                case SessionConfigurationPropertyLocation:
+                    return @"Location:";
+
+                case SessionConfigurationPropertyTherapist:
+                    return @"Therapist:";
+
+                case SessionConfigurationPropertyObserver:
+                    return @"Observer:";
+
+                case SessionConfigurationPropertyCount: {
+                    assert(NO);
+                    break;
+                }
+            }
+        }
+
+        case SectionActionButtons:
+            return nil;
+
+        case SectionCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+    
+    assert(NO);
+    return nil;
+}
+
 #pragma mark UICollectionViewDataSource
 
 - (NSInteger)numberOfSectionsInCollectionView:(UICollectionView *)collectionView {
@@ -326,23 +397,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
         view = headerView;
 
-        switch ((Section)indexPath.section) {
-            case SectionProjectProperties: {
-                headerView.label.text = @"Basic Info";
-                break;
-            }
-
-            case SectionSessionConfigurationProperties: {
-                headerView.label.text = @"Session Properties";
-                break;
-            }
-
-            case SectionActionButtons:
-            case SectionCount: {
-                assert(NO);
-                break;
-            }
-        }
+        headerView.label.text = [self headerTitleForSection:indexPath.section];
     } else if ([BLMUtils isString:kind equalToString:BLMCollectionViewKindFooter]) {
         view = [collectionView dequeueReusableSupplementaryViewOfKind:kind withReuseIdentifier:NSStringFromClass([BLMSectionSeparatorFooterView class]) forIndexPath:indexPath];
     }
@@ -439,57 +494,37 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     }
 }
 
-#pragma mark BLMCollectionViewCellDataSource
-
-- (NSString *)labelTextForCollectionViewCell:(BLMTextInputCell *)cell {
-    switch ((Section)cell.section) {
-        case SectionProjectProperties: {
-            switch ((ProjectProperty)cell.item) {
-                case ProjectPropertyName:
-                    return @"Project:";
-
-                case ProjectPropertyClient:
-                    return @"Client:";
-
-                case ProjectPropertyCount: {
-                    assert(NO);
-                    break;
-                }
-            }
-        }
 
+- (void)collectionView:(BLMCollectionView *)collectionView prefetchTextMeasurementsForSection:(NSUInteger)section {
+    switch ((Section)section) {
+        case SectionProjectProperties:
         case SectionSessionConfigurationProperties: {
-            switch ((SessionConfigurationProperty)cell.item) {
-                case SessionConfigurationPropertyCondition:
-                    return @"Condition:";
-
-                case SessionConfigurationPropertyLocation:
-                    return @"Location:";
-
-                case SessionConfigurationPropertyTherapist:
-                    return @"Therapist:";
+            BLMTextMeasurer *measurer = [BLMTextMeasurer sharedMeasurer];
+            NSMutableArray<NSString *> *labelTexts = [NSMutableArray array];
 
-                case SessionConfigurationPropertyObserver:
-                    return @"Observer:";
-
-                case SessionConfigurationPropertyCount: {
-                    assert(NO);
-                    break;
-                }
+            for (NSInteger item = 0; item < [self collectionView:collectionView numberOfItemsInSection:section]; item += 1) { // The data source, since this may be sent inside a batch update
+                [labelTexts addObject:[self labelTextForItem:item inSection:section]];
             }
+
+            [measurer prefetchSizesForTexts:labelTexts font:[BLMCollectionViewCell labelFont] width:BLMTextMeasurerUnboundedWidth];
+            [measurer prefetchSizesForTexts:@[[self headerTitleForSection:section]] font:[BLMSectionHeaderView labelFont] width:BLMTextMeasurerUnboundedWidth];
+            break;
         }
 
         case SectionActionButtons:
-            return nil;
+            break;
 
         case SectionCount: {
             assert(NO);
-            return nil;
+            break;
         }
     }
-    
-    assert(NO);
-    return nil;
+}
+
+#pragma mark BLMCollectionViewCellDataSource
+
+- (NSString *)labelTextForCollectionViewCell:(BLMTextInputCell *)cell {
+    return [self labelTextForItem:cell.item inSection:cell.section];
 }
 
 #pragma mark BLMTextInputCellDataSource
@@ -8,10 +8,20 @@
 
 #import <Foundation/Foundation.h>
 
+#import "BLMArchiveScheduler.h"
 #import "BLMBehavior.h"
+#import "BLMChangeFeed.h"
+#import "BLMDataManagerTransaction.h"
+#import "BLMDataSnapshot.h"
+#import "BLMEventRecorder.h"
+#import "BLMExportWriter.h"
+#import "BLMImportBatch.h"
+#import "BLMIntervalSampler.h"
 #import "BLMProject.h"
 #import "BLMSession.h"
+#import "BLMSessionAgreement.h"
 #import "BLMSessionConfiguration.h"
+#import "BLMTrendQuery.h"
 
 
 NS_ASSUME_NONNULL_BEGIN
@@ -20,16 +30,66 @@ NS_ASSUME_NONNULL_BEGIN
 extern NSString *const BLMDataManagerProjectErrorDomain;
 extern NSString *const BLMDataManagerBehaviorErrorDomain;
 
+extern NSString *const BLMDataManagerBatchCreatedNotification; // Posted once for a whole batch, in place of the per-object created notifications
+
+extern NSString *const BLMDataManagerBatchProjectsUserInfoKey; // NSArray<BLMProject *>
+extern NSString *const BLMDataManagerBatchBehaviorsUserInfoKey; // NSArray<BLMBehavior *>
+extern NSString *const BLMDataManagerBatchSessionsUserInfoKey; // NSArray<BLMSession *>
+extern NSString *const BLMDataManagerBatchSessionConfigurationsUserInfoKey; // NSArray<BLMSessionConfiguration *>
+
+extern NSString *const BLMDataManagerTransactionCommittedNotification; // Posted once per transaction that changed anything, in place of the per-object notifications
+
+extern NSString *const BLMDataManagerChangeSetUserInfoKey; // BLMChangeSet
+
+extern NSString *const BLMDataManagerArchiveRestoreFailedNotification; // Posted on the main thread when an archive journal couldn't be read and was set aside, or sessions couldn't be moved into their project's shard
+
+extern NSString *const BLMDataManagerArchiveErrorUserInfoKey; // NSError
+
+
+typedef NS_ENUM(NSInteger, BLMDataManagerProjectError) {
+    BLMDataManagerProjectErrorInvalidName,
+    BLMDataManagerProjectErrorDuplicateName,
+    BLMDataManagerProjectErrorInvalidClient,
+    BLMDataManagerProjectErrorSessionDataNotLoaded // Sessions can only be added to a project whose shard is loaded
+};
+
+
+typedef NS_ENUM(NSInteger, BLMDataManagerBehaviorError) {
+    BLMDataManagerBehaviorErrorInvalidName,
+    BLMDataManagerBehaviorErrorDuplicateName // Behavior names are unique within a project, ignoring case
+};
+
+
+typedef NS_ENUM(NSInteger, BLMDataManagerRestorePhase) {
+    BLMDataManagerRestorePhaseProjects, // Projects are published; enough to render the project menu
+    BLMDataManagerRestorePhaseBehaviorsAndConfigurations, // Behaviors are published; decoded concurrently with session configurations
+    BLMDataManagerRestorePhaseSanitization, // Sanitized session configurations are published and the restore is complete
+    BLMDataManagerRestorePhaseCount
+};
+
+
+typedef void (^BLMDataManagerRestorePhaseHandler)(BLMDataManagerRestorePhase phase, NSTimeInterval duration);
+
 
 #pragma mark
 
 @interface BLMDataManager : NSObject
 
 @property (nonatomic, assign, readonly, getter=isRestoringArchive) BOOL restoringArchive;
+@property (nonatomic, assign, readonly, getter=areProjectsRestored) BOOL projectsRestored; // YES once BLMDataManagerRestorePhaseProjects has finished, before the rest of the archive is restored
+@property (nonatomic, strong, readonly) BLMArchiveScheduler *archiveScheduler;
+@property (nonatomic, strong, readonly) BLMChangeFeed *changeFeed; // Every created, updated and deleted object, except for objects faulted in or out with their project's session data
+@property (nonatomic, assign, readonly) uint64_t generation; // Advanced by every change to an object, including objects faulted in or out
 
 + (void)initializeWithCompletion:(nullable dispatch_block_t)completion;
++ (void)initializeWithPhaseHandler:(nullable BLMDataManagerRestorePhaseHandler)phaseHandler completion:(nullable dispatch_block_t)completion; // The handler runs on the main thread as each phase is published, with the time spent on it
 + (instancetype)sharedManager;
 
+- (void)flushArchiveWithCompletion:(nullable void(^)(NSError *__nullable error))completion; // The error of a journal that couldn't be written, whose changes stay pending for the next flush
+- (void)performTransaction:(void(^)(BLMDataManagerTransaction *transaction))block completion:(nullable void(^)(BLMChangeSet *__nullable changeSet, NSError *__nullable error))completion; // Applies everything the block staged at once, with a single archive write and a single BLMDataManagerTransactionCommittedNotification; if any change is invalid nothing is applied, and the completion gets the error instead of a change set
+- (BLMDataSnapshot *)snapshot; // In O(1); readable from any thread once taken
+- (NSProgress *)exportToFileHandle:(NSFileHandle *)fileHandle format:(BLMExportFormat)format completion:(void(^)(NSError *__nullable error))completion; // Streams every project, session and event from a snapshot taken in the background; cancelling the progress stops the export with NSUserCancelledError
+
 @end
 
 
@@ -41,9 +101,19 @@ extern NSString *const BLMDataManagerBehaviorErrorDomain;
 
 - (BLMProject *)projectForUUID:(NSUUID *)UUID;
 - (NSEnumerator<BLMProject *> *)projectEnumerator;
+- (NSSet<NSUUID *> *)projectUUIDsForClient:(NSString *)client;
+
+- (NSUInteger)projectCount;
+- (NSUInteger)indexOfProjectUUID:(NSUUID *)UUID; // Position in name order, in O(log n); NSNotFound for unknown projects
+- (NSUInteger)indexForProjectName:(NSString *)name; // Projects ordered before name, in O(log n); for a deleted project's name, the index it had
+- (NSUUID *)projectUUIDAtIndex:(NSUInteger)index;
+- (NSArray<NSUUID *> *)projectUUIDsInRange:(NSRange)range; // In name order
 - (void)createProjectWithName:(NSString *)name client:(NSString *)client sessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID completion:(nullable void(^)(BLMProject *__nullable project, NSError *__nullable error))completion;
 - (void)updateProjectForUUID:(NSUUID *)UUID property:(BLMProjectProperty)property value:(nullable id)value completion:(nullable void(^)(BLMProject *__nullable updatedProject, NSError *__nullable error))completion;
-- (void)deleteProjectForUUID:(NSUUID *)UUID completion:(nullable void(^)(NSError *__nullable error))completion;
+- (void)deleteProjectForUUID:(NSUUID *)UUID completion:(nullable void(^)(NSError *__nullable error))completion; // Along with its sessions, its configuration unless another project or session still uses it, and behaviors nothing else uses; an unloaded shard is loaded first
+
+- (void)createProjectsWithImportBatch:(BLMImportBatch *)batch completion:(nullable void(^)(NSArray<BLMProject *> *__nullable projects, NSError *__nullable error))completion; // Creates everything in the batch, or nothing if any name is invalid, with a single archive write and a single BLMDataManagerBatchCreatedNotification; a project with the same name and client as an existing one is merged into it, and that project's session data must be loaded
+- (void)importProjectsFromCSVFileAtURL:(NSURL *)URL completion:(nullable void(^)(NSArray<BLMProject *> *__nullable projects, NSError *__nullable error))completion; // Parses the file in the background, loads the session data of any project it merges into, then creates its projects as one batch
 
 @end
 
@@ -54,9 +124,10 @@ extern NSString *const BLMDataManagerBehaviorErrorDomain;
 
 - (BLMBehavior *)behaviorForUUID:(NSUUID *)UUID;
 - (NSEnumerator<BLMBehavior *> *)behaviorEnumerator;
+- (NSSet<NSUUID *> *)behaviorUUIDsWithName:(NSString *)name inSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID; // Ignoring case
 - (void)createBehaviorWithName:(NSString *)name continuous:(BOOL)continuous completion:(nullable void(^)(BLMBehavior *__nullable behavior, NSError *__nullable error))completion;
 - (void)updateBehaviorForUUID:(NSUUID *)UUID property:(BLMBehaviorProperty)property value:(nullable id)value completion:(nullable void(^)(BLMBehavior *__nullable updatedBehavior, NSError *__nullable error))completion;
-- (void)deleteBehaviorForUUID:(NSUUID *)UUID completion:(void(^__nullable)(NSError *__nullable error))completion;
+- (void)deleteBehaviorForUUID:(NSUUID *)UUID completion:(void(^__nullable)(NSError *__nullable error))completion; // Also removes it from every project's configuration; sessions' configurations keep it, so their recorded events keep their behavior indexes
 
 @end
 
@@ -68,10 +139,22 @@ extern NSString *const BLMDataManagerBehaviorErrorDomain;
 
 - (BLMSession *)sessionForUUID:(NSUUID *)UUID;
 - (NSEnumerator<BLMSession *> *)sessionEnumerator;
+- (nullable NSUUID *)projectUUIDForSessionUUID:(NSUUID *)UUID; // Known whether or not the project's session data is loaded
 - (void)createSessionWithName:(NSString *)name configurationUUID:(NSUUID *)configurationUUID completion:(nullable void(^)(BLMSession *__nullable session, NSError *__nullable error))completion;
 - (void)updateSessionForUUID:(NSUUID *)UUID property:(BLMSessionProperty)property value:(nullable id)value completion:(nullable void(^)(BLMSession *__nullable updatedSession, NSError *__nullable error))completion;
 - (void)deleteSessionForUUID:(NSUUID *)UUID completion:(nullable void(^)(NSError *__nullable error))completion;
 
+- (BOOL)isSessionDataLoadedForProjectUUID:(NSUUID *)projectUUID;
+- (void)loadSessionDataForProjectUUID:(NSUUID *)projectUUID completion:(nullable dispatch_block_t)completion; // Faults in the project's sessions and their configurations; balance with relinquishSessionDataForProjectUUID:
+- (void)relinquishSessionDataForProjectUUID:(NSUUID *)projectUUID; // Unused session data stays cached until memory runs low
+
+- (BLMEventRecorder *)eventRecorderForSessionUUID:(NSUUID *)UUID; // Records into the session's event store, which is deleted along with the session
+- (BLMSessionMetrics *)metricsForSessionUUID:(NSUUID *)UUID; // Empty metrics keyed to the session's configuration; apply events to them as they are recorded
+- (void)computeMetricsForSessionUUIDs:(NSArray<NSUUID *> *)UUIDs completion:(void(^)(NSDictionary<NSUUID *, BLMSessionMetrics *> *metricsBySessionUUID))completion; // Replays each session's stored events in the background; the sessions' data must be loaded
+- (void)loadIntervalSamplerForSessionUUID:(NSUUID *)UUID completion:(void(^)(BLMIntervalSampler *sampler))completion; // Sorts the session's stored events in the background; the session's data must be loaded
+- (void)computeAgreementForProjectUUIDs:(NSArray<NSUUID *> *)projectUUIDs intervalLength:(BLMTimeInterval)intervalLength completion:(void(^)(NSArray<BLMSessionAgreement *> *agreements))completion; // Pairs each project's ended sessions that overlap in time and have comparable configurations, then scores the pairs in parallel in the background; the projects' session data must be loaded
+- (void)executeTrendQuery:(BLMTrendQuery *)query forProjectUUID:(NSUUID *)projectUUID completion:(void(^)(NSDictionary<NSString *, NSArray<BLMTrendPoint *> *> *pointsByGroup))completion; // Points are in start date order; each ended session's metrics are summarized once and kept until the session is updated; the project's session data must be loaded
+
 @end
 
 
@@ -81,9 +164,10 @@ extern NSString *const BLMDataManagerBehaviorErrorDomain;
 
 - (BLMSessionConfiguration *)sessionConfigurationForUUID:(NSUUID *)UUID;
 - (NSEnumerator<BLMSessionConfiguration *> *)sessionConfigurationEnumerator;
+- (NSSet<NSUUID *> *)sessionConfigurationUUIDsReferencingBehaviorUUID:(NSUUID *)behaviorUUID; // Only configurations in memory, so those of sessions in unloaded shards are missing
 - (void)createSessionConfigurationWithCondition:(nullable NSString *)condition location:(nullable NSString *)location therapist:(nullable NSString *)therapist observer:(nullable NSString *)observer timeLimit:(BLMTimeInterval)timeLimit timeLimitOptions:(BLMTimeLimitOptions)timeLimitOptions behaviorUUIDs:(nullable NSOrderedSet<NSUUID *> *)behaviorUUIDs completion:(nullable void(^)(BLMSessionConfiguration *__nullable sessionConfiguration, NSError *__nullable error))completion;
-- (void)updateSessionConfigurationForUUID:(NSUUID *)UUID property:(BLMSessionConfigurationProperty)property value:(nullable id)value completion:(nullable void(^)(BLMSessionConfiguration *__nullable updatedSessionConfiguration, NSError *__nullable error))completion;
-- (void)deleteSessionConfigurationForUUID:(NSUUID *)UUID completion:(nullable void(^)(NSError *__nullable error))completion;
+- (void)updateSessionConfigurationForUUID:(NSUUID *)UUID property:(BLMSessionConfigurationProperty)property value:(nullable id)value completion:(nullable void(^)(BLMSessionConfiguration *__nullable updatedSessionConfiguration, NSError *__nullable error))completion; // A behavior removed from the last configuration using it, in any shard, is deleted
+- (void)deleteSessionConfigurationForUUID:(NSUUID *)UUID completion:(nullable void(^)(NSError *__nullable error))completion; // Likewise deletes behaviors only it used
 
 @end
 
@@ -6,14 +6,24 @@
 //  Copyright © 2016 3Bird. All rights reserved.
 //
 
+#import "BLMArchiveJournal.h"
+#import "BLMArchiveScheduler.h"
 #import "BLMDataManager.h"
+#import "BLMEventStore.h"
+#import "BLMExportWriter.h"
+#import "BLMImportBatch.h"
+#import "BLMModelIndex.h"
+#import "BLMPersistentMap.h"
 #import "BLMProject.h"
+#import "BLMProjectOrder.h"
 #import "BLMSession.h"
+#import "BLMSessionSummary.h"
 #import "BLMUtils.h"
 #import "NSSet+BLMAdditions.h"
 #import "NSOrderedSet+BLMAdditions.h"
 
 #import <objc/runtime.h>
+#import <UIKit/UIKit.h>
 
 
 #pragma mark Constants
@@ -21,9 +31,23 @@
 NSString *const BLMDataManagerProjectErrorDomain = @"com.3bird.BehaviorLogger.Project";
 NSString *const BLMDataManagerBehaviorErrorDomain = @"com.3bird.BehaviorLogger.Behavior";
 
+NSString *const BLMDataManagerBatchCreatedNotification = @"BLMDataManagerBatchCreatedNotification";
 
-static NSString *const ArchiveFileName = @"project.dat";
-static NSString *const ArchiveVersionKey = @"ArchiveVersionKey";
+NSString *const BLMDataManagerBatchProjectsUserInfoKey = @"BLMDataManagerBatchProjectsUserInfoKey";
+NSString *const BLMDataManagerBatchBehaviorsUserInfoKey = @"BLMDataManagerBatchBehaviorsUserInfoKey";
+NSString *const BLMDataManagerBatchSessionsUserInfoKey = @"BLMDataManagerBatchSessionsUserInfoKey";
+NSString *const BLMDataManagerBatchSessionConfigurationsUserInfoKey = @"BLMDataManagerBatchSessionConfigurationsUserInfoKey";
+
+NSString *const BLMDataManagerTransactionCommittedNotification = @"BLMDataManagerTransactionCommittedNotification";
+
+NSString *const BLMDataManagerChangeSetUserInfoKey = @"BLMDataManagerChangeSetUserInfoKey";
+
+NSString *const BLMDataManagerArchiveRestoreFailedNotification = @"BLMDataManagerArchiveRestoreFailedNotification";
+
+NSString *const BLMDataManagerArchiveErrorUserInfoKey = @"BLMDataManagerArchiveErrorUserInfoKey";
+
+
+static NSString *const ArchiveName = @"project";
 
 
 static inline NSString *ArchiveDirectory() {
@@ -39,22 +63,44 @@ static inline NSString *ArchiveDirectory() {
 }
 
 
-typedef NS_ENUM(NSInteger, ArchiveVersion) {
-    ArchiveVersionUnknown,
-    ArchiveVersionLatest
-};
+static inline NSString *ShardDirectory() { // Holds one archive per project with its sessions and their configurations
+    return [ArchiveDirectory() stringByAppendingPathComponent:@"Shards"];
+}
+
+
+static inline NSString *EventDirectory() { // Holds one event store per session, outside the shards so recording never rewrites a project's archive
+    return [ArchiveDirectory() stringByAppendingPathComponent:@"Events"];
+}
+
+
+static inline NSString *SummaryPath(NSUUID *sessionUUID) { // Summaries are a cache of the event stores, so they live beside them rather than in the shards
+    return [NSString pathWithComponents:@[ArchiveDirectory(), @"Summaries", [sessionUUID.UUIDString stringByAppendingPathExtension:@"summary"]]];
+}
 
 
 #pragma mark
 
-@interface BLMDataManager ()
+@interface BLMDataManager () <BLMArchiveSchedulerDataSource>
 
 @property (nonatomic, copy, readwrite) NSSet<NSString *> *projectNameSet;
-@property (nonatomic, copy, readonly) NSMutableDictionary<NSUUID*, BLMProject *> *projectByUUID;
-@property (nonatomic, copy, readonly) NSMutableDictionary<NSUUID*, BLMBehavior *> *behaviorByUUID;
-@property (nonatomic, copy, readonly) NSMutableDictionary<NSUUID*, BLMSession *> *sessionByUUID;
-@property (nonatomic, copy, readonly) NSMutableDictionary<NSUUID*, BLMSessionConfiguration *> *sessionConfigurationByUUID;
+@property (nonatomic, strong) BLMPersistentMap<NSUUID *, BLMProject *> *projectByUUID; // Each map is replaced by setObject:forUUID:kind:, so one that has been read is a snapshot
+@property (nonatomic, strong) BLMPersistentMap<NSUUID *, BLMBehavior *> *behaviorByUUID;
+@property (nonatomic, strong) BLMPersistentMap<NSUUID *, BLMSession *> *sessionByUUID;
+@property (nonatomic, strong) BLMPersistentMap<NSUUID *, BLMSessionConfiguration *> *sessionConfigurationByUUID;
+@property (nonatomic, assign, readwrite) uint64_t generation;
+@property (nonatomic, strong) BLMDataSnapshot *cachedSnapshot; // Shared by every caller until the generation advances
+@property (nonatomic, strong, readonly) BLMModelIndex *modelIndex; // Kept current by setObject:forUUID:kind:
+@property (nonatomic, strong, readonly) BLMProjectOrder *projectOrder; // Kept current by setObject:forUUID:kind:
 @property (nonatomic, strong, readonly) NSOperationQueue *archiveQueue;
+@property (nonatomic, strong, readonly) BLMArchiveJournal *archiveJournal; // Index of projects, behaviors and project session configurations; only accessed from archiveQueue
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, BLMArchiveJournal *> *shardJournalByProjectUUID;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSUUID *> *shardProjectUUIDByUUID; // Owning project of each session and session-specific configuration in a loaded shard
+@property (nonatomic, strong, readonly) NSMutableSet<NSUUID *> *loadedShardProjectUUIDs;
+@property (nonatomic, strong, readonly) NSCountedSet<NSUUID *> *accessedShardProjectUUIDs;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSMutableArray<dispatch_block_t> *> *shardLoadCompletionsByProjectUUID;
+@property (nonatomic, strong) NSDictionary<NSUUID *, NSArray<BLMArchiveMutation *> *> *unmigratedMutationsByProjectUUID; // Index copies whose move into the project's shard failed at restore; merged into the shard when it loads
+@property (nonatomic, strong, readonly) dispatch_queue_t eventQueue; // Serial queue on which every event store is accessed
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, BLMSessionSummary *> *summaryBySessionUUID; // Only accessed from eventQueue
 
 @end
 
@@ -62,10 +108,15 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 @implementation BLMDataManager
 
 + (void)initializeWithCompletion:(dispatch_block_t)completion {
+    [self initializeWithPhaseHandler:nil completion:completion];
+}
+
+
++ (void)initializeWithPhaseHandler:(BLMDataManagerRestorePhaseHandler)phaseHandler completion:(dispatch_block_t)completion {
     static dispatch_once_t onceToken;
 
     dispatch_once(&onceToken, ^{
-        [[BLMDataManager sharedManager] restoreArchivedStateWithCompletion:completion];
+        [[BLMDataManager sharedManager] restoreArchivedStateWithPhaseHandler:phaseHandler completion:completion];
     });
 }
 
@@ -91,15 +142,35 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
         return nil;
     }
 
-    _projectByUUID = [NSMutableDictionary dictionary];
-    _behaviorByUUID = [NSMutableDictionary dictionary];
-    _sessionConfigurationByUUID = [NSMutableDictionary dictionary];
+    _projectByUUID = [BLMPersistentMap map];
+    _behaviorByUUID = [BLMPersistentMap map];
+    _sessionByUUID = [BLMPersistentMap map];
+    _sessionConfigurationByUUID = [BLMPersistentMap map];
+    _modelIndex = [[BLMModelIndex alloc] init];
+    _projectOrder = [[BLMProjectOrder alloc] init];
+    _changeFeed = [[BLMChangeFeed alloc] init];
 
     _archiveQueue = [[NSOperationQueue alloc] init];
     _archiveQueue.name = [NSString stringWithFormat:@"%@ - Archive Queue", NSStringFromClass([self class])];
     _archiveQueue.qualityOfService = NSOperationQualityOfServiceBackground;
     _archiveQueue.maxConcurrentOperationCount = 1;
 
+    _archiveJournal = [[BLMArchiveJournal alloc] initWithDirectory:ArchiveDirectory() name:ArchiveName];
+    _archiveScheduler = [[BLMArchiveScheduler alloc] initWithPrimaryJournal:_archiveJournal queue:_archiveQueue dataSource:self];
+
+    _shardJournalByProjectUUID = [NSMutableDictionary dictionary];
+    _shardProjectUUIDByUUID = [NSMutableDictionary dictionary];
+    _loadedShardProjectUUIDs = [NSMutableSet set];
+    _accessedShardProjectUUIDs = [NSCountedSet set];
+    _shardLoadCompletionsByProjectUUID = [NSMutableDictionary dictionary];
+    _unmigratedMutationsByProjectUUID = @{};
+
+    _eventQueue = dispatch_queue_create([NSString stringWithFormat:@"%@ - Event Queue", NSStringFromClass([self class])].UTF8String, dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    _summaryBySessionUUID = [NSMutableDictionary dictionary];
+
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleApplicationDidReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleSessionUpdated:) name:BLMSessionUpdatedNotification object:nil];
+
     return self;
 }
 
@@ -136,6 +207,37 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 }
 
 
+- (NSSet<NSUUID *> *)projectUUIDsForClient:(NSString *)client {
+    return [self.modelIndex projectUUIDsForClient:client];
+}
+
+
+- (NSUInteger)projectCount {
+    assert([NSThread isMainThread]);
+    return self.projectByUUID.count;
+}
+
+
+- (NSUInteger)indexOfProjectUUID:(NSUUID *)UUID {
+    return [self.projectOrder indexOfProjectUUID:UUID];
+}
+
+
+- (NSUInteger)indexForProjectName:(NSString *)name {
+    return [self.projectOrder indexForProjectName:name];
+}
+
+
+- (NSUUID *)projectUUIDAtIndex:(NSUInteger)index {
+    return [self.projectOrder projectUUIDAtIndex:index];
+}
+
+
+- (NSArray<NSUUID *> *)projectUUIDsInRange:(NSRange)range {
+    return [self.projectOrder projectUUIDsInRange:range];
+}
+
+
 - (void)createProjectWithName:(NSString *)name client:(NSString *)client sessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID completion:(void(^)(BLMProject *project, NSError *error))completion {
     assert([NSThread isMainThread]);
 
@@ -143,9 +245,13 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
     self.projectNameSet = [self.projectNameSet setByAddingObject:name];
 
     BLMProject *project = [[BLMProject alloc] initWithUUID:[NSUUID UUID] name:name client:client sessionConfigurationUUID:sessionConfigurationUUID sessionUUIDs:nil];
-    self.projectByUUID[project.UUID] = project;
+    [self setObject:project forUUID:project.UUID kind:BLMArchiveEntityKindProject];
+
+    [self.loadedShardProjectUUIDs addObject:project.UUID]; // A new project's shard is empty, so there is nothing to fault in
 
-    [self archiveCurrentState];
+    [self.archiveScheduler markDirtyUUID:project.UUID kind:BLMArchiveEntityKindProject];
+
+    [self.changeFeed recordChangeForUUID:project.UUID kind:BLMArchiveEntityKindProject original:nil updated:project];
 
     NSDictionary *userInfo = @{ BLMProjectUpdatedProjectUserInfoKey:project };
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMProjectCreatedNotification object:project userInfo:userInfo];
@@ -180,13 +286,27 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
         self.projectNameSet = projectNameSet;
     }
 
-    self.projectByUUID[UUID] = updated;
+    [self setObject:updated forUUID:UUID kind:BLMArchiveEntityKindProject];
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindProject];
+
+    if (property == BLMProjectPropertySessionUUIDs) {
+        assert([self.loadedShardProjectUUIDs containsObject:UUID]);
+
+        for (NSUUID *sessionUUID in updated.sessionUUIDs) {
+            if (![original.sessionUUIDs containsObject:sessionUUID]) {
+                [self assignSessionUUID:sessionUUID toShardForProjectUUID:UUID];
+            }
+        }
+    }
 
-    [self archiveCurrentState];
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindProject original:original updated:updated];
 
     NSDictionary *userInfo = @{ BLMProjectOriginalProjectUserInfoKey:original, BLMProjectUpdatedProjectUserInfoKey:updated };
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMProjectUpdatedNotification object:original userInfo:userInfo];
 
+    [self deleteObjectsReleasedByObject:original kind:BLMArchiveEntityKindProject changeSet:nil];
+
     if (completion != nil) {
         completion(updated, nil);
     }
@@ -199,18 +319,334 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
     BLMProject *project = self.projectByUUID[UUID];
     assert(project != nil);
 
+    if (![self.loadedShardProjectUUIDs containsObject:UUID]) { // The shard's configurations hold references to behaviors, which are only released by deleting them from memory
+        [self loadSessionDataForProjectUUID:UUID completion:^{
+            if (self.projectByUUID[UUID] != nil) {
+                [self deleteProjectForUUID:UUID completion:completion];
+            } else if (completion != nil) { // Deleted by an earlier request while the shard was loading
+                completion(nil);
+            }
+
+            [self relinquishSessionDataForProjectUUID:UUID];
+        }];
+        return;
+    }
+
     self.projectNameSet = [self.projectNameSet setByRemovingObject:project.name];
-    [self.projectByUUID removeObjectForKey:UUID];
+    [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindProject];
 
-    [self archiveCurrentState];
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindProject];
+
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindProject original:project updated:nil];
 
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMProjectDeletedNotification object:project userInfo:nil];
 
+    [self deleteObjectsReleasedByObject:project kind:BLMArchiveEntityKindProject changeSet:nil]; // Its sessions with their events and configurations, and its own configuration, releasing their behaviors
+
+    [self unloadSessionDataForProjectUUID:UUID]; // Whatever the cascade left of the shard goes with it
+    [self.archiveScheduler discardJournal:[self shardJournalForProjectUUID:UUID]];
+    [self.shardJournalByProjectUUID removeObjectForKey:UUID];
+
     if (completion != nil) {
         completion(nil);
     }
 }
 
+
+- (void)createProjectsWithImportBatch:(BLMImportBatch *)batch completion:(void(^)(NSArray<BLMProject *> *projects, NSError *error))completion {
+    assert([NSThread isMainThread]);
+    assert(!self.isRestoringArchive);
+
+    NSError *error = [self validationErrorForImportBatch:batch];
+
+    if (error != nil) {
+        if (completion != nil) {
+            completion(nil, error);
+        }
+        return;
+    }
+
+    NSMutableArray<BLMProject *> *projects = [NSMutableArray array];
+    NSMutableArray<BLMProject *> *createdProjects = [NSMutableArray array];
+    NSMutableArray<BLMBehavior *> *behaviors = [NSMutableArray array];
+    NSMutableArray<BLMSession *> *sessions = [NSMutableArray array];
+    NSMutableArray<BLMSessionConfiguration *> *sessionConfigurations = [NSMutableArray array];
+    NSMutableDictionary<NSUUID *, NSData *> *eventsBySessionUUID = [NSMutableDictionary dictionary];
+    NSMutableArray<dispatch_block_t> *updateNotifications = [NSMutableArray array];
+    NSMutableSet<NSString *> *projectNameSet = [self.projectNameSet mutableCopy];
+    NSDate *creationDate = [NSDate date];
+
+    // Everything is only marked dirty here, so the scheduler encodes the whole batch into one record per journal
+    for (BLMImportedProject *importedProject in batch.projects) {
+        BLMProject *mergedProject = [self projectForImportedProject:importedProject]; // Sessions from another observer join the project they were recorded for
+        NSUUID *projectUUID = ((mergedProject != nil) ? mergedProject.UUID : [NSUUID UUID]);
+        BLMSessionConfiguration *originalProjectSessionConfiguration = self.sessionConfigurationByUUID[mergedProject.sessionConfigurationUUID];
+        NSMutableOrderedSet<NSUUID *> *behaviorUUIDs = ((originalProjectSessionConfiguration.behaviorUUIDs != nil) ? [originalProjectSessionConfiguration.behaviorUUIDs mutableCopy] : [NSMutableOrderedSet orderedSet]);
+        NSMutableData *behaviorIndexByImportedIndex = [NSMutableData dataWithLength:(importedProject.behaviors.count * sizeof(uint32_t))];
+        uint32_t *behaviorIndexes = behaviorIndexByImportedIndex.mutableBytes;
+        BOOL behaviorIndexesMatch = YES;
+        NSMutableOrderedSet<NSUUID *> *sessionUUIDs = [NSMutableOrderedSet orderedSet];
+
+        assert((mergedProject == nil) || [self.loadedShardProjectUUIDs containsObject:projectUUID]);
+
+        [importedProject.behaviors enumerateObjectsUsingBlock:^(BLMImportedBehavior *__nonnull importedBehavior, NSUInteger importedIndex, BOOL *__nonnull stop) {
+            NSUUID *behaviorUUID = ((originalProjectSessionConfiguration != nil) ? [self behaviorUUIDsWithName:importedBehavior.name inSessionConfigurationUUID:originalProjectSessionConfiguration.UUID].anyObject : nil);
+
+            if (behaviorUUID == nil) {
+                BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:importedBehavior.name continuous:importedBehavior.isContinuous];
+
+                [self setObject:behavior forUUID:behavior.UUID kind:BLMArchiveEntityKindBehavior];
+                [self.archiveScheduler markDirtyUUID:behavior.UUID kind:BLMArchiveEntityKindBehavior];
+                [self.changeFeed recordChangeForUUID:behavior.UUID kind:BLMArchiveEntityKindBehavior original:nil updated:behavior];
+
+                [behaviorUUIDs addObject:behavior.UUID];
+                [behaviors addObject:behavior];
+
+                behaviorUUID = behavior.UUID;
+            }
+
+            behaviorIndexes[importedIndex] = (uint32_t)[behaviorUUIDs indexOfObject:behaviorUUID];
+        }];
+
+        for (NSUInteger importedIndex = 0; importedIndex < importedProject.behaviors.count; importedIndex += 1) {
+            behaviorIndexesMatch = (behaviorIndexesMatch && (behaviorIndexes[importedIndex] == importedIndex));
+        }
+
+        BLMSessionConfiguration *projectSessionConfiguration = nil;
+
+        if (originalProjectSessionConfiguration == nil) {
+            projectSessionConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:[NSUUID UUID] condition:nil location:nil therapist:nil observer:nil timeLimit:0 timeLimitOptions:0 behaviorUUIDs:behaviorUUIDs];
+
+            [self setObject:projectSessionConfiguration forUUID:projectSessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self.archiveScheduler markDirtyUUID:projectSessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self.changeFeed recordChangeForUUID:projectSessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration original:nil updated:projectSessionConfiguration];
+            [self updateBehaviorReferenceCountsFromSessionConfiguration:nil toSessionConfiguration:projectSessionConfiguration changeSet:nil];
+            [sessionConfigurations addObject:projectSessionConfiguration];
+        } else if (behaviorUUIDs.count > originalProjectSessionConfiguration.behaviorUUIDs.count) { // Behaviors the project didn't have yet are added after its own
+            projectSessionConfiguration = [originalProjectSessionConfiguration copyWithUpdatedValuesByProperty:@{ @(BLMSessionConfigurationPropertyBehaviorUUIDs):[behaviorUUIDs copy] }];
+
+            [self setObject:projectSessionConfiguration forUUID:projectSessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self.archiveScheduler markDirtyUUID:projectSessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self.changeFeed recordChangeForUUID:projectSessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration original:originalProjectSessionConfiguration updated:projectSessionConfiguration];
+            [self updateBehaviorReferenceCountsFromSessionConfiguration:originalProjectSessionConfiguration toSessionConfiguration:projectSessionConfiguration changeSet:nil];
+
+            [updateNotifications addObject:^{
+                NSDictionary *userInfo = @{ BLMSessionConfigurationOriginalSessionConfigurationUserInfoKey:originalProjectSessionConfiguration, BLMSessionConfigurationUpdatedSessionConfigurationUserInfoKey:projectSessionConfiguration };
+                [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationUpdatedNotification object:originalProjectSessionConfiguration userInfo:userInfo];
+            }];
+        } else {
+            projectSessionConfiguration = originalProjectSessionConfiguration;
+        }
+
+        [self shardJournalForProjectUUID:projectUUID];
+
+        for (BLMImportedSession *importedSession in importedProject.sessions) { // Each session keeps its own condition, location, therapist and observer in a configuration stored in the project's shard
+            BLMSessionConfiguration *sessionConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:[NSUUID UUID] condition:importedSession.condition location:importedSession.location therapist:importedSession.therapist observer:importedSession.observer timeLimit:importedSession.timeLimit timeLimitOptions:0 behaviorUUIDs:projectSessionConfiguration.behaviorUUIDs];
+            BLMSession *session = [[BLMSession alloc] initWithUUID:[NSUUID UUID] name:importedSession.name configurationUUID:sessionConfiguration.UUID creationDate:creationDate startDate:importedSession.startDate endDate:importedSession.endDate];
+
+            [self setObject:sessionConfiguration forUUID:sessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self setObject:session forUUID:session.UUID kind:BLMArchiveEntityKindSession];
+            self.shardProjectUUIDByUUID[sessionConfiguration.UUID] = projectUUID;
+            self.shardProjectUUIDByUUID[session.UUID] = projectUUID;
+
+            [self.archiveScheduler markDirtyUUID:sessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self.archiveScheduler markDirtyUUID:session.UUID kind:BLMArchiveEntityKindSession];
+            [self.changeFeed recordChangeForUUID:sessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration original:nil updated:sessionConfiguration];
+            [self.changeFeed recordChangeForUUID:session.UUID kind:BLMArchiveEntityKindSession original:nil updated:session];
+            [self updateBehaviorReferenceCountsFromSessionConfiguration:nil toSessionConfiguration:sessionConfiguration changeSet:nil];
+
+            if (importedSession.events.length > 0) {
+                eventsBySessionUUID[session.UUID] = (behaviorIndexesMatch ? importedSession.events : [BLMDataManager eventsFromImportedEvents:importedSession.events behaviorIndexes:behaviorIndexes]);
+            }
+
+            [sessionUUIDs addObject:session.UUID];
+            [sessionConfigurations addObject:sessionConfiguration];
+            [sessions addObject:session];
+        }
+
+        if (mergedProject != nil) {
+            NSMutableOrderedSet<NSUUID *> *updatedSessionUUIDs = ((mergedProject.sessionUUIDs != nil) ? [mergedProject.sessionUUIDs mutableCopy] : [NSMutableOrderedSet orderedSet]);
+            [updatedSessionUUIDs unionOrderedSet:sessionUUIDs];
+
+            BLMProject *project = [mergedProject copyWithUpdatedValuesByProperty:@{ @(BLMProjectPropertySessionUUIDs):[updatedSessionUUIDs copy] }];
+
+            [self setObject:project forUUID:projectUUID kind:BLMArchiveEntityKindProject];
+            [self.archiveScheduler markDirtyUUID:projectUUID kind:BLMArchiveEntityKindProject];
+            [self.changeFeed recordChangeForUUID:projectUUID kind:BLMArchiveEntityKindProject original:mergedProject updated:project];
+
+            [updateNotifications addObject:^{
+                NSDictionary *userInfo = @{ BLMProjectOriginalProjectUserInfoKey:mergedProject, BLMProjectUpdatedProjectUserInfoKey:project };
+                [[NSNotificationCenter defaultCenter] postNotificationName:BLMProjectUpdatedNotification object:mergedProject userInfo:userInfo];
+            }];
+
+            [projects addObject:project];
+        } else {
+            BLMProject *project = [[BLMProject alloc] initWithUUID:projectUUID name:importedProject.name client:importedProject.client sessionConfigurationUUID:projectSessionConfiguration.UUID sessionUUIDs:sessionUUIDs];
+
+            [self setObject:project forUUID:projectUUID kind:BLMArchiveEntityKindProject];
+            [self.loadedShardProjectUUIDs addObject:projectUUID];
+            [self.archiveScheduler markDirtyUUID:projectUUID kind:BLMArchiveEntityKindProject];
+            [self.changeFeed recordChangeForUUID:projectUUID kind:BLMArchiveEntityKindProject original:nil updated:project];
+
+            [projectNameSet addObject:project.name];
+            [projects addObject:project];
+            [createdProjects addObject:project];
+        }
+    }
+
+    self.projectNameSet = projectNameSet;
+
+    [self.archiveScheduler flushWithCompletion:nil]; // Written now rather than after the latency window, so a large import is on disk as soon as possible
+
+    if (eventsBySessionUUID.count > 0) {
+        dispatch_async(self.eventQueue, ^{
+            [eventsBySessionUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull sessionUUID, NSData *__nonnull events, BOOL *__nonnull stop) {
+                BLMEventStore *eventStore = [[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:sessionUUID];
+
+                [eventStore appendEvents:events.bytes count:(events.length / sizeof(BLMSessionEvent))];
+                [eventStore close];
+            }];
+        });
+    }
+
+    NSDictionary *userInfo = @{ BLMDataManagerBatchProjectsUserInfoKey:createdProjects,
+                                BLMDataManagerBatchBehaviorsUserInfoKey:behaviors,
+                                BLMDataManagerBatchSessionsUserInfoKey:sessions,
+                                BLMDataManagerBatchSessionConfigurationsUserInfoKey:sessionConfigurations };
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:BLMDataManagerBatchCreatedNotification object:self userInfo:userInfo];
+
+    for (dispatch_block_t postNotification in updateNotifications) {
+        postNotification();
+    }
+
+    if (completion != nil) {
+        completion(projects, nil);
+    }
+}
+
+
+- (void)importProjectsFromCSVFileAtURL:(NSURL *)URL completion:(void(^)(NSArray<BLMProject *> *projects, NSError *error))completion {
+    assert([NSThread isMainThread]);
+
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        NSError *error = nil;
+        NSData *data = [NSData dataWithContentsOfURL:URL options:NSDataReadingMappedIfSafe error:&error];
+        BLMImportBatch *batch = ((data != nil) ? [BLMImportBatch batchWithCSVData:data error:&error] : nil);
+
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+            if (batch == nil) {
+                if (completion != nil) {
+                    completion(nil, error);
+                }
+                return;
+            }
+
+            NSMutableSet<NSUUID *> *mergedProjectUUIDs = [NSMutableSet set];
+
+            for (BLMImportedProject *importedProject in batch.projects) {
+                BLMProject *mergedProject = [self projectForImportedProject:importedProject];
+
+                if (mergedProject != nil) {
+                    [mergedProjectUUIDs addObject:mergedProject.UUID];
+                }
+            }
+
+            __block NSUInteger pendingLoadCount = (mergedProjectUUIDs.count + 1);
+
+            dispatch_block_t loadCompletion = ^{ // Sessions can only be added to a project whose shard is in memory
+                pendingLoadCount -= 1;
+
+                if (pendingLoadCount > 0) {
+                    return;
+                }
+
+                [self createProjectsWithImportBatch:batch completion:completion];
+
+                for (NSUUID *projectUUID in mergedProjectUUIDs) {
+                    [self relinquishSessionDataForProjectUUID:projectUUID];
+                }
+            };
+
+            for (NSUUID *projectUUID in mergedProjectUUIDs) {
+                [self loadSessionDataForProjectUUID:projectUUID completion:loadCompletion];
+            }
+
+            loadCompletion();
+        }];
+    });
+}
+
+
+- (BLMProject *)projectForImportedProject:(BLMImportedProject *)importedProject { // The existing project an import merges into: same name and client
+    for (NSUUID *projectUUID in [self projectUUIDsForClient:importedProject.client]) {
+        BLMProject *project = self.projectByUUID[projectUUID];
+
+        if ([BLMUtils isString:project.name equalToString:importedProject.name]) {
+            return project;
+        }
+    }
+
+    return nil;
+}
+
+
++ (NSData *)eventsFromImportedEvents:(NSData *)importedEvents behaviorIndexes:(uint32_t const *)behaviorIndexes { // Reindexes events against the behaviors of the project they were merged into
+    NSMutableData *events = [importedEvents mutableCopy];
+    BLMSessionEvent *event = events.mutableBytes;
+    NSUInteger eventCount = (events.length / sizeof(BLMSessionEvent));
+
+    for (NSUInteger index = 0; index < eventCount; index += 1) {
+        assert(event[index].BehaviorIndex < UINT32_MAX);
+        event[index].BehaviorIndex = behaviorIndexes[event[index].BehaviorIndex];
+    }
+
+    return events;
+}
+
+
+- (NSError *)validationErrorForImportBatch:(BLMImportBatch *)batch { // nil if every name would be accepted by the UI
+    NSMutableSet<NSString *> *projectNameSet = [self.projectNameSet mutableCopy];
+    NSCharacterSet *whitespaceCharacterSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+
+    NSError *(^errorForName)(NSString *, NSInteger, NSString *) = ^NSError *(NSString *domain, NSInteger code, NSString *name) {
+        return [NSError errorWithDomain:domain code:code userInfo:@{ NSLocalizedFailureReasonErrorKey:name }];
+    };
+
+    for (BLMImportedProject *importedProject in batch.projects) {
+        if (importedProject.name.length < BLMProjectNameMinimumLength) {
+            return errorForName(BLMDataManagerProjectErrorDomain, BLMDataManagerProjectErrorInvalidName, importedProject.name);
+        }
+
+        if ([projectNameSet containsObject:importedProject.name] && ([self projectForImportedProject:importedProject] == nil)) { // A project with the same name is only merged into if it is for the same client
+            return errorForName(BLMDataManagerProjectErrorDomain, BLMDataManagerProjectErrorDuplicateName, importedProject.name);
+        }
+        if (importedProject.client.length < BLMProjectClientMinimumLength) {
+            return errorForName(BLMDataManagerProjectErrorDomain, BLMDataManagerProjectErrorInvalidClient, importedProject.name);
+        }
+
+        [projectNameSet addObject:importedProject.name];
+
+        NSMutableSet<NSString *> *behaviorNameSet = [NSMutableSet set];
+
+        for (BLMImportedBehavior *importedBehavior in importedProject.behaviors) {
+            NSString *lowercaseName = [importedBehavior.name.lowercaseString stringByTrimmingCharactersInSet:whitespaceCharacterSet];
+
+            if (lowercaseName.length < BLMBehaviorNameMinimumLength) {
+                return errorForName(BLMDataManagerBehaviorErrorDomain, BLMDataManagerBehaviorErrorInvalidName, importedBehavior.name);
+            }
+
+            if ([behaviorNameSet containsObject:lowercaseName]) {
+                return errorForName(BLMDataManagerBehaviorErrorDomain, BLMDataManagerBehaviorErrorDuplicateName, importedBehavior.name);
+            }
+
+            [behaviorNameSet addObject:lowercaseName];
+        }
+    }
+
+    return nil;
+}
+
 #pragma mark BLMBehavior
 
 - (BLMBehavior *)behaviorForUUID:(NSUUID *)UUID {
@@ -225,15 +661,22 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 }
 
 
+- (NSSet<NSUUID *> *)behaviorUUIDsWithName:(NSString *)name inSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID {
+    return [self.modelIndex behaviorUUIDsWithCaseFoldedName:BLMCaseFoldedBehaviorName(name) inSessionConfigurationUUID:sessionConfigurationUUID];
+}
+
+
 - (void)createBehaviorWithName:(NSString *)name continuous:(BOOL)continuous completion:(void(^)(BLMBehavior *behavior, NSError *error))completion {
     assert([NSThread isMainThread]);
 
     NSUUID *UUID = [NSUUID UUID];
     BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:UUID name:name continuous:continuous];
 
-    self.behaviorByUUID[UUID] = behavior;
+    [self setObject:behavior forUUID:UUID kind:BLMArchiveEntityKindBehavior];
 
-    [self archiveCurrentState];
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindBehavior];
+
+    [self.changeFeed recordChangeForUUID:behavior.UUID kind:BLMArchiveEntityKindBehavior original:nil updated:behavior];
 
     NSDictionary *userInfo = @{ BLMBehaviorUpdatedBehaviorUserInfoKey:behavior };
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMBehaviorCreatedNotification object:behavior userInfo:userInfo];
@@ -257,9 +700,11 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
         return;
     }
 
-    self.behaviorByUUID[UUID] = updated;
+    [self setObject:updated forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindBehavior];
 
-    [self archiveCurrentState];
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindBehavior original:original updated:updated];
 
     NSDictionary *userInfo = @{ BLMBehaviorOriginalBehaviorUserInfoKey:original, BLMBehaviorUpdatedBehaviorUserInfoKey:updated };
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMBehaviorUpdatedNotification object:original userInfo:userInfo];
@@ -276,12 +721,16 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
     BLMBehavior *behavior = self.behaviorByUUID[UUID];
     assert(behavior != nil);
 
-    [self.behaviorByUUID removeObjectForKey:UUID];
+    [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindBehavior];
 
-    [self archiveCurrentState];
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindBehavior];
+
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindBehavior original:behavior updated:nil];
 
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMBehaviorDeletedNotification object:behavior userInfo:nil];
 
+    [self deleteObjectsReleasedByObject:behavior kind:BLMArchiveEntityKindBehavior changeSet:nil];
+
     if (completion != nil) {
         completion(nil);
     }
@@ -301,15 +750,22 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
 }
 
 
+- (NSUUID *)projectUUIDForSessionUUID:(NSUUID *)UUID {
+    return [self.modelIndex projectUUIDForSessionUUID:UUID];
+}
+
+
 - (void)createSessionWithName:(NSString *)name configurationUUID:(NSUUID *)configurationUUID completion:(nullable void(^)(BLMSession *__nullable session, NSError *__nullable error))completion {
     assert([NSThread isMainThread]);
 
     NSUUID *UUID = [NSUUID UUID];
     BLMSession *session = [[BLMSession alloc] initWithUUID:UUID name:name configurationUUID:configurationUUID creationDate:[NSDate date] startDate:nil endDate:nil];
 
-    self.sessionByUUID[UUID] = session;
+    [self setObject:session forUUID:UUID kind:BLMArchiveEntityKindSession];
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSession];
 
-    [self archiveCurrentState];
+    [self.changeFeed recordChangeForUUID:session.UUID kind:BLMArchiveEntityKindSession original:nil updated:session];
 
     NSDictionary *userInfo = @{ BLMSessionUpdatedSessionUserInfoKey:session };
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionCreatedNotification object:session userInfo:userInfo];
@@ -333,13 +789,17 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
         return;
     }
 
-    self.sessionByUUID[UUID] = updated;
+    [self setObject:updated forUUID:UUID kind:BLMArchiveEntityKindSession];
 
-    [self archiveCurrentState];
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSession];
+
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindSession original:original updated:updated];
 
     NSDictionary *userInfo = @{ BLMSessionOriginalSessionUserInfoKey:original, BLMSessionUpdatedSessionUserInfoKey:updated };
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionUpdatedNotification object:original userInfo:userInfo];
 
+    [self deleteObjectsReleasedByObject:original kind:BLMArchiveEntityKindSession changeSet:nil];
+
     if (completion != nil) {
         completion(updated, nil);
     }
@@ -352,245 +812,1385 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
     BLMSession *session = self.sessionByUUID[UUID];
     assert(session != nil);
 
-    [self.sessionByUUID removeObjectForKey:UUID];
+    [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindSession];
 
-    [self archiveCurrentState];
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSession];
+    [self discardEventsForSessionUUIDs:@[UUID]];
+
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindSession original:session updated:nil];
 
     [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionDeletedNotification object:session userInfo:nil];
 
+    [self deleteObjectsReleasedByObject:session kind:BLMArchiveEntityKindSession changeSet:nil];
+
     if (completion != nil) {
         completion(nil);
     }
 }
 
-#pragma mark BLMSessionConfiguration
+#pragma mark Session Events
 
-- (BLMSessionConfiguration *)sessionConfigurationForUUID:(NSUUID *)UUID {
+- (BLMEventRecorder *)eventRecorderForSessionUUID:(NSUUID *)UUID {
     assert([NSThread isMainThread]);
-    return self.sessionConfigurationByUUID[UUID];
-}
+    assert(self.sessionByUUID[UUID] != nil);
 
+    BLMEventStore *eventStore = [[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:UUID];
 
-- (NSEnumerator<BLMSessionConfiguration *> *)sessionConfigurationEnumerator {
-    assert([NSThread isMainThread]);
-    return self.sessionConfigurationByUUID.objectEnumerator;
+    return [[BLMEventRecorder alloc] initWithStore:eventStore queue:self.eventQueue];
 }
 
 
-- (void)createSessionConfigurationWithCondition:(NSString *)condition location:(NSString *)location therapist:(NSString *)therapist observer:(NSString *)observer timeLimit:(BLMTimeInterval)timeLimit timeLimitOptions:(BLMTimeLimitOptions)timeLimitOptions behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs completion:(void(^)(BLMSessionConfiguration *sessionConfiguration, NSError *error))completion {
+- (BLMSessionMetrics *)metricsForSessionUUID:(NSUUID *)UUID {
     assert([NSThread isMainThread]);
 
-    NSUUID *UUID = [NSUUID UUID];
-    BLMSessionConfiguration *sessionConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:UUID condition:condition location:location therapist:therapist observer:observer timeLimit:timeLimit timeLimitOptions:timeLimitOptions behaviorUUIDs:behaviorUUIDs];
-
-    self.sessionConfigurationByUUID[UUID] = sessionConfiguration;
+    BLMSession *session = self.sessionByUUID[UUID];
+    assert(session != nil);
 
-    [self archiveCurrentState];
+    BLMSessionConfiguration *sessionConfiguration = self.sessionConfigurationByUUID[session.configurationUUID];
+    assert(sessionConfiguration != nil);
 
-    NSDictionary *userInfo = @{ BLMBehaviorUpdatedBehaviorUserInfoKey:sessionConfiguration };
-    [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationCreatedNotification object:sessionConfiguration userInfo:userInfo];
+    NSMutableSet<NSUUID *> *continuousBehaviorUUIDs = [NSMutableSet set];
 
-    if (completion != nil) {
-        completion(sessionConfiguration, nil);
+    for (NSUUID *behaviorUUID in sessionConfiguration.behaviorUUIDs) {
+        if (self.behaviorByUUID[behaviorUUID].isContinuous) {
+            [continuousBehaviorUUIDs addObject:behaviorUUID];
+        }
     }
+
+    return [[BLMSessionMetrics alloc] initWithSessionConfiguration:sessionConfiguration continuousBehaviorUUIDs:continuousBehaviorUUIDs];
 }
 
 
-- (void)updateSessionConfigurationForUUID:(NSUUID *)UUID property:(BLMSessionConfigurationProperty)property value:(id)value completion:(void(^)(BLMSessionConfiguration *updatedSessionConfiguration, NSError *error))completion {
+- (void)computeMetricsForSessionUUIDs:(NSArray<NSUUID *> *)UUIDs completion:(void(^)(NSDictionary<NSUUID *, BLMSessionMetrics *> *metricsBySessionUUID))completion {
     assert([NSThread isMainThread]);
 
-    BLMSessionConfiguration *original = self.sessionConfigurationByUUID[UUID];
-    BLMSessionConfiguration *updated = [original copyWithUpdatedValuesByProperty:@{ @(property):(value ?: [NSNull null]) }];
+    NSMutableDictionary<NSUUID *, BLMSessionMetrics *> *metricsBySessionUUID = [NSMutableDictionary dictionary];
 
-    if ([BLMUtils isObject:original equalToObject:updated]) {
-        if (completion != nil) {
-            completion(original, nil);
-        }
-        return;
+    for (NSUUID *UUID in UUIDs) { // Everything read from the data model is captured here, so the replay never touches it
+        metricsBySessionUUID[UUID] = [self metricsForSessionUUID:UUID];
     }
 
-    self.sessionConfigurationByUUID[UUID] = updated;
-
-    [self archiveCurrentState];
-
-    NSDictionary *userInfo = @{ BLMSessionConfigurationOriginalSessionConfigurationUserInfoKey:original, BLMSessionConfigurationUpdatedSessionConfigurationUserInfoKey:updated };
-    [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationUpdatedNotification object:original userInfo:userInfo];
+    dispatch_async(self.eventQueue, ^{
+        [metricsBySessionUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull UUID, BLMSessionMetrics *__nonnull metrics, BOOL *__nonnull stop) {
+            [metrics applyEventsFromStore:[[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:UUID]];
+        }];
 
-    if (completion != nil) {
-        completion(updated, nil);
-    }
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+            completion(metricsBySessionUUID);
+        }];
+    });
 }
 
 
-- (void)deleteSessionConfigurationForUUID:(NSUUID *)UUID completion:(void(^)(NSError *error))completion {
+- (void)loadIntervalSamplerForSessionUUID:(NSUUID *)UUID completion:(void(^)(BLMIntervalSampler *sampler))completion {
     assert([NSThread isMainThread]);
 
-    BLMSessionConfiguration *sessionConfiguration = self.sessionConfigurationByUUID[UUID];
+    BLMSession *session = self.sessionByUUID[UUID];
+    assert(session != nil);
+
+    BLMSessionConfiguration *sessionConfiguration = self.sessionConfigurationByUUID[session.configurationUUID];
     assert(sessionConfiguration != nil);
 
-    [self.sessionConfigurationByUUID removeObjectForKey:UUID];
+    NSTimeInterval recordedLength = (((session.startDate != nil) && (session.endDate != nil)) ? [session.endDate timeIntervalSinceDate:session.startDate] : 0.0);
 
-    [self archiveCurrentState];
+    dispatch_async(self.eventQueue, ^{
+        BLMEventStore *eventStore = [[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:UUID];
+        uint64_t sessionLength = ((recordedLength > 0.0) ? (uint64_t)(recordedLength * NSEC_PER_SEC) : eventStore.lastTimeOffset); // A session that has not ended is scored up to its latest event
 
-    [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationDeletedNotification object:sessionConfiguration userInfo:nil];
+        BLMIntervalSampler *sampler = [[BLMIntervalSampler alloc] initWithSessionConfiguration:sessionConfiguration sessionLength:sessionLength];
+        [sampler applyEventsFromStore:eventStore];
 
-    if (completion != nil) {
-        completion(nil);
-    }
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+            completion(sampler);
+        }];
+    });
 }
 
-#pragma mark Archiving
 
-- (void)archiveCurrentState {
+- (void)computeAgreementForProjectUUIDs:(NSArray<NSUUID *> *)projectUUIDs intervalLength:(BLMTimeInterval)intervalLength completion:(void(^)(NSArray<BLMSessionAgreement *> *agreements))completion {
     assert([NSThread isMainThread]);
-    assert(!self.isRestoringArchive);
+    assert(intervalLength > 0);
 
-    if (self.archiveQueue.operationCount > 1) { // No need for enqueued archive operations to happen, since this one is the most up to date
-        [self.archiveQueue cancelAllOperations];
-    }
+    NSMutableArray<NSArray<NSUUID *> *> *sessionUUIDPairs = [NSMutableArray array];
+    NSMutableDictionary<NSUUID *, BLMIntervalSampler *> *samplerBySessionUUID = [NSMutableDictionary dictionary];
 
-    NSDictionary *projectByUUID = [self.projectByUUID copy];
-    NSDictionary *behaviorByUUID = [self.behaviorByUUID copy];
-    NSDictionary *sessionConfigurationByUUID = [self.sessionConfigurationByUUID copy];
+    for (NSUUID *projectUUID in projectUUIDs) {
+        assert([self isSessionDataLoadedForProjectUUID:projectUUID]);
 
-    [self.archiveQueue addOperationWithBlock:^{
-        BOOL isDirectory = NO;
+        NSMutableArray<BLMSession *> *endedSessions = [NSMutableArray array];
 
-        if (![[NSFileManager defaultManager] fileExistsAtPath:ArchiveDirectory() isDirectory:&isDirectory]) {
-            if ([[NSFileManager defaultManager] createDirectoryAtPath:ArchiveDirectory() withIntermediateDirectories:YES attributes:nil error:NULL]) {
-                isDirectory = YES;
-            } else {
-                assert(NO);
-                return;
-            }
-        }
+        for (NSUUID *sessionUUID in self.projectByUUID[projectUUID].sessionUUIDs) {
+            BLMSession *session = self.sessionByUUID[sessionUUID];
 
-        if (!isDirectory) {
-            assert(NO);
-            return;
+            if ((session.startDate != nil) && (session.endDate != nil)) {
+                [endedSessions addObject:session];
+            }
         }
 
-        NSString *filePath = [ArchiveDirectory() stringByAppendingPathComponent:ArchiveFileName];
+        [endedSessions sortUsingComparator:^NSComparisonResult(BLMSession *__nonnull session, BLMSession *__nonnull otherSession) {
+            return [session.startDate compare:otherSession.startDate];
+        }];
 
-        if (![[NSFileManager defaultManager] fileExistsAtPath:filePath]
-            && ![[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:@{ NSFileProtectionKey : NSFileProtectionNone }]) {
-            assert(NO);
-            return;
-        }
+        for (NSUInteger index = 0; index < endedSessions.count; index += 1) {
+            BLMSession *primarySession = endedSessions[index];
 
-        NSMutableData *archiveData = [NSMutableData data];
-        NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:archiveData];
+            for (NSUInteger otherIndex = (index + 1); otherIndex < endedSessions.count; otherIndex += 1) {
+                BLMSession *secondarySession = endedSessions[otherIndex];
 
-        [archiver encodeInteger:ArchiveVersionLatest forKey:ArchiveVersionKey];
-        [archiver encodeObject:projectByUUID forKey:@"projectByUUID"];
-        [archiver encodeObject:behaviorByUUID forKey:@"behaviorByUUID"];
-        [archiver encodeObject:sessionConfigurationByUUID forKey:@"sessionConfigurationByUUID"];
-        [archiver finishEncoding];
+                if ([secondarySession.startDate compare:primarySession.endDate] != NSOrderedAscending) { // Every later session starts after this one ends
+                    break;
+                }
+
+                if (![self.sessionConfigurationByUUID[secondarySession.configurationUUID] isComparableToSessionConfiguration:self.sessionConfigurationByUUID[primarySession.configurationUUID]]) { // Every session has its own copy of its configuration, one per observer
+                    continue;
+                }
+
+                [sessionUUIDPairs addObject:@[primarySession.UUID, secondarySession.UUID]];
+
+                for (BLMSession *session in @[primarySession, secondarySession]) {
+                    if (samplerBySessionUUID[session.UUID] == nil) { // A session observed alongside several others is only replayed once
+                        NSTimeInterval sessionLength = [session.endDate timeIntervalSinceDate:session.startDate];
+                        samplerBySessionUUID[session.UUID] = [[BLMIntervalSampler alloc] initWithSessionConfiguration:self.sessionConfigurationByUUID[session.configurationUUID] sessionLength:(uint64_t)(MAX(sessionLength, 0.0) * NSEC_PER_SEC)];
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t binWidth = ((uint64_t)intervalLength * NSEC_PER_SEC);
+    NSArray<NSUUID *> *sessionUUIDs = samplerBySessionUUID.allKeys;
+
+    dispatch_async(self.eventQueue, ^{ // Holding the event queue keeps recorders from appending to the stores while they are read
+        dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+        NSMutableArray *agreements = [NSMutableArray array];
+
+        dispatch_apply(sessionUUIDs.count, queue, ^(size_t index) { // Each sampler is only touched by its own iteration
+            NSUUID *sessionUUID = sessionUUIDs[index];
+            [samplerBySessionUUID[sessionUUID] applyEventsFromStore:[[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:sessionUUID]];
+        });
+
+        for (NSUInteger index = 0; index < sessionUUIDPairs.count; index += 1) {
+            [agreements addObject:[NSNull null]];
+        }
+
+        dispatch_apply(sessionUUIDPairs.count, queue, ^(size_t index) { // Samplers are only read from here on
+            NSUUID *primarySessionUUID = sessionUUIDPairs[index][0];
+            NSUUID *secondarySessionUUID = sessionUUIDPairs[index][1];
+            BLMIntervalSampler *primarySampler = samplerBySessionUUID[primarySessionUUID];
+            BLMIntervalSampler *secondarySampler = samplerBySessionUUID[secondarySessionUUID];
+
+            BLMSessionAgreement *agreement = [[BLMSessionAgreement alloc] initWithPrimarySessionUUID:primarySessionUUID
+                                                                                      primarySampling:[primarySampler samplingWithBinWidth:binWidth]
+                                                                                 secondarySessionUUID:secondarySessionUUID
+                                                                                    secondarySampling:[secondarySampler samplingWithBinWidth:binWidth]
+                                                                                        behaviorUUIDs:primarySampler.behaviorUUIDs];
+
+            @synchronized (agreements) {
+                agreements[index] = agreement;
+            }
+        });
+
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+            completion(agreements);
+        }];
+    });
+}
+
+
+- (void)discardEventsForSessionUUIDs:(NSArray<NSUUID *> *)sessionUUIDs {
+    assert([NSThread isMainThread]);
+
+    if (sessionUUIDs.count == 0) {
+        return;
+    }
+
+    dispatch_async(self.eventQueue, ^{ // Queued behind any recorder still draining into these stores
+        for (NSUUID *sessionUUID in sessionUUIDs) {
+            [[[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:sessionUUID] discard];
+        }
+    });
+
+    [self discardSummariesForSessionUUIDs:sessionUUIDs];
+}
+
+#pragma mark Session Summaries
+
+- (void)executeTrendQuery:(BLMTrendQuery *)query forProjectUUID:(NSUUID *)projectUUID completion:(void(^)(NSDictionary<NSString *, NSArray<BLMTrendPoint *> *> *pointsByGroup))completion {
+    assert([NSThread isMainThread]);
+    assert([self isSessionDataLoadedForProjectUUID:projectUUID]);
+
+    NSMutableArray<BLMSession *> *sessions = [NSMutableArray array];
+    NSMutableDictionary<NSUUID *, NSString *> *groupBySessionUUID = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSUUID *, BLMSessionMetrics *> *metricsBySessionUUID = [NSMutableDictionary dictionary];
+
+    for (NSUUID *sessionUUID in self.projectByUUID[projectUUID].sessionUUIDs) {
+        BLMSession *session = self.sessionByUUID[sessionUUID];
+        BLMSessionConfiguration *sessionConfiguration = self.sessionConfigurationByUUID[session.configurationUUID];
+
+        if ((session.startDate == nil) || (session.endDate == nil) || ![query includesSessionStartDate:session.startDate] || ![sessionConfiguration.behaviorUUIDs containsObject:query.behaviorUUID]) {
+            continue;
+        }
+
+        [sessions addObject:session];
+        groupBySessionUUID[sessionUUID] = [query groupForSessionConfiguration:sessionConfiguration]; // Grouped by the configuration as it is now, so summaries survive configuration edits
+        metricsBySessionUUID[sessionUUID] = [self metricsForSessionUUID:sessionUUID]; // Only replayed if the session has no summary made with the same configuration and behaviors
+    }
+
+    [sessions sortUsingComparator:^NSComparisonResult(BLMSession *__nonnull session, BLMSession *__nonnull otherSession) {
+        return [session.startDate compare:otherSession.startDate];
+    }];
+
+    dispatch_async(self.eventQueue, ^{
+        NSMutableDictionary<NSString *, NSMutableArray<BLMTrendPoint *> *> *pointsByGroup = [NSMutableDictionary dictionary];
+
+        for (BLMSession *session in sessions) {
+            uint64_t observedTimeOffset = (uint64_t)(MAX([session.endDate timeIntervalSinceDate:session.startDate], 0.0) * NSEC_PER_SEC);
+            BLMSessionSummary *summary = [self summaryForSessionUUID:session.UUID metrics:metricsBySessionUUID[session.UUID] observedTimeOffset:observedTimeOffset];
+            BLMBehaviorMetricsSummary metricsSummary;
+
+            if (![summary getMetricsSummary:&metricsSummary forBehaviorUUID:query.behaviorUUID]) {
+                continue;
+            }
+
+            NSString *group = groupBySessionUUID[session.UUID];
+
+            if (pointsByGroup[group] == nil) {
+                pointsByGroup[group] = [NSMutableArray array];
+            }
+
+            [pointsByGroup[group] addObject:[[BLMTrendPoint alloc] initWithSessionUUID:session.UUID startDate:session.startDate value:[query valueForMetricsSummary:metricsSummary]]];
+        }
+
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+            completion(pointsByGroup);
+        }];
+    });
+}
+
+
+- (BLMSessionSummary *)summaryForSessionUUID:(NSUUID *)sessionUUID metrics:(BLMSessionMetrics *)metrics observedTimeOffset:(uint64_t)observedTimeOffset {
+    BLMSessionSummary *summary = self.summaryBySessionUUID[sessionUUID];
+
+    if ([summary isSummaryOfMetrics:metrics observedTimeOffset:observedTimeOffset]) {
+        return summary;
+    }
+
+    NSString *summaryPath = SummaryPath(sessionUUID);
+    summary = [BLMSessionSummary summaryWithContentsOfFile:summaryPath];
+
+    if (![summary isSummaryOfMetrics:metrics observedTimeOffset:observedTimeOffset]) { // Catches a session updated while the app was not running, and a behavior's continuity toggled while the summary was on disk
+        [metrics applyEventsFromStore:[[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:sessionUUID]];
+
+        summary = [[BLMSessionSummary alloc] initWithSessionUUID:sessionUUID metrics:metrics observedTimeOffset:observedTimeOffset];
+
+        [summary writeToFile:summaryPath]; // A summary that cannot be written is still used for this query, and recomputed for the next
+    }
+
+    self.summaryBySessionUUID[sessionUUID] = summary;
+
+    return summary;
+}
+
+
+- (void)discardSummariesForSessionUUIDs:(NSArray<NSUUID *> *)sessionUUIDs {
+    assert([NSThread isMainThread]);
+
+    if (sessionUUIDs.count == 0) {
+        return;
+    }
+
+    dispatch_async(self.eventQueue, ^{ // Ordered with the queries, so none can read a summary after it is discarded
+        for (NSUUID *sessionUUID in sessionUUIDs) {
+            [self.summaryBySessionUUID removeObjectForKey:sessionUUID];
+            [[NSFileManager defaultManager] removeItemAtPath:SummaryPath(sessionUUID) error:NULL];
+        }
+    });
+}
+
+
+- (void)handleSessionUpdated:(NSNotification *)notification {
+    BLMSession *original = notification.userInfo[BLMSessionOriginalSessionUserInfoKey];
+    [self discardSummariesForSessionUUIDs:@[original.UUID]];
+}
+
+#pragma mark BLMSessionConfiguration
+
+- (BLMSessionConfiguration *)sessionConfigurationForUUID:(NSUUID *)UUID {
+    assert([NSThread isMainThread]);
+    return self.sessionConfigurationByUUID[UUID];
+}
+
+
+- (NSEnumerator<BLMSessionConfiguration *> *)sessionConfigurationEnumerator {
+    assert([NSThread isMainThread]);
+    return self.sessionConfigurationByUUID.objectEnumerator;
+}
+
+
+- (NSSet<NSUUID *> *)sessionConfigurationUUIDsReferencingBehaviorUUID:(NSUUID *)behaviorUUID {
+    return [self.modelIndex sessionConfigurationUUIDsReferencingBehaviorUUID:behaviorUUID];
+}
+
+
+- (void)createSessionConfigurationWithCondition:(NSString *)condition location:(NSString *)location therapist:(NSString *)therapist observer:(NSString *)observer timeLimit:(BLMTimeInterval)timeLimit timeLimitOptions:(BLMTimeLimitOptions)timeLimitOptions behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs completion:(void(^)(BLMSessionConfiguration *sessionConfiguration, NSError *error))completion {
+    assert([NSThread isMainThread]);
+
+    NSUUID *UUID = [NSUUID UUID];
+    BLMSessionConfiguration *sessionConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:UUID condition:condition location:location therapist:therapist observer:observer timeLimit:timeLimit timeLimitOptions:timeLimitOptions behaviorUUIDs:behaviorUUIDs];
+
+    [self setObject:sessionConfiguration forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+    [self updateBehaviorReferenceCountsFromSessionConfiguration:nil toSessionConfiguration:sessionConfiguration changeSet:nil];
+
+    [self.changeFeed recordChangeForUUID:sessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration original:nil updated:sessionConfiguration];
+
+    NSDictionary *userInfo = @{ BLMBehaviorUpdatedBehaviorUserInfoKey:sessionConfiguration };
+    [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationCreatedNotification object:sessionConfiguration userInfo:userInfo];
+
+    if (completion != nil) {
+        completion(sessionConfiguration, nil);
+    }
+}
+
+
+- (void)updateSessionConfigurationForUUID:(NSUUID *)UUID property:(BLMSessionConfigurationProperty)property value:(id)value completion:(void(^)(BLMSessionConfiguration *updatedSessionConfiguration, NSError *error))completion {
+    assert([NSThread isMainThread]);
+
+    BLMSessionConfiguration *original = self.sessionConfigurationByUUID[UUID];
+    BLMSessionConfiguration *updated = [original copyWithUpdatedValuesByProperty:@{ @(property):(value ?: [NSNull null]) }];
+
+    if ([BLMUtils isObject:original equalToObject:updated]) {
+        if (completion != nil) {
+            completion(original, nil);
+        }
+        return;
+    }
+
+    [self setObject:updated forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration original:original updated:updated];
+
+    NSDictionary *userInfo = @{ BLMSessionConfigurationOriginalSessionConfigurationUserInfoKey:original, BLMSessionConfigurationUpdatedSessionConfigurationUserInfoKey:updated };
+    [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationUpdatedNotification object:original userInfo:userInfo];
+
+    [self updateBehaviorReferenceCountsFromSessionConfiguration:original toSessionConfiguration:updated changeSet:nil]; // A behavior removed from its last configuration is deleted
+
+    if (completion != nil) {
+        completion(updated, nil);
+    }
+}
+
+
+- (void)deleteSessionConfigurationForUUID:(NSUUID *)UUID completion:(void(^)(NSError *error))completion {
+    assert([NSThread isMainThread]);
+
+    BLMSessionConfiguration *sessionConfiguration = self.sessionConfigurationByUUID[UUID];
+    assert(sessionConfiguration != nil);
+
+    [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    [self.changeFeed recordChangeForUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration original:sessionConfiguration updated:nil];
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationDeletedNotification object:sessionConfiguration userInfo:nil];
+
+    [self updateBehaviorReferenceCountsFromSessionConfiguration:sessionConfiguration toSessionConfiguration:nil changeSet:nil];
+
+    if (completion != nil) {
+        completion(nil);
+    }
+}
+
+#pragma mark BLMArchiveSchedulerDataSource
+
+- (BLMArchiveJournal *)archiveScheduler:(BLMArchiveScheduler *)scheduler journalForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+        case BLMArchiveEntityKindBehavior:
+            return self.archiveJournal;
+
+        case BLMArchiveEntityKindSession:
+        case BLMArchiveEntityKindSessionConfiguration: {
+            NSUUID *projectUUID = self.shardProjectUUIDByUUID[UUID];
+            return ((projectUUID == nil) ? self.archiveJournal : self.shardJournalByProjectUUID[projectUUID]); // Project session configurations and sessions not yet added to a project live in the index
+        }
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+}
+
+
+- (id<NSCoding>)archiveScheduler:(BLMArchiveScheduler *)scheduler objectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    return [self objectByUUIDForKind:kind][UUID];
+}
+
+#pragma mark Project Shards
+
+- (BOOL)isSessionDataLoadedForProjectUUID:(NSUUID *)projectUUID {
+    assert([NSThread isMainThread]);
+    return [self.loadedShardProjectUUIDs containsObject:projectUUID];
+}
+
+
+- (void)loadSessionDataForProjectUUID:(NSUUID *)projectUUID completion:(dispatch_block_t)completion {
+    assert([NSThread isMainThread]);
+    assert(!self.isRestoringArchive);
+    assert(self.projectByUUID[projectUUID] != nil);
+
+    [self.accessedShardProjectUUIDs addObject:projectUUID];
+
+    if ([self.loadedShardProjectUUIDs containsObject:projectUUID]) {
+        if (completion != nil) {
+            completion();
+        }
+        return;
+    }
+
+    NSMutableArray<dispatch_block_t> *completions = self.shardLoadCompletionsByProjectUUID[projectUUID];
+
+    if (completions != nil) { // Already being loaded
+        if (completion != nil) {
+            [completions addObject:completion];
+        }
+        return;
+    }
+
+    completions = [NSMutableArray array];
+    self.shardLoadCompletionsByProjectUUID[projectUUID] = completions;
+
+    if (completion != nil) {
+        [completions addObject:completion];
+    }
+
+    BLMArchiveJournal *shardJournal = [self shardJournalForProjectUUID:projectUUID];
+
+    [self.archiveQueue addOperationWithBlock:^{
+        NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [shardJournal restoreObjectByUUIDByKind];
+
+        [self reportRestoreErrorForJournal:shardJournal];
+
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+            [self.shardLoadCompletionsByProjectUUID removeObjectForKey:projectUUID];
+
+            BLMProject *project = self.projectByUUID[projectUUID];
+
+            if (project != nil) { // Otherwise the project was deleted while its shard was loading
+                NSArray<BLMArchiveMutation *> *unmigratedMutations = self.unmigratedMutationsByProjectUUID[projectUUID];
+
+                for (BLMArchiveMutation *mutation in unmigratedMutations) { // The shard was empty at restore, so only sessions created since then can already be in it
+                    NSMutableDictionary<NSUUID *, id> *objectByUUID = objectByUUIDByKind[@(mutation.kind)];
+
+                    if (objectByUUID[mutation.UUID] == nil) {
+                        objectByUUID[mutation.UUID] = mutation.object;
+                    }
+                }
+
+                [self addSessionByUUID:objectByUUIDByKind[@(BLMArchiveEntityKindSession)] sessionConfigurationByUUID:objectByUUIDByKind[@(BLMArchiveEntityKindSessionConfiguration)] forProject:project];
+
+                if (unmigratedMutations != nil) { // Rewritten into the shard, which keeps them pending until a write succeeds; the index copies are dropped at the first launch that finds the shard
+                    for (BLMArchiveMutation *mutation in unmigratedMutations) {
+                        [self.archiveScheduler markDirtyUUID:mutation.UUID kind:mutation.kind];
+                    }
+
+                    NSMutableDictionary<NSUUID *, NSArray<BLMArchiveMutation *> *> *unmigratedMutationsByProjectUUID = [self.unmigratedMutationsByProjectUUID mutableCopy];
+                    [unmigratedMutationsByProjectUUID removeObjectForKey:projectUUID];
+                    self.unmigratedMutationsByProjectUUID = unmigratedMutationsByProjectUUID;
+                }
+            }
+
+            for (dispatch_block_t loadCompletion in completions) {
+                loadCompletion();
+            }
+        }];
+    }];
+}
+
+
+- (void)relinquishSessionDataForProjectUUID:(NSUUID *)projectUUID {
+    assert([NSThread isMainThread]);
+    assert([self.accessedShardProjectUUIDs countForObject:projectUUID] > 0);
+
+    [self.accessedShardProjectUUIDs removeObject:projectUUID];
+}
+
+
+- (void)addSessionByUUID:(NSDictionary<NSUUID *, BLMSession *> *)sessionByUUID sessionConfigurationByUUID:(NSDictionary<NSUUID *, BLMSessionConfiguration *> *)sessionConfigurationByUUID forProject:(BLMProject *)project {
+    assert([NSThread isMainThread]);
+    assert(![self.loadedShardProjectUUIDs containsObject:project.UUID]);
+
+    NSMutableSet<NSUUID *> *referencedSessionConfigurationUUIDs = [NSMutableSet set];
+
+    for (NSUUID *sessionUUID in project.sessionUUIDs) {
+        BLMSession *session = sessionByUUID[sessionUUID];
+
+        if (session == nil) {
+            assert(NO);
+            continue;
+        }
+
+        assert(self.sessionByUUID[sessionUUID] == nil);
+
+        [self setObject:session forUUID:sessionUUID kind:BLMArchiveEntityKindSession];
+        self.shardProjectUUIDByUUID[sessionUUID] = project.UUID;
+
+        [referencedSessionConfigurationUUIDs addObject:session.configurationUUID];
+    }
+
+    [sessionConfigurationByUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull UUID, BLMSessionConfiguration *__nonnull sessionConfiguration, BOOL *__nonnull stop) {
+        self.shardProjectUUIDByUUID[UUID] = project.UUID;
+
+        if ([referencedSessionConfigurationUUIDs containsObject:UUID]) {
+            assert(self.sessionConfigurationByUUID[UUID] == nil);
+            [self setObject:sessionConfiguration forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+        } else { // Not in memory, so the next flush records it as deleted from the shard
+            [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            [self updateBehaviorReferenceCountsFromSessionConfiguration:sessionConfiguration toSessionConfiguration:nil changeSet:nil];
+        }
+    }];
+
+    [sessionByUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull UUID, BLMSession *__nonnull session, BOOL *__nonnull stop) {
+        if (![project.sessionUUIDs containsObject:UUID]) {
+            self.shardProjectUUIDByUUID[UUID] = project.UUID;
+            [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindSession];
+        }
+    }];
+
+    [self.loadedShardProjectUUIDs addObject:project.UUID];
+}
+
+
+- (BOOL)hasPendingChangesForProjectUUID:(NSUUID *)projectUUID { // Changes made since the last flush, or that the last flush failed to write
+    assert([NSThread isMainThread]);
+
+    for (NSUUID *UUID in [self.shardProjectUUIDByUUID allKeysForObject:projectUUID]) {
+        if ([self.archiveScheduler isDirtyUUID:UUID kind:BLMArchiveEntityKindSession] || [self.archiveScheduler isDirtyUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration]) {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+
+- (void)unloadSessionDataForProjectUUID:(NSUUID *)projectUUID {
+    assert([NSThread isMainThread]);
+
+    NSArray<NSUUID *> *UUIDs = [self.shardProjectUUIDByUUID allKeysForObject:projectUUID];
+
+    for (NSUUID *UUID in UUIDs) {
+        [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindSession];
+        [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+    }
+
+    [self.shardProjectUUIDByUUID removeObjectsForKeys:UUIDs];
+    [self.loadedShardProjectUUIDs removeObject:projectUUID];
+}
+
+
+- (void)assignSessionUUID:(NSUUID *)sessionUUID toShardForProjectUUID:(NSUUID *)projectUUID {
+    assert([NSThread isMainThread]);
+
+    BLMSession *session = self.sessionByUUID[sessionUUID];
+    assert(session != nil);
+
+    [self shardJournalForProjectUUID:projectUUID];
+
+    self.shardProjectUUIDByUUID[sessionUUID] = projectUUID;
+    [self.archiveScheduler markDirtyUUID:sessionUUID kind:BLMArchiveEntityKindSession]; // Rewritten into the shard; a stale copy left in the index is dropped at the next launch
+
+    for (BLMProject *project in self.projectByUUID.objectEnumerator) {
+        if ([BLMUtils isObject:project.sessionConfigurationUUID equalToObject:session.configurationUUID]) { // Project session configurations always stay in the index
+            return;
+        }
+    }
+
+    self.shardProjectUUIDByUUID[session.configurationUUID] = projectUUID;
+    [self.archiveScheduler markDirtyUUID:session.configurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+}
+
+
+- (BLMArchiveJournal *)shardJournalForProjectUUID:(NSUUID *)projectUUID {
+    assert([NSThread isMainThread]);
+
+    BLMArchiveJournal *shardJournal = self.shardJournalByProjectUUID[projectUUID];
+
+    if (shardJournal == nil) {
+        shardJournal = [[BLMArchiveJournal alloc] initWithDirectory:ShardDirectory() name:projectUUID.UUIDString];
+        self.shardJournalByProjectUUID[projectUUID] = shardJournal;
+    }
+
+    return shardJournal;
+}
+
+
+- (void)handleApplicationDidReceiveMemoryWarning:(NSNotification *)notification {
+    if (self.isRestoringArchive) {
+        return;
+    }
+
+    [self.archiveScheduler flushWithCompletion:^(NSError *error) {
+        for (NSUUID *projectUUID in [self.loadedShardProjectUUIDs copy]) {
+            if (([self.accessedShardProjectUUIDs countForObject:projectUUID] == 0) && ![self hasPendingChangesForProjectUUID:projectUUID]) { // Unloading an entity with an unwritten change would record it as deleted
+                [self unloadSessionDataForProjectUUID:projectUUID];
+            }
+        }
+    }];
+}
+
+#pragma mark Transactions
+
+- (void)performTransaction:(void(^)(BLMDataManagerTransaction *transaction))block completion:(void(^)(BLMChangeSet *changeSet, NSError *error))completion {
+    assert([NSThread isMainThread]);
+    assert(!self.isRestoringArchive);
+
+    BLMDataManagerTransaction *transaction = [[BLMDataManagerTransaction alloc] initWithDataManager:self];
+    block(transaction);
+
+    BLMChangeSet *changeSet = [transaction changeSet];
+    NSError *error = [self validationErrorForChangeSet:changeSet];
+
+    if (error != nil) { // Nothing was applied, so the staged changes are simply dropped
+        if (completion != nil) {
+            completion(nil, error);
+        }
+        return;
+    }
+
+    if (!changeSet.isEmpty) {
+        [self applyChangeSet:changeSet];
+
+        [self.changeFeed recordChangeSet:changeSet];
+
+        [self.archiveScheduler flushWithCompletion:nil]; // Every change lands in one record per journal, with the shards' records written ahead of the index's
+
+        NSDictionary *userInfo = @{ BLMDataManagerChangeSetUserInfoKey:changeSet };
+        [[NSNotificationCenter defaultCenter] postNotificationName:BLMDataManagerTransactionCommittedNotification object:self userInfo:userInfo];
+    }
+
+    if (completion != nil) {
+        completion(changeSet, nil);
+    }
+}
+
+
+- (NSError *)validationErrorForChangeSet:(BLMChangeSet *)changeSet { // nil if applyChangeSet: can apply every change
+    assert([changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeDeleted].count == 0); // Transactions have no way to stage one
+
+    NSArray<NSUUID *> *createdProjectUUIDs = [changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeCreated];
+    NSArray<NSUUID *> *changedProjectUUIDs = [createdProjectUUIDs arrayByAddingObjectsFromArray:[changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeUpdated]];
+    NSMutableSet<NSString *> *projectNameSet = [self.projectNameSet mutableCopy];
+
+    NSError *(^errorForName)(NSInteger, NSString *) = ^NSError *(NSInteger code, NSString *name) {
+        return [NSError errorWithDomain:BLMDataManagerProjectErrorDomain code:code userInfo:@{ NSLocalizedFailureReasonErrorKey:(name ?: @"") }];
+    };
+
+    for (NSUUID *UUID in changedProjectUUIDs) { // Every original name is released first, so two projects may swap names
+        [projectNameSet removeObject:((BLMProject *)[changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindProject]).name];
+    }
+
+    for (NSUUID *UUID in changedProjectUUIDs) {
+        BLMProject *original = [changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindProject];
+        BLMProject *updated = [changeSet updatedObjectForUUID:UUID kind:BLMArchiveEntityKindProject];
+
+        if (![BLMUtils isString:original.name equalToString:updated.name] && (updated.name.length < BLMProjectNameMinimumLength)) { // Lengths are only checked as they change, as the UI does
+            return errorForName(BLMDataManagerProjectErrorInvalidName, updated.name);
+        }
+
+        if ([projectNameSet containsObject:updated.name]) {
+            return errorForName(BLMDataManagerProjectErrorDuplicateName, updated.name);
+        }
+
+        if (![BLMUtils isString:original.client equalToString:updated.client] && (updated.client.length < BLMProjectClientMinimumLength)) {
+            return errorForName(BLMDataManagerProjectErrorInvalidClient, updated.name);
+        }
+
+        [projectNameSet addObject:updated.name];
+
+        if ((original != nil) && ![self.loadedShardProjectUUIDs containsObject:UUID]) {
+            for (NSUUID *sessionUUID in updated.sessionUUIDs) {
+                if (![original.sessionUUIDs containsObject:sessionUUID]) {
+                    return errorForName(BLMDataManagerProjectErrorSessionDataNotLoaded, updated.name);
+                }
+            }
+        }
+    }
+
+    return nil;
+}
+
+
+- (void)applyChangeSet:(BLMChangeSet *)changeSet { // Only sent once validationErrorForChangeSet: has accepted the change set
+    assert([NSThread isMainThread]);
+
+    NSArray<NSUUID *> *createdProjectUUIDs = [changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeCreated];
+    NSArray<NSUUID *> *changedProjectUUIDs = [createdProjectUUIDs arrayByAddingObjectsFromArray:[changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeUpdated]];
+    NSMutableSet<NSString *> *projectNameSet = [self.projectNameSet mutableCopy];
+
+    for (NSUUID *UUID in changedProjectUUIDs) {
+        [projectNameSet removeObject:((BLMProject *)[changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindProject]).name];
+    }
+
+    for (NSUUID *UUID in changedProjectUUIDs) {
+        [projectNameSet addObject:((BLMProject *)[changeSet updatedObjectForUUID:UUID kind:BLMArchiveEntityKindProject]).name];
+    }
+
+    self.projectNameSet = projectNameSet;
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (BLMChangeType changeType = 0; changeType < BLMChangeTypeCount; changeType += 1) {
+            for (NSUUID *UUID in [changeSet UUIDsForKind:kind changeType:changeType]) {
+                [self setObject:[changeSet updatedObjectForUUID:UUID kind:kind] forUUID:UUID kind:kind];
+                [self.archiveScheduler markDirtyUUID:UUID kind:kind];
+            }
+        }
+    }
+
+    [self.loadedShardProjectUUIDs addObjectsFromArray:createdProjectUUIDs]; // A new project's shard is empty, so there is nothing to fault in
+
+    for (NSUUID *UUID in changedProjectUUIDs) { // Sessions are already in place, so they can be moved into their project's shard
+        BLMProject *original = [changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindProject];
+        BLMProject *updated = [changeSet updatedObjectForUUID:UUID kind:BLMArchiveEntityKindProject];
+
+        for (NSUUID *sessionUUID in updated.sessionUUIDs) {
+            if (![original.sessionUUIDs containsObject:sessionUUID]) {
+                assert([self.loadedShardProjectUUIDs containsObject:UUID]);
+                [self assignSessionUUID:sessionUUID toShardForProjectUUID:UUID];
+            }
+        }
+    }
+
+    for (NSUUID *UUID in [[changeSet UUIDsForKind:BLMArchiveEntityKindSessionConfiguration] copy]) { // Before the cascade below, whose replacements count their own
+        [self updateBehaviorReferenceCountsFromSessionConfiguration:[changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration] toSessionConfiguration:[changeSet updatedObjectForUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration] changeSet:changeSet];
+    }
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) { // Whatever the changes left unreferenced is deleted along with them and joins the change set, so its events are discarded below
+        for (NSUUID *UUID in [[changeSet UUIDsForKind:kind] copy]) {
+            id original = [changeSet originalObjectForUUID:UUID kind:kind];
+
+            if (original != nil) {
+                [self deleteObjectsReleasedByObject:original kind:kind changeSet:changeSet];
+            }
+        }
+    }
+
+    [self discardEventsForSessionUUIDs:[changeSet UUIDsForKind:BLMArchiveEntityKindSession changeType:BLMChangeTypeDeleted]];
+    [self discardSummariesForSessionUUIDs:[changeSet UUIDsForKind:BLMArchiveEntityKindSession changeType:BLMChangeTypeUpdated]];
+}
+
+
+#pragma mark Indexes
+
+- (void)setObject:(id)object forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind { // Every change to the object dictionaries goes through here, so the indexes never need a rescan
+    assert([NSThread isMainThread]);
+
+    BLMPersistentMap *objectByUUID = [self objectByUUIDForKind:kind];
+    id original = objectByUUID[UUID];
+
+    [self setObjectByUUID:[objectByUUID mapBySettingObject:object forKey:UUID] forKind:kind];
+
+    self.generation += 1;
+    self.cachedSnapshot = nil;
+
+    [self.modelIndex replaceObject:original withObject:object kind:kind];
+
+    if (kind == BLMArchiveEntityKindProject) {
+        NSString *originalName = ((BLMProject *)original).name;
+        NSString *updatedName = ((BLMProject *)object).name;
+
+        if (![BLMUtils isString:originalName equalToString:updatedName]) { // Collation keys are only recomputed when a name changes
+            if (originalName != nil) {
+                [self.projectOrder removeProjectUUID:UUID];
+            }
+
+            if (updatedName != nil) {
+                [self.projectOrder insertProjectUUID:UUID name:updatedName];
+            }
+        }
+    }
+}
+
+
+- (void)setObjectsFromDictionary:(NSDictionary<NSUUID *, id> *)objectByUUID kind:(BLMArchiveEntityKind)kind {
+    [objectByUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull UUID, id __nonnull object, BOOL *__nonnull stop) {
+        [self setObject:object forUUID:UUID kind:kind];
+    }];
+}
+
+
+- (BOOL)isModelIndexConsistent { // Compares the incrementally maintained indexes against a full rebuild; only asserted once restore completes, since BLMModelIndexTests cover the incremental updates
+    assert([NSThread isMainThread]);
+
+    BLMModelIndex *rebuiltIndex = [[BLMModelIndex alloc] init];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (id object in [self objectByUUIDForKind:kind].objectEnumerator) {
+            [rebuiltIndex replaceObject:nil withObject:object kind:kind];
+        }
+    }
+
+    return [rebuiltIndex isEqual:self.modelIndex];
+}
+
+
+- (BLMPersistentMap *)objectByUUIDForKind:(BLMArchiveEntityKind)kind {
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            return self.projectByUUID;
+
+        case BLMArchiveEntityKindBehavior:
+            return self.behaviorByUUID;
+
+        case BLMArchiveEntityKindSession:
+            return self.sessionByUUID;
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            return self.sessionConfigurationByUUID;
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+}
+
+
+- (void)setObjectByUUID:(BLMPersistentMap *)objectByUUID forKind:(BLMArchiveEntityKind)kind {
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            self.projectByUUID = objectByUUID;
+            break;
+
+        case BLMArchiveEntityKindBehavior:
+            self.behaviorByUUID = objectByUUID;
+            break;
+
+        case BLMArchiveEntityKindSession:
+            self.sessionByUUID = objectByUUID;
+            break;
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            self.sessionConfigurationByUUID = objectByUUID;
+            break;
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+#pragma mark References
+
+- (void)deleteObjectsReleasedByObject:(id)original kind:(BLMArchiveEntityKind)kind changeSet:(nullable BLMChangeSet *)changeSet { // Once original has been replaced or deleted; cascaded changes join changeSet if there is one, and are broadcast otherwise
+    assert([NSThread isMainThread]);
+
+    switch (kind) {
+        case BLMArchiveEntityKindProject: {
+            BLMProject *project = original;
+
+            for (NSUUID *sessionUUID in project.sessionUUIDs) {
+                [self deleteObjectIfUnreferencedForUUID:sessionUUID kind:BLMArchiveEntityKindSession changeSet:changeSet];
+            }
+
+            [self deleteObjectIfUnreferencedForUUID:project.sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration changeSet:changeSet];
+            break;
+        }
+
+        case BLMArchiveEntityKindBehavior: {
+            NSUUID *behaviorUUID = [original UUID];
+
+            if (self.behaviorByUUID[behaviorUUID] != nil) { // Only a deleted behavior releases anything
+                break;
+            }
+
+            for (NSUUID *sessionConfigurationUUID in [self.modelIndex sessionConfigurationUUIDsReferencingBehaviorUUID:behaviorUUID]) {
+                if (![self.modelIndex isProjectSessionConfigurationUUID:sessionConfigurationUUID]) { // A session's configuration keeps the behavior, since its recorded events index into its behaviors
+                    continue;
+                }
+
+                BLMSessionConfiguration *sessionConfiguration = self.sessionConfigurationByUUID[sessionConfigurationUUID];
+                NSOrderedSet *behaviorUUIDs = [sessionConfiguration.behaviorUUIDs orderedSetByRemovingObject:behaviorUUID];
+
+                [self replaceObject:sessionConfiguration withObject:[sessionConfiguration copyWithUpdatedValuesByProperty:@{ @(BLMSessionConfigurationPropertyBehaviorUUIDs):behaviorUUIDs }] forUUID:sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration changeSet:changeSet];
+            }
+
+            break;
+        }
+
+        case BLMArchiveEntityKindSession:
+            [self deleteObjectIfUnreferencedForUUID:((BLMSession *)original).configurationUUID kind:BLMArchiveEntityKindSessionConfiguration changeSet:changeSet];
+            break;
+
+        case BLMArchiveEntityKindSessionConfiguration: // Behaviors are released through their reference counts as the configuration is replaced
+            break;
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+
+- (void)deleteObjectIfUnreferencedForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind changeSet:(nullable BLMChangeSet *)changeSet {
+    id object = [self objectByUUIDForKind:kind][UUID];
+
+    if ((object == nil) || ([self.modelIndex referenceCountForUUID:UUID kind:kind] > 0)) { // Unloaded, already deleted, or still in use
+        return;
+    }
+
+    [self replaceObject:object withObject:nil forUUID:UUID kind:kind changeSet:changeSet];
+
+    if ((kind == BLMArchiveEntityKindSession) && (changeSet == nil)) { // Otherwise discarded along with the rest of the change set's sessions
+        [self discardEventsForSessionUUIDs:@[UUID]];
+    }
+
+    [self deleteObjectsReleasedByObject:object kind:kind changeSet:changeSet];
+}
+
+
+- (void)replaceObject:(id)original withObject:(nullable id)updated forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind changeSet:(nullable BLMChangeSet *)changeSet {
+    assert((kind == BLMArchiveEntityKindSession) || (kind == BLMArchiveEntityKindSessionConfiguration) || ((kind == BLMArchiveEntityKindBehavior) && (updated == nil)));
+
+    [self setObject:updated forUUID:UUID kind:kind]; // Consistency is checked by the caller once its whole cascade is done
+
+    [self.archiveScheduler markDirtyUUID:UUID kind:kind];
+
+    if (changeSet != nil) {
+        [changeSet addChangeForUUID:UUID kind:kind original:original updated:updated];
+    } else {
+        [self.changeFeed recordChangeForUUID:UUID kind:kind original:original updated:updated];
+
+        if (updated != nil) { // Only configurations are updated by a cascade
+            assert(kind == BLMArchiveEntityKindSessionConfiguration);
+
+            NSDictionary *userInfo = @{ BLMSessionConfigurationOriginalSessionConfigurationUserInfoKey:original, BLMSessionConfigurationUpdatedSessionConfigurationUserInfoKey:updated };
+            [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationUpdatedNotification object:original userInfo:userInfo];
+        } else if (kind == BLMArchiveEntityKindBehavior) {
+            [[NSNotificationCenter defaultCenter] postNotificationName:BLMBehaviorDeletedNotification object:original userInfo:nil];
+        } else if (kind == BLMArchiveEntityKindSession) {
+            [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionDeletedNotification object:original userInfo:nil];
+        } else {
+            [[NSNotificationCenter defaultCenter] postNotificationName:BLMSessionConfigurationDeletedNotification object:original userInfo:nil];
+        }
+    }
+
+    if (kind == BLMArchiveEntityKindSessionConfiguration) {
+        [self updateBehaviorReferenceCountsFromSessionConfiguration:original toSessionConfiguration:updated changeSet:changeSet];
+    }
+}
+
+
+- (void)updateBehaviorReferenceCountsFromSessionConfiguration:(nullable BLMSessionConfiguration *)original toSessionConfiguration:(nullable BLMSessionConfiguration *)updated changeSet:(nullable BLMChangeSet *)changeSet { // For a configuration created, updated or deleted, but not for one loaded or unloaded with its shard
+    for (NSUUID *behaviorUUID in original.behaviorUUIDs) {
+        if (![updated.behaviorUUIDs containsObject:behaviorUUID]) {
+            [self adjustReferenceCountForBehaviorUUID:behaviorUUID delta:-1 changeSet:changeSet];
+        }
+    }
+
+    for (NSUUID *behaviorUUID in updated.behaviorUUIDs) {
+        if (![original.behaviorUUIDs containsObject:behaviorUUID]) {
+            [self adjustReferenceCountForBehaviorUUID:behaviorUUID delta:1 changeSet:changeSet];
+        }
+    }
+}
+
+
+- (void)adjustReferenceCountForBehaviorUUID:(NSUUID *)UUID delta:(NSInteger)delta changeSet:(nullable BLMChangeSet *)changeSet { // A behavior is deleted once no configuration in any shard uses it
+    BLMBehavior *behavior = self.behaviorByUUID[UUID];
+
+    if ((behavior == nil) || (behavior.referenceCount == NSNotFound)) { // Deleted while sessions still used it, or archived before counts were kept and so never deleted this way
+        return;
+    }
+
+    assert(((NSInteger)behavior.referenceCount + delta) >= 0);
+    NSUInteger referenceCount = (NSUInteger)((NSInteger)behavior.referenceCount + delta);
+
+    if (referenceCount == 0) {
+        [self replaceObject:behavior withObject:nil forUUID:UUID kind:BLMArchiveEntityKindBehavior changeSet:changeSet];
+        return;
+    }
+
+    [self setObject:[behavior copyWithReferenceCount:referenceCount] forUUID:UUID kind:BLMArchiveEntityKindBehavior]; // Only archived; nothing observers see has changed
+    [self.archiveScheduler markDirtyUUID:UUID kind:BLMArchiveEntityKindBehavior];
+}
+
+#pragma mark Snapshots
+
+- (BLMDataSnapshot *)snapshot {
+    assert([NSThread isMainThread]);
+
+    if (self.cachedSnapshot == nil) {
+        self.cachedSnapshot = [[BLMDataSnapshot alloc] initWithGeneration:self.generation projectByUUID:self.projectByUUID behaviorByUUID:self.behaviorByUUID sessionByUUID:self.sessionByUUID sessionConfigurationByUUID:self.sessionConfigurationByUUID];
+    }
+
+    return self.cachedSnapshot;
+}
+
+#pragma mark Export
+
+- (NSProgress *)exportToFileHandle:(NSFileHandle *)fileHandle format:(BLMExportFormat)format completion:(void(^)(NSError *__nullable error))completion {
+    assert([NSThread isMainThread]);
+    assert(!self.isRestoringArchive);
+
+    NSProgress *progress = [NSProgress progressWithTotalUnitCount:-1];
+    progress.cancellable = YES;
+    progress.pausable = NO;
+
+    [self.archiveScheduler flushWithCompletion:^(NSError *flushError) { // Shards are read from disk, so everything changed so far must be written first
+        if (flushError != nil) { // The shards on disk would be missing the unwritten changes
+            completion(flushError);
+            return;
+        }
+
+        BLMDataSnapshot *snapshot = self.snapshot; // Unaffected by changes made while the export runs
+        NSMutableArray<BLMProject *> *projects = [NSMutableArray array];
+        NSMutableArray<BLMArchiveJournal *> *shardJournals = [NSMutableArray array];
+        int64_t sessionCount = 0;
+
+        for (NSUUID *projectUUID in [self projectUUIDsInRange:NSMakeRange(0, self.projectCount)]) { // In the order the project menu shows them
+            BLMProject *project = [snapshot projectForUUID:projectUUID];
+
+            [projects addObject:project];
+            [shardJournals addObject:[self shardJournalForProjectUUID:projectUUID]];
+            sessionCount += project.sessionUUIDs.count;
+        }
+
+        progress.totalUnitCount = MAX(sessionCount, 1);
+
+        dispatch_queue_t exportQueue = dispatch_queue_create([NSString stringWithFormat:@"%@ - Export Queue", NSStringFromClass([self class])].UTF8String, dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        BLMExportWriter *writer = [[BLMExportWriter alloc] initWithFileHandle:fileHandle format:format];
+
+        [self exportProjectAtIndex:0 ofProjects:projects shardJournals:shardJournals snapshot:snapshot writer:writer queue:exportQueue progress:progress completion:completion];
+    }];
+
+    return progress;
+}
+
+
+- (void)exportProjectAtIndex:(NSUInteger)projectIndex ofProjects:(NSArray<BLMProject *> *)projects shardJournals:(NSArray<BLMArchiveJournal *> *)shardJournals snapshot:(BLMDataSnapshot *)snapshot writer:(BLMExportWriter *)writer queue:(dispatch_queue_t)queue progress:(NSProgress *)progress completion:(void(^)(NSError *error))completion { // Sent from any thread; only the shard read runs on the archive queue, so archive writes wait for at most one shard
+    if ((projectIndex == projects.count) || progress.isCancelled) {
+        dispatch_async(queue, ^{ // After the last project has been written
+            NSError *error = nil;
+
+            if (progress.isCancelled) {
+                error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+            } else {
+                [writer finishWithError:&error];
+            }
+
+            [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+                completion(error);
+            }];
+        });
+        return;
+    }
 
-        NSFileHandle *archiveFile = [NSFileHandle fileHandleForWritingAtPath:filePath];
+    BLMArchiveJournal *shardJournal = shardJournals[projectIndex];
 
-        [archiveFile truncateFileAtOffset:0];
-        [archiveFile writeData:archiveData];
-        [archiveFile closeFile];
+    [self.archiveQueue addOperationWithBlock:^{
+        NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [shardJournal restoreObjectByUUIDByKind];
+
+        [self reportRestoreErrorForJournal:shardJournal];
+
+        dispatch_async(queue, ^{
+            @autoreleasepool { // Only one project's sessions are held at a time
+                BLMProject *project = projects[projectIndex];
+                NSDictionary<NSUUID *, BLMSession *> *sessionByUUID = objectByUUIDByKind[@(BLMArchiveEntityKindSession)];
+                NSDictionary<NSUUID *, BLMSessionConfiguration *> *shardSessionConfigurationByUUID = objectByUUIDByKind[@(BLMArchiveEntityKindSessionConfiguration)];
+
+                [writer beginProject:project];
+
+                for (NSUUID *sessionUUID in project.sessionUUIDs) { // The snapshot's sessions, so a session added to the shard since is left out
+                    if (progress.isCancelled) {
+                        break;
+                    }
+
+                    BLMSession *session = sessionByUUID[sessionUUID];
+                    BLMSessionConfiguration *sessionConfiguration = (shardSessionConfigurationByUUID[session.configurationUUID] ?: [snapshot sessionConfigurationForUUID:session.configurationUUID]);
+
+                    if ((session == nil) || (sessionConfiguration == nil)) { // Deleted since the snapshot was taken
+                        progress.completedUnitCount += 1;
+                        continue;
+                    }
+
+                    [writer beginSession:session configuration:sessionConfiguration snapshot:snapshot];
+
+                    dispatch_sync(self.eventQueue, ^{ // Event stores are only read on the event queue; a recorder's drain waits for at most one session's events to be written
+                        [[[BLMEventStore alloc] initWithDirectory:EventDirectory() sessionUUID:sessionUUID] enumerateEventsUsingBlock:^(BLMSessionEvent event, BOOL *stop) {
+                            [writer writeEvent:event];
+                        }];
+                    });
+
+                    [writer endSession];
+
+                    progress.completedUnitCount += 1;
+                }
+
+                [writer endProject];
+            }
+
+            [self exportProjectAtIndex:(projectIndex + 1) ofProjects:projects shardJournals:shardJournals snapshot:snapshot writer:writer queue:queue progress:progress completion:completion];
+        });
+    }];
+}
+
+#pragma mark Archiving
+
+- (void)reportRestoreErrorForJournal:(BLMArchiveJournal *)journal { // Sent from archiveQueue right after the journal is restored
+    NSError *error = journal.restoreError;
+
+    if (error == nil) {
+        return;
+    }
+
+    [self reportRestoreError:error];
+}
+
+
+- (void)reportRestoreError:(NSError *)error {
+    [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:BLMDataManagerArchiveRestoreFailedNotification object:self userInfo:@{ BLMDataManagerArchiveErrorUserInfoKey:error }];
     }];
 }
 
 
-- (void)restoreArchivedStateWithCompletion:(dispatch_block_t)completion {
+- (void)flushArchiveWithCompletion:(void(^)(NSError *error))completion {
+    assert([NSThread isMainThread]);
+    assert(!self.isRestoringArchive);
+
+    [self.archiveScheduler flushWithCompletion:completion];
+}
+
+
+- (void)restoreArchivedStateWithPhaseHandler:(BLMDataManagerRestorePhaseHandler)phaseHandler completion:(dispatch_block_t)completion {
     assert([NSThread isMainThread]);
     assert(!self.isRestoringArchive);
 
     _restoringArchive = YES;
 
-    [self.archiveQueue addOperationWithBlock:^{
-        NSMutableDictionary<NSUUID *, BLMProject *> *projectByUUID = nil;
-        NSMutableDictionary<NSUUID *, BLMBehavior *> *behaviorByUUID = nil;
-        NSMutableDictionary<NSUUID *, BLMSession *> *sessionByUUID = nil;
-        NSMutableDictionary<NSUUID *, BLMSessionConfiguration *> *sessionConfigurationByUUID = nil;
-        NSString *filePath = [ArchiveDirectory() stringByAppendingPathComponent:ArchiveFileName];
-        NSData *archiveData = [NSData dataWithContentsOfFile:filePath];
-
-        if (archiveData.length == 0) {
-            [[NSFileManager defaultManager] removeItemAtPath:filePath error:NULL];
-        } else {
-            NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:archiveData];
+    [self.archiveQueue addOperationWithBlock:^{ // Only the index is restored here; each project's sessions are faulted in from its shard on demand
+        __block NSTimeInterval phaseStartTime = [NSProcessInfo processInfo].systemUptime;
+
+        void (^publishPhase)(BLMDataManagerRestorePhase, dispatch_block_t) = ^(BLMDataManagerRestorePhase phase, dispatch_block_t publication) {
+            NSTimeInterval duration = ([NSProcessInfo processInfo].systemUptime - phaseStartTime);
+
+            [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+                publication();
+
+                if (phaseHandler != nil) {
+                    phaseHandler(phase, duration);
+                }
+            }];
+
+            phaseStartTime = [NSProcessInfo processInfo].systemUptime;
+        };
+
+        NSMutableIndexSet *remainingKinds = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(0, BLMArchiveEntityKindCount)];
+        [remainingKinds removeIndex:BLMArchiveEntityKindProject];
+
+        NSArray<NSIndexSet *> *phases = @[[NSIndexSet indexSetWithIndex:BLMArchiveEntityKindProject], remainingKinds];
+
+        // Replays the journal on top of the last checkpoint; projects are decoded first so the menu can render while everything else is still being read
+        NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [self.archiveJournal restoreObjectByUUIDByKindInPhases:phases phaseHandler:^(NSUInteger phaseIndex, NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *restoredObjectByUUIDByKind) {
+            switch ((BLMDataManagerRestorePhase)phaseIndex) {
+                case BLMDataManagerRestorePhaseProjects: {
+                    NSDictionary<NSUUID *, BLMProject *> *projectByUUID = restoredObjectByUUIDByKind[@(BLMArchiveEntityKindProject)]; // Not mutated again, so it can be read here while the main thread copies it
+
+                    publishPhase(BLMDataManagerRestorePhaseProjects, ^{
+                        assert(self.projectByUUID.count == 0);
+                        [self setObjectsFromDictionary:projectByUUID kind:BLMArchiveEntityKindProject];
+
+                        _projectsRestored = YES;
+                    });
 
-            switch ((ArchiveVersion)[unarchiver decodeIntegerForKey:ArchiveVersionKey]) {
-                case ArchiveVersionUnknown:
-                    assert(NO);
                     break;
+                }
+
+                case BLMDataManagerRestorePhaseBehaviorsAndConfigurations: {
+                    NSDictionary<NSUUID *, BLMBehavior *> *behaviorByUUID = restoredObjectByUUIDByKind[@(BLMArchiveEntityKindBehavior)];
+
+                    publishPhase(BLMDataManagerRestorePhaseBehaviorsAndConfigurations, ^{ // Session configurations are held back until they have been sanitized
+                        assert(self.behaviorByUUID.count == 0);
+                        [self setObjectsFromDictionary:behaviorByUUID kind:BLMArchiveEntityKindBehavior];
+                    });
+
+                    break;
+                }
 
-                case ArchiveVersionLatest:
-                    projectByUUID = [[unarchiver decodeObjectForKey:@"projectByUUID"] mutableCopy];
-                    behaviorByUUID = [[unarchiver decodeObjectForKey:@"behaviorByUUID"] mutableCopy];
-                    sessionByUUID = [[unarchiver decodeObjectForKey:@"sessionByUUID"] mutableCopy];
-                    sessionConfigurationByUUID = [[unarchiver decodeObjectForKey:@"sessionConfigurationByUUID"] mutableCopy];
+                case BLMDataManagerRestorePhaseSanitization:
+                case BLMDataManagerRestorePhaseCount:
+                    assert(NO);
                     break;
             }
+        }];
 
-            [unarchiver finishDecoding];
+        [self reportRestoreErrorForJournal:self.archiveJournal];
+
+        NSMutableDictionary<NSUUID *, BLMProject *> *projectByUUID = objectByUUIDByKind[@(BLMArchiveEntityKindProject)];
+        NSDictionary<NSUUID *, BLMBehavior *> *behaviorByUUID = objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)]; // Already published, so only read here
+        NSMutableDictionary<NSUUID *, BLMSession *> *sessionByUUID = objectByUUIDByKind[@(BLMArchiveEntityKindSession)];
+        NSMutableDictionary<NSUUID *, BLMSessionConfiguration *> *sessionConfigurationByUUID = objectByUUIDByKind[@(BLMArchiveEntityKindSessionConfiguration)];
+        NSMutableArray<BLMArchiveMutation *> *sanitizingMutations = [NSMutableArray array];
+        NSMutableSet<NSUUID *> *projectSessionConfigurationUUIDs = [NSMutableSet set];
+        NSMutableSet<NSUUID *> *unmigratedUUIDs = [NSMutableSet set];
+        NSMutableDictionary<NSUUID *, NSArray<BLMArchiveMutation *> *> *unmigratedMutationsByProjectUUID = [NSMutableDictionary dictionary];
+        __block NSError *migrationError = nil;
+
+        for (BLMProject *project in projectByUUID.objectEnumerator) {
+            [projectSessionConfigurationUUIDs addObject:project.sessionConfigurationUUID];
+        }
+
+        __block BOOL recountingBehaviorReferences = NO; // Behaviors archived before counts were kept have their counts computed once, from every configuration in the index and the shards
+        NSMutableDictionary<NSUUID *, BLMSessionConfiguration *> *countedSessionConfigurationByUUID = [NSMutableDictionary dictionary];
+
+        for (BLMBehavior *behavior in behaviorByUUID.objectEnumerator) {
+            if (behavior.referenceCount == NSNotFound) {
+                recountingBehaviorReferences = (self.archiveJournal.restoreError == nil); // An incomplete restore could undercount, deleting a behavior still in use
+                break;
+            }
         }
 
-        NSMutableSet<NSUUID *> *referenedBehaviorUUIDs = [NSMutableSet set];
-        NSMutableSet<NSUUID *> *referenedSessionUUIDs = [NSMutableSet set];
-        NSMutableSet<NSUUID *> *referenedSessionConfigurationUUIDs = [NSMutableSet set];
+        if (recountingBehaviorReferences) {
+            for (NSUUID *UUID in projectSessionConfigurationUUIDs) {
+                countedSessionConfigurationByUUID[UUID] = sessionConfigurationByUUID[UUID];
+            }
+        }
 
+        // A session's configuration keeps a deleted behavior so its events keep their indexes, and a project's loses it as it is deleted, so nothing is checked for references to missing behaviors here
         [projectByUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull projectUUID, BLMProject *__nonnull project, BOOL *__nonnull stopProjectUUIDEnumeration) {
-            [project.sessionUUIDs enumerateObjectsUsingBlock:^(NSUUID *__nonnull sessionUUID, NSUInteger index, BOOL *__nonnull stopSessionUUIDEnumeration) {
-                BLMSession *session = sessionByUUID[sessionUUID];
-                BLMSessionConfiguration *sessionConfiguration = sessionConfigurationByUUID[session.configurationUUID];
+            BLMArchiveJournal *shardJournal = [[BLMArchiveJournal alloc] initWithDirectory:ShardDirectory() name:projectUUID.UUIDString];
 
-                assert([sessionConfiguration.behaviorUUIDs isSubsetOfSet:[NSSet setWithArray:behaviorByUUID.allKeys]]);
+            if (recountingBehaviorReferences && shardJournal.hasArchive) {
+                [countedSessionConfigurationByUUID addEntriesFromDictionary:[shardJournal restoreObjectByUUIDByKind][@(BLMArchiveEntityKindSessionConfiguration)]];
+                [self reportRestoreErrorForJournal:shardJournal];
 
-                [referenedBehaviorUUIDs unionSet:sessionConfiguration.behaviorUUIDs.set];
-                [referenedSessionConfigurationUUIDs addObject:session.configurationUUID];
-            }];
+                recountingBehaviorReferences = (shardJournal.restoreError == nil); // Otherwise left for a later launch
+            }
 
-            BLMSessionConfiguration *projectSessionConfiguration = sessionConfigurationByUUID[project.sessionConfigurationUUID];
+            if (!shardJournal.hasArchive) { // Sessions archived before storage was split per project are moved into their project's shard
+                NSMutableArray<BLMArchiveMutation *> *migratingMutations = [NSMutableArray array];
 
-            NSOrderedSet *sanitizedBehaviorUUIDs = [projectSessionConfiguration.behaviorUUIDs filteredOrderedSetUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(NSUUID *behaviorUUID, NSDictionary *bindings) {
-                return (behaviorByUUID[behaviorUUID] != nil);
-            }]];
+                for (NSUUID *sessionUUID in project.sessionUUIDs) {
+                    BLMSession *session = sessionByUUID[sessionUUID];
 
-            if (![BLMUtils isOrderedSet:sanitizedBehaviorUUIDs equalToOrderedSet:projectSessionConfiguration.behaviorUUIDs]) { // Remove references to behaviors that no longer exist from projects' default session configurations
-                projectSessionConfiguration = [projectSessionConfiguration copyWithUpdatedValuesByProperty:@{ @(BLMSessionConfigurationPropertyBehaviorUUIDs):sanitizedBehaviorUUIDs }];
-                sessionConfigurationByUUID[project.sessionConfigurationUUID] = projectSessionConfiguration;
-            }
+                    if (session == nil) {
+                        continue;
+                    }
+
+                    [migratingMutations addObject:[[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindSession UUID:sessionUUID object:session]];
+
+                    BLMSessionConfiguration *sessionConfiguration = sessionConfigurationByUUID[session.configurationUUID];
+
+                    if ((sessionConfiguration != nil) && ![projectSessionConfigurationUUIDs containsObject:session.configurationUUID]) {
+                        [migratingMutations addObject:[[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindSessionConfiguration UUID:session.configurationUUID object:sessionConfiguration]];
+                        countedSessionConfigurationByUUID[session.configurationUUID] = sessionConfiguration;
+                    }
+                }
+
+                if (![shardJournal appendMutations:migratingMutations]) { // The index copies are kept until a later write into the shard succeeds
+                    unmigratedMutationsByProjectUUID[projectUUID] = migratingMutations;
 
-            [referenedBehaviorUUIDs unionSet:sanitizedBehaviorUUIDs.set];
-            [referenedSessionUUIDs unionSet:project.sessionUUIDs.set];
-            [referenedSessionConfigurationUUIDs addObject:project.sessionConfigurationUUID];
+                    for (BLMArchiveMutation *mutation in migratingMutations) {
+                        [unmigratedUUIDs addObject:mutation.UUID];
+                    }
+
+                    if (migrationError == nil) {
+                        NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:shardJournal.journalPath forKey:NSFilePathErrorKey];
+
+                        if (shardJournal.restoreError != nil) {
+                            userInfo[NSUnderlyingErrorKey] = shardJournal.restoreError;
+                        }
+
+                        migrationError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:userInfo];
+                    }
+                }
+            }
         }];
 
-        void (^removeUnreferencedEntries)(NSMutableDictionary *, NSSet *) = ^(NSMutableDictionary<NSUUID *, id> *entryByUUID, NSSet<NSUUID *> *referencedUUIDs) {
+        if (migrationError != nil) {
+            [self reportRestoreError:migrationError];
+        }
+
+        void (^removeUnreferencedEntries)(NSMutableDictionary *, NSSet *, BLMArchiveEntityKind) = ^(NSMutableDictionary<NSUUID *, id> *entryByUUID, NSSet<NSUUID *> *referencedUUIDs, BLMArchiveEntityKind kind) {
             NSMutableArray *unreferencedUUIDs = [NSMutableArray array];
 
             for (NSUUID *UUID in entryByUUID.keyEnumerator) {
                 if (![referencedUUIDs containsObject:UUID]) {
                     [unreferencedUUIDs addObject:UUID];
+
+                    if (![unmigratedUUIDs containsObject:UUID]) { // Held back from memory but kept on disk, since the shard doesn't have them yet
+                        [sanitizingMutations addObject:[[BLMArchiveMutation alloc] initWithKind:kind UUID:UUID object:nil]];
+                    }
                 }
             }
 
             [entryByUUID removeObjectsForKeys:unreferencedUUIDs];
         };
 
-        removeUnreferencedEntries(behaviorByUUID, referenedBehaviorUUIDs);
-        removeUnreferencedEntries(sessionByUUID, referenedSessionUUIDs);
-        removeUnreferencedEntries(sessionConfigurationByUUID, referenedSessionConfigurationUUIDs);
+        // Unreferenced objects are deleted as they are released, so what is left to drop are index copies superseded by a shard's, and sessions never added to a project
+        // Behavior reference counts are left alone: a superseded copy's behaviors are still counted for the shard's, and an overcount only keeps a behavior alive
+        removeUnreferencedEntries(sessionByUUID, [NSSet set], BLMArchiveEntityKindSession);
+        removeUnreferencedEntries(sessionConfigurationByUUID, projectSessionConfigurationUUIDs, BLMArchiveEntityKindSessionConfiguration);
 
-        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
-            assert(self.projectByUUID.count == 0);
-            [self.projectByUUID addEntriesFromDictionary:projectByUUID];
+        NSCountedSet<NSUUID *> *behaviorReferences = [NSCountedSet set];
+        NSMutableDictionary<NSUUID *, BLMBehavior *> *recountedBehaviorByUUID = [NSMutableDictionary dictionary];
+        NSMutableSet<NSUUID *> *unusedBehaviorUUIDs = [NSMutableSet set];
+
+        for (BLMSessionConfiguration *sessionConfiguration in countedSessionConfigurationByUUID.objectEnumerator) {
+            [behaviorReferences unionSet:[NSSet setWithArray:sessionConfiguration.behaviorUUIDs]];
+        }
+
+        // Behaviors no configuration uses are deleted, including ones created and never added to a project; a partial restore may lack the record that added one, so it deletes nothing
+        [behaviorByUUID enumerateKeysAndObjectsUsingBlock:^(NSUUID *__nonnull UUID, BLMBehavior *__nonnull behavior, BOOL *__nonnull stop) {
+            if (self.archiveJournal.restoreError != nil) {
+                *stop = YES;
+                return;
+            }
+
+            NSUInteger referenceCount = (recountingBehaviorReferences ? [behaviorReferences countForObject:UUID] : behavior.referenceCount);
+
+            if (referenceCount == 0) {
+                [unusedBehaviorUUIDs addObject:UUID];
+                [sanitizingMutations addObject:[[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindBehavior UUID:UUID object:nil]];
+            } else if (referenceCount != behavior.referenceCount) {
+                recountedBehaviorByUUID[UUID] = [behavior copyWithReferenceCount:referenceCount];
+                [sanitizingMutations addObject:[[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindBehavior UUID:UUID object:recountedBehaviorByUUID[UUID]]];
+            }
+        }];
 
-            assert(self.behaviorByUUID.count == 0);
-            [self.behaviorByUUID addEntriesFromDictionary:behaviorByUUID];
+        if ([self.archiveJournal appendMutations:sanitizingMutations] && (migrationError == nil) && self.archiveJournal.needsCompaction) { // Persist the sweep so it isn't repeated on every launch; compaction waits until every shard has been migrated
+            [self.archiveJournal compact];
+        }
 
+        publishPhase(BLMDataManagerRestorePhaseSanitization, ^{
             assert(self.sessionConfigurationByUUID.count == 0);
-            [self.sessionConfigurationByUUID addEntriesFromDictionary:sessionConfigurationByUUID];
+            [self setObjectsFromDictionary:recountedBehaviorByUUID kind:BLMArchiveEntityKindBehavior];
+
+            for (NSUUID *UUID in unusedBehaviorUUIDs) {
+                [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+            }
+
+            [self setObjectsFromDictionary:sessionConfigurationByUUID kind:BLMArchiveEntityKindSessionConfiguration];
+            assert([self isModelIndexConsistent]);
+
+            self.unmigratedMutationsByProjectUUID = unmigratedMutationsByProjectUUID;
 
             assert(self.isRestoringArchive);
             _restoringArchive = NO;
-            
+        });
+
+        [[NSOperationQueue mainQueue] addOperationWithBlock:^{ // Runs after the sanitization phase's handler
             if (completion != nil) {
                 completion();
             }
@@ -0,0 +1,93 @@
+//
+//  BLMDataManagerTransaction.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/19/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMArchiveJournal.h"
+#import "BLMBehavior.h"
+#import "BLMProject.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class BLMDataManager;
+
+
+typedef NS_ENUM(NSInteger, BLMChangeType) {
+    BLMChangeTypeCreated,
+    BLMChangeTypeUpdated,
+    BLMChangeTypeDeleted,
+    BLMChangeTypeCount
+};
+
+
+#pragma mark
+
+/*
+ ` The net effect of a series of changes on each object they touched. Each added change is coalesced
+ ` with any earlier one to the same object, so an object created and then deleted, or updated back to
+ ` its original values, does not appear at all.
+ */
+
+@interface BLMChangeSet : NSObject
+
+@property (nonatomic, assign, readonly, getter=isEmpty) BOOL empty;
+
+- (NSArray<NSUUID *> *)UUIDsForKind:(BLMArchiveEntityKind)kind; // Every change type, in the order the objects were first changed
+- (NSArray<NSUUID *> *)UUIDsForKind:(BLMArchiveEntityKind)kind changeType:(BLMChangeType)changeType; // In the order the objects were first changed
+- (BLMChangeType)changeTypeForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // The UUID must be in the change set
+- (nullable id)originalObjectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // nil for created objects
+- (nullable id)updatedObjectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // nil for deleted objects
+
+- (void)addChangeForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind original:(nullable id)original updated:(nullable id)updated; // original must be the object as the previous change to it left it
+- (void)addChangesFromChangeSet:(BLMChangeSet *)changeSet;
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Stages creates, updates and deletes against a view of the data manager's objects without touching
+ ` them, so staged objects can be read back and built upon within the same transaction. Nothing is
+ ` applied, archived or broadcast until the data manager commits the transaction.
+ `
+ ` Projects cannot be deleted in a transaction, since deleting one also discards its shard and events.
+ ` All messages must be sent from the main thread, within the data manager's performTransaction: block.
+ */
+
+@interface BLMDataManagerTransaction : NSObject
+
+- (instancetype)initWithDataManager:(BLMDataManager *)dataManager;
+
+- (nullable id)objectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // Includes staged changes
+- (BLMChangeSet *)changeSet; // Staged objects compared against the data manager's current ones
+
+- (BLMProject *)createProjectWithName:(NSString *)name client:(NSString *)client sessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID;
+- (BLMProject *)updateProjectForUUID:(NSUUID *)UUID property:(BLMProjectProperty)property value:(nullable id)value;
+
+- (BLMBehavior *)createBehaviorWithName:(NSString *)name continuous:(BOOL)continuous;
+- (BLMBehavior *)createBehaviorWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous; // For a behavior drafted outside the data model, which keeps its UUID once created
+- (BLMBehavior *)updateBehaviorForUUID:(NSUUID *)UUID property:(BLMBehaviorProperty)property value:(nullable id)value;
+- (void)deleteBehaviorForUUID:(NSUUID *)UUID;
+
+- (BLMSession *)createSessionWithName:(NSString *)name configurationUUID:(NSUUID *)configurationUUID;
+- (BLMSession *)updateSessionForUUID:(NSUUID *)UUID property:(BLMSessionProperty)property value:(nullable id)value;
+- (void)deleteSessionForUUID:(NSUUID *)UUID;
+
+- (BLMSessionConfiguration *)createSessionConfigurationWithCondition:(nullable NSString *)condition location:(nullable NSString *)location therapist:(nullable NSString *)therapist observer:(nullable NSString *)observer timeLimit:(BLMTimeInterval)timeLimit timeLimitOptions:(BLMTimeLimitOptions)timeLimitOptions behaviorUUIDs:(nullable NSOrderedSet<NSUUID *> *)behaviorUUIDs;
+- (BLMSessionConfiguration *)updateSessionConfigurationForUUID:(NSUUID *)UUID property:(BLMSessionConfigurationProperty)property value:(nullable id)value;
+- (void)deleteSessionConfigurationForUUID:(NSUUID *)UUID;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
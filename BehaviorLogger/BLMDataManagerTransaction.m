@@ -0,0 +1,349 @@
+//
+//  BLMDataManagerTransaction.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/19/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMDataManager.h"
+#import "BLMDataManagerTransaction.h"
+#import "BLMUtils.h"
+
+
+#pragma mark
+
+@interface BLMChangeSet ()
+
+@property (nonatomic, strong, readonly) NSArray<NSMutableOrderedSet<NSUUID *> *> *UUIDsByKind; // In the order first changed
+@property (nonatomic, strong, readonly) NSArray<NSMutableDictionary<NSUUID *, id> *> *originalObjectByUUIDByKind;
+@property (nonatomic, strong, readonly) NSArray<NSMutableDictionary<NSUUID *, id> *> *updatedObjectByUUIDByKind;
+
+@end
+
+
+@implementation BLMChangeSet
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    NSMutableArray *UUIDsByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+    NSMutableArray *originalObjectByUUIDByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+    NSMutableArray *updatedObjectByUUIDByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        [UUIDsByKind addObject:[NSMutableOrderedSet orderedSet]];
+        [originalObjectByUUIDByKind addObject:[NSMutableDictionary dictionary]];
+        [updatedObjectByUUIDByKind addObject:[NSMutableDictionary dictionary]];
+    }
+
+    _UUIDsByKind = UUIDsByKind;
+    _originalObjectByUUIDByKind = originalObjectByUUIDByKind;
+    _updatedObjectByUUIDByKind = updatedObjectByUUIDByKind;
+
+    return self;
+}
+
+
+- (BOOL)isEmpty {
+    for (NSMutableOrderedSet *UUIDs in self.UUIDsByKind) {
+        if (UUIDs.count > 0) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+
+- (NSArray<NSUUID *> *)UUIDsForKind:(BLMArchiveEntityKind)kind {
+    assert(kind < BLMArchiveEntityKindCount);
+    return self.UUIDsByKind[kind].array;
+}
+
+
+- (NSArray<NSUUID *> *)UUIDsForKind:(BLMArchiveEntityKind)kind changeType:(BLMChangeType)changeType {
+    assert(kind < BLMArchiveEntityKindCount);
+    assert(changeType < BLMChangeTypeCount);
+
+    NSMutableArray<NSUUID *> *UUIDs = [NSMutableArray array];
+
+    for (NSUUID *UUID in self.UUIDsByKind[kind]) {
+        if ([self changeTypeForUUID:UUID kind:kind] == changeType) {
+            [UUIDs addObject:UUID];
+        }
+    }
+
+    return UUIDs;
+}
+
+
+- (BLMChangeType)changeTypeForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([self.UUIDsByKind[kind] containsObject:UUID]);
+
+    if (self.originalObjectByUUIDByKind[kind][UUID] == nil) {
+        return BLMChangeTypeCreated;
+    }
+
+    return ((self.updatedObjectByUUIDByKind[kind][UUID] == nil) ? BLMChangeTypeDeleted : BLMChangeTypeUpdated);
+}
+
+
+- (id)originalObjectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert(kind < BLMArchiveEntityKindCount);
+    return self.originalObjectByUUIDByKind[kind][UUID];
+}
+
+
+- (id)updatedObjectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert(kind < BLMArchiveEntityKindCount);
+    return self.updatedObjectByUUIDByKind[kind][UUID];
+}
+
+
+- (void)addChangeForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind original:(id)original updated:(id)updated {
+    assert(kind < BLMArchiveEntityKindCount);
+    assert((original != nil) || (updated != nil));
+
+    NSMutableOrderedSet<NSUUID *> *UUIDs = self.UUIDsByKind[kind];
+
+    if ([UUIDs containsObject:UUID]) { // Coalesced into the earlier change, which must have left the object as this one found it
+        assert([BLMUtils isObject:original equalToObject:self.updatedObjectByUUIDByKind[kind][UUID]]);
+        original = self.originalObjectByUUIDByKind[kind][UUID];
+    }
+
+    if ([BLMUtils isObject:original equalToObject:updated]) { // Created then deleted, or changed back
+        [UUIDs removeObject:UUID];
+        [self.originalObjectByUUIDByKind[kind] removeObjectForKey:UUID];
+        [self.updatedObjectByUUIDByKind[kind] removeObjectForKey:UUID];
+        return;
+    }
+
+    [UUIDs addObject:UUID];
+
+    self.originalObjectByUUIDByKind[kind][UUID] = original;
+    self.updatedObjectByUUIDByKind[kind][UUID] = updated;
+}
+
+
+- (void)addChangesFromChangeSet:(BLMChangeSet *)changeSet {
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (NSUUID *UUID in changeSet.UUIDsByKind[kind]) {
+            [self addChangeForUUID:UUID kind:kind original:[changeSet originalObjectForUUID:UUID kind:kind] updated:[changeSet updatedObjectForUUID:UUID kind:kind]];
+        }
+    }
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMDataManagerTransaction ()
+
+@property (nonatomic, strong, readonly) BLMDataManager *dataManager;
+@property (nonatomic, strong, readonly) NSArray<NSMutableOrderedSet<NSUUID *> *> *stagedUUIDsByKind; // In the order first staged
+@property (nonatomic, strong, readonly) NSArray<NSMutableDictionary<NSUUID *, id> *> *stagedObjectByUUIDByKind; // NSNull for deleted objects
+
+@end
+
+
+@implementation BLMDataManagerTransaction
+
+- (instancetype)initWithDataManager:(BLMDataManager *)dataManager {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    NSMutableArray *stagedUUIDsByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+    NSMutableArray *stagedObjectByUUIDByKind = [NSMutableArray arrayWithCapacity:BLMArchiveEntityKindCount];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        [stagedUUIDsByKind addObject:[NSMutableOrderedSet orderedSet]];
+        [stagedObjectByUUIDByKind addObject:[NSMutableDictionary dictionary]];
+    }
+
+    _dataManager = dataManager;
+    _stagedUUIDsByKind = stagedUUIDsByKind;
+    _stagedObjectByUUIDByKind = stagedObjectByUUIDByKind;
+
+    return self;
+}
+
+#pragma mark Staged State
+
+- (id)objectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    assert(kind < BLMArchiveEntityKindCount);
+
+    id stagedObject = self.stagedObjectByUUIDByKind[kind][UUID];
+
+    if (stagedObject != nil) {
+        return ((stagedObject == [NSNull null]) ? nil : stagedObject);
+    }
+
+    return [self committedObjectForUUID:UUID kind:kind];
+}
+
+
+- (id)committedObjectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            return [self.dataManager projectForUUID:UUID];
+
+        case BLMArchiveEntityKindBehavior:
+            return [self.dataManager behaviorForUUID:UUID];
+
+        case BLMArchiveEntityKindSession:
+            return [self.dataManager sessionForUUID:UUID];
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            return [self.dataManager sessionConfigurationForUUID:UUID];
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+}
+
+
+- (void)stageObject:(id)object forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+
+    [self.stagedUUIDsByKind[kind] addObject:UUID];
+    self.stagedObjectByUUIDByKind[kind][UUID] = (object ?: [NSNull null]);
+}
+
+
+- (BLMChangeSet *)changeSet {
+    assert([NSThread isMainThread]);
+
+    BLMChangeSet *changeSet = [[BLMChangeSet alloc] init];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (NSUUID *UUID in self.stagedUUIDsByKind[kind]) {
+            id original = [self committedObjectForUUID:UUID kind:kind];
+            id updated = [self objectForUUID:UUID kind:kind];
+
+            if (![BLMUtils isObject:original equalToObject:updated]) {
+                [changeSet addChangeForUUID:UUID kind:kind original:original updated:updated];
+            }
+        }
+    }
+
+    return changeSet;
+}
+
+#pragma mark BLMProject
+
+- (BLMProject *)createProjectWithName:(NSString *)name client:(NSString *)client sessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID {
+    BLMProject *project = [[BLMProject alloc] initWithUUID:[NSUUID UUID] name:name client:client sessionConfigurationUUID:sessionConfigurationUUID sessionUUIDs:nil];
+    [self stageObject:project forUUID:project.UUID kind:BLMArchiveEntityKindProject];
+
+    return project;
+}
+
+
+- (BLMProject *)updateProjectForUUID:(NSUUID *)UUID property:(BLMProjectProperty)property value:(id)value {
+    BLMProject *original = [self objectForUUID:UUID kind:BLMArchiveEntityKindProject];
+    assert(original != nil);
+
+    BLMProject *updated = [original copyWithUpdatedValuesByProperty:@{ @(property):(value ?: [NSNull null]) }];
+    [self stageObject:updated forUUID:UUID kind:BLMArchiveEntityKindProject];
+
+    return updated;
+}
+
+#pragma mark BLMBehavior
+
+- (BLMBehavior *)createBehaviorWithName:(NSString *)name continuous:(BOOL)continuous {
+    return [self createBehaviorWithUUID:[NSUUID UUID] name:name continuous:continuous];
+}
+
+
+- (BLMBehavior *)createBehaviorWithUUID:(NSUUID *)UUID name:(NSString *)name continuous:(BOOL)continuous {
+    assert([self objectForUUID:UUID kind:BLMArchiveEntityKindBehavior] == nil);
+
+    BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:UUID name:name continuous:continuous];
+    [self stageObject:behavior forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+
+    return behavior;
+}
+
+
+- (BLMBehavior *)updateBehaviorForUUID:(NSUUID *)UUID property:(BLMBehaviorProperty)property value:(id)value {
+    BLMBehavior *original = [self objectForUUID:UUID kind:BLMArchiveEntityKindBehavior];
+    assert(original != nil);
+
+    BLMBehavior *updated = [original copyWithUpdatedValuesByProperty:@{ @(property):(value ?: [NSNull null]) }];
+    [self stageObject:updated forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+
+    return updated;
+}
+
+
+- (void)deleteBehaviorForUUID:(NSUUID *)UUID {
+    assert([self objectForUUID:UUID kind:BLMArchiveEntityKindBehavior] != nil);
+    [self stageObject:nil forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+}
+
+#pragma mark BLMSession
+
+- (BLMSession *)createSessionWithName:(NSString *)name configurationUUID:(NSUUID *)configurationUUID {
+    BLMSession *session = [[BLMSession alloc] initWithUUID:[NSUUID UUID] name:name configurationUUID:configurationUUID creationDate:[NSDate date] startDate:nil endDate:nil];
+    [self stageObject:session forUUID:session.UUID kind:BLMArchiveEntityKindSession];
+
+    return session;
+}
+
+
+- (BLMSession *)updateSessionForUUID:(NSUUID *)UUID property:(BLMSessionProperty)property value:(id)value {
+    BLMSession *original = [self objectForUUID:UUID kind:BLMArchiveEntityKindSession];
+    assert(original != nil);
+
+    BLMSession *updated = [original copyWithUpdatedValuesByProperty:@{ @(property):(value ?: [NSNull null]) }];
+    [self stageObject:updated forUUID:UUID kind:BLMArchiveEntityKindSession];
+
+    return updated;
+}
+
+
+- (void)deleteSessionForUUID:(NSUUID *)UUID {
+    assert([self objectForUUID:UUID kind:BLMArchiveEntityKindSession] != nil);
+    [self stageObject:nil forUUID:UUID kind:BLMArchiveEntityKindSession];
+}
+
+#pragma mark BLMSessionConfiguration
+
+- (BLMSessionConfiguration *)createSessionConfigurationWithCondition:(NSString *)condition location:(NSString *)location therapist:(NSString *)therapist observer:(NSString *)observer timeLimit:(BLMTimeInterval)timeLimit timeLimitOptions:(BLMTimeLimitOptions)timeLimitOptions behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs {
+    BLMSessionConfiguration *sessionConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:[NSUUID UUID] condition:condition location:location therapist:therapist observer:observer timeLimit:timeLimit timeLimitOptions:timeLimitOptions behaviorUUIDs:behaviorUUIDs];
+    [self stageObject:sessionConfiguration forUUID:sessionConfiguration.UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    return sessionConfiguration;
+}
+
+
+- (BLMSessionConfiguration *)updateSessionConfigurationForUUID:(NSUUID *)UUID property:(BLMSessionConfigurationProperty)property value:(id)value {
+    BLMSessionConfiguration *original = [self objectForUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+    assert(original != nil);
+
+    BLMSessionConfiguration *updated = [original copyWithUpdatedValuesByProperty:@{ @(property):(value ?: [NSNull null]) }];
+    [self stageObject:updated forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    return updated;
+}
+
+
+- (void)deleteSessionConfigurationForUUID:(NSUUID *)UUID {
+    assert([self objectForUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration] != nil);
+    [self stageObject:nil forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+}
+
+@end
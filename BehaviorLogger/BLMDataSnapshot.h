@@ -0,0 +1,55 @@
+//
+//  BLMDataSnapshot.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/24/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMPersistentMap.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class BLMBehavior;
+@class BLMProject;
+@class BLMSession;
+@class BLMSessionConfiguration;
+
+
+/*
+ ` The data manager's objects as they were at one generation. Taking a snapshot on the main thread costs
+ ` O(1), since it holds the data manager's persistent maps rather than copies of them, and a snapshot is
+ ` immutable, so it may then be read from any thread. Sessions and their configurations are only those
+ ` of projects whose session data was loaded when the snapshot was taken.
+ `
+ ` Every change to the data manager's objects advances its generation, so background work can compare
+ ` its snapshot's generation with the data manager's to tell whether its results are stale.
+ */
+
+@interface BLMDataSnapshot : NSObject
+
+@property (nonatomic, assign, readonly) uint64_t generation;
+
+- (instancetype)initWithGeneration:(uint64_t)generation projectByUUID:(BLMPersistentMap<NSUUID *, BLMProject *> *)projectByUUID behaviorByUUID:(BLMPersistentMap<NSUUID *, BLMBehavior *> *)behaviorByUUID sessionByUUID:(BLMPersistentMap<NSUUID *, BLMSession *> *)sessionByUUID sessionConfigurationByUUID:(BLMPersistentMap<NSUUID *, BLMSessionConfiguration *> *)sessionConfigurationByUUID;
+
+- (nullable BLMProject *)projectForUUID:(NSUUID *)UUID;
+- (NSEnumerator<BLMProject *> *)projectEnumerator;
+- (NSUInteger)projectCount;
+
+- (nullable BLMBehavior *)behaviorForUUID:(NSUUID *)UUID;
+- (NSEnumerator<BLMBehavior *> *)behaviorEnumerator;
+
+- (nullable BLMSession *)sessionForUUID:(NSUUID *)UUID;
+- (NSEnumerator<BLMSession *> *)sessionEnumerator;
+
+- (nullable BLMSessionConfiguration *)sessionConfigurationForUUID:(NSUUID *)UUID;
+- (NSEnumerator<BLMSessionConfiguration *> *)sessionConfigurationEnumerator;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
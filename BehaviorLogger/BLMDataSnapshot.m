@@ -0,0 +1,94 @@
+//
+//  BLMDataSnapshot.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/24/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMDataSnapshot.h"
+
+
+@interface BLMDataSnapshot ()
+
+@property (nonatomic, strong, readonly) BLMPersistentMap<NSUUID *, BLMProject *> *projectByUUID;
+@property (nonatomic, strong, readonly) BLMPersistentMap<NSUUID *, BLMBehavior *> *behaviorByUUID;
+@property (nonatomic, strong, readonly) BLMPersistentMap<NSUUID *, BLMSession *> *sessionByUUID;
+@property (nonatomic, strong, readonly) BLMPersistentMap<NSUUID *, BLMSessionConfiguration *> *sessionConfigurationByUUID;
+
+@end
+
+
+@implementation BLMDataSnapshot
+
+- (instancetype)initWithGeneration:(uint64_t)generation projectByUUID:(BLMPersistentMap<NSUUID *, BLMProject *> *)projectByUUID behaviorByUUID:(BLMPersistentMap<NSUUID *, BLMBehavior *> *)behaviorByUUID sessionByUUID:(BLMPersistentMap<NSUUID *, BLMSession *> *)sessionByUUID sessionConfigurationByUUID:(BLMPersistentMap<NSUUID *, BLMSessionConfiguration *> *)sessionConfigurationByUUID {
+    assert(projectByUUID != nil);
+    assert(behaviorByUUID != nil);
+    assert(sessionByUUID != nil);
+    assert(sessionConfigurationByUUID != nil);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _generation = generation;
+    _projectByUUID = projectByUUID;
+    _behaviorByUUID = behaviorByUUID;
+    _sessionByUUID = sessionByUUID;
+    _sessionConfigurationByUUID = sessionConfigurationByUUID;
+
+    return self;
+}
+
+#pragma mark BLMProject
+
+- (BLMProject *)projectForUUID:(NSUUID *)UUID {
+    return self.projectByUUID[UUID];
+}
+
+
+- (NSEnumerator<BLMProject *> *)projectEnumerator {
+    return self.projectByUUID.objectEnumerator;
+}
+
+
+- (NSUInteger)projectCount {
+    return self.projectByUUID.count;
+}
+
+#pragma mark BLMBehavior
+
+- (BLMBehavior *)behaviorForUUID:(NSUUID *)UUID {
+    return self.behaviorByUUID[UUID];
+}
+
+
+- (NSEnumerator<BLMBehavior *> *)behaviorEnumerator {
+    return self.behaviorByUUID.objectEnumerator;
+}
+
+#pragma mark BLMSession
+
+- (BLMSession *)sessionForUUID:(NSUUID *)UUID {
+    return self.sessionByUUID[UUID];
+}
+
+
+- (NSEnumerator<BLMSession *> *)sessionEnumerator {
+    return self.sessionByUUID.objectEnumerator;
+}
+
+#pragma mark BLMSessionConfiguration
+
+- (BLMSessionConfiguration *)sessionConfigurationForUUID:(NSUUID *)UUID {
+    return self.sessionConfigurationByUUID[UUID];
+}
+
+
+- (NSEnumerator<BLMSessionConfiguration *> *)sessionConfigurationEnumerator {
+    return self.sessionConfigurationByUUID.objectEnumerator;
+}
+
+@end
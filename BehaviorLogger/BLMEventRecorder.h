@@ -0,0 +1,46 @@
+//
+//  BLMEventRecorder.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/9/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMEventStore.h"
+#import "BLMSessionMetrics.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/*
+ ` Captures events on the main thread and hands them to a background consumer that appends them to an
+ ` event store. The hand-off is a single-producer/single-consumer ring buffer: recording an event never
+ ` takes a lock or touches the disk, it only writes the record into the next free slot and wakes the
+ ` consumer, which drains every slot published since its last pass in one write.
+ `
+ ` If the consumer falls a full ring (1024 events) behind, further events are dropped and counted
+ ` rather than blocking the main thread.
+ */
+
+@interface BLMEventRecorder : NSObject
+
+@property (nonatomic, strong, readonly) BLMEventStore *store;
+@property (nonatomic, assign, readonly, getter=isRecording) BOOL recording;
+@property (nonatomic, assign, readonly) NSUInteger recordedEventCount;
+@property (nonatomic, assign, readonly) NSUInteger droppedEventCount;
+@property (nullable, nonatomic, strong) BLMSessionMetrics *metrics; // Every event that reaches the store is also applied here, on the main thread
+
+- (instancetype)initWithStore:(BLMEventStore *)store queue:(dispatch_queue_t)queue; // The store is only accessed from the queue, which must be serial
+
+- (void)startAtTimeOffset:(uint64_t)timeOffset; // Resumes a session that already has events at timeOffset nanoseconds; 0 for a new session
+- (uint64_t)currentTimeOffset;
+- (BOOL)recordEventWithType:(BLMSessionEventType)type behaviorIndex:(uint32_t)behaviorIndex; // NO if the event was dropped
+- (void)stopWithCompletion:(nullable dispatch_block_t)completion; // Completion runs on the main thread once every recorded event is in the store
+
+@end
+
+
+NS_ASSUME_NONNULL_END
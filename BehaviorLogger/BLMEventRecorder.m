@@ -0,0 +1,201 @@
+//
+//  BLMEventRecorder.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/9/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMEventRecorder.h"
+
+#import <mach/mach_time.h>
+#import <stdatomic.h>
+
+
+#pragma mark Constants
+
+enum {
+    RingBufferCapacity = 1024 // Must be a power of two
+};
+
+
+typedef struct RingBuffer {
+    BLMSessionEvent Events[RingBufferCapacity];
+    _Atomic(uint64_t) Head; // Total events published; only written by the producer
+    _Atomic(uint64_t) Tail; // Total events consumed; only written by the consumer
+} RingBuffer;
+
+
+static mach_timebase_info_data_t MachTimebase() {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken = 0;
+
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+
+    return timebase;
+}
+
+
+static void DrainRingBuffer(RingBuffer *ringBuffer, BLMEventStore *store) { // Only called on the consumer queue
+    uint64_t tail = atomic_load_explicit(&ringBuffer->Tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ringBuffer->Head, memory_order_acquire); // Pairs with the producer's release, so every slot before head is fully written
+
+    while (tail < head) {
+        NSUInteger startIndex = (NSUInteger)(tail & (RingBufferCapacity - 1));
+        NSUInteger count = (NSUInteger)MIN((head - tail), (RingBufferCapacity - startIndex)); // Slots up to the end of the ring, then the wrapped remainder on the next pass
+
+        if (![store appendEvents:&ringBuffer->Events[startIndex] count:count]) {
+            assert(NO);
+        }
+
+        tail += count;
+        atomic_store_explicit(&ringBuffer->Tail, tail, memory_order_release); // Slots are only handed back once they have been written out
+    }
+}
+
+
+static void FinishDraining(dispatch_queue_t queue, dispatch_source_t drainSource, RingBuffer *ringBuffer, BLMEventStore *store, dispatch_block_t completion) { // Only called once the producer has stopped
+    dispatch_async(queue, ^{
+        DrainRingBuffer(ringBuffer, store);
+        [store close];
+
+        dispatch_source_cancel(drainSource); // The cancel handler frees the buffer once any pending drain has been skipped
+
+        if (completion != nil) {
+            dispatch_async(dispatch_get_main_queue(), completion);
+        }
+    });
+}
+
+
+#pragma mark
+
+@interface BLMEventRecorder ()
+
+@property (nonatomic, strong, readonly) dispatch_queue_t queue;
+@property (nonatomic, strong, readonly) dispatch_source_t drainSource;
+@property (nonatomic, assign, readonly) RingBuffer *ringBuffer;
+@property (nonatomic, assign) uint64_t startMachTime;
+@property (nonatomic, assign, getter=isStopped) BOOL stopped;
+
+@end
+
+
+@implementation BLMEventRecorder
+
+- (instancetype)initWithStore:(BLMEventStore *)store queue:(dispatch_queue_t)queue {
+    assert((RingBufferCapacity & (RingBufferCapacity - 1)) == 0);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    RingBuffer *ringBuffer = calloc(1, sizeof(RingBuffer));
+    assert(ringBuffer != NULL);
+
+    atomic_init(&ringBuffer->Head, 0);
+    atomic_init(&ringBuffer->Tail, 0);
+
+    dispatch_source_t drainSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, queue); // Wake-ups posted while a drain is pending coalesce into one
+
+    dispatch_source_set_event_handler(drainSource, ^{ // Captures the buffer and store rather than self so a pending drain never outlives them
+        DrainRingBuffer(ringBuffer, store);
+    });
+
+    dispatch_source_set_cancel_handler(drainSource, ^{
+        free(ringBuffer);
+    });
+
+    _store = store;
+    _queue = queue;
+    _drainSource = drainSource;
+    _ringBuffer = ringBuffer;
+
+    return self;
+}
+
+
+- (void)dealloc {
+    if (_stopped) {
+        return;
+    }
+
+    if (!_recording) {
+        dispatch_resume(_drainSource); // A suspended source is never cancelled
+    }
+
+    FinishDraining(_queue, _drainSource, _ringBuffer, _store, nil);
+}
+
+#pragma mark Recording
+
+- (void)startAtTimeOffset:(uint64_t)timeOffset {
+    assert([NSThread isMainThread]);
+    assert(!self.isRecording);
+    assert(!self.isStopped);
+
+    mach_timebase_info_data_t timebase = MachTimebase();
+    uint64_t machTime = mach_absolute_time();
+    uint64_t timeOffsetMachTime = ((timeOffset * timebase.denom) / timebase.numer); // Walk the start back so the clock continues from where the session left off
+
+    self.startMachTime = (machTime - MIN(machTime, timeOffsetMachTime));
+
+    _recording = YES;
+
+    dispatch_resume(self.drainSource);
+}
+
+
+- (uint64_t)currentTimeOffset {
+    assert(self.isRecording);
+
+    mach_timebase_info_data_t timebase = MachTimebase();
+
+    return (((mach_absolute_time() - self.startMachTime) * timebase.numer) / timebase.denom);
+}
+
+
+- (BOOL)recordEventWithType:(BLMSessionEventType)type behaviorIndex:(uint32_t)behaviorIndex {
+    assert([NSThread isMainThread]);
+    assert(self.isRecording);
+    assert(type < BLMSessionEventTypeCount);
+
+    RingBuffer *ringBuffer = self.ringBuffer;
+    uint64_t head = atomic_load_explicit(&ringBuffer->Head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ringBuffer->Tail, memory_order_acquire); // Pairs with the consumer's release, so a freed slot is no longer being read
+
+    if ((head - tail) >= RingBufferCapacity) {
+        _droppedEventCount += 1;
+        return NO;
+    }
+
+    BLMSessionEvent event = { .TimeOffset = self.currentTimeOffset, .BehaviorIndex = behaviorIndex, .Type = type };
+
+    ringBuffer->Events[head & (RingBufferCapacity - 1)] = event;
+    atomic_store_explicit(&ringBuffer->Head, (head + 1), memory_order_release);
+
+    dispatch_source_merge_data(self.drainSource, 1);
+
+    [self.metrics applyEvent:event];
+
+    _recordedEventCount += 1;
+
+    return YES;
+}
+
+
+- (void)stopWithCompletion:(dispatch_block_t)completion {
+    assert([NSThread isMainThread]);
+    assert(self.isRecording);
+
+    _recording = NO;
+    self.stopped = YES;
+
+    FinishDraining(self.queue, self.drainSource, self.ringBuffer, self.store, completion);
+}
+
+@end
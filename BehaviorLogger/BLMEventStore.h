@@ -0,0 +1,75 @@
+//
+//  BLMEventStore.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/9/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+typedef NS_ENUM(uint32_t, BLMSessionEventType) {
+    BLMSessionEventTypeOccurrence, // A discrete behavior was observed
+    BLMSessionEventTypeOnset, // A continuous behavior started
+    BLMSessionEventTypeOffset, // A continuous behavior stopped
+    BLMSessionEventTypeCount
+};
+
+
+typedef struct BLMSessionEvent {
+    uint64_t TimeOffset; // Nanoseconds since the session started, measured with the monotonic clock
+    uint32_t BehaviorIndex; // Index into the session configuration's behaviorUUIDs
+    BLMSessionEventType Type;
+} BLMSessionEvent;
+
+
+#pragma mark
+
+/*
+ ` ### Event File Layout
+ `
+ ` *------------------------------* <- Header: magic and version
+ ` |            Header            |
+ ` *------------------------------*
+ ` |         Block Header         | <- Payload length and checksum, event count, min/max time offset
+ ` |         Time Column          | <- Varint deltas from the previous event's time offset
+ ` |       Behavior Column        | <- Varint (behavior index << 2 | event type)
+ ` *------------------------------*
+ ` |             ...              | <- Further blocks of at most 512 events
+ ` *------------------------------*
+ `
+ ` Events are stored in the order they were recorded, which must also be time order. Each append
+ ` writes its own block, so the file can grow while a session is recording; closing the store folds
+ ` runs of small blocks back into full ones. Only the block headers are read to build the time index,
+ ` so a range scan decodes just the blocks that overlap it. A torn final block is truncated away the
+ ` first time the file is read or appended to. A file whose header isn't recognized is moved aside
+ ` rather than truncated, and the store starts over with an empty file.
+ `
+ ` The store is not thread safe; every message must be sent from its owner's serial queue.
+ */
+
+@interface BLMEventStore : NSObject
+
+@property (nonatomic, copy, readonly) NSString *path;
+@property (nonatomic, assign, readonly) BOOL hasEvents;
+@property (nonatomic, assign, readonly) NSUInteger eventCount;
+@property (nonatomic, assign, readonly) uint64_t lastTimeOffset; // 0 if the store is empty
+@property (nullable, nonatomic, strong, readonly) NSError *readError; // Set when the file had an unrecognized header; it is kept at the error's NSFilePathErrorKey, and if it couldn't be moved there nothing is appended
+
+- (instancetype)initWithDirectory:(NSString *)directory sessionUUID:(NSUUID *)sessionUUID;
+
+- (BOOL)appendEvents:(BLMSessionEvent const *)events count:(NSUInteger)count; // Events must not precede lastTimeOffset
+- (void)enumerateEventsUsingBlock:(void(^)(BLMSessionEvent event, BOOL *stop))block;
+- (void)enumerateEventsFromTimeOffset:(uint64_t)startTimeOffset toTimeOffset:(uint64_t)endTimeOffset usingBlock:(void(^)(BLMSessionEvent event, BOOL *stop))block; // Events in [startTimeOffset, endTimeOffset)
+- (BOOL)compact; // Rewrites the file with every block full
+- (void)close; // Releases the file handle held open while appending and compacts the file if appends left it fragmented
+- (void)discard; // Deletes the file
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,516 @@
+//
+//  BLMEventStore.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/9/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMEventStore.h"
+#import "BLMUtils.h"
+
+
+#pragma mark Constants
+
+static NSString *const EventFileExtension = @"events";
+static NSString *const UnreadableFileExtension = @"unreadable";
+
+static uint32_t const EventFileMagic = 0x454D4C42; // "BLME"
+
+static NSUInteger const BlockEventCapacity = 512;
+static NSUInteger const FragmentedBlockCompactionThreshold = 16; // Closing the store compacts it once this many blocks are less than full
+
+
+typedef NS_ENUM(uint32_t, EventFileVersion) {
+    EventFileVersionUnknown,
+    EventFileVersionFixedRecords, // The header is followed by packed BLMSessionEvent records; migrated to blocks the first time the file is read
+    EventFileVersionColumnarBlocks, // The header is followed by delta-encoded blocks
+    EventFileVersionLatest = EventFileVersionColumnarBlocks
+};
+
+
+typedef struct EventFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+} EventFileHeader;
+
+
+typedef struct EventBlockHeader {
+    uint32_t Length; // Byte length of the payload that immediately follows the header
+    uint32_t Checksum; // FNV-1a hash of the payload bytes
+    uint32_t EventCount;
+    uint32_t TimeColumnLength; // The behavior column takes up the rest of the payload
+    uint64_t MinTimeOffset; // Time offset of the first event, which every delta in the time column builds on
+    uint64_t MaxTimeOffset;
+} EventBlockHeader;
+
+
+typedef struct EventBlockIndexEntry {
+    uint64_t Offset; // File offset of the block header
+    uint64_t MinTimeOffset;
+    uint64_t MaxTimeOffset;
+    uint32_t EventCount;
+} EventBlockIndexEntry;
+
+
+static inline void AppendVarint(NSMutableData *data, uint64_t value) {
+    uint8_t bytes[10];
+    NSUInteger length = 0;
+
+    do {
+        bytes[length] = (uint8_t)(value & 0x7F);
+        value >>= 7;
+
+        if (value != 0) {
+            bytes[length] |= 0x80;
+        }
+
+        length += 1;
+    } while (value != 0);
+
+    [data appendBytes:bytes length:length];
+}
+
+
+static inline BOOL ReadVarint(uint8_t const **cursor, uint8_t const *end, uint64_t *value) {
+    uint64_t result = 0;
+
+    for (unsigned shift = 0; (*cursor < end) && (shift < 64); shift += 7) {
+        uint8_t byte = **cursor;
+        *cursor += 1;
+
+        result |= ((uint64_t)(byte & 0x7F) << shift);
+
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+
+static NSData *BlockDataForEvents(BLMSessionEvent const *events, NSUInteger count) {
+    assert((count > 0) && (count <= BlockEventCapacity));
+
+    NSMutableData *timeColumn = [NSMutableData dataWithCapacity:(count * 2)];
+    NSMutableData *behaviorColumn = [NSMutableData dataWithCapacity:count];
+    uint64_t previousTimeOffset = events[0].TimeOffset;
+
+    for (NSUInteger index = 0; index < count; index += 1) {
+        assert(events[index].TimeOffset >= previousTimeOffset);
+        assert(events[index].Type < BLMSessionEventTypeCount);
+
+        AppendVarint(timeColumn, (events[index].TimeOffset - previousTimeOffset));
+        AppendVarint(behaviorColumn, (((uint64_t)events[index].BehaviorIndex << 2) | events[index].Type));
+
+        previousTimeOffset = events[index].TimeOffset;
+    }
+
+    NSMutableData *blockData = [NSMutableData dataWithLength:sizeof(EventBlockHeader)];
+
+    [blockData appendData:timeColumn];
+    [blockData appendData:behaviorColumn];
+
+    NSUInteger payloadLength = (timeColumn.length + behaviorColumn.length);
+
+    EventBlockHeader blockHeader = {
+        .Length = (uint32_t)payloadLength,
+        .Checksum = [BLMUtils checksumForBytes:((uint8_t const *)blockData.bytes + sizeof(EventBlockHeader)) length:payloadLength],
+        .EventCount = (uint32_t)count,
+        .TimeColumnLength = (uint32_t)timeColumn.length,
+        .MinTimeOffset = events[0].TimeOffset,
+        .MaxTimeOffset = events[count - 1].TimeOffset
+    };
+
+    [blockData replaceBytesInRange:NSMakeRange(0, sizeof(EventBlockHeader)) withBytes:&blockHeader];
+
+    return blockData;
+}
+
+
+static NSData *FileDataForEvents(BLMSessionEvent const *events, NSUInteger count) { // Every block is full except the last
+    NSMutableData *fileData = [NSMutableData data];
+    EventFileHeader fileHeader = { .Magic = EventFileMagic, .Version = EventFileVersionLatest };
+
+    [fileData appendBytes:&fileHeader length:sizeof(EventFileHeader)];
+
+    for (NSUInteger startIndex = 0; startIndex < count; startIndex += BlockEventCapacity) {
+        [fileData appendData:BlockDataForEvents((events + startIndex), MIN(BlockEventCapacity, (count - startIndex)))];
+    }
+
+    return fileData;
+}
+
+
+static BOOL DecodeBlock(uint8_t const *blockBytes, uint64_t startTimeOffset, uint64_t endTimeOffset, BOOL *stop, void(^block)(BLMSessionEvent event, BOOL *stop)) {
+    EventBlockHeader blockHeader;
+    memcpy(&blockHeader, blockBytes, sizeof(EventBlockHeader));
+
+    uint8_t const *timeCursor = (blockBytes + sizeof(EventBlockHeader));
+    uint8_t const *timeEnd = (timeCursor + blockHeader.TimeColumnLength);
+    uint8_t const *behaviorCursor = timeEnd;
+    uint8_t const *behaviorEnd = (timeCursor + blockHeader.Length);
+    uint64_t timeOffset = blockHeader.MinTimeOffset;
+
+    for (uint32_t index = 0; (index < blockHeader.EventCount) && !*stop; index += 1) {
+        uint64_t timeDelta = 0;
+        uint64_t behaviorValue = 0;
+
+        if (!ReadVarint(&timeCursor, timeEnd, &timeDelta) || !ReadVarint(&behaviorCursor, behaviorEnd, &behaviorValue)) {
+            return NO;
+        }
+
+        timeOffset += timeDelta;
+
+        if (timeOffset < startTimeOffset) {
+            continue;
+        }
+
+        if (timeOffset >= endTimeOffset) { // Every later event is also past the end of the range
+            *stop = YES;
+            break;
+        }
+
+        BLMSessionEvent event = { .TimeOffset = timeOffset, .BehaviorIndex = (uint32_t)(behaviorValue >> 2), .Type = (BLMSessionEventType)(behaviorValue & 0x3) };
+        block(event, stop);
+    }
+
+    return YES;
+}
+
+
+#pragma mark
+
+@interface BLMEventStore ()
+
+@property (nonatomic, copy, readonly) NSString *directory;
+@property (nullable, nonatomic, strong) NSFileHandle *fileHandle;
+@property (nonatomic, strong, readonly) NSMutableData *blockIndex; // One EventBlockIndexEntry per block, in file order
+@property (nonatomic, assign) NSUInteger indexedEventCount;
+@property (nonatomic, assign) unsigned long long validLength; // Length of the header plus every complete block
+@property (nonatomic, assign, getter=isValidated) BOOL validated;
+@property (nonatomic, assign, getter=isLocked) BOOL locked; // Set when an unreadable file couldn't be moved aside, so it is never overwritten
+
+@end
+
+
+@implementation BLMEventStore
+
+- (instancetype)initWithDirectory:(NSString *)directory sessionUUID:(NSUUID *)sessionUUID {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _directory = [directory copy];
+    _path = [[directory stringByAppendingPathComponent:sessionUUID.UUIDString] stringByAppendingPathExtension:EventFileExtension];
+    _blockIndex = [NSMutableData data];
+
+    return self;
+}
+
+
+- (void)dealloc {
+    [_fileHandle closeFile];
+}
+
+
+- (BOOL)hasEvents {
+    return (self.eventCount > 0);
+}
+
+
+- (NSUInteger)eventCount {
+    [self validateIfNeeded];
+    return self.indexedEventCount;
+}
+
+
+- (uint64_t)lastTimeOffset {
+    [self validateIfNeeded];
+
+    NSUInteger blockCount = (self.blockIndex.length / sizeof(EventBlockIndexEntry));
+
+    if (blockCount == 0) {
+        return 0;
+    }
+
+    return ((EventBlockIndexEntry const *)self.blockIndex.bytes)[blockCount - 1].MaxTimeOffset;
+}
+
+#pragma mark Reading
+
+- (void)validateIfNeeded {
+    if (self.isValidated) {
+        return;
+    }
+
+    self.validated = YES;
+    self.blockIndex.length = 0;
+    self.indexedEventCount = 0;
+
+    NSData *eventData = [NSData dataWithContentsOfFile:self.path options:NSDataReadingMappedIfSafe error:NULL];
+    unsigned long long validLength = 0;
+
+    if (eventData.length >= sizeof(EventFileHeader)) {
+        EventFileHeader fileHeader;
+        memcpy(&fileHeader, eventData.bytes, sizeof(EventFileHeader));
+
+        if ((fileHeader.Magic == EventFileMagic) && (fileHeader.Version == EventFileVersionColumnarBlocks)) {
+            validLength = [self indexBlocksInEventData:eventData];
+        } else if ((fileHeader.Magic == EventFileMagic) && (fileHeader.Version == EventFileVersionFixedRecords)) {
+            [self migrateFixedRecordEventData:eventData];
+            return;
+        } else {
+            [self setAsideUnreadableEventFile];
+            return;
+        }
+    }
+
+    if ((eventData != nil) && (validLength < eventData.length)) { // Discard a torn final block so the next append starts on a block boundary
+        NSFileHandle *eventFile = [NSFileHandle fileHandleForWritingAtPath:self.path];
+
+        [eventFile truncateFileAtOffset:validLength];
+        [eventFile closeFile];
+    }
+
+    self.validLength = validLength;
+}
+
+
+- (void)setAsideUnreadableEventFile { // Written by a newer version, or damaged; either way its events may still be recoverable
+    NSString *unreadablePath = [[self.path stringByAppendingPathExtension:[NSString stringWithFormat:@"%llu", (unsigned long long)[NSDate date].timeIntervalSince1970]] stringByAppendingPathExtension:UnreadableFileExtension];
+    NSError *moveError = nil;
+
+    self.validLength = 0;
+
+    if (![[NSFileManager defaultManager] moveItemAtPath:self.path toPath:unreadablePath error:&moveError]) {
+        _readError = moveError;
+        self.locked = YES;
+        return;
+    }
+
+    _readError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:@{ NSFilePathErrorKey:unreadablePath, NSLocalizedFailureReasonErrorKey:@"The event file has an unrecognized header" }];
+}
+
+
+- (unsigned long long)indexBlocksInEventData:(NSData *)eventData { // Reads block headers only; payloads are left untouched until they are scanned
+    uint8_t const *bytes = eventData.bytes;
+    unsigned long long offset = sizeof(EventFileHeader);
+
+    while ((offset + sizeof(EventBlockHeader)) <= eventData.length) {
+        EventBlockHeader blockHeader;
+        memcpy(&blockHeader, (bytes + offset), sizeof(EventBlockHeader));
+
+        unsigned long long payloadOffset = (offset + sizeof(EventBlockHeader));
+        unsigned long long blockEnd = (payloadOffset + blockHeader.Length);
+
+        if ((blockHeader.EventCount == 0)
+            || (blockHeader.TimeColumnLength > blockHeader.Length)
+            || (blockEnd > eventData.length)) {
+            break;
+        }
+
+        if ((blockEnd == eventData.length) // Earlier blocks were followed by a complete append, so only the final one can be torn
+            && ([BLMUtils checksumForBytes:(bytes + payloadOffset) length:blockHeader.Length] != blockHeader.Checksum)) {
+            break;
+        }
+
+        EventBlockIndexEntry entry = { .Offset = offset, .MinTimeOffset = blockHeader.MinTimeOffset, .MaxTimeOffset = blockHeader.MaxTimeOffset, .EventCount = blockHeader.EventCount };
+
+        [self.blockIndex appendBytes:&entry length:sizeof(EventBlockIndexEntry)];
+        self.indexedEventCount += blockHeader.EventCount;
+
+        offset = blockEnd;
+    }
+
+    return offset;
+}
+
+
+- (void)migrateFixedRecordEventData:(NSData *)eventData {
+    NSUInteger eventCount = ((eventData.length - sizeof(EventFileHeader)) / sizeof(BLMSessionEvent));
+    NSData *eventBuffer = [NSData dataWithBytes:((uint8_t const *)eventData.bytes + sizeof(EventFileHeader)) length:(eventCount * sizeof(BLMSessionEvent))]; // Copied so the records are aligned
+
+    if (![FileDataForEvents(eventBuffer.bytes, eventCount) writeToFile:self.path options:(NSDataWritingAtomic | NSDataWritingFileProtectionNone) error:NULL]) {
+        assert(NO);
+        return;
+    }
+
+    self.validated = NO;
+    [self validateIfNeeded];
+}
+
+
+- (void)enumerateEventsUsingBlock:(void(^)(BLMSessionEvent event, BOOL *stop))block {
+    [self enumerateEventsFromTimeOffset:0 toTimeOffset:UINT64_MAX usingBlock:block];
+}
+
+
+- (void)enumerateEventsFromTimeOffset:(uint64_t)startTimeOffset toTimeOffset:(uint64_t)endTimeOffset usingBlock:(void(^)(BLMSessionEvent event, BOOL *stop))block {
+    [self validateIfNeeded];
+
+    EventBlockIndexEntry const *entries = self.blockIndex.bytes;
+    NSUInteger blockCount = (self.blockIndex.length / sizeof(EventBlockIndexEntry));
+
+    if ((blockCount == 0) || (startTimeOffset >= endTimeOffset)) {
+        return;
+    }
+
+    NSUInteger lowerBound = 0;
+    NSUInteger upperBound = blockCount;
+
+    while (lowerBound < upperBound) { // Find the first block that ends at or after the start; maximums never decrease because events are appended in time order
+        NSUInteger middle = (lowerBound + ((upperBound - lowerBound) / 2));
+
+        if (entries[middle].MaxTimeOffset < startTimeOffset) {
+            lowerBound = (middle + 1);
+        } else {
+            upperBound = middle;
+        }
+    }
+
+    NSData *eventData = [NSData dataWithContentsOfFile:self.path options:NSDataReadingMappedIfSafe error:NULL];
+    BOOL stop = NO;
+
+    assert(eventData.length >= self.validLength);
+
+    for (NSUInteger blockIndex = lowerBound; (blockIndex < blockCount) && !stop && (entries[blockIndex].MinTimeOffset < endTimeOffset); blockIndex += 1) {
+        if (!DecodeBlock(((uint8_t const *)eventData.bytes + entries[blockIndex].Offset), startTimeOffset, endTimeOffset, &stop, block)) {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+#pragma mark Writing
+
+- (BOOL)appendEvents:(BLMSessionEvent const *)events count:(NSUInteger)count {
+    if (count == 0) {
+        return YES;
+    }
+
+    [self validateIfNeeded];
+
+    assert(events[0].TimeOffset >= self.lastTimeOffset);
+
+    if (self.isLocked) {
+        return NO;
+    }
+
+    if ((self.fileHandle == nil) && ![self openFileHandle]) {
+        return NO;
+    }
+
+    NSMutableData *appendedData = [NSMutableData data];
+
+    if (self.validLength == 0) {
+        EventFileHeader fileHeader = { .Magic = EventFileMagic, .Version = EventFileVersionLatest };
+        [appendedData appendBytes:&fileHeader length:sizeof(EventFileHeader)];
+    }
+
+    for (NSUInteger startIndex = 0; startIndex < count; startIndex += BlockEventCapacity) {
+        NSUInteger blockEventCount = MIN(BlockEventCapacity, (count - startIndex));
+        EventBlockIndexEntry entry = { .Offset = (self.validLength + appendedData.length), .MinTimeOffset = events[startIndex].TimeOffset, .MaxTimeOffset = events[startIndex + blockEventCount - 1].TimeOffset, .EventCount = (uint32_t)blockEventCount };
+
+        [appendedData appendData:BlockDataForEvents((events + startIndex), blockEventCount)];
+        [self.blockIndex appendBytes:&entry length:sizeof(EventBlockIndexEntry)];
+    }
+
+    [self.fileHandle writeData:appendedData];
+
+    self.validLength += appendedData.length;
+    self.indexedEventCount += count;
+
+    return YES;
+}
+
+
+- (BOOL)openFileHandle {
+    NSError *error = nil;
+
+    if (![[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:&error]) {
+        assert(NO);
+        return NO;
+    }
+
+    if (![[NSFileManager defaultManager] fileExistsAtPath:self.path]
+        && ![[NSFileManager defaultManager] createFileAtPath:self.path contents:nil attributes:@{ NSFileProtectionKey : NSFileProtectionNone }]) { // Sessions may be recorded while the device is locked
+        assert(NO);
+        return NO;
+    }
+
+    self.fileHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+    [self.fileHandle truncateFileAtOffset:self.validLength]; // Also positions the file pointer after the last complete block
+
+    return (self.fileHandle != nil);
+}
+
+
+- (BOOL)compact {
+    [self validateIfNeeded];
+
+    if (self.eventCount == 0) {
+        return YES;
+    }
+
+    NSMutableData *eventBuffer = [NSMutableData dataWithCapacity:(self.eventCount * sizeof(BLMSessionEvent))];
+
+    [self enumerateEventsUsingBlock:^(BLMSessionEvent event, BOOL *stop) {
+        [eventBuffer appendBytes:&event length:sizeof(BLMSessionEvent)];
+    }];
+
+    [self.fileHandle closeFile];
+    self.fileHandle = nil;
+
+    if (![FileDataForEvents(eventBuffer.bytes, (eventBuffer.length / sizeof(BLMSessionEvent))) writeToFile:self.path options:(NSDataWritingAtomic | NSDataWritingFileProtectionNone) error:NULL]) {
+        assert(NO);
+        return NO;
+    }
+
+    self.validated = NO; // The block index is rebuilt from the new file the next time it is needed
+
+    return YES;
+}
+
+
+- (void)close {
+    [self.fileHandle closeFile];
+    self.fileHandle = nil;
+
+    if (!self.isValidated) {
+        return;
+    }
+
+    EventBlockIndexEntry const *entries = self.blockIndex.bytes;
+    NSUInteger blockCount = (self.blockIndex.length / sizeof(EventBlockIndexEntry));
+    NSUInteger fragmentedBlockCount = 0;
+
+    for (NSUInteger blockIndex = 0; (blockIndex + 1) < blockCount; blockIndex += 1) { // The final block is allowed to be partial
+        if (entries[blockIndex].EventCount < BlockEventCapacity) {
+            fragmentedBlockCount += 1;
+        }
+    }
+
+    if (fragmentedBlockCount >= FragmentedBlockCompactionThreshold) {
+        [self compact];
+    }
+}
+
+
+- (void)discard {
+    [self.fileHandle closeFile];
+    self.fileHandle = nil;
+
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+
+    self.blockIndex.length = 0;
+    self.validLength = 0;
+    self.validated = YES;
+    self.indexedEventCount = 0;
+}
+
+@end
@@ -0,0 +1,59 @@
+//
+//  BLMExportWriter.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/15/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMEventStore.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+typedef NS_ENUM(NSInteger, BLMExportFormat) {
+    BLMExportFormatCSV, // One row per event, repeating its project, session and configuration; sessions without events get a single row
+    BLMExportFormatJSON // Projects containing sessions containing events
+};
+
+
+#pragma mark
+
+@class BLMBehavior;
+@class BLMDataSnapshot;
+@class BLMProject;
+@class BLMSession;
+@class BLMSessionConfiguration;
+
+
+/*
+ ` Streams an export to a file handle as it is walked, one project, session and event at a time.
+ ` Output collects in a fixed-size buffer that is written out whenever it fills, so memory use does
+ ` not depend on how much is exported. Once a write fails every later message is ignored, and the
+ ` failure is reported by finish.
+ `
+ ` The writer is not thread safe, but does not depend on the main thread.
+ */
+
+@interface BLMExportWriter : NSObject
+
+@property (nonatomic, assign, readonly) BLMExportFormat format;
+@property (nonatomic, assign, readonly) unsigned long long writtenLength; // Bytes handed to the file handle so far
+
+- (instancetype)initWithFileHandle:(NSFileHandle *)fileHandle format:(BLMExportFormat)format;
+
+- (void)beginProject:(BLMProject *)project;
+- (void)beginSession:(BLMSession *)session configuration:(BLMSessionConfiguration *)configuration snapshot:(BLMDataSnapshot *)snapshot;
+- (void)writeEvent:(BLMSessionEvent)event;
+- (void)endSession;
+- (void)endProject;
+
+- (BOOL)finishWithError:(NSError **)error; // Closes the document and writes out the buffer
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,378 @@
+//
+//  BLMExportWriter.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/15/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMBehavior.h"
+#import "BLMDataSnapshot.h"
+#import "BLMExportWriter.h"
+#import "BLMProject.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+#pragma mark Constants
+
+static NSUInteger const BufferCapacity = (64 * 1024);
+
+static NSString *const CSVHeader = @"Project,Client,Session,Session UUID,Start Date,End Date,Condition,Location,Therapist,Observer,Time Limit,Behavior,Behavior UUID,Continuous,Event,Time Offset\n";
+
+
+static char const *const EventTypeNames[BLMSessionEventTypeCount] = {
+    [BLMSessionEventTypeOccurrence] = "occurrence",
+    [BLMSessionEventTypeOnset] = "onset",
+    [BLMSessionEventTypeOffset] = "offset"
+};
+
+
+static NSString *CSVField(NSString *__nullable string) {
+    static NSCharacterSet *quotedCharacterSet = nil;
+    static dispatch_once_t onceToken = 0;
+
+    dispatch_once(&onceToken, ^{
+        quotedCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@",\"\r\n"];
+    });
+
+    if ((string == nil) || ([string rangeOfCharacterFromSet:quotedCharacterSet].location == NSNotFound)) {
+        return (string ?: @"");
+    }
+
+    return [NSString stringWithFormat:@"\"%@\"", [string stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+}
+
+
+static NSString *JSONValue(NSString *__nullable string) {
+    if (string == nil) {
+        return @"null";
+    }
+
+    NSMutableString *literal = [NSMutableString stringWithCapacity:(string.length + 2)];
+    [literal appendString:@"\""];
+
+    for (NSUInteger index = 0; index < string.length; index += 1) {
+        unichar character = [string characterAtIndex:index];
+
+        switch (character) {
+            case '"':
+                [literal appendString:@"\\\""];
+                break;
+
+            case '\\':
+                [literal appendString:@"\\\\"];
+                break;
+
+            case '\n':
+                [literal appendString:@"\\n"];
+                break;
+
+            case '\r':
+                [literal appendString:@"\\r"];
+                break;
+
+            case '\t':
+                [literal appendString:@"\\t"];
+                break;
+
+            default:
+                if (character < 0x20) {
+                    [literal appendFormat:@"\\u%04x", character];
+                } else {
+                    [literal appendFormat:@"%C", character];
+                }
+                break;
+        }
+    }
+
+    [literal appendString:@"\""];
+
+    return literal;
+}
+
+
+static inline int FormatTimeOffset(char *buffer, size_t length, uint64_t timeOffset) { // Seconds to the microsecond, without a round trip through floating point
+    return snprintf(buffer, length, "%llu.%06llu", (unsigned long long)(timeOffset / NSEC_PER_SEC), (unsigned long long)((timeOffset % NSEC_PER_SEC) / NSEC_PER_USEC));
+}
+
+
+#pragma mark
+
+@interface BLMExportWriter ()
+
+@property (nonatomic, strong, readonly) NSFileHandle *fileHandle;
+@property (nonatomic, strong, readonly) NSMutableData *buffer;
+@property (nonatomic, strong, readonly) NSDateFormatter *dateFormatter;
+@property (nonatomic, strong, nullable) NSError *writeError;
+@property (nonatomic, assign, getter=isDocumentStarted) BOOL documentStarted;
+@property (nonatomic, assign) NSUInteger projectCount;
+@property (nonatomic, assign) NSUInteger sessionCount; // Within the current project
+@property (nonatomic, assign) NSUInteger eventCount; // Within the current session
+@property (nonatomic, copy, nullable) NSString *projectFields; // CSV only
+@property (nonatomic, copy, nullable) NSString *sessionFields; // CSV only
+@property (nonatomic, copy, nullable) NSArray<NSData *> *eventPrefixes; // One per behavior index, ending where the event type begins
+@property (nonatomic, copy, nullable) NSData *unknownBehaviorEventPrefix; // For events recorded against behaviors since removed from the configuration
+
+@end
+
+
+@implementation BLMExportWriter
+
+- (instancetype)initWithFileHandle:(NSFileHandle *)fileHandle format:(BLMExportFormat)format {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _fileHandle = fileHandle;
+    _format = format;
+    _buffer = [NSMutableData dataWithCapacity:BufferCapacity];
+
+    _dateFormatter = [[NSDateFormatter alloc] init];
+    _dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    _dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    _dateFormatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'";
+
+    return self;
+}
+
+#pragma mark Buffering
+
+- (void)appendBytes:(void const *)bytes length:(NSUInteger)length {
+    if (self.writeError != nil) {
+        return;
+    }
+
+    if ((self.buffer.length + length) > BufferCapacity) {
+        [self flushBuffer];
+    }
+
+    if (length > BufferCapacity) { // Too large to buffer, so written straight through
+        [self writeData:[NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO]];
+        return;
+    }
+
+    [self.buffer appendBytes:bytes length:length];
+}
+
+
+- (void)appendString:(NSString *)string {
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    [self appendBytes:data.bytes length:data.length];
+}
+
+
+- (void)flushBuffer {
+    if (self.buffer.length == 0) {
+        return;
+    }
+
+    [self writeData:self.buffer];
+    self.buffer.length = 0;
+}
+
+
+- (void)writeData:(NSData *)data {
+    if (self.writeError != nil) {
+        return;
+    }
+
+    @try {
+        [self.fileHandle writeData:data];
+        _writtenLength += data.length;
+    } @catch (NSException *exception) { // NSFileHandle reports write failures, such as a full disk, by raising
+        self.writeError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:@{ NSLocalizedFailureReasonErrorKey:(exception.reason ?: @"") }];
+    }
+}
+
+#pragma mark Document Structure
+
+- (void)startDocumentIfNeeded {
+    if (self.isDocumentStarted) {
+        return;
+    }
+
+    self.documentStarted = YES;
+
+    switch (self.format) {
+        case BLMExportFormatCSV:
+            [self appendString:CSVHeader];
+            break;
+
+        case BLMExportFormatJSON:
+            [self appendString:@"{\"projects\":["];
+            break;
+    }
+}
+
+
+- (void)beginProject:(BLMProject *)project {
+    assert(self.projectFields == nil);
+
+    [self startDocumentIfNeeded];
+
+    switch (self.format) {
+        case BLMExportFormatCSV: {
+            self.projectFields = [NSString stringWithFormat:@"%@,%@", CSVField(project.name), CSVField(project.client)];
+            break;
+        }
+
+        case BLMExportFormatJSON: {
+            self.projectFields = @"";
+            [self appendString:[NSString stringWithFormat:@"%@{\"UUID\":\"%@\",\"name\":%@,\"client\":%@,\"sessions\":[", ((self.projectCount > 0) ? @"," : @""), project.UUID.UUIDString, JSONValue(project.name), JSONValue(project.client)]];
+            break;
+        }
+    }
+
+    self.projectCount += 1;
+    self.sessionCount = 0;
+}
+
+
+- (void)beginSession:(BLMSession *)session configuration:(BLMSessionConfiguration *)configuration snapshot:(BLMDataSnapshot *)snapshot {
+    assert(self.projectFields != nil);
+    assert(self.eventPrefixes == nil);
+
+    NSMutableArray<NSData *> *eventPrefixes = [NSMutableArray arrayWithCapacity:configuration.behaviorUUIDs.count];
+    NSString *startDate = ((session.startDate != nil) ? [self.dateFormatter stringFromDate:session.startDate] : nil);
+    NSString *endDate = ((session.endDate != nil) ? [self.dateFormatter stringFromDate:session.endDate] : nil);
+
+    switch (self.format) {
+        case BLMExportFormatCSV: {
+            self.sessionFields = [NSString stringWithFormat:@"%@,%@,%@,%@,%@,%@,%@,%@,%@,%ld", self.projectFields, CSVField(session.name), session.UUID.UUIDString, (startDate ?: @""), (endDate ?: @""), CSVField(configuration.condition), CSVField(configuration.location), CSVField(configuration.therapist), CSVField(configuration.observer), (long)configuration.timeLimit];
+
+            for (NSUUID *behaviorUUID in configuration.behaviorUUIDs) {
+                BLMBehavior *behavior = [snapshot behaviorForUUID:behaviorUUID];
+                NSString *prefix = [NSString stringWithFormat:@"%@,%@,%@,%@,", self.sessionFields, CSVField(behavior.name), behaviorUUID.UUIDString, (behavior.isContinuous ? @"YES" : @"NO")];
+
+                [eventPrefixes addObject:[prefix dataUsingEncoding:NSUTF8StringEncoding]];
+            }
+
+            self.unknownBehaviorEventPrefix = [[NSString stringWithFormat:@"%@,,,,", self.sessionFields] dataUsingEncoding:NSUTF8StringEncoding];
+            break;
+        }
+
+        case BLMExportFormatJSON: {
+            [self appendString:[NSString stringWithFormat:@"%@{\"UUID\":\"%@\",\"name\":%@,\"startDate\":%@,\"endDate\":%@,\"configuration\":{\"UUID\":\"%@\",\"condition\":%@,\"location\":%@,\"therapist\":%@,\"observer\":%@,\"timeLimit\":%ld},\"events\":[",
+                                ((self.sessionCount > 0) ? @"," : @""), session.UUID.UUIDString, JSONValue(session.name), JSONValue(startDate), JSONValue(endDate),
+                                configuration.UUID.UUIDString, JSONValue(configuration.condition), JSONValue(configuration.location), JSONValue(configuration.therapist), JSONValue(configuration.observer), (long)configuration.timeLimit]];
+
+            for (NSUUID *behaviorUUID in configuration.behaviorUUIDs) {
+                NSString *prefix = [NSString stringWithFormat:@"{\"behaviorUUID\":\"%@\",\"behavior\":%@,\"type\":\"", behaviorUUID.UUIDString, JSONValue([snapshot behaviorForUUID:behaviorUUID].name)];
+                [eventPrefixes addObject:[prefix dataUsingEncoding:NSUTF8StringEncoding]];
+            }
+
+            self.unknownBehaviorEventPrefix = [@"{\"behaviorUUID\":null,\"behavior\":null,\"type\":\"" dataUsingEncoding:NSUTF8StringEncoding];
+            break;
+        }
+    }
+
+    self.eventPrefixes = eventPrefixes;
+    self.sessionCount += 1;
+    self.eventCount = 0;
+}
+
+
+- (void)writeEvent:(BLMSessionEvent)event {
+    assert(self.eventPrefixes != nil);
+    assert(event.Type < BLMSessionEventTypeCount);
+
+    NSData *prefix = ((event.BehaviorIndex < self.eventPrefixes.count) ? self.eventPrefixes[event.BehaviorIndex] : self.unknownBehaviorEventPrefix);
+    char suffix[64];
+    int suffixLength = 0;
+
+    switch (self.format) {
+        case BLMExportFormatCSV: {
+            char timeOffset[32];
+            FormatTimeOffset(timeOffset, sizeof(timeOffset), event.TimeOffset);
+            suffixLength = snprintf(suffix, sizeof(suffix), "%s,%s\n", EventTypeNames[event.Type], timeOffset);
+            break;
+        }
+
+        case BLMExportFormatJSON: {
+            char timeOffset[32];
+            FormatTimeOffset(timeOffset, sizeof(timeOffset), event.TimeOffset);
+            suffixLength = snprintf(suffix, sizeof(suffix), "%s\",\"timeOffset\":%s}", EventTypeNames[event.Type], timeOffset);
+
+            if (self.eventCount > 0) {
+                [self appendBytes:"," length:1];
+            }
+            break;
+        }
+    }
+
+    assert((suffixLength > 0) && ((size_t)suffixLength < sizeof(suffix)));
+
+    [self appendBytes:prefix.bytes length:prefix.length];
+    [self appendBytes:suffix length:(NSUInteger)suffixLength];
+
+    self.eventCount += 1;
+}
+
+
+- (void)endSession {
+    assert(self.eventPrefixes != nil);
+
+    switch (self.format) {
+        case BLMExportFormatCSV: {
+            if (self.eventCount == 0) {
+                [self appendString:[NSString stringWithFormat:@"%@,,,,,\n", self.sessionFields]];
+            }
+
+            self.sessionFields = nil;
+            break;
+        }
+
+        case BLMExportFormatJSON: {
+            [self appendString:@"]}"];
+            break;
+        }
+    }
+
+    self.eventPrefixes = nil;
+    self.unknownBehaviorEventPrefix = nil;
+}
+
+
+- (void)endProject {
+    assert(self.projectFields != nil);
+    assert(self.eventPrefixes == nil);
+
+    if (self.format == BLMExportFormatJSON) {
+        [self appendString:@"]}"];
+    }
+
+    self.projectFields = nil;
+}
+
+
+- (BOOL)finishWithError:(NSError **)error {
+    assert(self.projectFields == nil);
+
+    [self startDocumentIfNeeded];
+
+    if (self.format == BLMExportFormatJSON) {
+        [self appendString:@"]}\n"];
+    }
+
+    [self flushBuffer];
+
+    if (self.writeError != nil) {
+        if (error != NULL) {
+            *error = self.writeError;
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+@end
+
+
+NS_ASSUME_NONNULL_END
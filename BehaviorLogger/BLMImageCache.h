@@ -0,0 +1,50 @@
+//
+//  BLMImageCache.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/29/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+extern NSUInteger const BLMImageCacheDefaultByteLimit;
+
+
+typedef void (^BLMImageCacheDrawingHandler)(CGSize size); // Draws into the current image context, which is size points at the cache's scale
+
+
+#pragma mark
+
+/*
+ ` Rasterizes each (shape, color, size, scale) once and hands out the same image until it is evicted.
+ ` Images with nonzero cap insets are returned resizable, so a border only needs to be drawn at its
+ ` smallest size and can then be stretched over any view. Eviction is by decoded byte cost, capped at
+ ` byteLimit.
+ `
+ ` Images may be requested from any thread once the shared cache has been created on the main thread.
+ ` Only main thread requests count toward the hit and miss counts.
+ */
+
+@interface BLMImageCache : NSObject
+
+@property (nonatomic, assign, readonly) CGFloat scale; // The main screen's, read when the shared cache is created
+@property (nonatomic, assign) NSUInteger byteLimit;
+
+@property (nonatomic, assign, readonly) NSUInteger hitCount;
+@property (nonatomic, assign, readonly) NSUInteger missCount; // Images rasterized on the main thread because they weren't prewarmed or had been evicted
+
++ (instancetype)sharedCache;
+
+- (UIImage *)imageForShape:(NSString *)shape color:(UIColor *)color size:(CGSize)size opaque:(BOOL)opaque capInsets:(UIEdgeInsets)capInsets drawingHandler:(BLMImageCacheDrawingHandler)drawingHandler;
+
+- (void)prewarmWithBlock:(dispatch_block_t)block; // Runs block on a background queue; images it requests are rasterized there and cached for the main thread
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,185 @@
+//
+//  BLMImageCache.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/29/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMImageCache.h"
+#import "BLMUtils.h"
+
+
+#pragma mark Constants
+
+NSUInteger const BLMImageCacheDefaultByteLimit = (4 * 1024 * 1024);
+
+
+#pragma mark
+
+@interface ImageKey : NSObject <NSCopying>
+
+@property (nonatomic, copy, readonly) NSString *shape;
+@property (nonatomic, strong, readonly) UIColor *color;
+@property (nonatomic, assign, readonly) CGSize size;
+@property (nonatomic, assign, readonly) CGFloat scale;
+@property (nonatomic, assign, readonly, getter=isOpaque) BOOL opaque;
+@property (nonatomic, assign, readonly) UIEdgeInsets capInsets;
+
+@end
+
+
+@implementation ImageKey
+
+- (instancetype)initWithShape:(NSString *)shape color:(UIColor *)color size:(CGSize)size scale:(CGFloat)scale opaque:(BOOL)opaque capInsets:(UIEdgeInsets)capInsets {
+    assert(shape.length > 0);
+    assert(color != nil);
+    assert((size.width > 0.0) && (size.height > 0.0));
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _shape = [shape copy];
+    _color = color;
+    _size = size;
+    _scale = scale;
+    _opaque = opaque;
+    _capInsets = capInsets;
+
+    return self;
+}
+
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // Immutable
+}
+
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[self class]]) {
+        return NO;
+    }
+
+    ImageKey *other = object;
+
+    return (CGSizeEqualToSize(self.size, other.size)
+            && (self.scale == other.scale)
+            && (self.isOpaque == other.isOpaque)
+            && UIEdgeInsetsEqualToEdgeInsets(self.capInsets, other.capInsets)
+            && [BLMUtils isString:self.shape equalToString:other.shape]
+            && [BLMUtils isObject:self.color equalToObject:other.color]);
+}
+
+
+- (NSUInteger)hash {
+    return (self.shape.hash ^ self.color.hash ^ @(self.size.width).hash ^ (@(self.size.height).hash << 1) ^ (self.isOpaque ? 1 : 0) ^ ([NSValue valueWithUIEdgeInsets:self.capInsets].hash << 2));
+}
+
+
+- (NSUInteger)byteCost {
+    return (NSUInteger)(ceil(self.size.width * self.scale) * ceil(self.size.height * self.scale) * 4);
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMImageCache ()
+
+@property (nonatomic, strong, readonly) NSCache<ImageKey *, UIImage *> *imageByKey; // Written from both the main thread and queue
+@property (nonatomic, strong, readonly) NSOperationQueue *queue;
+
+@end
+
+
+@implementation BLMImageCache
+
++ (instancetype)sharedCache {
+    static BLMImageCache *sharedCache = nil;
+    static dispatch_once_t onceToken = 0;
+
+    dispatch_once(&onceToken, ^{
+        assert([NSThread isMainThread]);
+        sharedCache = [[BLMImageCache alloc] init];
+    });
+
+    return sharedCache;
+}
+
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _scale = [UIScreen mainScreen].scale;
+    _imageByKey = [[NSCache alloc] init];
+    _queue = [[NSOperationQueue alloc] init];
+
+    self.imageByKey.totalCostLimit = BLMImageCacheDefaultByteLimit;
+
+    self.queue.name = @"com.3bird.BehaviorLogger.ImageCache";
+    self.queue.maxConcurrentOperationCount = 1;
+    self.queue.qualityOfService = NSQualityOfServiceUtility;
+
+    return self;
+}
+
+
+- (NSUInteger)byteLimit {
+    return self.imageByKey.totalCostLimit;
+}
+
+
+- (void)setByteLimit:(NSUInteger)byteLimit {
+    self.imageByKey.totalCostLimit = byteLimit;
+}
+
+
+- (UIImage *)imageForShape:(NSString *)shape color:(UIColor *)color size:(CGSize)size opaque:(BOOL)opaque capInsets:(UIEdgeInsets)capInsets drawingHandler:(BLMImageCacheDrawingHandler)drawingHandler {
+    ImageKey *key = [[ImageKey alloc] initWithShape:shape color:color size:size scale:self.scale opaque:opaque capInsets:capInsets];
+    UIImage *image = [self.imageByKey objectForKey:key];
+    BOOL isMainThread = [NSThread isMainThread];
+
+    if (image != nil) {
+        if (isMainThread) {
+            _hitCount += 1;
+        }
+
+        return image;
+    }
+
+    if (isMainThread) {
+        _missCount += 1;
+    }
+
+    UIGraphicsBeginImageContextWithOptions(size, opaque, self.scale);
+
+    drawingHandler(size);
+
+    image = UIGraphicsGetImageFromCurrentImageContext();
+
+    UIGraphicsEndImageContext();
+
+    if (!UIEdgeInsetsEqualToEdgeInsets(capInsets, UIEdgeInsetsZero)) {
+        image = [image resizableImageWithCapInsets:capInsets resizingMode:UIImageResizingModeStretch];
+    }
+
+    [self.imageByKey setObject:image forKey:key cost:key.byteCost];
+
+    return image;
+}
+
+
+- (void)prewarmWithBlock:(dispatch_block_t)block {
+    assert([NSThread isMainThread]);
+    [self.queue addOperationWithBlock:block];
+}
+
+@end
@@ -0,0 +1,85 @@
+//
+//  BLMImportBatch.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/16/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMEventStore.h"
+#import "BLMSessionConfiguration.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@interface BLMImportedBehavior : NSObject
+
+@property (nonatomic, copy, readonly) NSString *name;
+@property (nonatomic, assign, readonly, getter=isContinuous) BOOL continuous;
+
+- (instancetype)initWithName:(NSString *)name continuous:(BOOL)continuous;
+
+@end
+
+
+#pragma mark
+
+@interface BLMImportedSession : NSObject
+
+@property (nonatomic, copy, readonly) NSString *name;
+@property (nullable, nonatomic, strong, readonly) NSDate *startDate;
+@property (nullable, nonatomic, strong, readonly) NSDate *endDate;
+@property (nullable, nonatomic, copy, readonly) NSString *condition;
+@property (nullable, nonatomic, copy, readonly) NSString *location;
+@property (nullable, nonatomic, copy, readonly) NSString *therapist;
+@property (nullable, nonatomic, copy, readonly) NSString *observer;
+@property (nonatomic, assign, readonly) BLMTimeInterval timeLimit;
+@property (nonatomic, copy, readonly) NSData *events; // BLMSessionEvent values in time order, indexing the project's behaviors
+
+- (instancetype)initWithName:(NSString *)name startDate:(nullable NSDate *)startDate endDate:(nullable NSDate *)endDate condition:(nullable NSString *)condition location:(nullable NSString *)location therapist:(nullable NSString *)therapist observer:(nullable NSString *)observer timeLimit:(BLMTimeInterval)timeLimit events:(nullable NSData *)events;
+
+@end
+
+
+#pragma mark
+
+@interface BLMImportedProject : NSObject
+
+@property (nonatomic, copy, readonly) NSString *name;
+@property (nonatomic, copy, readonly) NSString *client;
+@property (nonatomic, copy, readonly) NSArray<BLMImportedBehavior *> *behaviors;
+@property (nonatomic, copy, readonly) NSArray<BLMImportedSession *> *sessions;
+
+- (instancetype)initWithName:(NSString *)name client:(NSString *)client behaviors:(NSArray<BLMImportedBehavior *> *)behaviors sessions:(NSArray<BLMImportedSession *> *)sessions;
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Projects, behaviors, sessions and events waiting to be created together by the data manager. A
+ ` batch is plain data with no connection to the data model, so it can be built on any thread.
+ `
+ ` CSV is read in the layout BLMExportWriter writes: one row per event, identified by column name in
+ ` the header row. Project, Client and Session are required; every other column is optional. Rows are
+ ` grouped into sessions by Session UUID when present, and otherwise by session name and start date.
+ ` Behavior names within a project are matched ignoring case and surrounding whitespace, keeping the
+ ` first spelling seen.
+ */
+
+@interface BLMImportBatch : NSObject
+
+@property (nonatomic, copy, readonly) NSArray<BLMImportedProject *> *projects;
+
++ (nullable instancetype)batchWithCSVData:(NSData *)data error:(NSError **)error; // Fails with NSFileReadCorruptFileError, naming the offending line
+
+- (instancetype)initWithProjects:(NSArray<BLMImportedProject *> *)projects;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
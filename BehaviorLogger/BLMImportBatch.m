@@ -0,0 +1,480 @@
+//
+//  BLMImportBatch.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/16/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMImportBatch.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+#pragma mark Constants
+
+typedef NS_ENUM(NSInteger, Column) {
+    ColumnProject,
+    ColumnClient,
+    ColumnSession,
+    ColumnSessionUUID,
+    ColumnStartDate,
+    ColumnEndDate,
+    ColumnCondition,
+    ColumnLocation,
+    ColumnTherapist,
+    ColumnObserver,
+    ColumnTimeLimit,
+    ColumnBehavior,
+    ColumnContinuous,
+    ColumnEvent,
+    ColumnTimeOffset,
+    ColumnCount
+};
+
+
+static NSString *const ColumnNames[ColumnCount] = { // Matches the header BLMExportWriter writes
+    [ColumnProject] = @"Project",
+    [ColumnClient] = @"Client",
+    [ColumnSession] = @"Session",
+    [ColumnSessionUUID] = @"Session UUID",
+    [ColumnStartDate] = @"Start Date",
+    [ColumnEndDate] = @"End Date",
+    [ColumnCondition] = @"Condition",
+    [ColumnLocation] = @"Location",
+    [ColumnTherapist] = @"Therapist",
+    [ColumnObserver] = @"Observer",
+    [ColumnTimeLimit] = @"Time Limit",
+    [ColumnBehavior] = @"Behavior",
+    [ColumnContinuous] = @"Continuous",
+    [ColumnEvent] = @"Event",
+    [ColumnTimeOffset] = @"Time Offset"
+};
+
+
+static NSError *CorruptFileError(NSUInteger lineNumber, NSString *reason) {
+    NSString *failureReason = [NSString stringWithFormat:@"Line %lu: %@", (unsigned long)lineNumber, reason];
+    return [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:@{ NSLocalizedFailureReasonErrorKey:failureReason }];
+}
+
+
+static int CompareEventTimeOffsets(void const *event, void const *otherEvent) {
+    uint64_t timeOffset = ((BLMSessionEvent const *)event)->TimeOffset;
+    uint64_t otherTimeOffset = ((BLMSessionEvent const *)otherEvent)->TimeOffset;
+
+    return ((timeOffset < otherTimeOffset) ? -1 : ((timeOffset > otherTimeOffset) ? 1 : 0));
+}
+
+
+static BOOL EnumerateCSVRows(NSString *text, BOOL (^rowHandler)(NSArray<NSString *> *fields, NSUInteger lineNumber)) { // NO if a quoted field is never closed, or the handler stops the enumeration
+    NSUInteger length = text.length;
+    unichar *characters = malloc(MAX(length, 1) * sizeof(unichar));
+    unichar *fieldCharacters = malloc(MAX(length, 1) * sizeof(unichar)); // No field can be longer than the text
+    NSUInteger fieldLength = 0;
+    NSMutableArray<NSString *> *fields = [NSMutableArray array];
+    NSUInteger lineNumber = 1;
+    NSUInteger rowLineNumber = 1;
+    BOOL quoted = NO;
+    BOOL completed = YES;
+
+    assert((characters != NULL) && (fieldCharacters != NULL));
+
+    [text getCharacters:characters range:NSMakeRange(0, length)];
+
+    for (NSUInteger index = 0; (index <= length) && completed; index += 1) {
+        unichar character = ((index < length) ? characters[index] : '\n'); // The last row may not end with a newline
+
+        if (quoted) {
+            if (index == length) {
+                completed = NO;
+            } else if (character != '"') {
+                lineNumber += (character == '\n');
+                fieldCharacters[fieldLength++] = character;
+            } else if (((index + 1) < length) && (characters[index + 1] == '"')) { // An escaped quote
+                fieldCharacters[fieldLength++] = '"';
+                index += 1;
+            } else {
+                quoted = NO;
+            }
+            continue;
+        }
+
+        switch (character) {
+            case '"': {
+                if (fieldLength == 0) {
+                    quoted = YES;
+                } else {
+                    fieldCharacters[fieldLength++] = character;
+                }
+                break;
+            }
+
+            case ',': {
+                [fields addObject:[[NSString alloc] initWithCharacters:fieldCharacters length:fieldLength]];
+                fieldLength = 0;
+                break;
+            }
+
+            case '\r':
+                if (((index + 1) < length) && (characters[index + 1] == '\n')) { // Handled with the newline
+                    break;
+                }
+
+            case '\n': {
+                [fields addObject:[[NSString alloc] initWithCharacters:fieldCharacters length:fieldLength]];
+                fieldLength = 0;
+
+                if ((fields.count > 1) || (fields[0].length > 0)) { // Blank lines are skipped
+                    completed = rowHandler(fields, rowLineNumber);
+                }
+
+                [fields removeAllObjects];
+                lineNumber += 1;
+                rowLineNumber = lineNumber;
+                break;
+            }
+
+            default: {
+                fieldCharacters[fieldLength++] = character;
+                break;
+            }
+        }
+    }
+
+    free(characters);
+    free(fieldCharacters);
+
+    return completed;
+}
+
+
+#pragma mark
+
+@interface ImportedSessionBuilder : NSObject
+
+@property (nonatomic, copy) NSString *name;
+@property (nullable, nonatomic, strong) NSDate *startDate;
+@property (nullable, nonatomic, strong) NSDate *endDate;
+@property (nullable, nonatomic, copy) NSString *condition;
+@property (nullable, nonatomic, copy) NSString *location;
+@property (nullable, nonatomic, copy) NSString *therapist;
+@property (nullable, nonatomic, copy) NSString *observer;
+@property (nonatomic, assign) BLMTimeInterval timeLimit;
+@property (nonatomic, strong) NSMutableData *events;
+
+@end
+
+
+@implementation ImportedSessionBuilder
+
+@end
+
+
+#pragma mark
+
+@interface ImportedProjectBuilder : NSObject
+
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, copy) NSString *client;
+@property (nonatomic, strong) NSMutableArray<NSString *> *behaviorNames;
+@property (nonatomic, strong) NSMutableIndexSet *continuousBehaviorIndexes;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *behaviorIndexByKey; // Lowercased and trimmed name -> index
+@property (nonatomic, strong) NSMutableArray<ImportedSessionBuilder *> *sessions;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, ImportedSessionBuilder *> *sessionByKey;
+
+@end
+
+
+@implementation ImportedProjectBuilder
+
+@end
+
+
+#pragma mark
+
+@implementation BLMImportedBehavior
+
+- (instancetype)initWithName:(NSString *)name continuous:(BOOL)continuous {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _name = [name copy];
+    _continuous = continuous;
+
+    return self;
+}
+
+@end
+
+
+#pragma mark
+
+@implementation BLMImportedSession
+
+- (instancetype)initWithName:(NSString *)name startDate:(nullable NSDate *)startDate endDate:(nullable NSDate *)endDate condition:(nullable NSString *)condition location:(nullable NSString *)location therapist:(nullable NSString *)therapist observer:(nullable NSString *)observer timeLimit:(BLMTimeInterval)timeLimit events:(nullable NSData *)events {
+    assert((events.length % sizeof(BLMSessionEvent)) == 0);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _name = [name copy];
+    _startDate = startDate;
+    _endDate = endDate;
+    _condition = [condition copy];
+    _location = [location copy];
+    _therapist = [therapist copy];
+    _observer = [observer copy];
+    _timeLimit = timeLimit;
+    _events = ([events copy] ?: [NSData data]);
+
+    return self;
+}
+
+@end
+
+
+#pragma mark
+
+@implementation BLMImportedProject
+
+- (instancetype)initWithName:(NSString *)name client:(NSString *)client behaviors:(NSArray<BLMImportedBehavior *> *)behaviors sessions:(NSArray<BLMImportedSession *> *)sessions {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _name = [name copy];
+    _client = [client copy];
+    _behaviors = [behaviors copy];
+    _sessions = [sessions copy];
+
+    return self;
+}
+
+@end
+
+
+#pragma mark
+
+@implementation BLMImportBatch
+
++ (nullable instancetype)batchWithCSVData:(NSData *)data error:(NSError **)error {
+    NSString *text = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+
+    if (text == nil) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadInapplicableStringEncodingError userInfo:nil];
+        }
+        return nil;
+    }
+
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+
+    NSDate *__nullable (^dateFromString)(NSString *) = ^NSDate *__nullable (NSString *string) {
+        for (NSString *dateFormat in @[@"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'", @"yyyy-MM-dd'T'HH:mm:ss'Z'", @"yyyy-MM-dd'T'HH:mm:ssZZZZZ", @"yyyy-MM-dd HH:mm:ss"]) {
+            dateFormatter.dateFormat = dateFormat;
+            NSDate *date = [dateFormatter dateFromString:string];
+
+            if (date != nil) {
+                return date;
+            }
+        }
+
+        return nil;
+    };
+
+    NSCharacterSet *whitespaceCharacterSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSDictionary<NSString *, NSNumber *> *eventTypeByName = @{ @"occurrence":@(BLMSessionEventTypeOccurrence), @"onset":@(BLMSessionEventTypeOnset), @"offset":@(BLMSessionEventTypeOffset) };
+    NSMutableArray<ImportedProjectBuilder *> *projects = [NSMutableArray array];
+    NSMutableDictionary<NSString *, ImportedProjectBuilder *> *projectByName = [NSMutableDictionary dictionary];
+    NSUInteger *columnIndexes = calloc(ColumnCount, sizeof(NSUInteger)); // Index of each column's field in a row, or NSNotFound
+    __block BOOL headerRead = NO;
+    __block NSError *parseError = nil;
+
+    assert(columnIndexes != NULL);
+
+    BOOL completed = EnumerateCSVRows(text, ^BOOL(NSArray<NSString *> *fields, NSUInteger lineNumber) {
+        if (!headerRead) {
+            for (Column column = 0; column < ColumnCount; column += 1) {
+                columnIndexes[column] = [fields indexOfObjectPassingTest:^BOOL(NSString *__nonnull field, NSUInteger index, BOOL *__nonnull stop) {
+                    return ([[field stringByTrimmingCharactersInSet:whitespaceCharacterSet] caseInsensitiveCompare:ColumnNames[column]] == NSOrderedSame);
+                }];
+            }
+
+            for (Column column = ColumnProject; column <= ColumnSession; column += 1) {
+                if (columnIndexes[column] == NSNotFound) {
+                    parseError = CorruptFileError(lineNumber, [NSString stringWithFormat:@"The header has no %@ column.", ColumnNames[column]]);
+                    return NO;
+                }
+            }
+
+            headerRead = YES;
+            return YES;
+        }
+
+        NSString *__nullable (^valueForColumn)(Column) = ^NSString *__nullable (Column column) { // nil for a missing or empty field
+            NSUInteger index = columnIndexes[column];
+            NSString *value = ((index < fields.count) ? [fields[index] stringByTrimmingCharactersInSet:whitespaceCharacterSet] : nil);
+
+            return ((value.length > 0) ? value : nil);
+        };
+
+        NSString *projectName = valueForColumn(ColumnProject);
+        NSString *sessionName = valueForColumn(ColumnSession);
+
+        if ((projectName == nil) || (sessionName == nil)) {
+            parseError = CorruptFileError(lineNumber, @"Every row needs a project and a session.");
+            return NO;
+        }
+
+        ImportedProjectBuilder *project = projectByName[projectName];
+
+        if (project == nil) {
+            project = [[ImportedProjectBuilder alloc] init];
+            project.name = projectName;
+            project.client = (valueForColumn(ColumnClient) ?: @"");
+            project.behaviorNames = [NSMutableArray array];
+            project.continuousBehaviorIndexes = [NSMutableIndexSet indexSet];
+            project.behaviorIndexByKey = [NSMutableDictionary dictionary];
+            project.sessions = [NSMutableArray array];
+            project.sessionByKey = [NSMutableDictionary dictionary];
+
+            projectByName[projectName] = project;
+            [projects addObject:project];
+        }
+
+        NSString *startDateString = valueForColumn(ColumnStartDate);
+        NSString *sessionKey = (valueForColumn(ColumnSessionUUID) ?: [NSString stringWithFormat:@"%@\n%@", sessionName, (startDateString ?: @"")]);
+        ImportedSessionBuilder *session = project.sessionByKey[sessionKey];
+
+        if (session == nil) { // The first row of a session supplies its details
+            NSString *endDateString = valueForColumn(ColumnEndDate);
+            NSString *timeLimitString = valueForColumn(ColumnTimeLimit);
+
+            session = [[ImportedSessionBuilder alloc] init];
+            session.name = sessionName;
+            session.startDate = ((startDateString != nil) ? dateFromString(startDateString) : nil);
+            session.endDate = ((endDateString != nil) ? dateFromString(endDateString) : nil);
+            session.condition = valueForColumn(ColumnCondition);
+            session.location = valueForColumn(ColumnLocation);
+            session.therapist = valueForColumn(ColumnTherapist);
+            session.observer = valueForColumn(ColumnObserver);
+            session.timeLimit = timeLimitString.integerValue;
+            session.events = [NSMutableData data];
+
+            if (((startDateString != nil) && (session.startDate == nil)) || ((endDateString != nil) && (session.endDate == nil))) {
+                parseError = CorruptFileError(lineNumber, @"A session date is not in a recognized format.");
+                return NO;
+            }
+
+            project.sessionByKey[sessionKey] = session;
+            [project.sessions addObject:session];
+        }
+
+        NSString *behaviorName = valueForColumn(ColumnBehavior);
+        NSString *eventName = valueForColumn(ColumnEvent);
+
+        if (behaviorName == nil) {
+            if (eventName != nil) {
+                parseError = CorruptFileError(lineNumber, @"An event has no behavior.");
+                return NO;
+            }
+            return YES;
+        }
+
+        NSString *behaviorKey = behaviorName.lowercaseString;
+        NSNumber *behaviorIndex = project.behaviorIndexByKey[behaviorKey];
+
+        if (behaviorIndex == nil) {
+            behaviorIndex = @(project.behaviorNames.count);
+            project.behaviorIndexByKey[behaviorKey] = behaviorIndex;
+            [project.behaviorNames addObject:behaviorName];
+        }
+
+        NSString *continuous = valueForColumn(ColumnContinuous).lowercaseString;
+
+        if ([continuous isEqualToString:@"yes"] || [continuous isEqualToString:@"true"] || [continuous isEqualToString:@"1"]) {
+            [project.continuousBehaviorIndexes addIndex:behaviorIndex.unsignedIntegerValue];
+        }
+
+        if (eventName == nil) {
+            return YES;
+        }
+
+        NSNumber *eventType = eventTypeByName[eventName.lowercaseString];
+        double timeOffset = 0.0;
+        NSScanner *scanner = [NSScanner scannerWithString:(valueForColumn(ColumnTimeOffset) ?: @"")];
+
+        if ((eventType == nil) || ![scanner scanDouble:&timeOffset] || !scanner.isAtEnd || !(timeOffset >= 0.0)) {
+            parseError = CorruptFileError(lineNumber, @"An event needs a type of occurrence, onset or offset, and a time offset in seconds.");
+            return NO;
+        }
+
+        if (eventType.unsignedIntValue != BLMSessionEventTypeOccurrence) {
+            [project.continuousBehaviorIndexes addIndex:behaviorIndex.unsignedIntegerValue];
+        }
+
+        BLMSessionEvent event = { .TimeOffset = (uint64_t)llround(timeOffset * NSEC_PER_SEC), .BehaviorIndex = behaviorIndex.unsignedIntValue, .Type = eventType.unsignedIntValue };
+        [session.events appendBytes:&event length:sizeof(BLMSessionEvent)];
+
+        return YES;
+    });
+
+    free(columnIndexes);
+
+    if (!completed || !headerRead) {
+        if (error != NULL) {
+            *error = (parseError ?: CorruptFileError(1, (headerRead ? @"A quoted field is never closed." : @"There is no header row.")));
+        }
+        return nil;
+    }
+
+    NSMutableArray<BLMImportedProject *> *importedProjects = [NSMutableArray arrayWithCapacity:projects.count];
+
+    for (ImportedProjectBuilder *project in projects) {
+        NSMutableArray<BLMImportedBehavior *> *behaviors = [NSMutableArray arrayWithCapacity:project.behaviorNames.count];
+        NSMutableArray<BLMImportedSession *> *sessions = [NSMutableArray arrayWithCapacity:project.sessions.count];
+
+        [project.behaviorNames enumerateObjectsUsingBlock:^(NSString *__nonnull name, NSUInteger index, BOOL *__nonnull stop) {
+            [behaviors addObject:[[BLMImportedBehavior alloc] initWithName:name continuous:[project.continuousBehaviorIndexes containsIndex:index]]];
+        }];
+
+        for (ImportedSessionBuilder *session in project.sessions) {
+            mergesort(session.events.mutableBytes, (session.events.length / sizeof(BLMSessionEvent)), sizeof(BLMSessionEvent), CompareEventTimeOffsets); // Stable, so an offset and onset at the same instant keep their order
+
+            [sessions addObject:[[BLMImportedSession alloc] initWithName:session.name startDate:session.startDate endDate:session.endDate condition:session.condition location:session.location therapist:session.therapist observer:session.observer timeLimit:session.timeLimit events:session.events]];
+        }
+
+        [importedProjects addObject:[[BLMImportedProject alloc] initWithName:project.name client:project.client behaviors:behaviors sessions:sessions]];
+    }
+
+    return [[BLMImportBatch alloc] initWithProjects:importedProjects];
+}
+
+
+- (instancetype)initWithProjects:(NSArray<BLMImportedProject *> *)projects {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _projects = [projects copy];
+
+    return self;
+}
+
+@end
+
+
+NS_ASSUME_NONNULL_END
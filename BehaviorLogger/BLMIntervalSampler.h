@@ -0,0 +1,73 @@
+//
+//  BLMIntervalSampler.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/12/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMEventStore.h"
+#import "BLMSessionConfiguration.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+typedef NS_ENUM(NSInteger, BLMSamplingMethod) {
+    BLMSamplingMethodPartialInterval, // Scored if the behavior occurred at any point in the interval
+    BLMSamplingMethodWholeInterval, // Scored if the behavior occurred throughout the interval
+    BLMSamplingMethodMomentaryTimeSample, // Scored if the behavior was occurring at the end of the interval
+    BLMSamplingMethodCount
+};
+
+
+#pragma mark
+
+@interface BLMIntervalSampling : NSObject
+
+@property (nonatomic, assign, readonly) uint64_t binWidth; // Nanoseconds
+@property (nonatomic, assign, readonly) NSUInteger binCount; // The final bin may be shorter than binWidth
+@property (nonatomic, assign, readonly) NSUInteger behaviorCount;
+
+- (BOOL)isBinScored:(NSUInteger)binIndex forBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method;
+- (NSUInteger)scoredBinCountForBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method;
+- (double)scoredBinFractionForBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method; // 0 if there are no bins
+- (NSUInteger)responseCountInBin:(NSUInteger)binIndex forBehaviorIndex:(NSUInteger)behaviorIndex; // Occurrences and onsets
+
+- (uint8_t const *)scoredBinsForBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method NS_RETURNS_INNER_POINTER; // binCount entries of 0 or 1
+- (uint32_t const *)responseCountsForBehaviorIndex:(NSUInteger)behaviorIndex NS_RETURNS_INNER_POINTER; // binCount entries
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Scores a session with every sampling method at once. Applying events only sorts them into
+ ` per-behavior arrays of onsets, offsets and response times; each call to samplingWithBinWidth: then
+ ` walks those arrays alongside the bin boundaries in a single merge, so sweeping many bin widths costs
+ ` O(events + bins) per width and never rescans the event store.
+ `
+ ` Only continuous behaviors, whose episodes have a length, can be scored for whole intervals or
+ ` momentary time samples. An episode still open when the session ends is closed there, and nothing
+ ` past the configuration's time limit is scored.
+ */
+
+@interface BLMIntervalSampler : NSObject
+
+@property (nonatomic, copy, readonly) NSOrderedSet<NSUUID *> *behaviorUUIDs;
+@property (nonatomic, assign, readonly) uint64_t sessionLength; // Nanoseconds, already cut off at the time limit
+
+- (instancetype)initWithSessionConfiguration:(BLMSessionConfiguration *)sessionConfiguration sessionLength:(uint64_t)sessionLength;
+
+- (void)applyEvent:(BLMSessionEvent)event; // Events must be applied in time order
+- (void)applyEventsFromStore:(BLMEventStore *)store; // Applies every stored event to a sampler that has none yet; must be sent from the store's queue
+
+- (BLMIntervalSampling *)samplingWithBinWidth:(uint64_t)binWidth;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
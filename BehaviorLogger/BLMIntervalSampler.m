@@ -0,0 +1,279 @@
+//
+//  BLMIntervalSampler.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/12/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMIntervalSampler.h"
+
+
+#pragma mark Constants
+
+typedef struct BinScoringBuffers {
+    uint8_t *ScoredBinsByMethod[BLMSamplingMethodCount];
+    uint32_t *ResponseCounts;
+    NSUInteger *ScoredBinCountsByMethod; // BLMSamplingMethodCount entries
+} BinScoringBuffers;
+
+
+static inline uint64_t OffsetAtIndex(uint64_t const *offsets, NSUInteger offsetCount, NSUInteger index) { // An episode without an offset is still open, so it never ends before any bin boundary
+    return ((index < offsetCount) ? offsets[index] : UINT64_MAX);
+}
+
+
+static void ScoreBins(uint64_t const *onsets, NSUInteger onsetCount, uint64_t const *offsets, NSUInteger offsetCount, uint64_t const *responseTimes, NSUInteger responseCount, uint64_t binWidth, NSUInteger binCount, uint64_t sessionLength, BinScoringBuffers buffers) {
+    NSUInteger episodeIndex = 0;
+    NSUInteger responseIndex = 0;
+    uint64_t completedOccupancy = 0; // Total length of the episodes that ended at or before the current boundary
+    uint64_t previousOccupancy = 0; // Time occupied before the previous boundary
+    uint64_t binStart = 0;
+
+    for (NSUInteger binIndex = 0; binIndex < binCount; binIndex += 1) {
+        uint64_t binEnd = MIN((binStart + binWidth), sessionLength);
+
+        while ((episodeIndex < onsetCount) && (OffsetAtIndex(offsets, offsetCount, episodeIndex) <= binEnd)) {
+            completedOccupancy += (OffsetAtIndex(offsets, offsetCount, episodeIndex) - onsets[episodeIndex]);
+            episodeIndex += 1;
+        }
+
+        BOOL activeAtBinEnd = ((episodeIndex < onsetCount) && (onsets[episodeIndex] < binEnd));
+        uint64_t occupancy = (completedOccupancy + (activeAtBinEnd ? (binEnd - onsets[episodeIndex]) : 0));
+        uint64_t binOccupancy = (occupancy - previousOccupancy);
+        uint32_t binResponseCount = 0;
+
+        while ((responseIndex < responseCount) && (responseTimes[responseIndex] < binEnd)) {
+            binResponseCount += 1;
+            responseIndex += 1;
+        }
+
+        uint8_t scoresByMethod[BLMSamplingMethodCount] = {
+            [BLMSamplingMethodPartialInterval] = ((binOccupancy > 0) || (binResponseCount > 0)),
+            [BLMSamplingMethodWholeInterval] = ((binEnd > binStart) && (binOccupancy == (binEnd - binStart))),
+            [BLMSamplingMethodMomentaryTimeSample] = activeAtBinEnd
+        };
+
+        for (BLMSamplingMethod method = 0; method < BLMSamplingMethodCount; method += 1) {
+            buffers.ScoredBinsByMethod[method][binIndex] = scoresByMethod[method];
+            buffers.ScoredBinCountsByMethod[method] += scoresByMethod[method];
+        }
+
+        buffers.ResponseCounts[binIndex] = binResponseCount;
+
+        previousOccupancy = occupancy;
+        binStart = binEnd;
+    }
+}
+
+
+#pragma mark
+
+@interface BLMIntervalSampling ()
+
+@property (nonatomic, strong, readonly) NSMutableData *scoredBins; // uint8_t per bin, grouped by method within each behavior
+@property (nonatomic, strong, readonly) NSMutableData *scoredBinCounts; // NSUInteger per method, grouped by behavior
+@property (nonatomic, strong, readonly) NSMutableData *responseCounts; // uint32_t per bin, grouped by behavior
+
+- (instancetype)initWithBinWidth:(uint64_t)binWidth binCount:(NSUInteger)binCount behaviorCount:(NSUInteger)behaviorCount;
+- (BinScoringBuffers)scoringBuffersForBehaviorIndex:(NSUInteger)behaviorIndex;
+
+@end
+
+
+@implementation BLMIntervalSampling
+
+- (instancetype)initWithBinWidth:(uint64_t)binWidth binCount:(NSUInteger)binCount behaviorCount:(NSUInteger)behaviorCount {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _binWidth = binWidth;
+    _binCount = binCount;
+    _behaviorCount = behaviorCount;
+    _scoredBins = [NSMutableData dataWithLength:(behaviorCount * BLMSamplingMethodCount * binCount * sizeof(uint8_t))];
+    _scoredBinCounts = [NSMutableData dataWithLength:(behaviorCount * BLMSamplingMethodCount * sizeof(NSUInteger))];
+    _responseCounts = [NSMutableData dataWithLength:(behaviorCount * binCount * sizeof(uint32_t))];
+
+    return self;
+}
+
+
+- (BinScoringBuffers)scoringBuffersForBehaviorIndex:(NSUInteger)behaviorIndex {
+    assert(behaviorIndex < self.behaviorCount);
+
+    BinScoringBuffers buffers;
+
+    for (BLMSamplingMethod method = 0; method < BLMSamplingMethodCount; method += 1) {
+        buffers.ScoredBinsByMethod[method] = ((uint8_t *)self.scoredBins.mutableBytes + (((behaviorIndex * BLMSamplingMethodCount) + method) * self.binCount));
+    }
+
+    buffers.ResponseCounts = ((uint32_t *)self.responseCounts.mutableBytes + (behaviorIndex * self.binCount));
+    buffers.ScoredBinCountsByMethod = ((NSUInteger *)self.scoredBinCounts.mutableBytes + (behaviorIndex * BLMSamplingMethodCount));
+
+    return buffers;
+}
+
+
+- (BOOL)isBinScored:(NSUInteger)binIndex forBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method {
+    assert(binIndex < self.binCount);
+    assert((method >= 0) && (method < BLMSamplingMethodCount));
+
+    return ([self scoringBuffersForBehaviorIndex:behaviorIndex].ScoredBinsByMethod[method][binIndex] != 0);
+}
+
+
+- (NSUInteger)scoredBinCountForBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method {
+    assert((method >= 0) && (method < BLMSamplingMethodCount));
+    return [self scoringBuffersForBehaviorIndex:behaviorIndex].ScoredBinCountsByMethod[method];
+}
+
+
+- (double)scoredBinFractionForBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method {
+    if (self.binCount == 0) {
+        return 0.0;
+    }
+
+    return ((double)[self scoredBinCountForBehaviorIndex:behaviorIndex method:method] / self.binCount);
+}
+
+
+- (NSUInteger)responseCountInBin:(NSUInteger)binIndex forBehaviorIndex:(NSUInteger)behaviorIndex {
+    assert(binIndex < self.binCount);
+    return [self scoringBuffersForBehaviorIndex:behaviorIndex].ResponseCounts[binIndex];
+}
+
+
+- (uint8_t const *)scoredBinsForBehaviorIndex:(NSUInteger)behaviorIndex method:(BLMSamplingMethod)method {
+    assert((method >= 0) && (method < BLMSamplingMethodCount));
+    return [self scoringBuffersForBehaviorIndex:behaviorIndex].ScoredBinsByMethod[method];
+}
+
+
+- (uint32_t const *)responseCountsForBehaviorIndex:(NSUInteger)behaviorIndex {
+    return [self scoringBuffersForBehaviorIndex:behaviorIndex].ResponseCounts;
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMIntervalSampler ()
+
+@property (nonatomic, copy, readonly) NSArray<NSMutableData *> *onsetsByBehaviorIndex; // uint64_t time offsets
+@property (nonatomic, copy, readonly) NSArray<NSMutableData *> *offsetsByBehaviorIndex;
+@property (nonatomic, copy, readonly) NSArray<NSMutableData *> *responseTimesByBehaviorIndex; // Occurrences and onsets
+@property (nonatomic, assign) uint64_t lastTimeOffset;
+
+@end
+
+
+@implementation BLMIntervalSampler
+
+- (instancetype)initWithSessionConfiguration:(BLMSessionConfiguration *)sessionConfiguration sessionLength:(uint64_t)sessionLength {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    uint64_t timeLimit = ((uint64_t)MAX(sessionConfiguration.timeLimit, 0) * NSEC_PER_SEC);
+    NSMutableArray *onsetsByBehaviorIndex = [NSMutableArray array];
+    NSMutableArray *offsetsByBehaviorIndex = [NSMutableArray array];
+    NSMutableArray *responseTimesByBehaviorIndex = [NSMutableArray array];
+
+    for (NSUInteger behaviorIndex = 0; behaviorIndex < sessionConfiguration.behaviorUUIDs.count; behaviorIndex += 1) {
+        [onsetsByBehaviorIndex addObject:[NSMutableData data]];
+        [offsetsByBehaviorIndex addObject:[NSMutableData data]];
+        [responseTimesByBehaviorIndex addObject:[NSMutableData data]];
+    }
+
+    _behaviorUUIDs = [sessionConfiguration.behaviorUUIDs copy];
+    _sessionLength = ((timeLimit > 0) ? MIN(sessionLength, timeLimit) : sessionLength);
+    _onsetsByBehaviorIndex = onsetsByBehaviorIndex;
+    _offsetsByBehaviorIndex = offsetsByBehaviorIndex;
+    _responseTimesByBehaviorIndex = responseTimesByBehaviorIndex;
+
+    return self;
+}
+
+#pragma mark Accumulation
+
+- (void)applyEvent:(BLMSessionEvent)event {
+    assert(event.TimeOffset >= self.lastTimeOffset);
+
+    self.lastTimeOffset = event.TimeOffset;
+
+    if ((event.BehaviorIndex >= self.behaviorUUIDs.count) || (event.TimeOffset >= self.sessionLength)) { // An episode still open at the end of the session is closed there when scoring
+        return;
+    }
+
+    NSMutableData *onsets = self.onsetsByBehaviorIndex[event.BehaviorIndex];
+    NSMutableData *offsets = self.offsetsByBehaviorIndex[event.BehaviorIndex];
+    NSMutableData *responseTimes = self.responseTimesByBehaviorIndex[event.BehaviorIndex];
+    BOOL active = (onsets.length > offsets.length);
+    uint64_t timeOffset = event.TimeOffset;
+
+    switch (event.Type) {
+        case BLMSessionEventTypeOccurrence: {
+            [responseTimes appendBytes:&timeOffset length:sizeof(uint64_t)];
+            break;
+        }
+
+        case BLMSessionEventTypeOnset: {
+            if (!active) { // A repeated onset continues the current episode
+                [responseTimes appendBytes:&timeOffset length:sizeof(uint64_t)];
+                [onsets appendBytes:&timeOffset length:sizeof(uint64_t)];
+            }
+            break;
+        }
+
+        case BLMSessionEventTypeOffset: {
+            if (active) {
+                [offsets appendBytes:&timeOffset length:sizeof(uint64_t)];
+            }
+            break;
+        }
+
+        case BLMSessionEventTypeCount: {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+
+- (void)applyEventsFromStore:(BLMEventStore *)store {
+    assert(self.lastTimeOffset == 0);
+
+    [store enumerateEventsFromTimeOffset:0 toTimeOffset:self.sessionLength usingBlock:^(BLMSessionEvent event, BOOL *stop) {
+        [self applyEvent:event];
+    }];
+}
+
+#pragma mark Scoring
+
+- (BLMIntervalSampling *)samplingWithBinWidth:(uint64_t)binWidth {
+    assert(binWidth > 0);
+
+    NSUInteger binCount = (NSUInteger)((self.sessionLength + binWidth - 1) / binWidth);
+    BLMIntervalSampling *sampling = [[BLMIntervalSampling alloc] initWithBinWidth:binWidth binCount:binCount behaviorCount:self.behaviorUUIDs.count];
+
+    for (NSUInteger behaviorIndex = 0; behaviorIndex < self.behaviorUUIDs.count; behaviorIndex += 1) {
+        NSData *onsets = self.onsetsByBehaviorIndex[behaviorIndex];
+        NSData *offsets = self.offsetsByBehaviorIndex[behaviorIndex];
+        NSData *responseTimes = self.responseTimesByBehaviorIndex[behaviorIndex];
+
+        ScoreBins(onsets.bytes, (onsets.length / sizeof(uint64_t)),
+                  offsets.bytes, (offsets.length / sizeof(uint64_t)),
+                  responseTimes.bytes, (responseTimes.length / sizeof(uint64_t)),
+                  binWidth, binCount, self.sessionLength, [sampling scoringBuffersForBehaviorIndex:behaviorIndex]);
+    }
+
+    return sampling;
+}
+
+@end
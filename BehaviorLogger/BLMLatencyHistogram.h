@@ -0,0 +1,47 @@
+//
+//  BLMLatencyHistogram.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/30/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+extern NSTimeInterval const BLMLatencyHistogramBucketWidth; // 0.25 ms
+extern NSUInteger const BLMLatencyHistogramBucketCount; // The last bucket collects everything past 32 ms
+
+
+#pragma mark
+
+/*
+ ` Counts latencies in fixed-width buckets. Recording a latency only increments a counter in a
+ ` preallocated array, so it can sit on the touch path without allocating or taking a lock.
+ ` Percentiles are reported at bucket granularity, as the upper bound of the bucket they fall in.
+ `
+ ` The histogram is not thread safe.
+ */
+
+@interface BLMLatencyHistogram : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger sampleCount;
+@property (nonatomic, assign, readonly) NSTimeInterval maximumLatency;
+
+- (void)recordLatency:(NSTimeInterval)latency; // Negative latencies are recorded as 0
+- (void)reset;
+
+- (NSUInteger)countInBucket:(NSUInteger)bucketIndex;
+- (NSTimeInterval)upperBoundForBucket:(NSUInteger)bucketIndex; // INFINITY for the last bucket
+- (NSUInteger)countExceedingLatency:(NSTimeInterval)latency; // Samples in buckets entirely above latency
+- (NSTimeInterval)latencyAtPercentile:(double)percentile; // percentile in [0, 100]; 0 if there are no samples
+
+- (NSString *)CSVRepresentation; // One "upper_bound_ms,count" row per nonempty bucket, after a header row
+
+@end
+
+
+NS_ASSUME_NONNULL_END
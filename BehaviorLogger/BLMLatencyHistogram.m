@@ -0,0 +1,125 @@
+//
+//  BLMLatencyHistogram.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/30/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMLatencyHistogram.h"
+
+
+#pragma mark Constants
+
+enum {
+    BucketCount = 129 // 128 bounded buckets and one overflow bucket
+};
+
+
+NSTimeInterval const BLMLatencyHistogramBucketWidth = 0.00025;
+NSUInteger const BLMLatencyHistogramBucketCount = BucketCount;
+
+
+#pragma mark
+
+@interface BLMLatencyHistogram () {
+    NSUInteger _counts[BucketCount];
+}
+
+@end
+
+
+@implementation BLMLatencyHistogram
+
+- (void)recordLatency:(NSTimeInterval)latency {
+    latency = MAX(latency, 0.0);
+
+    NSUInteger bucketIndex = MIN((NSUInteger)(latency / BLMLatencyHistogramBucketWidth), (BucketCount - 1));
+
+    _counts[bucketIndex] += 1;
+    _sampleCount += 1;
+    _maximumLatency = MAX(_maximumLatency, latency);
+}
+
+
+- (void)reset {
+    memset(_counts, 0, sizeof(_counts));
+
+    _sampleCount = 0;
+    _maximumLatency = 0.0;
+}
+
+
+- (NSUInteger)countInBucket:(NSUInteger)bucketIndex {
+    assert(bucketIndex < BucketCount);
+    return _counts[bucketIndex];
+}
+
+
+- (NSTimeInterval)upperBoundForBucket:(NSUInteger)bucketIndex {
+    assert(bucketIndex < BucketCount);
+    return ((bucketIndex == (BucketCount - 1)) ? INFINITY : ((bucketIndex + 1) * BLMLatencyHistogramBucketWidth));
+}
+
+
+- (NSUInteger)countExceedingLatency:(NSTimeInterval)latency {
+    NSUInteger count = 0;
+
+    for (NSUInteger bucketIndex = 0; bucketIndex < BucketCount; bucketIndex += 1) {
+        NSTimeInterval lowerBound = (bucketIndex * BLMLatencyHistogramBucketWidth);
+
+        if (lowerBound >= latency) {
+            count += _counts[bucketIndex];
+        }
+    }
+
+    return count;
+}
+
+
+- (NSTimeInterval)latencyAtPercentile:(double)percentile {
+    assert((percentile >= 0.0) && (percentile <= 100.0));
+
+    if (self.sampleCount == 0) {
+        return 0.0;
+    }
+
+    NSUInteger targetCount = MAX((NSUInteger)ceil((percentile / 100.0) * self.sampleCount), 1);
+    NSUInteger cumulativeCount = 0;
+
+    for (NSUInteger bucketIndex = 0; bucketIndex < BucketCount; bucketIndex += 1) {
+        cumulativeCount += _counts[bucketIndex];
+
+        if (cumulativeCount >= targetCount) {
+            return MIN([self upperBoundForBucket:bucketIndex], self.maximumLatency);
+        }
+    }
+
+    assert(NO);
+    return self.maximumLatency;
+}
+
+
+- (NSString *)CSVRepresentation {
+    NSMutableString *representation = [NSMutableString stringWithString:@"upper_bound_ms,count\n"];
+
+    for (NSUInteger bucketIndex = 0; bucketIndex < BucketCount; bucketIndex += 1) {
+        if (_counts[bucketIndex] == 0) {
+            continue;
+        }
+
+        NSTimeInterval upperBound = [self upperBoundForBucket:bucketIndex];
+        NSString *upperBoundString = (isinf(upperBound) ? @"inf" : [NSString stringWithFormat:@"%.2f", (upperBound * 1000.0)]);
+
+        [representation appendFormat:@"%@,%lu\n", upperBoundString, (unsigned long)_counts[bucketIndex]];
+    }
+
+    return representation;
+}
+
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %lu samples, p50 %.2f ms, p99 %.2f ms, max %.2f ms>", NSStringFromClass([self class]), (unsigned long)self.sampleCount, ([self latencyAtPercentile:50.0] * 1000.0), ([self latencyAtPercentile:99.0] * 1000.0), (self.maximumLatency * 1000.0)];
+}
+
+@end
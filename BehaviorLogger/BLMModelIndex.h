@@ -0,0 +1,47 @@
+//
+//  BLMModelIndex.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/20/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMArchiveJournal.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+extern NSString *BLMCaseFoldedBehaviorName(NSString *name);
+
+
+#pragma mark
+
+/*
+ ` Secondary indexes over the data manager's objects, kept current by replacing each object as it
+ ` changes rather than by rescanning. Behaviors and the session configurations that reference them may
+ ` be indexed in either order; a configuration's name index fills in as its behaviors arrive.
+ `
+ ` Reference counts are kept the same way, so whatever a change or deletion leaves unreferenced can be
+ ` found without a sweep. Only objects in memory are indexed, so configurations of sessions in unloaded
+ ` shards are absent, and neither they nor their sessions count as references.
+ ` All messages must be sent from the main thread.
+ */
+
+@interface BLMModelIndex : NSObject
+
+- (void)replaceObject:(nullable id)original withObject:(nullable id)updated kind:(BLMArchiveEntityKind)kind; // nil original for insertions, nil updated for removals
+
+- (NSSet<NSUUID *> *)behaviorUUIDsWithCaseFoldedName:(NSString *)caseFoldedName inSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID;
+- (NSSet<NSUUID *> *)sessionConfigurationUUIDsReferencingBehaviorUUID:(NSUUID *)behaviorUUID;
+- (NSSet<NSUUID *> *)projectUUIDsForClient:(NSString *)client;
+- (nullable NSUUID *)projectUUIDForSessionUUID:(NSUUID *)sessionUUID;
+- (BOOL)isProjectSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID; // As opposed to one owned by a session
+- (NSUInteger)referenceCountForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind; // Configurations referencing a behavior, projects and sessions using a configuration, the project owning a session; projects are never referenced
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,324 @@
+//
+//  BLMModelIndex.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/20/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMBehavior.h"
+#import "BLMModelIndex.h"
+#import "BLMProject.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+#import "BLMUtils.h"
+
+
+#pragma mark Constants
+
+NSString *BLMCaseFoldedBehaviorName(NSString *name) {
+    return name.lowercaseString;
+}
+
+
+static void AddObjectToSetForKey(NSMutableDictionary *setByKey, id<NSCopying> key, id object) {
+    NSMutableSet *set = setByKey[key];
+
+    if (set == nil) {
+        set = [NSMutableSet set];
+        setByKey[key] = set;
+    }
+
+    [set addObject:object];
+}
+
+
+static void RemoveObjectFromSetForKey(NSMutableDictionary *setByKey, id<NSCopying> key, id object) {
+    NSMutableSet *set = setByKey[key];
+    [set removeObject:object];
+
+    if (set.count == 0) { // Empty sets are dropped so a rebuilt index compares equal
+        [setByKey removeObjectForKey:key];
+    }
+}
+
+
+static void AdjustCountForKey(NSMutableDictionary<id, NSNumber *> *countByKey, id<NSCopying> key, NSInteger delta) {
+    NSInteger count = (countByKey[key].integerValue + delta);
+    assert(count >= 0);
+
+    countByKey[key] = ((count == 0) ? nil : @(count)); // Zero counts are dropped so a rebuilt index compares equal
+}
+
+
+#pragma mark
+
+@interface BLMModelIndex ()
+
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSString *> *caseFoldedNameByBehaviorUUID;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSMutableDictionary<NSString *, NSMutableSet<NSUUID *> *> *> *behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSMutableSet<NSUUID *> *> *sessionConfigurationUUIDsByBehaviorUUID;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSString *, NSMutableSet<NSUUID *> *> *projectUUIDsByClient;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSUUID *> *projectUUIDBySessionUUID;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSNumber *> *referenceCountBySessionConfigurationUUID; // Projects and sessions using each configuration
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSNumber *> *projectCountBySessionConfigurationUUID;
+
+@end
+
+
+@implementation BLMModelIndex
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _caseFoldedNameByBehaviorUUID = [NSMutableDictionary dictionary];
+    _behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID = [NSMutableDictionary dictionary];
+    _sessionConfigurationUUIDsByBehaviorUUID = [NSMutableDictionary dictionary];
+    _projectUUIDsByClient = [NSMutableDictionary dictionary];
+    _projectUUIDBySessionUUID = [NSMutableDictionary dictionary];
+    _referenceCountBySessionConfigurationUUID = [NSMutableDictionary dictionary];
+    _projectCountBySessionConfigurationUUID = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[self class]]) {
+        return NO;
+    }
+
+    BLMModelIndex *other = (BLMModelIndex *)object;
+
+    return ([BLMUtils isObject:self.caseFoldedNameByBehaviorUUID equalToObject:other.caseFoldedNameByBehaviorUUID]
+            && [BLMUtils isObject:self.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID equalToObject:other.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID]
+            && [BLMUtils isObject:self.sessionConfigurationUUIDsByBehaviorUUID equalToObject:other.sessionConfigurationUUIDsByBehaviorUUID]
+            && [BLMUtils isObject:self.projectUUIDsByClient equalToObject:other.projectUUIDsByClient]
+            && [BLMUtils isObject:self.projectUUIDBySessionUUID equalToObject:other.projectUUIDBySessionUUID]
+            && [BLMUtils isObject:self.referenceCountBySessionConfigurationUUID equalToObject:other.referenceCountBySessionConfigurationUUID]
+            && [BLMUtils isObject:self.projectCountBySessionConfigurationUUID equalToObject:other.projectCountBySessionConfigurationUUID]);
+}
+
+
+- (NSUInteger)hash {
+    return (self.caseFoldedNameByBehaviorUUID.count ^ self.projectUUIDBySessionUUID.count);
+}
+
+#pragma mark Maintenance
+
+- (void)replaceObject:(id)original withObject:(id)updated kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+    assert((original == nil) || (updated == nil) || [[original UUID] isEqual:[updated UUID]]);
+
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            [self replaceProject:original withProject:updated];
+            break;
+
+        case BLMArchiveEntityKindBehavior:
+            [self replaceBehavior:original withBehavior:updated];
+            break;
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            [self replaceSessionConfiguration:original withSessionConfiguration:updated];
+            break;
+
+        case BLMArchiveEntityKindSession:
+            [self replaceSession:original withSession:updated];
+            break;
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+
+- (void)replaceProject:(BLMProject *)original withProject:(BLMProject *)updated {
+    if (![BLMUtils isString:original.client equalToString:updated.client]) {
+        if (original != nil) {
+            RemoveObjectFromSetForKey(self.projectUUIDsByClient, original.client, original.UUID);
+        }
+
+        if (updated != nil) {
+            AddObjectToSetForKey(self.projectUUIDsByClient, updated.client, updated.UUID);
+        }
+    }
+
+    for (NSUUID *sessionUUID in original.sessionUUIDs) {
+        if (![updated.sessionUUIDs containsObject:sessionUUID]) {
+            [self.projectUUIDBySessionUUID removeObjectForKey:sessionUUID];
+        }
+    }
+
+    for (NSUUID *sessionUUID in updated.sessionUUIDs) {
+        self.projectUUIDBySessionUUID[sessionUUID] = updated.UUID;
+    }
+
+    if (![BLMUtils isObject:original.sessionConfigurationUUID equalToObject:updated.sessionConfigurationUUID]) {
+        if (original != nil) {
+            AdjustCountForKey(self.referenceCountBySessionConfigurationUUID, original.sessionConfigurationUUID, -1);
+            AdjustCountForKey(self.projectCountBySessionConfigurationUUID, original.sessionConfigurationUUID, -1);
+        }
+
+        if (updated != nil) {
+            AdjustCountForKey(self.referenceCountBySessionConfigurationUUID, updated.sessionConfigurationUUID, 1);
+            AdjustCountForKey(self.projectCountBySessionConfigurationUUID, updated.sessionConfigurationUUID, 1);
+        }
+    }
+}
+
+
+- (void)replaceSession:(BLMSession *)original withSession:(BLMSession *)updated { // Sessions are otherwise indexed through their projects
+    if ([BLMUtils isObject:original.configurationUUID equalToObject:updated.configurationUUID]) {
+        return;
+    }
+
+    if (original != nil) {
+        AdjustCountForKey(self.referenceCountBySessionConfigurationUUID, original.configurationUUID, -1);
+    }
+
+    if (updated != nil) {
+        AdjustCountForKey(self.referenceCountBySessionConfigurationUUID, updated.configurationUUID, 1);
+    }
+}
+
+
+- (void)replaceBehavior:(BLMBehavior *)original withBehavior:(BLMBehavior *)updated {
+    NSUUID *UUID = (updated.UUID ?: original.UUID);
+    NSString *originalName = self.caseFoldedNameByBehaviorUUID[UUID];
+    NSString *updatedName = ((updated == nil) ? nil : BLMCaseFoldedBehaviorName(updated.name));
+
+    if ([BLMUtils isString:originalName equalToString:updatedName]) { // Toggling continuous leaves every index alone
+        return;
+    }
+
+    self.caseFoldedNameByBehaviorUUID[UUID] = updatedName;
+
+    for (NSUUID *sessionConfigurationUUID in self.sessionConfigurationUUIDsByBehaviorUUID[UUID]) {
+        if (originalName != nil) {
+            [self removeBehaviorUUID:UUID caseFoldedName:originalName fromSessionConfigurationUUID:sessionConfigurationUUID];
+        }
+
+        if (updatedName != nil) {
+            [self addBehaviorUUID:UUID caseFoldedName:updatedName toSessionConfigurationUUID:sessionConfigurationUUID];
+        }
+    }
+}
+
+
+- (void)replaceSessionConfiguration:(BLMSessionConfiguration *)original withSessionConfiguration:(BLMSessionConfiguration *)updated {
+    NSUUID *UUID = (updated.UUID ?: original.UUID);
+
+    for (NSUUID *behaviorUUID in original.behaviorUUIDs) {
+        if ([updated.behaviorUUIDs containsObject:behaviorUUID]) {
+            continue;
+        }
+
+        RemoveObjectFromSetForKey(self.sessionConfigurationUUIDsByBehaviorUUID, behaviorUUID, UUID);
+
+        NSString *caseFoldedName = self.caseFoldedNameByBehaviorUUID[behaviorUUID];
+
+        if (caseFoldedName != nil) {
+            [self removeBehaviorUUID:behaviorUUID caseFoldedName:caseFoldedName fromSessionConfigurationUUID:UUID];
+        }
+    }
+
+    for (NSUUID *behaviorUUID in updated.behaviorUUIDs) {
+        if ([original.behaviorUUIDs containsObject:behaviorUUID]) {
+            continue;
+        }
+
+        AddObjectToSetForKey(self.sessionConfigurationUUIDsByBehaviorUUID, behaviorUUID, UUID);
+
+        NSString *caseFoldedName = self.caseFoldedNameByBehaviorUUID[behaviorUUID];
+
+        if (caseFoldedName != nil) { // Otherwise filled in once the behavior is indexed
+            [self addBehaviorUUID:behaviorUUID caseFoldedName:caseFoldedName toSessionConfigurationUUID:UUID];
+        }
+    }
+}
+
+
+- (void)addBehaviorUUID:(NSUUID *)behaviorUUID caseFoldedName:(NSString *)caseFoldedName toSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID {
+    NSMutableDictionary *behaviorUUIDsByCaseFoldedName = self.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID[sessionConfigurationUUID];
+
+    if (behaviorUUIDsByCaseFoldedName == nil) {
+        behaviorUUIDsByCaseFoldedName = [NSMutableDictionary dictionary];
+        self.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID[sessionConfigurationUUID] = behaviorUUIDsByCaseFoldedName;
+    }
+
+    AddObjectToSetForKey(behaviorUUIDsByCaseFoldedName, caseFoldedName, behaviorUUID);
+}
+
+
+- (void)removeBehaviorUUID:(NSUUID *)behaviorUUID caseFoldedName:(NSString *)caseFoldedName fromSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID {
+    NSMutableDictionary *behaviorUUIDsByCaseFoldedName = self.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID[sessionConfigurationUUID];
+    RemoveObjectFromSetForKey(behaviorUUIDsByCaseFoldedName, caseFoldedName, behaviorUUID);
+
+    if (behaviorUUIDsByCaseFoldedName.count == 0) {
+        [self.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID removeObjectForKey:sessionConfigurationUUID];
+    }
+}
+
+#pragma mark Queries
+
+- (NSSet<NSUUID *> *)behaviorUUIDsWithCaseFoldedName:(NSString *)caseFoldedName inSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID {
+    assert([NSThread isMainThread]);
+    return ([self.behaviorUUIDsByCaseFoldedNameBySessionConfigurationUUID[sessionConfigurationUUID][caseFoldedName] copy] ?: [NSSet set]);
+}
+
+
+- (NSSet<NSUUID *> *)sessionConfigurationUUIDsReferencingBehaviorUUID:(NSUUID *)behaviorUUID {
+    assert([NSThread isMainThread]);
+    return ([self.sessionConfigurationUUIDsByBehaviorUUID[behaviorUUID] copy] ?: [NSSet set]);
+}
+
+
+- (NSSet<NSUUID *> *)projectUUIDsForClient:(NSString *)client {
+    assert([NSThread isMainThread]);
+    return ([self.projectUUIDsByClient[client] copy] ?: [NSSet set]);
+}
+
+
+- (NSUUID *)projectUUIDForSessionUUID:(NSUUID *)sessionUUID {
+    assert([NSThread isMainThread]);
+    return self.projectUUIDBySessionUUID[sessionUUID];
+}
+
+
+- (BOOL)isProjectSessionConfigurationUUID:(NSUUID *)sessionConfigurationUUID {
+    assert([NSThread isMainThread]);
+    return (self.projectCountBySessionConfigurationUUID[sessionConfigurationUUID] != nil);
+}
+
+
+- (NSUInteger)referenceCountForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    assert([NSThread isMainThread]);
+
+    switch (kind) {
+        case BLMArchiveEntityKindProject:
+            return 0;
+
+        case BLMArchiveEntityKindBehavior:
+            return self.sessionConfigurationUUIDsByBehaviorUUID[UUID].count;
+
+        case BLMArchiveEntityKindSession: // A session belongs to at most one project
+            return ((self.projectUUIDBySessionUUID[UUID] == nil) ? 0 : 1);
+
+        case BLMArchiveEntityKindSessionConfiguration:
+            return self.referenceCountBySessionConfigurationUUID[UUID].unsignedIntegerValue;
+
+        case BLMArchiveEntityKindCount: {
+            assert(NO);
+            return 0;
+        }
+    }
+}
+
+@end
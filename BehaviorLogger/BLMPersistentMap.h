@@ -0,0 +1,39 @@
+//
+//  BLMPersistentMap.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/23/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/*
+ ` An immutable dictionary stored as a hash array mapped trie. Setting or removing a key returns a new
+ ` map in O(log n) that shares every node off the changed key's path with the receiver, so holding on
+ ` to a map is an O(1) snapshot that later changes never disturb. Maps may be read from any thread.
+ */
+
+@interface BLMPersistentMap<KeyType, ObjectType> : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger count;
+
++ (instancetype)map;
+
+- (nullable ObjectType)objectForKey:(KeyType)key;
+- (nullable ObjectType)objectForKeyedSubscript:(KeyType)key;
+- (instancetype)mapBySettingObject:(nullable ObjectType)object forKey:(KeyType)key; // nil removes the key; the receiver itself if nothing changes
+
+- (void)enumerateKeysAndObjectsUsingBlock:(void(^)(KeyType key, ObjectType object, BOOL *stop))block; // In no particular order
+- (NSArray<KeyType> *)allKeys;
+- (NSArray<ObjectType> *)allValues;
+- (NSEnumerator<ObjectType> *)objectEnumerator;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,439 @@
+//
+//  BLMPersistentMap.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/23/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMPersistentMap.h"
+
+
+#pragma mark Constants
+
+static NSUInteger const BitsPerLevel = 5;
+static uint64_t const LevelMask = 0x1F;
+static NSUInteger const HashBitCount = 64;
+
+
+static inline uint64_t HashForKey(id key) { // Mixed, since each level of the trie consumes five bits and -hash need not spread across all of them
+    uint64_t hash = (uint64_t)[key hash];
+
+    hash ^= (hash >> 33);
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= (hash >> 33);
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= (hash >> 33);
+
+    return hash;
+}
+
+
+static inline uint32_t BitForHash(uint64_t keyHash, NSUInteger shift) {
+    return ((uint32_t)1 << ((keyHash >> shift) & LevelMask));
+}
+
+
+static inline NSUInteger ChildIndexForBit(uint32_t bitmap, uint32_t bit) { // Children are packed, so a child's index is the number of set bits below its own
+    return (NSUInteger)__builtin_popcount(bitmap & (bit - 1));
+}
+
+
+#pragma mark
+
+@interface MapEntry : NSObject
+
+@property (nonatomic, assign, readonly) uint64_t keyHash;
+@property (nonatomic, strong, readonly) id key;
+@property (nonatomic, strong, readonly) id object;
+
+- (instancetype)initWithKey:(id)key object:(id)object keyHash:(uint64_t)keyHash;
+- (BOOL)hasKey:(id)key keyHash:(uint64_t)keyHash;
+
+@end
+
+
+@implementation MapEntry
+
+- (instancetype)initWithKey:(id)key object:(id)object keyHash:(uint64_t)keyHash {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _keyHash = keyHash;
+    _key = key;
+    _object = object;
+
+    return self;
+}
+
+
+- (BOOL)hasKey:(id)key keyHash:(uint64_t)keyHash {
+    return ((self.keyHash == keyHash) && [self.key isEqual:key]);
+}
+
+@end
+
+
+#pragma mark
+
+@interface MapNode : NSObject // One child, either a MapEntry or a MapNode, per set bit of the bitmap
+
+@property (nonatomic, assign, readonly) uint32_t bitmap;
+@property (nonatomic, copy, readonly) NSArray *children;
+
+- (instancetype)initWithBitmap:(uint32_t)bitmap children:(NSArray *)children;
+
+- (nullable id)objectForKey:(id)key keyHash:(uint64_t)keyHash shift:(NSUInteger)shift;
+- (MapNode *)nodeBySettingEntry:(MapEntry *)entry shift:(NSUInteger)shift added:(BOOL *)added;
+- (nullable MapNode *)nodeByRemovingKey:(id)key keyHash:(uint64_t)keyHash shift:(NSUInteger)shift removed:(BOOL *)removed; // nil once the node would be empty
+- (void)enumerateEntriesUsingBlock:(void(^)(MapEntry *entry, BOOL *stop))block stop:(BOOL *)stop;
+
+@end
+
+
+@interface MapCollisionNode : MapNode // Entries whose hashes are identical in every bit, searched linearly
+
+@property (nonatomic, assign, readonly) uint64_t keyHash;
+@property (nonatomic, copy, readonly) NSArray<MapEntry *> *entries;
+
+- (instancetype)initWithEntries:(NSArray<MapEntry *> *)entries;
+
+@end
+
+
+@implementation MapNode
+
+- (instancetype)initWithBitmap:(uint32_t)bitmap children:(NSArray *)children {
+    assert((NSUInteger)__builtin_popcount(bitmap) == children.count);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _bitmap = bitmap;
+    _children = [children copy];
+
+    return self;
+}
+
+
++ (MapNode *)nodeWithChild:(id)child childHash:(uint64_t)childHash entry:(MapEntry *)entry shift:(NSUInteger)shift { // The child and entry share every hash bit below shift
+    assert(childHash != entry.keyHash);
+    assert(shift < HashBitCount);
+
+    uint32_t childBit = BitForHash(childHash, shift);
+    uint32_t entryBit = BitForHash(entry.keyHash, shift);
+
+    if (childBit == entryBit) {
+        return [[MapNode alloc] initWithBitmap:childBit children:@[[self nodeWithChild:child childHash:childHash entry:entry shift:(shift + BitsPerLevel)]]];
+    }
+
+    return [[MapNode alloc] initWithBitmap:(childBit | entryBit) children:((childBit < entryBit) ? @[child, entry] : @[entry, child])];
+}
+
+
+- (id)objectForKey:(id)key keyHash:(uint64_t)keyHash shift:(NSUInteger)shift {
+    uint32_t bit = BitForHash(keyHash, shift);
+
+    if ((self.bitmap & bit) == 0) {
+        return nil;
+    }
+
+    id child = self.children[ChildIndexForBit(self.bitmap, bit)];
+
+    if ([child isKindOfClass:[MapNode class]]) {
+        return [(MapNode *)child objectForKey:key keyHash:keyHash shift:(shift + BitsPerLevel)];
+    }
+
+    return ([(MapEntry *)child hasKey:key keyHash:keyHash] ? ((MapEntry *)child).object : nil);
+}
+
+
+- (MapNode *)nodeBySettingEntry:(MapEntry *)entry shift:(NSUInteger)shift added:(BOOL *)added {
+    uint32_t bit = BitForHash(entry.keyHash, shift);
+    NSUInteger index = ChildIndexForBit(self.bitmap, bit);
+
+    if ((self.bitmap & bit) == 0) {
+        NSMutableArray *children = [self.children mutableCopy];
+        [children insertObject:entry atIndex:index];
+
+        *added = YES;
+
+        return [[MapNode alloc] initWithBitmap:(self.bitmap | bit) children:children];
+    }
+
+    id child = self.children[index];
+    id updatedChild = nil;
+
+    if ([child isKindOfClass:[MapCollisionNode class]] && (((MapCollisionNode *)child).keyHash != entry.keyHash)) {
+        updatedChild = [MapNode nodeWithChild:child childHash:((MapCollisionNode *)child).keyHash entry:entry shift:(shift + BitsPerLevel)];
+        *added = YES;
+    } else if ([child isKindOfClass:[MapNode class]]) {
+        updatedChild = [(MapNode *)child nodeBySettingEntry:entry shift:(shift + BitsPerLevel) added:added];
+    } else {
+        MapEntry *existingEntry = (MapEntry *)child;
+
+        if ([existingEntry hasKey:entry.key keyHash:entry.keyHash]) {
+            updatedChild = ((existingEntry.object == entry.object) ? existingEntry : entry);
+        } else if (existingEntry.keyHash == entry.keyHash) {
+            updatedChild = [[MapCollisionNode alloc] initWithEntries:@[existingEntry, entry]];
+            *added = YES;
+        } else {
+            updatedChild = [MapNode nodeWithChild:existingEntry childHash:existingEntry.keyHash entry:entry shift:(shift + BitsPerLevel)];
+            *added = YES;
+        }
+    }
+
+    if (updatedChild == child) {
+        return self;
+    }
+
+    NSMutableArray *children = [self.children mutableCopy];
+    children[index] = updatedChild;
+
+    return [[MapNode alloc] initWithBitmap:self.bitmap children:children];
+}
+
+
+- (MapNode *)nodeByRemovingKey:(id)key keyHash:(uint64_t)keyHash shift:(NSUInteger)shift removed:(BOOL *)removed {
+    uint32_t bit = BitForHash(keyHash, shift);
+
+    if ((self.bitmap & bit) == 0) {
+        return self;
+    }
+
+    NSUInteger index = ChildIndexForBit(self.bitmap, bit);
+    id child = self.children[index];
+    id updatedChild = nil;
+
+    if ([child isKindOfClass:[MapNode class]]) {
+        MapNode *updatedNode = [(MapNode *)child nodeByRemovingKey:key keyHash:keyHash shift:(shift + BitsPerLevel) removed:removed];
+
+        if (updatedNode == child) {
+            return self;
+        }
+
+        if ((updatedNode.children.count == 1) && [updatedNode.children.firstObject isKindOfClass:[MapEntry class]]) { // A lone entry moves up in place of its node, so the trie stays as shallow as it would be had the key never been set
+            updatedChild = updatedNode.children.firstObject;
+        } else {
+            updatedChild = updatedNode;
+        }
+    } else if (![(MapEntry *)child hasKey:key keyHash:keyHash]) {
+        return self;
+    } else {
+        *removed = YES;
+    }
+
+    NSMutableArray *children = [self.children mutableCopy];
+
+    if (updatedChild != nil) {
+        children[index] = updatedChild;
+        return [[MapNode alloc] initWithBitmap:self.bitmap children:children];
+    }
+
+    if (self.bitmap == bit) {
+        return nil;
+    }
+
+    [children removeObjectAtIndex:index];
+
+    return [[MapNode alloc] initWithBitmap:(self.bitmap & ~bit) children:children];
+}
+
+
+- (void)enumerateEntriesUsingBlock:(void(^)(MapEntry *entry, BOOL *stop))block stop:(BOOL *)stop {
+    for (id child in self.children) {
+        if ([child isKindOfClass:[MapNode class]]) {
+            [(MapNode *)child enumerateEntriesUsingBlock:block stop:stop];
+        } else {
+            block(child, stop);
+        }
+
+        if (*stop) {
+            return;
+        }
+    }
+}
+
+@end
+
+
+@implementation MapCollisionNode
+
+- (instancetype)initWithEntries:(NSArray<MapEntry *> *)entries {
+    assert(entries.count >= 2);
+
+    self = [super initWithBitmap:0 children:@[]];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _keyHash = entries.firstObject.keyHash;
+    _entries = [entries copy];
+
+    return self;
+}
+
+
+- (NSArray *)children {
+    return self.entries;
+}
+
+
+- (NSUInteger)indexOfKey:(id)key {
+    return [self.entries indexOfObjectPassingTest:^BOOL(MapEntry *__nonnull entry, NSUInteger index, BOOL *__nonnull stop) {
+        return [entry.key isEqual:key];
+    }];
+}
+
+
+- (id)objectForKey:(id)key keyHash:(uint64_t)keyHash shift:(NSUInteger)shift {
+    if (keyHash != self.keyHash) {
+        return nil;
+    }
+
+    NSUInteger index = [self indexOfKey:key];
+    return ((index == NSNotFound) ? nil : self.entries[index].object);
+}
+
+
+- (MapNode *)nodeBySettingEntry:(MapEntry *)entry shift:(NSUInteger)shift added:(BOOL *)added {
+    assert(entry.keyHash == self.keyHash);
+
+    NSMutableArray<MapEntry *> *entries = [self.entries mutableCopy];
+    NSUInteger index = [self indexOfKey:entry.key];
+
+    if (index == NSNotFound) {
+        [entries addObject:entry];
+        *added = YES;
+    } else if (entries[index].object == entry.object) {
+        return self;
+    } else {
+        entries[index] = entry;
+    }
+
+    return [[MapCollisionNode alloc] initWithEntries:entries];
+}
+
+
+- (MapNode *)nodeByRemovingKey:(id)key keyHash:(uint64_t)keyHash shift:(NSUInteger)shift removed:(BOOL *)removed {
+    NSUInteger index = ((keyHash == self.keyHash) ? [self indexOfKey:key] : NSNotFound);
+
+    if (index == NSNotFound) {
+        return self;
+    }
+
+    NSMutableArray<MapEntry *> *entries = [self.entries mutableCopy];
+    [entries removeObjectAtIndex:index];
+
+    *removed = YES;
+
+    if (entries.count == 1) { // Returned as a one-entry node, which the parent replaces with the entry itself
+        return [[MapNode alloc] initWithBitmap:BitForHash(self.keyHash, shift) children:entries];
+    }
+
+    return [[MapCollisionNode alloc] initWithEntries:entries];
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMPersistentMap ()
+
+@property (nonatomic, strong, readonly) MapNode *root;
+
+@end
+
+
+@implementation BLMPersistentMap
+
++ (instancetype)map {
+    return [[self alloc] initWithRoot:[[MapNode alloc] initWithBitmap:0 children:@[]] count:0];
+}
+
+
+- (instancetype)initWithRoot:(MapNode *)root count:(NSUInteger)count {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _root = root;
+    _count = count;
+
+    return self;
+}
+
+
+- (id)objectForKey:(id)key {
+    return [self.root objectForKey:key keyHash:HashForKey(key) shift:0];
+}
+
+
+- (id)objectForKeyedSubscript:(id)key {
+    return [self objectForKey:key];
+}
+
+
+- (instancetype)mapBySettingObject:(id)object forKey:(id)key {
+    uint64_t keyHash = HashForKey(key);
+
+    if (object == nil) {
+        BOOL removed = NO;
+        MapNode *root = ([self.root nodeByRemovingKey:key keyHash:keyHash shift:0 removed:&removed] ?: [[MapNode alloc] initWithBitmap:0 children:@[]]);
+
+        return (removed ? [[[self class] alloc] initWithRoot:root count:(self.count - 1)] : self);
+    }
+
+    BOOL added = NO;
+    MapNode *root = [self.root nodeBySettingEntry:[[MapEntry alloc] initWithKey:key object:object keyHash:keyHash] shift:0 added:&added];
+
+    return ((root == self.root) ? self : [[[self class] alloc] initWithRoot:root count:(self.count + (added ? 1 : 0))]);
+}
+
+
+- (void)enumerateKeysAndObjectsUsingBlock:(void(^)(id key, id object, BOOL *stop))block {
+    BOOL stopped = NO;
+
+    [self.root enumerateEntriesUsingBlock:^(MapEntry *entry, BOOL *stop) {
+        block(entry.key, entry.object, stop);
+    } stop:&stopped];
+}
+
+
+- (NSArray *)allKeys {
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:self.count];
+
+    [self enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL *stop) {
+        [keys addObject:key];
+    }];
+
+    return keys;
+}
+
+
+- (NSArray *)allValues {
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:self.count];
+
+    [self enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL *stop) {
+        [objects addObject:object];
+    }];
+
+    return objects;
+}
+
+
+- (NSEnumerator *)objectEnumerator {
+    return self.allValues.objectEnumerator;
+}
+
+@end
@@ -31,6 +31,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (instancetype)initWithProjectUUID:(NSUUID *)projectUUID delegate:(id<BLMProjectDetailControllerDelegate>)delegate;
 
++ (void)prewarmImageCache; // Rasterizes the cell borders and button images on a background queue
+
 @end
 
 
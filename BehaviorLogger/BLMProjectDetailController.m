@@ -10,8 +10,11 @@
 #import "BLMButtonCell.h"
 #import "BLMCollectionView.h"
 #import "BLMDataManager.h"
+#import "BLMImageCache.h"
+#import "BLMLatencyHistogram.h"
 #import "BLMProjectDetailController.h"
 #import "BLMProjectMenuController.h"
+#import "BLMSessionRecordingController.h"
 #import "BLMTextInputCell.h"
 #import "BLMTextField.h"
 #import "BLMUtils.h"
@@ -32,6 +35,7 @@ static UIEdgeInsets const SectionSeparatorInsets = { .top = 10.0, .left = 20.0,
 
 static CGFloat const BehaviorCellDeleteButtonImageRadius = 12.0;
 static CGFloat const BehaviorCellDeleteButtonOffset = ((2 * BehaviorCellDeleteButtonImageRadius) / 3.0);
+static NSString *const BehaviorCellToggleSwitchLabelText = @"Continuous:";
 
 
 typedef NS_ENUM(NSUInteger, Section) {
@@ -68,23 +72,25 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
 #pragma mark
 
-@interface BehaviorCellBorderView : UIView
+@interface BehaviorCellBorderView : UIImageView
 
 @property (nonatomic, strong) UIColor *borderColor;
 
++ (UIImage *)borderImageWithColor:(UIColor *)color;
+
 @end
 
 
 @implementation BehaviorCellBorderView
 
 - (instancetype)init {
-    self = [super init];
+    self = [super initWithImage:nil];
 
     if (self == nil) {
         return nil;
     }
 
-    _borderColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeBlue];
+    self.borderColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeBlue];
 
     return self;
 }
@@ -97,13 +103,11 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
     _borderColor = borderColor;
 
-    [self setNeedsDisplay];
+    self.image = [BehaviorCellBorderView borderImageWithColor:borderColor];
 }
 
 
-- (void)drawRect:(CGRect)rect {
-    [super drawRect:rect];
-
++ (UIImage *)borderImageWithColor:(UIColor *)color { // Drawn at the smallest size that holds the corners and the gap left for the delete button, then stretched across the cell
     static CGFloat edgeLengthCoveredByDeleteButton = 0;
     static dispatch_once_t onceToken = 0;
 
@@ -116,60 +120,68 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
                                                               / BehaviorCellDeleteButtonImageRadius)))); // ...as a ratio of the circle's radius
     });
 
+    CGFloat leadingCap = (edgeLengthCoveredByDeleteButton + 1.0);
+    CGFloat trailingCap = (BLMCollectionViewRoundedCornerRadius + 1.0);
+    CGSize imageSize = CGSizeMake((leadingCap + 1.0 + trailingCap), (leadingCap + 1.0 + trailingCap));
+    UIEdgeInsets capInsets = { .top = leadingCap, .left = leadingCap, .bottom = trailingCap, .right = trailingCap };
 
-    UIBezierPath *path = [UIBezierPath bezierPath];
+    return [[BLMImageCache sharedCache] imageForShape:@"BehaviorCellBorder" color:color size:imageSize opaque:NO capInsets:capInsets drawingHandler:^(CGSize size) {
+        CGRect rect = { .size = size };
 
-    [path moveToPoint:(CGPoint) {
-        .x = CGRectGetMinX(rect) + 0.5 + edgeLengthCoveredByDeleteButton,
-        .y = CGRectGetMinY(rect) + 0.5
-    }];
+        UIBezierPath *path = [UIBezierPath bezierPath];
 
-    [path addLineToPoint:(CGPoint) {
-        .x = CGRectGetMaxX(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius,
-        .y = CGRectGetMinY(rect) + 0.5
-    }];
+        [path moveToPoint:(CGPoint) {
+            .x = CGRectGetMinX(rect) + 0.5 + edgeLengthCoveredByDeleteButton,
+            .y = CGRectGetMinY(rect) + 0.5
+        }];
 
-    CGPoint arcCenter = (CGPoint) {
-        .x = CGRectGetMaxX(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius,
-        .y = CGRectGetMinY(rect) + 0.5 + BLMCollectionViewRoundedCornerRadius
-    };
+        [path addLineToPoint:(CGPoint) {
+            .x = CGRectGetMaxX(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius,
+            .y = CGRectGetMinY(rect) + 0.5
+        }];
 
-    [path addArcWithCenter:arcCenter radius:BLMCollectionViewRoundedCornerRadius startAngle:(3 * M_PI_2) endAngle:0 clockwise:YES];
+        CGPoint arcCenter = (CGPoint) {
+            .x = CGRectGetMaxX(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius,
+            .y = CGRectGetMinY(rect) + 0.5 + BLMCollectionViewRoundedCornerRadius
+        };
 
-    [path addLineToPoint:(CGPoint) {
-        .x = CGRectGetMaxX(rect) - 0.5,
-        .y = CGRectGetMaxY(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius
-    }];
+        [path addArcWithCenter:arcCenter radius:BLMCollectionViewRoundedCornerRadius startAngle:(3 * M_PI_2) endAngle:0 clockwise:YES];
 
-    arcCenter = (CGPoint) {
-        .x = CGRectGetMaxX(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius,
-        .y = CGRectGetMaxY(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius
-    };
+        [path addLineToPoint:(CGPoint) {
+            .x = CGRectGetMaxX(rect) - 0.5,
+            .y = CGRectGetMaxY(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius
+        }];
 
-    [path addArcWithCenter:arcCenter radius:BLMCollectionViewRoundedCornerRadius startAngle:0 endAngle:M_PI_2 clockwise:YES];
+        arcCenter = (CGPoint) {
+            .x = CGRectGetMaxX(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius,
+            .y = CGRectGetMaxY(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius
+        };
 
-    [path addLineToPoint:(CGPoint) {
-        .x = CGRectGetMinX(rect) + 0.5 + BLMCollectionViewRoundedCornerRadius,
-        .y = CGRectGetMaxY(rect) - 0.5
-    }];
+        [path addArcWithCenter:arcCenter radius:BLMCollectionViewRoundedCornerRadius startAngle:0 endAngle:M_PI_2 clockwise:YES];
 
-    arcCenter = (CGPoint) {
-        .x = CGRectGetMinX(rect) + 0.5 + BLMCollectionViewRoundedCornerRadius,
-        .y = CGRectGetMaxY(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius
-    };
+        [path addLineToPoint:(CGPoint) {
+            .x = CGRectGetMinX(rect) + 0.5 + BLMCollectionViewRoundedCornerRadius,
+            .y = CGRectGetMaxY(rect) - 0.5
+        }];
 
-    [path addArcWithCenter:arcCenter radius:BLMCollectionViewRoundedCornerRadius startAngle:M_PI_2 endAngle:M_PI clockwise:YES];
+        arcCenter = (CGPoint) {
+            .x = CGRectGetMinX(rect) + 0.5 + BLMCollectionViewRoundedCornerRadius,
+            .y = CGRectGetMaxY(rect) - 0.5 - BLMCollectionViewRoundedCornerRadius
+        };
 
-    [path addLineToPoint:(CGPoint) {
-        .x = CGRectGetMinX(rect) + 0.5,
-        .y = CGRectGetMinY(rect) + 0.5 + edgeLengthCoveredByDeleteButton
-    }];
+        [path addArcWithCenter:arcCenter radius:BLMCollectionViewRoundedCornerRadius startAngle:M_PI_2 endAngle:M_PI clockwise:YES];
+
+        [path addLineToPoint:(CGPoint) {
+            .x = CGRectGetMinX(rect) + 0.5,
+            .y = CGRectGetMinY(rect) + 0.5 + edgeLengthCoveredByDeleteButton
+        }];
 
-    path.lineWidth = 1.0;
+        path.lineWidth = 1.0;
 
-    [self.borderColor setStroke];
+        [color setStroke];
 
-    [path stroke];
+        [path stroke];
+    }];
 }
 
 @end
@@ -188,15 +200,17 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 @end
 
 
-@interface BehaviorCell : BLMTextInputCell
+@interface BehaviorCell : BLMTextInputCell <BLMChangeFeedObserver>
 
 @property (nonatomic, strong, readonly) BehaviorCellBorderView *borderView;
 @property (nonatomic, strong, readonly) UIButton *deleteButton;
 @property (nonatomic, strong, readonly) UISwitch *toggleSwitch;
-@property (nonatomic, strong, readonly) UILabel *toggleSwitchLabel;
+@property (nonatomic, strong, readonly) BLMMeasuredLabel *toggleSwitchLabel;
 @property (nonatomic, weak) id<BehaviorCellDelegate> delegate;
 @property (nonatomic, strong) BLMBehavior *behavior;
 
++ (UIImage *)deleteButtonImageForState:(UIControlState)state;
+
 @end
 
 
@@ -225,14 +239,8 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
     // Delete Button
 
-    static UIImage *deleteButtonDefaultImage = nil;
-    static UIImage *deleteButtonSelectedImage = nil;
-    static dispatch_once_t onceToken = 0;
-
-    dispatch_once(&onceToken, ^{
-        deleteButtonDefaultImage = [BLMViewUtils deleteItemImageWithBackgroundColor:[BLMViewUtils colorForHexCode:0x000000 alpha:0.6] diameter:(BehaviorCellDeleteButtonImageRadius * 2.0)];
-        deleteButtonSelectedImage = [BLMViewUtils deleteItemImageWithBackgroundColor:[BLMViewUtils colorForHexCode:0xB83020 alpha:0.8] diameter:(BehaviorCellDeleteButtonImageRadius * 2.0)];
-    });
+    UIImage *deleteButtonDefaultImage = [BehaviorCell deleteButtonImageForState:UIControlStateNormal];
+    UIImage *deleteButtonSelectedImage = [BehaviorCell deleteButtonImageForState:UIControlStateSelected];
 
     _deleteButton = [UIButton buttonWithType:UIButtonTypeCustom];
 
@@ -265,7 +273,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
     // Toggle Switch Label
 
-    _toggleSwitchLabel = [[UILabel alloc] init];
+    _toggleSwitchLabel = [[BLMMeasuredLabel alloc] init];
 
     [self.toggleSwitchLabel setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisVertical];
     [self.toggleSwitchLabel setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisHorizontal];
@@ -273,7 +281,8 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     [self.toggleSwitchLabel setContentCompressionResistancePriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisVertical];
     [self.toggleSwitchLabel setContentCompressionResistancePriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisHorizontal];
 
-    self.toggleSwitchLabel.text = @"Continuous:";
+    self.toggleSwitchLabel.font = [BLMCollectionViewCell labelFont];
+    self.toggleSwitchLabel.text = BehaviorCellToggleSwitchLabelText;
     self.toggleSwitchLabel.translatesAutoresizingMaskIntoConstraints = NO;
 
     [self.contentView addSubview:self.toggleSwitchLabel];
@@ -285,21 +294,29 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
 
 - (void)dealloc {
-    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [[BLMDataManager sharedManager].changeFeed removeObserver:self];
+}
+
+
++ (UIImage *)deleteButtonImageForState:(UIControlState)state {
+    UIColor *backgroundColor = ((state == UIControlStateNormal) ? [BLMViewUtils colorForHexCode:0x000000 alpha:0.6] : [BLMViewUtils colorForHexCode:0xB83020 alpha:0.8]);
+    return [BLMViewUtils deleteItemImageWithBackgroundColor:backgroundColor diameter:(BehaviorCellDeleteButtonImageRadius * 2.0)];
 }
 
 
 - (void)setBehavior:(BLMBehavior *)behavior {
     assert([NSThread isMainThread]);
 
-    if (self.behavior != nil) {
-        [[NSNotificationCenter defaultCenter] removeObserver:self name:BLMBehaviorUpdatedNotification object:self.behavior];
+    BLMChangeFeed *changeFeed = [BLMDataManager sharedManager].changeFeed;
+
+    if ((self.behavior != nil) && ![BLMUtils isObject:self.behavior.UUID equalToObject:behavior.UUID]) {
+        [changeFeed removeObserver:self forUUID:self.behavior.UUID kind:BLMArchiveEntityKindBehavior];
     }
 
     _behavior = behavior;
 
     if (behavior != nil) {
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleBehaviorUpdated:) name:BLMBehaviorUpdatedNotification object:behavior];
+        [changeFeed addObserver:self forUUID:behavior.UUID kind:BLMArchiveEntityKindBehavior];
     }
 }
 
@@ -336,8 +353,16 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 }
 
 
-- (void)handleBehaviorUpdated:(NSNotification *)notification {
-    BLMBehavior *updatedBehavior = notification.userInfo[BLMBehaviorUpdatedBehaviorUserInfoKey];
+- (void)changeFeed:(BLMChangeFeed *)changeFeed didDeliverChangeSet:(BLMChangeSet *)changeSet {
+    BLMBehavior *updatedBehavior = ((self.behavior == nil) ? nil : [changeSet updatedObjectForUUID:self.behavior.UUID kind:BLMArchiveEntityKindBehavior]);
+
+    if (updatedBehavior != nil) { // Deletions are left to the controller, which removes the cell
+        [self updateWithBehavior:updatedBehavior];
+    }
+}
+
+
+- (void)updateWithBehavior:(BLMBehavior *)updatedBehavior {
     assert([BLMUtils isObject:updatedBehavior equalToObject:[[BLMDataManager sharedManager] behaviorForUUID:self.behavior.UUID]]);
 
     self.behavior = updatedBehavior;
@@ -349,10 +374,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 - (void)updateLabelSubviewsPreferredMaxLayoutWidthWithLayoutRequired:(BOOL *)layoutRequired {
     [super updateLabelSubviewsPreferredMaxLayoutWidthWithLayoutRequired:layoutRequired];
 
-    CGFloat preferredMaxLayoutWidth = CGRectGetWidth([self.toggleSwitchLabel alignmentRectForFrame:self.toggleSwitchLabel.frame]);
-
-    if (preferredMaxLayoutWidth != self.toggleSwitchLabel.preferredMaxLayoutWidth) {
-        self.toggleSwitchLabel.preferredMaxLayoutWidth = preferredMaxLayoutWidth;
+    if ([self.toggleSwitchLabel updatePreferredMaxLayoutWidth]) {
         *layoutRequired = YES;
     }
 }
@@ -390,18 +412,34 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
 #pragma mark
 
-@interface BLMProjectDetailController () <UICollectionViewDataSource, BLMCollectionViewLayoutDelegate, BLMTextInputCellDataSource, BehaviorCellDelegate, BLMButtonCellDataSource, BLMButtonCellDelegate>
+@interface BLMProjectDetailController () <UICollectionViewDataSource, BLMCollectionViewLayoutDelegate, BLMTextInputCellDataSource, BehaviorCellDelegate, BLMButtonCellDataSource, BLMButtonCellDelegate, BLMChangeFeedObserver, BLMSessionRecordingControllerDelegate>
 
 @property (nonatomic, strong, readonly) BLMCollectionView *collectionView;
-@property (nonatomic, strong, readonly) UILabel *instructionsLabel;
+@property (nonatomic, strong, readonly) BLMMeasuredLabel *instructionsLabel;
 @property (nonatomic, assign, readonly) NSRange instructionsLabelClickableRange;
-@property (nonatomic, strong) NSUUID *addedBehaviorUUID;
+@property (nonatomic, strong) BLMBehavior *addedBehavior; // Drafted in the row after the configuration's behaviors; only created in the data model once its name is committed
+@property (nonatomic, strong, readonly) NSUUID *addedBehaviorUUID;
+@property (nonatomic, assign, getter=isSessionDataLoaded) BOOL sessionDataLoaded;
 
 @end
 
 
 @implementation BLMProjectDetailController
 
++ (void)prewarmImageCache {
+    [[BLMImageCache sharedCache] prewarmWithBlock:^{
+        for (UIColor *borderColor in @[[BLMViewUtils colorForHexCode:BLMColorHexCodeBlue], [BLMCollectionViewCell errorColor]]) {
+            [BehaviorCellBorderView borderImageWithColor:borderColor];
+        }
+
+        for (NSNumber *state in @[@(UIControlStateNormal), @(UIControlStateSelected)]) {
+            [BehaviorCell deleteButtonImageForState:state.unsignedIntegerValue];
+            [BLMProjectDetailController addBehaviorButtonImageForState:state.unsignedIntegerValue];
+        }
+    }];
+}
+
+
 - (instancetype)initWithProjectUUID:(NSUUID *)projectUUID delegate:(id<BLMProjectDetailControllerDelegate>)delegate {
     assert(delegate != nil);
 
@@ -419,7 +457,11 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
 
 - (void)dealloc {
-    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [[BLMDataManager sharedManager].changeFeed removeObserver:self];
+
+    if ((self.projectUUID != nil) && self.isViewLoaded) {
+        [[BLMDataManager sharedManager] relinquishSessionDataForProjectUUID:self.projectUUID];
+    }
 }
 
 
@@ -431,7 +473,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     self.view.backgroundColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeDefaultBackground];
 
     if (self.projectUUID == nil) {
-        _instructionsLabel = [[UILabel alloc] init];
+        _instructionsLabel = [[BLMMeasuredLabel alloc] init];
 
         [self.instructionsLabel setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisVertical];
         [self.instructionsLabel setContentHuggingPriority:UILayoutPriorityRequired forAxis:UILayoutConstraintAxisHorizontal];
@@ -486,10 +528,13 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
         [self.view addSubview:self.collectionView];
         [self.view addConstraints:[BLMViewUtils constraintsForItem:self.collectionView equalToItem:self.view]];
 
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleProjectUpdated:) name:BLMProjectUpdatedNotification object:self.project];
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleSessionConfigurationUpdated:) name:BLMSessionConfigurationUpdatedNotification object:self.projectSessionConfiguration];
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleBehaviorUpdated:) name:BLMBehaviorUpdatedNotification object:nil];
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleBehaviorDeleted:) name:BLMBehaviorDeletedNotification object:nil];
+        [self.collectionView prefetchTextMeasurementsForSections:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, SectionCount)]];
+        [self updateChangeFeedRegistrations];
+
+        [[BLMDataManager sharedManager] loadSessionDataForProjectUUID:self.projectUUID completion:^{
+            self.sessionDataLoaded = YES;
+            [self.collectionView reloadSections:[NSIndexSet indexSetWithIndex:SectionSessions]];
+        }];
     }
 }
 
@@ -497,14 +542,10 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 - (void)viewDidDisappear:(BOOL)animated {
     [super viewDidDisappear:animated];
 
-    if (self.addedBehaviorUUID != nil) {
-        BLMBehavior *addedBehavior = [[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID];
-
-        if ([self isBehaviorName:addedBehavior.name validForUUID:self.addedBehaviorUUID]) {
-            [self updateProjectSessionConfigurationWithAddedBehaviorUUID];
-        } else {
-            [[BLMDataManager sharedManager] deleteBehaviorForUUID:self.addedBehaviorUUID completion:nil];
-        }
+    if ((self.addedBehavior != nil)
+        && ([[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID] == nil) // Otherwise already committed, and waiting for the change to be delivered
+        && [self isBehaviorName:self.addedBehavior.name validForUUID:self.addedBehaviorUUID]) { // An invalid draft was never in the data model, so there is nothing to delete
+        [self commitAddedBehaviorWithName:self.addedBehavior.name];
     }
 }
 
@@ -515,9 +556,9 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     if (self.instructionsLabel != nil) {
         assert(self.projectUUID == nil);
 
-        self.instructionsLabel.preferredMaxLayoutWidth = CGRectGetWidth([self.instructionsLabel alignmentRectForFrame:self.instructionsLabel.frame]);
-
-        [self.view layoutIfNeeded];
+        if ([self.instructionsLabel updatePreferredMaxLayoutWidth]) {
+            [self.view layoutIfNeeded];
+        }
     }
 }
 
@@ -533,6 +574,16 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 }
 
 
+- (NSOrderedSet<NSUUID *> *)loadedSessionUUIDs { // Empty until the project's sessions have been faulted in
+    return (self.isSessionDataLoaded ? self.project.sessionUUIDs : [NSOrderedSet orderedSet]);
+}
+
+
+- (NSUUID *)addedBehaviorUUID {
+    return self.addedBehavior.UUID;
+}
+
+
 - (BOOL)isBehaviorName:(NSString *)name validForUUID:(NSUUID *)UUID {
     NSString *lowercaseName = [name.lowercaseString stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
 
@@ -540,27 +591,108 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
         return NO;
     }
 
-    for (BLMBehavior *behavior in [NSEnumerator behaviorEnumeratorForUUIDs:self.projectSessionConfiguration.behaviorUUIDs dataManager:[BLMDataManager sharedManager]]) {
-        if (![BLMUtils isObject:behavior.UUID equalToObject:UUID] && [BLMUtils isString:lowercaseName equalToString:behavior.name.lowercaseString]) {
-            return NO;
-        }
-    }
+    NSSet<NSUUID *> *sameNameUUIDs = [[BLMDataManager sharedManager] behaviorUUIDsWithName:lowercaseName inSessionConfigurationUUID:self.project.sessionConfigurationUUID];
 
-    return YES;
+    return ((sameNameUUIDs.count == 0) || ((sameNameUUIDs.count == 1) && [sameNameUUIDs containsObject:UUID]));
 }
 
 
-- (void)updateProjectSessionConfigurationWithAddedBehaviorUUID {
-    assert(self.addedBehaviorUUID != nil);
+- (void)commitAddedBehaviorWithName:(NSString *)name { // Creates the drafted behavior with its name and adds it to the project's session configuration in one transaction
+    assert(self.addedBehavior != nil);
+    assert([[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID] == nil);
     assert(![self.projectSessionConfiguration.behaviorUUIDs containsObject:self.addedBehaviorUUID]);
-    assert([self isBehaviorName:[[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID].name validForUUID:self.addedBehaviorUUID]);
+    assert([self isBehaviorName:name validForUUID:self.addedBehaviorUUID]);
 
+    BLMBehavior *addedBehavior = self.addedBehavior;
     BLMSessionConfiguration *sessionConfiguration = self.projectSessionConfiguration;
-    NSOrderedSet *updatedBehaviorUUIDs = [sessionConfiguration.behaviorUUIDs orderedSetByAddingObject:self.addedBehaviorUUID];
+    NSOrderedSet *updatedBehaviorUUIDs = [sessionConfiguration.behaviorUUIDs orderedSetByAddingObject:addedBehavior.UUID];
+
+    [[BLMDataManager sharedManager] performTransaction:^(BLMDataManagerTransaction *transaction) {
+        [transaction createBehaviorWithUUID:addedBehavior.UUID name:name continuous:addedBehavior.isContinuous];
+        [transaction updateSessionConfigurationForUUID:sessionConfiguration.UUID property:BLMSessionConfigurationPropertyBehaviorUUIDs value:updatedBehaviorUUIDs];
+    } completion:nil];
+}
+
+
+- (void)discardAddedBehavior {
+    assert(self.addedBehavior != nil);
+
+    NSOrderedSet<NSUUID *> *behaviorUUIDs = self.projectSessionConfiguration.behaviorUUIDs;
+
+    self.addedBehavior = nil;
+
+    [self.collectionView performBatchUpdates:^{
+        [self.collectionView deleteItemsAtIndexPaths:@[[NSIndexPath indexPathForItem:behaviorUUIDs.count inSection:SectionBehaviors]]];
+        [self.collectionView reloadItemsAtIndexPaths:@[[self indexPathForAddBehaviorButtonCell]]];
+    } completion:^(BOOL finished) {
+        assert(finished);
+    }];
+}
+
+
+- (void)createSessionFromCurrentConfiguration { // The session gets its own copy of the configuration, so later edits to the project don't rewrite what was recorded
+    assert(self.isSessionDataLoaded);
+
+    BLMProject *project = self.project;
+    BLMSessionConfiguration *projectSessionConfiguration = self.projectSessionConfiguration;
+    NSString *name = [NSString stringWithFormat:@"%@-%@-%@", project.client, project.name, (projectSessionConfiguration.observer ?: @"<no_observer>")];
+    __block NSUUID *sessionUUID = nil;
 
-    [[BLMDataManager sharedManager] updateSessionConfigurationForUUID:sessionConfiguration.UUID property:BLMSessionConfigurationPropertyBehaviorUUIDs value:updatedBehaviorUUIDs completion:nil];
+    [[BLMDataManager sharedManager] performTransaction:^(BLMDataManagerTransaction *transaction) { // One archive write and one change set, rather than one per object
+        BLMSessionConfiguration *sessionConfiguration = [transaction createSessionConfigurationWithCondition:projectSessionConfiguration.condition location:projectSessionConfiguration.location therapist:projectSessionConfiguration.therapist observer:projectSessionConfiguration.observer timeLimit:projectSessionConfiguration.timeLimit timeLimitOptions:projectSessionConfiguration.timeLimitOptions behaviorUUIDs:projectSessionConfiguration.behaviorUUIDs];
+        sessionUUID = [transaction createSessionWithName:name configurationUUID:sessionConfiguration.UUID].UUID;
 
-    assert(self.addedBehaviorUUID == nil);
+        NSOrderedSet<NSUUID *> *updatedSessionUUIDs = ((project.sessionUUIDs != nil) ? [project.sessionUUIDs orderedSetByAddingObject:sessionUUID] : [NSOrderedSet orderedSetWithObject:sessionUUID]);
+        [transaction updateProjectForUUID:self.projectUUID property:BLMProjectPropertySessionUUIDs value:updatedSessionUUIDs];
+    } completion:nil];
+
+    assert(sessionUUID != nil);
+
+    BLMSessionRecordingController *recordingController = [[BLMSessionRecordingController alloc] initWithSessionUUID:sessionUUID delegate:self];
+    [self.navigationController pushViewController:recordingController animated:YES];
+}
+
+
+- (void)presentAfterNavigationTransition:(dispatch_block_t)presentation { // Presenting while the recording controller is still being popped would be dropped
+    id<UIViewControllerTransitionCoordinator> transitionCoordinator = self.navigationController.transitionCoordinator;
+
+    if (transitionCoordinator == nil) {
+        presentation();
+        return;
+    }
+
+    [transitionCoordinator animateAlongsideTransition:nil completion:^(id<UIViewControllerTransitionCoordinatorContext> context) {
+        presentation();
+    }];
+}
+
+
+- (void)shareLatencyHistogramAtURL:(NSURL *)URL { // The temporary file is removed once the share sheet is dismissed, whether or not it was shared
+    UIActivityViewController *activityController = [[UIActivityViewController alloc] initWithActivityItems:@[URL] applicationActivities:nil];
+
+    activityController.completionWithItemsHandler = ^(NSString *activityType, BOOL completed, NSArray *returnedItems, NSError *activityError) {
+        [[NSFileManager defaultManager] removeItemAtURL:URL error:NULL];
+    };
+
+    activityController.popoverPresentationController.sourceView = self.view; // Always a popover on iPad
+    activityController.popoverPresentationController.sourceRect = CGRectMake(CGRectGetMidX(self.view.bounds), CGRectGetMidY(self.view.bounds), 0.0, 0.0);
+    activityController.popoverPresentationController.permittedArrowDirections = 0;
+
+    [self presentViewController:activityController animated:YES completion:nil];
+}
+
+
+- (void)updateChangeFeedRegistrations { // Only the project, its session configuration and that configuration's behaviors, so changes elsewhere in the data model never reach this controller
+    BLMChangeFeed *changeFeed = [BLMDataManager sharedManager].changeFeed;
+    BLMProject *project = self.project;
+
+    [changeFeed removeObserver:self];
+    [changeFeed addObserver:self forUUID:self.projectUUID kind:BLMArchiveEntityKindProject];
+    [changeFeed addObserver:self forUUID:project.sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    for (NSUUID *UUID in self.projectSessionConfiguration.behaviorUUIDs) {
+        [changeFeed addObserver:self forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+    }
 }
 
 
@@ -575,35 +707,112 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     return [NSIndexPath indexPathForItem:cellItem inSection:SectionSessions];
 }
 
-#pragma mark Event Handling
 
-- (void)handleProjectUpdated:(NSNotification *)notification {
-    BLMProject *original = (BLMProject *)notification.userInfo[BLMProjectOriginalProjectUserInfoKey];
-    assert(original == notification.object);
+- (NSString *)headerTitleForSection:(Section)section {
+    switch (section) {
+        case SectionSessionProperties:
+            return @"Default Session Properties";
 
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:BLMProjectUpdatedNotification object:original];
+        case SectionBehaviors:
+            return @"Behaviors";
 
-    BLMProject *updated = (BLMProject *)notification.userInfo[BLMProjectUpdatedProjectUserInfoKey];
-    assert(updated == self.project);
+        case SectionSessions:
+            return @"Sessions";
 
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleProjectUpdated:) name:BLMProjectUpdatedNotification object:updated];
+        case SectionBasicProperties:
+        case SectionActionButtons:
+        case SectionCount: {
+            assert(NO);
+            return nil;
+        }
+    }
+}
 
-    if (![BLMUtils isObject:original.sessionConfigurationUUID equalToObject:updated.sessionConfigurationUUID]) {
-        [self.collectionView reloadSections:[NSIndexSet indexSetWithIndex:SectionBehaviors]];
+
+- (NSString *)labelTextForItem:(NSInteger)item inSection:(Section)section {
+    switch (section) {
+        case SectionBasicProperties: {
+            switch ((BasicInfo)item) {
+                case BasicInfoProjectName:
+                    return @"Project:";
+
+                case BasicInfoClientName:
+                    return @"Client:";
+
+                case BasicInfoCount: {
+                    assert(NO);
+                    return nil;
+                }
+            }
+        }
+
+        case SectionSessionProperties: {
+            switch ((SessionConfigurationInfo)item) {
+                case SessionConfigurationInfoCondition:
+                    return @"Condition:";
+
+                case SessionConfigurationInfoLocation:
+                    return @"Location:";
+
+                case SessionConfigurationInfoTherapist:
+                    return @"Therapist:";
+
+                case SessionConfigurationInfoObserver:
+                    return @"Observer:";
+
+                case SessionConfigurationInfoCount: {
+                    assert(NO);
+                    return nil;
+                }
+            }
+        }
+
+        case SectionBehaviors:
+            if (item < ([self.collectionView numberOfItemsInSection:SectionBehaviors] - 1)) {
+                return @"Name:";
+            }
+
+        case SectionSessions:
+        case SectionActionButtons:
+            return nil;
+
+        case SectionCount: {
+            assert(NO);
+            return nil;
+        }
     }
 }
 
 
-- (void)handleSessionConfigurationUpdated:(NSNotification *)notification {
-    BLMSessionConfiguration *original = (BLMSessionConfiguration *)notification.userInfo[BLMSessionConfigurationOriginalSessionConfigurationUserInfoKey];
-    assert(original == notification.object);
++ (UIImage *)addBehaviorButtonImageForState:(UIControlState)state {
+    return [BLMViewUtils plusSignImageWithColor:[BLMViewUtils colorForHexCode:((state == UIControlStateNormal) ? BLMColorHexCodeGreen : BLMColorHexCodePurple)]];
+}
 
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:BLMSessionConfigurationUpdatedNotification object:original];
 
-    BLMSessionConfiguration *updated = (BLMSessionConfiguration *)notification.userInfo[BLMSessionConfigurationUpdatedSessionConfigurationUserInfoKey];
-    assert(updated == self.projectSessionConfiguration);
++ (NSAttributedString *)addBehaviorButtonTitleForState:(UIControlState)state {
+    UIColor *titleColor = [BLMViewUtils colorForHexCode:((state == UIControlStateNormal) ? BLMColorHexCodeGreen : BLMColorHexCodePurple)];
+    NSDictionary *attributes = @{ NSForegroundColorAttributeName:titleColor, NSFontAttributeName:[UIFont boldSystemFontOfSize:20.0] };
+
+    return [[NSAttributedString alloc] initWithString:@"Add Behavior" attributes:attributes];
+}
+
+#pragma mark Event Handling
+
+- (void)handleProjectUpdatedFromOriginal:(BLMProject *)original toUpdated:(BLMProject *)updated {
+    assert(updated == self.project);
 
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleSessionConfigurationUpdated:) name:BLMSessionConfigurationUpdatedNotification object:updated];
+    if (![BLMUtils isObject:original.sessionConfigurationUUID equalToObject:updated.sessionConfigurationUUID]) {
+        [self.collectionView reloadSections:[NSIndexSet indexSetWithIndex:SectionBehaviors]];
+    }
+
+    if (self.isSessionDataLoaded && ![BLMUtils isOrderedSet:original.sessionUUIDs equalToOrderedSet:updated.sessionUUIDs]) {
+        [self.collectionView reloadSections:[NSIndexSet indexSetWithIndex:SectionSessions]];
+    }
+}
+
+
+- (void)handleSessionConfigurationUpdatedFromOriginal:(BLMSessionConfiguration *)original toUpdated:(BLMSessionConfiguration *)updated {
+    assert(updated == self.projectSessionConfiguration);
 
     if ([BLMUtils isOrderedSet:original.behaviorUUIDs equalToOrderedSet:updated.behaviorUUIDs]) {
         return;
@@ -627,7 +836,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
         if (addedBehaviorUUIDIndex != NSNotFound) {
             [reloadedIndexPaths addObject:[NSIndexPath indexPathForItem:addedBehaviorUUIDIndex inSection:SectionBehaviors]];
-            self.addedBehaviorUUID = nil;
+            self.addedBehavior = nil;
         }
 
         NSMutableArray<NSIndexPath *> *insertedIndexPaths = [NSMutableArray array];
@@ -647,54 +856,24 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 }
 
 
-- (void)handleBehaviorUpdated:(NSNotification *)notification {
-    BLMBehavior *behavior = (BLMBehavior *)notification.object;
-    BOOL updatedBehaviorIsAddedBehavior = [BLMUtils isObject:behavior.UUID equalToObject:self.addedBehaviorUUID];
-    NSOrderedSet<NSUUID *> *behaviorUUIDs = self.projectSessionConfiguration.behaviorUUIDs;
-
-    if ((self.addedBehaviorUUID == nil)
-        || (!updatedBehaviorIsAddedBehavior
-            && ![behaviorUUIDs containsObject:behavior.UUID])) { // Currently only interested in updates that impact the added behavior's validity so we know when to reload the add behavior button cell
+- (void)handleBehaviorUpdatedFromOriginal:(BLMBehavior *)behavior {
+    if ((self.addedBehavior == nil)
+        || ([[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID] != nil)
+        || ![self.projectSessionConfiguration.behaviorUUIDs containsObject:behavior.UUID]) { // Currently only interested in renames that make the drafted behavior's name valid
         return;
     }
 
-    BLMBehavior *addedBehavior = [[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID];
-    BOOL isAddedBehaviorNameValid = [self isBehaviorName:addedBehavior.name validForUUID:self.addedBehaviorUUID];
-    BOOL wasAddedBehaviorNameValid = NO; // The added behavior name must have been invalid the last time its cell lost focus, otherwise its UUID would be in the project's default session configuration
-
-    if (updatedBehaviorIsAddedBehavior) {
-        wasAddedBehaviorNameValid = [self isBehaviorName:behavior.name validForUUID:self.addedBehaviorUUID];
-    }
-
-    if (wasAddedBehaviorNameValid == isAddedBehaviorNameValid) { // Reload only when the validity of the added behavior's name changes to avoid strobing of the add behavior button cell image
-        return;
-    }
-
-    if (updatedBehaviorIsAddedBehavior) { // Enable the add behavior button cell, but don't reload the added behavior cell or it will lose its first responder status; its own notification handler will update its UI
-        [self.collectionView reloadItemsAtIndexPaths:@[[self indexPathForAddBehaviorButtonCell]]];
-    } else if (isAddedBehaviorNameValid) {
-        [self updateProjectSessionConfigurationWithAddedBehaviorUUID];
+    if ([self isBehaviorName:self.addedBehavior.name validForUUID:self.addedBehaviorUUID]) { // The draft's name must have been invalid the last time its cell lost focus, otherwise it would have been committed
+        [self commitAddedBehaviorWithName:self.addedBehavior.name];
     }
 }
 
 
-- (void)handleBehaviorDeleted:(NSNotification *)notification {
-    BLMBehavior *behavior = (BLMBehavior *)notification.object;
+- (void)handleBehaviorDeletedForOriginal:(BLMBehavior *)behavior {
     BLMSessionConfiguration *sessionConfiguration = self.projectSessionConfiguration;
     NSOrderedSet<NSUUID *> *behaviorUUIDs = sessionConfiguration.behaviorUUIDs;
 
-    if ([BLMUtils isObject:behavior.UUID equalToObject:self.addedBehaviorUUID]) {
-        assert(![behaviorUUIDs containsObject:self.addedBehaviorUUID]);
-
-        self.addedBehaviorUUID = nil;
-
-        [self.collectionView performBatchUpdates:^{
-            [self.collectionView deleteItemsAtIndexPaths:@[[NSIndexPath indexPathForItem:behaviorUUIDs.count inSection:SectionBehaviors]]];
-            [self.collectionView reloadItemsAtIndexPaths:@[[self indexPathForAddBehaviorButtonCell]]];
-        } completion:^(BOOL finished) {
-            assert(finished);
-        }];
-    } else if ([behaviorUUIDs containsObject:behavior.UUID]) {
+    if ([behaviorUUIDs containsObject:behavior.UUID]) {
         NSOrderedSet<NSUUID *> *updatedBehaviorUUIDs = [behaviorUUIDs orderedSetByRemovingObject:behavior.UUID];
         [[BLMDataManager sharedManager] updateSessionConfigurationForUUID:sessionConfiguration.UUID property:BLMSessionConfigurationPropertyBehaviorUUIDs value:updatedBehaviorUUIDs completion:nil];
     }
@@ -722,6 +901,57 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     }
 }
 
+#pragma mark BLMSessionRecordingControllerDelegate
+
+- (void)sessionRecordingControllerDidFinish:(BLMSessionRecordingController *)controller {
+    NSURL *URL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"Latency-%@.csv", controller.sessionUUID.UUIDString]]]; // Shared from a temporary file, so the histogram can be retrieved without exposing Documents
+    NSError *error = nil;
+    BOOL written = [[controller.latencyHistogram CSVRepresentation] writeToURL:URL atomically:YES encoding:NSUTF8StringEncoding error:&error];
+
+    [self.navigationController popToViewController:self animated:YES];
+
+    [self presentAfterNavigationTransition:^{
+        if (written) {
+            [self shareLatencyHistogramAtURL:URL];
+        } else {
+            UIAlertController *alertController = [UIAlertController alertControllerWithTitle:@"Error" message:[NSString stringWithFormat:@"Failed to export latency histogram!\n%@", error.localizedDescription] preferredStyle:UIAlertControllerStyleAlert];
+            [alertController addAction:[UIAlertAction actionWithTitle:@"Ok" style:UIAlertActionStyleDefault handler:nil]];
+
+            [self presentViewController:alertController animated:YES completion:nil];
+        }
+    }];
+}
+
+#pragma mark BLMChangeFeedObserver
+
+- (void)changeFeed:(BLMChangeFeed *)changeFeed didDeliverChangeSet:(BLMChangeSet *)changeSet { // The project and its configuration first, so the rows match the data model before behavior changes are acted on; anything those handlers change arrives in a following change set
+    if (self.project == nil) { // Deleted; the project menu is about to replace this controller
+        return;
+    }
+
+    BLMProject *originalProject = [changeSet originalObjectForUUID:self.projectUUID kind:BLMArchiveEntityKindProject];
+
+    if (originalProject != nil) {
+        [self handleProjectUpdatedFromOriginal:originalProject toUpdated:self.project];
+    }
+
+    BLMSessionConfiguration *originalSessionConfiguration = [changeSet originalObjectForUUID:self.project.sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    if ((originalSessionConfiguration != nil) && (self.projectSessionConfiguration != nil)) {
+        [self handleSessionConfigurationUpdatedFromOriginal:originalSessionConfiguration toUpdated:self.projectSessionConfiguration];
+    }
+
+    for (NSUUID *UUID in [changeSet UUIDsForKind:BLMArchiveEntityKindBehavior changeType:BLMChangeTypeUpdated]) {
+        [self handleBehaviorUpdatedFromOriginal:[changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindBehavior]];
+    }
+
+    for (NSUUID *UUID in [changeSet UUIDsForKind:BLMArchiveEntityKindBehavior changeType:BLMChangeTypeDeleted]) {
+        [self handleBehaviorDeletedForOriginal:[changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindBehavior]];
+    }
+
+    [self updateChangeFeedRegistrations];
+}
+
 #pragma mark UICollectionViewDataSource
 
 - (NSInteger)numberOfSectionsInCollectionView:(UICollectionView *)collectionView {
@@ -740,15 +970,15 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
         case SectionBehaviors: {
             NSInteger itemCount = self.projectSessionConfiguration.behaviorUUIDs.count;
 
-            if (self.addedBehaviorUUID != nil) {
-                itemCount += 1; // +1 for the BLMBehavior that's been added to the data model but not to a session configuration
+            if (self.addedBehavior != nil) {
+                itemCount += 1; // +1 for the drafted BLMBehavior that hasn't been added to the data model yet
             }
 
             return (itemCount + 1); // +1 for the "add behavior" button cell
         }
 
         case SectionSessions:
-            return (self.project.sessionUUIDs.count + 1); // +1 for the "begin session" button cell
+            return (self.loadedSessionUUIDs.count + 1); // +1 for the "begin session" button cell
 
         case SectionActionButtons:
             return ActionButtonCount;
@@ -783,8 +1013,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
                 behaviorCell.dataSource = self;
                 behaviorCell.delegate = self;
 
-                NSUUID *behaviorUUID = ((indexPath.item < behaviorUUIDs.count) ? behaviorUUIDs[indexPath.item] : self.addedBehaviorUUID);
-                behaviorCell.behavior = [[BLMDataManager sharedManager] behaviorForUUID:behaviorUUID];
+                behaviorCell.behavior = ((indexPath.item < behaviorUUIDs.count) ? [[BLMDataManager sharedManager] behaviorForUUID:behaviorUUIDs[indexPath.item]] : self.addedBehavior);
                 
                 cell = behaviorCell;
             } else {
@@ -833,29 +1062,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
         view = headerView;
 
-        switch ((Section)indexPath.section) {
-            case SectionSessionProperties: {
-                headerView.label.text = @"Default Session Properties";
-                break;
-            }
-
-            case SectionBehaviors: {
-                headerView.label.text = @"Behaviors";
-                break;
-            }
-
-            case SectionSessions: {
-                headerView.label.text = @"Sessions";
-                break;
-            }
-
-            case SectionBasicProperties:
-            case SectionActionButtons:
-            case SectionCount: {
-                assert(NO);
-                break;
-            }
-        }
+        headerView.label.text = [self headerTitleForSection:indexPath.section];
     } else if ([BLMUtils isString:kind equalToString:BLMCollectionViewKindFooter]) {
         view = [collectionView dequeueReusableSupplementaryViewOfKind:kind withReuseIdentifier:NSStringFromClass([BLMSectionSeparatorFooterView class]) forIndexPath:indexPath];
     } else if ([BLMUtils isString:kind equalToString:BLMCollectionViewKindItemAreaBackground]) {
@@ -1017,60 +1224,61 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     }
 }
 
-#pragma mark BLMCollectionViewCellDataSource
 
-- (NSString *)labelTextForCollectionViewCell:(BLMTextInputCell *)cell {
-    switch ((Section)cell.section) {
-        case SectionBasicProperties: {
-            switch ((BasicInfo)cell.item) {
-                case BasicInfoProjectName:
-                    return @"Project:";
+- (void)collectionView:(BLMCollectionView *)collectionView prefetchTextMeasurementsForSection:(NSUInteger)section {
+    BLMTextMeasurer *measurer = [BLMTextMeasurer sharedMeasurer];
+    NSMutableArray<NSString *> *labelTexts = [NSMutableArray array];
 
-                case BasicInfoClientName:
-                    return @"Client:";
+    switch ((Section)section) {
+        case SectionBasicProperties:
+        case SectionSessionProperties:
+        case SectionBehaviors: {
+            for (NSInteger item = 0; item < [self collectionView:collectionView numberOfItemsInSection:section]; item += 1) { // The data source, since this may be sent inside a batch update
+                NSString *labelText = [self labelTextForItem:item inSection:section];
 
-                case BasicInfoCount: {
-                    assert(NO);
-                    return nil;
+                if ((labelText != nil) && ![labelTexts containsObject:labelText]) {
+                    [labelTexts addObject:labelText];
                 }
             }
-        }
-
-        case SectionSessionProperties: {
-            switch ((SessionConfigurationInfo)cell.item) {
-                case SessionConfigurationInfoCondition:
-                    return @"Condition:";
-
-                case SessionConfigurationInfoLocation:
-                    return @"Location:";
 
-                case SessionConfigurationInfoTherapist:
-                    return @"Therapist:";
-
-                case SessionConfigurationInfoObserver:
-                    return @"Observer:";
-
-                case SessionConfigurationInfoCount: {
-                    assert(NO);
-                    return nil;
-                }
-            }
+            break;
         }
 
-        case SectionBehaviors:
-            if (cell.item < ([self.collectionView numberOfItemsInSection:SectionBehaviors] - 1)) {
-                return @"Name:";
-            }
-
         case SectionSessions:
         case SectionActionButtons:
-            return nil;
+            break;
 
         case SectionCount: {
             assert(NO);
-            return nil;
+            break;
         }
     }
+
+    if (section == SectionBehaviors) {
+        [labelTexts addObject:BehaviorCellToggleSwitchLabelText];
+        [measurer prefetchSizesForAttributedTexts:@[[BLMProjectDetailController addBehaviorButtonTitleForState:UIControlStateNormal], [BLMProjectDetailController addBehaviorButtonTitleForState:UIControlStateHighlighted]] width:BLMTextMeasurerUnboundedWidth];
+    }
+
+    [measurer prefetchSizesForTexts:labelTexts font:[BLMCollectionViewCell labelFont] width:BLMTextMeasurerUnboundedWidth];
+
+    switch ((Section)section) {
+        case SectionSessionProperties:
+        case SectionBehaviors:
+        case SectionSessions:
+            [measurer prefetchSizesForTexts:@[[self headerTitleForSection:section]] font:[BLMSectionHeaderView labelFont] width:BLMTextMeasurerUnboundedWidth];
+            break;
+
+        case SectionBasicProperties:
+        case SectionActionButtons:
+        case SectionCount:
+            break;
+    }
+}
+
+#pragma mark BLMCollectionViewCellDataSource
+
+- (NSString *)labelTextForCollectionViewCell:(BLMTextInputCell *)cell {
+    return [self labelTextForItem:cell.item inSection:cell.section];
 }
 
 
@@ -1136,6 +1344,10 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
             BehaviorCell *behaviorCell = (BehaviorCell *)cell;
             NSUUID *UUID = behaviorCell.behavior.UUID;
 
+            if ([BLMUtils isObject:UUID equalToObject:self.addedBehaviorUUID]) {
+                return self.addedBehavior.name;
+            }
+
             return [[BLMDataManager sharedManager] behaviorForUUID:UUID].name;
         }
 
@@ -1221,8 +1433,15 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
             BehaviorCell *behaviorCell = (BehaviorCell *)cell;
             NSUUID *UUID = behaviorCell.behavior.UUID;
 
-            if ([BLMUtils isObject:UUID equalToObject:self.addedBehaviorUUID]) { // Update the added behavior on every cell text change, but ignore established behaviors' cells until they call didAcceptInputForTextInputCell:
-                [[BLMDataManager sharedManager] updateBehaviorForUUID:UUID property:BLMBehaviorPropertyName value:cell.textField.text completion:nil];
+            if ([BLMUtils isObject:UUID equalToObject:self.addedBehaviorUUID]) { // Update the draft on every cell text change, but ignore established behaviors' cells until they call didAcceptInputForTextInputCell:
+                BOOL wasAddedBehaviorNameValid = [self isBehaviorName:self.addedBehavior.name validForUUID:UUID];
+
+                self.addedBehavior = [self.addedBehavior copyWithUpdatedValuesByProperty:@{ @(BLMBehaviorPropertyName):(cell.textField.text ?: @"") }];
+                behaviorCell.behavior = self.addedBehavior;
+
+                if (wasAddedBehaviorNameValid != [self isBehaviorName:self.addedBehavior.name validForUUID:UUID]) { // Reload only when the validity changes to avoid strobing of the add behavior button cell image; the draft's own cell keeps first responder status
+                    [self.collectionView reloadItemsAtIndexPaths:@[[self indexPathForAddBehaviorButtonCell]]];
+                }
             }
 
             [behaviorCell updateBorderColor];
@@ -1339,15 +1558,15 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
             BehaviorCell *behaviorCell = (BehaviorCell *)cell;
             NSUUID *UUID = behaviorCell.behavior.UUID;
 
-            assert([[BLMDataManager sharedManager] behaviorForUUID:UUID].isContinuous == behaviorCell.toggleSwitch.isOn);
+            assert(behaviorCell.behavior.isContinuous == behaviorCell.toggleSwitch.isOn);
 
             NSString *updatedName = cell.textField.text;
             assert([self isBehaviorName:updatedName validForUUID:UUID]);
 
-            [[BLMDataManager sharedManager] updateBehaviorForUUID:UUID property:BLMBehaviorPropertyName value:updatedName completion:nil];
-            
             if ([BLMUtils isObject:UUID equalToObject:self.addedBehaviorUUID]) {
-                [self updateProjectSessionConfigurationWithAddedBehaviorUUID];
+                [self commitAddedBehaviorWithName:updatedName];
+            } else {
+                [[BLMDataManager sharedManager] updateBehaviorForUUID:UUID property:BLMBehaviorPropertyName value:updatedName completion:nil];
             }
             break;
         }
@@ -1370,12 +1589,11 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     [UIView beginAnimations:nil context:NULL];
 
     NSUUID *cellBehaviorUUID = cell.behavior.UUID;
-    NSUUID *addedBehaviorUUID = self.addedBehaviorUUID;
 
     dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)([UIView inheritedAnimationDuration] * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{ // Wait until prior animations end (i.e. keyboard hiding) to avoid stuttering
-        if ([BLMUtils isObject:cellBehaviorUUID equalToObject:addedBehaviorUUID]) {
-            [[BLMDataManager sharedManager] deleteBehaviorForUUID:addedBehaviorUUID completion:nil];
-        } else {
+        if ([BLMUtils isObject:cellBehaviorUUID equalToObject:self.addedBehaviorUUID] && ([[BLMDataManager sharedManager] behaviorForUUID:cellBehaviorUUID] == nil)) { // Still a draft; ending editing may instead have committed it
+            [self discardAddedBehavior];
+        } else if ([self.projectSessionConfiguration.behaviorUUIDs containsObject:cellBehaviorUUID]) {
             BLMSessionConfiguration *sessionConfiguration = self.projectSessionConfiguration;
             NSOrderedSet *updatedBehaviorUUIDs = [sessionConfiguration.behaviorUUIDs orderedSetByRemovingObject:cellBehaviorUUID];
 
@@ -1388,6 +1606,12 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 
 
 - (void)didChangeToggleSwitchStateForBehaviorCell:(BehaviorCell *)cell {
+    if ([BLMUtils isObject:cell.behavior.UUID equalToObject:self.addedBehaviorUUID]) { // Recorded when the draft is committed
+        self.addedBehavior = [self.addedBehavior copyWithUpdatedValuesByProperty:@{ @(BLMBehaviorPropertyContinuous):@(cell.toggleSwitch.isOn) }];
+        cell.behavior = self.addedBehavior;
+        return;
+    }
+
     [[BLMDataManager sharedManager] updateBehaviorForUUID:cell.behavior.UUID property:BLMBehaviorPropertyContinuous value:@(cell.toggleSwitch.isOn) completion:nil];
 }
 
@@ -1396,8 +1620,8 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
 - (BOOL)isButtonEnabledForButtonCell:(BLMButtonCell *)cell {
     switch ((Section)cell.section) {
         case SectionBehaviors:
-            return ((self.addedBehaviorUUID == nil)
-                    || [self isBehaviorName:[[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID].name validForUUID:self.addedBehaviorUUID]);
+            return ((self.addedBehavior == nil)
+                    || [self isBehaviorName:self.addedBehavior.name validForUUID:self.addedBehaviorUUID]);
 
         case SectionSessions:
         case SectionActionButtons:
@@ -1418,16 +1642,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
         case SectionBehaviors: {
             assert(cell.item == self.indexPathForAddBehaviorButtonCell.item);
 
-            static UIImage *highlightedPlusSignImage = nil;
-            static UIImage *normalPlusSignImage = nil;
-            static dispatch_once_t onceToken = 0;
-
-            dispatch_once(&onceToken, ^{
-                highlightedPlusSignImage = [BLMViewUtils plusSignImageWithColor:[BLMViewUtils colorForHexCode:BLMColorHexCodePurple]];
-                normalPlusSignImage = [BLMViewUtils plusSignImageWithColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeGreen]];
-            });
-
-            return ((state == UIControlStateNormal) ? normalPlusSignImage : highlightedPlusSignImage);
+            return [BLMProjectDetailController addBehaviorButtonImageForState:state];
         }
 
         case SectionSessions:
@@ -1448,18 +1663,14 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
     switch ((Section)cell.section) {
         case SectionBehaviors: {
             assert(cell.item == self.indexPathForAddBehaviorButtonCell.item);
-
-            UIColor *titleColor = [BLMViewUtils colorForHexCode:((state == UIControlStateNormal) ? BLMColorHexCodeGreen : BLMColorHexCodePurple)];
-            NSDictionary *attributes = @{ NSForegroundColorAttributeName:titleColor, NSFontAttributeName:[UIFont boldSystemFontOfSize:20.0] };
-
-            return [[NSAttributedString alloc] initWithString:@"Add Behavior" attributes:attributes];
+            return [BLMProjectDetailController addBehaviorButtonTitleForState:state];
         }
 
         case SectionSessions: {
             NSString *title;
             UIFont *titleFont;
             BLMColorHexCode titleColorHexCode;
-            NSOrderedSet *sessionUUIDs = self.project.sessionUUIDs;
+            NSOrderedSet *sessionUUIDs = self.loadedSessionUUIDs;
 
             if (cell.item < sessionUUIDs.count) {
                 NSUUID *UUID = sessionUUIDs[cell.item];
@@ -1521,51 +1732,46 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
         case SectionBehaviors: {
             assert(cell.item == ([self.collectionView numberOfItemsInSection:SectionBehaviors] - 1));
 
-            if (self.addedBehaviorUUID != nil) { // There is a valid behavior item that has not been officially added to the data model
+            if (self.addedBehavior != nil) { // There is a valid drafted behavior that has not been added to the data model
                 NSOrderedSet<NSUUID *> *behaviorUUIDs = self.projectSessionConfiguration.behaviorUUIDs;
                 NSIndexPath *addedBehaviorIndexPath = [NSIndexPath indexPathForItem:behaviorUUIDs.count inSection:SectionBehaviors];
                 BehaviorCell *addedBehaviorCell = (BehaviorCell *)[self.collectionView cellForItemAtIndexPath:addedBehaviorIndexPath];
 
-                assert([BLMUtils isString:addedBehaviorCell.textField.text equalToString:addedBehaviorCell.behavior.name]);
+                assert([BLMUtils isString:addedBehaviorCell.textField.text equalToString:self.addedBehavior.name]);
                 assert([self isBehaviorName:addedBehaviorCell.textField.text validForUUID:self.addedBehaviorUUID]);
-                assert([BLMUtils isObject:[[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID] equalToObject:addedBehaviorCell.behavior]);
+                assert([BLMUtils isObject:self.addedBehavior equalToObject:addedBehaviorCell.behavior]);
                 assert(addedBehaviorCell.textField.isFirstResponder); // The "add behavior" must have been enabled in response to the added behavior cell's text becoming valid.
 
                 [addedBehaviorCell.textField resignFirstResponder]; // Resign first responder to force update the data model
+                [[BLMDataManager sharedManager].changeFeed deliverPendingChanges]; // The committed behavior's rows must be in place before another is added
             }
 
-            assert(self.addedBehaviorUUID == nil);
-
-            [[BLMDataManager sharedManager] createBehaviorWithName:@"" continuous:NO completion:^(BLMBehavior *behavior, NSError *error) {
-                if (error != nil) {
-                    return;
-                }
+            assert(self.addedBehavior == nil);
 
-                self.addedBehaviorUUID = behavior.UUID;
+            self.addedBehavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"" continuous:NO]; // Only drafted here; it is created in the data model when its name is committed
 
-                NSOrderedSet<NSUUID *> *behaviorUUIDs = self.projectSessionConfiguration.behaviorUUIDs;
-                NSIndexPath *addedBehaviorIndexPath = [NSIndexPath indexPathForItem:behaviorUUIDs.count inSection:SectionBehaviors];
+            NSOrderedSet<NSUUID *> *behaviorUUIDs = self.projectSessionConfiguration.behaviorUUIDs;
+            NSIndexPath *addedBehaviorIndexPath = [NSIndexPath indexPathForItem:behaviorUUIDs.count inSection:SectionBehaviors];
 
-                [self.collectionView performBatchUpdates:^{
-                    [self.collectionView insertItemsAtIndexPaths:@[addedBehaviorIndexPath]];
-                } completion:^(BOOL finished) {
-                    [self.collectionView reloadItemsAtIndexPaths:@[[NSIndexPath indexPathForItem:(behaviorUUIDs.count + 1) inSection:SectionBehaviors]]];
-                    [self.collectionView scrollToItemAtIndexPath:addedBehaviorIndexPath atScrollPosition:UICollectionViewScrollPositionTop animated:YES];
+            [self.collectionView performBatchUpdates:^{
+                [self.collectionView insertItemsAtIndexPaths:@[addedBehaviorIndexPath]];
+            } completion:^(BOOL finished) {
+                [self.collectionView reloadItemsAtIndexPaths:@[[NSIndexPath indexPathForItem:(behaviorUUIDs.count + 1) inSection:SectionBehaviors]]];
+                [self.collectionView scrollToItemAtIndexPath:addedBehaviorIndexPath atScrollPosition:UICollectionViewScrollPositionTop animated:YES];
 
-                    BehaviorCell *addedBehaviorCell = (BehaviorCell *)[self.collectionView cellForItemAtIndexPath:addedBehaviorIndexPath];
-                    assert([BLMUtils isObject:[[BLMDataManager sharedManager] behaviorForUUID:self.addedBehaviorUUID] equalToObject:addedBehaviorCell.behavior]);
+                BehaviorCell *addedBehaviorCell = (BehaviorCell *)[self.collectionView cellForItemAtIndexPath:addedBehaviorIndexPath];
+                assert([BLMUtils isObject:self.addedBehavior equalToObject:addedBehaviorCell.behavior]);
 
-                    [addedBehaviorCell.textField becomeFirstResponder];
+                [addedBehaviorCell.textField becomeFirstResponder];
 
-                    UITextRange *selectedTextRange = [addedBehaviorCell.textField textRangeFromPosition:addedBehaviorCell.textField.beginningOfDocument toPosition:addedBehaviorCell.textField.endOfDocument];
-                    addedBehaviorCell.textField.selectedTextRange = selectedTextRange;
-                }];
+                UITextRange *selectedTextRange = [addedBehaviorCell.textField textRangeFromPosition:addedBehaviorCell.textField.beginningOfDocument toPosition:addedBehaviorCell.textField.endOfDocument];
+                addedBehaviorCell.textField.selectedTextRange = selectedTextRange;
             }];
             break;
         }
 
         case SectionSessions: {
-            NSOrderedSet *sessionUUIDs = self.project.sessionUUIDs;
+            NSOrderedSet *sessionUUIDs = self.loadedSessionUUIDs;
 
             if (cell.item < sessionUUIDs.count) {
                 NSUUID *UUID = sessionUUIDs[cell.item];
@@ -1576,8 +1782,7 @@ typedef NS_ENUM(NSUInteger, ActionButton) {
                 // TODO: Show session details
             } else {
                 assert(cell.item == self.indexPathForCreateSessionButtonCell.item);
-                // TODO: Create session workflow
-//                NSString *name = [NSString stringWithFormat:@"%@-%@-%@", self.project.client, self.project.name, (self.projectSessionConfiguration.observer ?: @"<no_observer>")];
+                [self createSessionFromCurrentConfiguration];
             }
             break;
         }
@@ -30,7 +30,8 @@ extern BLMColorHexCode const BLMCreateProjectCellTextColor;
 
 @interface BLMProjectMenuController : UIViewController
 
-- (void)loadProjectData;
+- (void)loadProjectData; // Only requires projects, so it can be sent before the rest of the archive is restored
+- (void)finishLoadingProjectData; // Shows the first project's details once the archive is fully restored
 
 @end
 
@@ -109,7 +109,6 @@ typedef NS_ENUM(NSInteger, TableSection) {
 @property (nonatomic, assign, getter=isShowingProjectCreationController) BOOL showingProjectCreationController;
 @property (nonatomic, assign, getter=isShowingProjectDetailController) BOOL showingProjectDetailController;
 @property (nonatomic, strong) NSUUID *lastShownProjectUUID;
-@property (nonatomic, copy, readonly) NSMutableArray<NSUUID *> *projectUUIDs;
 @property (nonatomic, strong, readonly) UITableView *tableView;
 
 @end
@@ -117,19 +116,6 @@ typedef NS_ENUM(NSInteger, TableSection) {
 
 @implementation BLMProjectMenuController
 
-- (instancetype)init {
-    self = [super init];
-
-    if (self == nil) {
-        return nil;
-    }
-
-    _projectUUIDs = [NSMutableArray array];
-
-    return self;
-}
-
-
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
@@ -155,43 +141,31 @@ typedef NS_ENUM(NSInteger, TableSection) {
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleDataModelProjectCreated:) name:BLMProjectCreatedNotification object:nil];
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleDataModelProjectDeleted:) name:BLMProjectDeletedNotification object:nil];
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleDataModelProjectUpdated:) name:BLMProjectUpdatedNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleDataModelBatchCreated:) name:BLMDataManagerBatchCreatedNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleDataModelTransactionCommitted:) name:BLMDataManagerTransactionCommittedNotification object:nil];
 }
 
 #pragma mark Internal State
 
 - (void)loadProjectData {
     assert([NSThread isMainThread]);
-    assert(self.projectUUIDs.count == 0);
     assert(self.lastShownProjectUUID == nil);
-    assert(![BLMDataManager sharedManager].isRestoringArchive);
+    assert([BLMDataManager sharedManager].areProjectsRestored);
 
-    for (BLMProject *project in [BLMDataManager sharedManager].projectEnumerator) {
-        [self.projectUUIDs insertObject:project.UUID atIndex:[self insertionIndexForProjectUUID:project.UUID]];
-    }
+    self.tableView.userInteractionEnabled = ![BLMDataManager sharedManager].isRestoringArchive; // Project details need behaviors and session configurations, which may not be restored yet
 
     [self.tableView reloadData];
-
-    [self showDetailsForProjectUUID:self.projectUUIDs.firstObject];
 }
 
 
-- (NSUInteger)insertionIndexForProjectUUID:(NSUUID *)UUID {
-    static NSComparator comparator;
-    static dispatch_once_t onceToken;
-
-    dispatch_once(&onceToken, ^{
-        comparator = ^NSComparisonResult(NSUUID *leftUUID, NSUUID *rightUUID) {
-            NSString *leftName = [[BLMDataManager sharedManager] projectForUUID:leftUUID].name;
-            NSString *rightName = [[BLMDataManager sharedManager] projectForUUID:rightUUID].name;
-
-            assert(leftName != nil);
-            assert(rightName != nil);
+- (void)finishLoadingProjectData {
+    assert([NSThread isMainThread]);
+    assert(self.lastShownProjectUUID == nil);
+    assert(![BLMDataManager sharedManager].isRestoringArchive);
 
-            return [leftName compare:rightName];
-        };
-    });
+    self.tableView.userInteractionEnabled = YES;
 
-    return [self.projectUUIDs indexOfObject:UUID inSortedRange:NSMakeRange(0, self.projectUUIDs.count) options:NSBinarySearchingInsertionIndex usingComparator:comparator];
+    [self showDetailsForProjectUUID:[self firstProjectUUID]];
 }
 
 
@@ -213,7 +187,7 @@ typedef NS_ENUM(NSInteger, TableSection) {
 
 - (void)showDetailsForProjectUUID:(NSUUID *)UUID {
     assert([NSThread isMainThread]);
-    assert((UUID == nil) || [self.projectUUIDs containsObject:UUID]);
+    assert((UUID == nil) || ([[BLMDataManager sharedManager] indexOfProjectUUID:UUID] != NSNotFound));
 
     if ([BLMUtils isObject:UUID equalToObject:self.lastShownProjectUUID] && self.isShowingProjectDetailController) { // Already being shown
         assert(!self.isShowingProjectCreationController);
@@ -221,7 +195,7 @@ typedef NS_ENUM(NSInteger, TableSection) {
     }
 
     if (UUID != nil) {
-        NSUInteger UUIDIndex = [self.projectUUIDs indexOfObject:UUID];
+        NSUInteger UUIDIndex = [[BLMDataManager sharedManager] indexOfProjectUUID:UUID];
         NSIndexPath *indexPath = [NSIndexPath indexPathForRow:UUIDIndex inSection:TableSectionProjectList];
         UITableViewScrollPosition scrollPosition = ((self.lastShownProjectUUID == nil) ? UITableViewScrollPositionBottom : UITableViewScrollPositionNone);
         [self.tableView selectRowAtIndexPath:indexPath animated:NO scrollPosition:scrollPosition];
@@ -237,18 +211,101 @@ typedef NS_ENUM(NSInteger, TableSection) {
     self.lastShownProjectUUID = UUID;
 }
 
+
+- (NSUUID *)firstProjectUUID { // nil when there are no projects
+    BLMDataManager *dataManager = [BLMDataManager sharedManager];
+    return ((dataManager.projectCount > 0) ? [dataManager projectUUIDAtIndex:0] : nil);
+}
+
 #pragma mark Event Handling
 
 - (void)handleDataModelProjectCreated:(NSNotification *)notification {
-    [self.tableView beginUpdates];
-
     BLMProject *project = (BLMProject *)notification.object;
-    NSUInteger UUIDIndex = [self insertionIndexForProjectUUID:project.UUID];
+    [self updateRowsForCreatedProjectUUIDs:@[project.UUID] originalProjects:@[]];
+}
 
-    [self.projectUUIDs insertObject:project.UUID atIndex:UUIDIndex];
 
-    [self.tableView insertRowsAtIndexPaths:@[[NSIndexPath indexPathForRow:UUIDIndex inSection:TableSectionProjectList]] withRowAnimation:UITableViewRowAnimationNone];
-    [self.tableView endUpdates];
+- (void)handleDataModelBatchCreated:(NSNotification *)notification {
+    NSArray<BLMProject *> *projects = notification.userInfo[BLMDataManagerBatchProjectsUserInfoKey];
+    [self updateRowsForCreatedProjectUUIDs:[projects valueForKey:@"UUID"] originalProjects:@[]];
+}
+
+
+- (void)handleDataModelTransactionCommitted:(NSNotification *)notification {
+    BLMChangeSet *changeSet = notification.userInfo[BLMDataManagerChangeSetUserInfoKey];
+
+    NSArray<NSUUID *> *createdUUIDs = [changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeCreated];
+    NSMutableArray<BLMProject *> *originalProjects = [NSMutableArray array];
+
+    for (NSUUID *UUID in [changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeUpdated]) {
+        [originalProjects addObject:[changeSet originalObjectForUUID:UUID kind:BLMArchiveEntityKindProject]];
+    }
+
+    assert([changeSet UUIDsForKind:BLMArchiveEntityKindProject changeType:BLMChangeTypeDeleted].count == 0);
+
+    [self updateRowsForCreatedProjectUUIDs:createdUUIDs originalProjects:originalProjects];
+}
+
+
+- (void)updateRowsForCreatedProjectUUIDs:(NSArray<NSUUID *> *)createdUUIDs originalProjects:(NSArray<BLMProject *> *)originalProjects { // originalProjects are the updated projects as they were; rows move to wherever the data manager's name order now puts them
+    if ((createdUUIDs.count == 0) && (originalProjects.count == 0)) {
+        return;
+    }
+
+    BLMDataManager *dataManager = [BLMDataManager sharedManager];
+    NSMutableSet<NSUUID *> *renamedUUIDs = [NSMutableSet set];
+    NSMutableIndexSet *insertedIndexes = [NSMutableIndexSet indexSet];
+
+    for (NSUUID *UUID in createdUUIDs) {
+        [insertedIndexes addIndex:[dataManager indexOfProjectUUID:UUID]];
+    }
+
+    for (BLMProject *originalProject in originalProjects) {
+        if (![BLMUtils isString:originalProject.name equalToString:[dataManager projectForUUID:originalProject.UUID].name]) {
+            [renamedUUIDs addObject:originalProject.UUID];
+            [insertedIndexes addIndex:[dataManager indexOfProjectUUID:originalProject.UUID]];
+        }
+    }
+
+    if (renamedUUIDs.count > 1) { // Their original indexes would depend on how their original names order among themselves, which the data manager no longer holds
+        [self.tableView reloadData];
+    } else {
+        NSMutableIndexSet *deletedIndexes = [NSMutableIndexSet indexSet];
+        NSMutableArray<NSIndexPath *> *reloadedIndexPaths = [NSMutableArray array];
+
+        for (BLMProject *originalProject in originalProjects) {
+            NSUInteger nameIndex = [dataManager indexForProjectName:originalProject.name];
+            NSUInteger originalIndex = (nameIndex - [insertedIndexes countOfIndexesInRange:NSMakeRange(0, nameIndex)]); // Created and renamed projects were not ordered before it until now
+
+            if ([renamedUUIDs containsObject:originalProject.UUID]) {
+                [deletedIndexes addIndex:originalIndex];
+            } else {
+                [reloadedIndexPaths addObject:[NSIndexPath indexPathForRow:originalIndex inSection:TableSectionProjectList]];
+            }
+        }
+
+        [self.tableView beginUpdates]; // Deletions and reloads by original index, insertions by final index
+        [self.tableView deleteRowsAtIndexPaths:[self indexPathsForIndexes:deletedIndexes] withRowAnimation:UITableViewRowAnimationNone];
+        [self.tableView insertRowsAtIndexPaths:[self indexPathsForIndexes:insertedIndexes] withRowAnimation:UITableViewRowAnimationNone];
+        [self.tableView reloadRowsAtIndexPaths:reloadedIndexPaths withRowAnimation:UITableViewRowAnimationNone];
+        [self.tableView endUpdates];
+    }
+
+    if ((self.lastShownProjectUUID != nil) && ((renamedUUIDs.count > 1) || [renamedUUIDs containsObject:self.lastShownProjectUUID])) { // A renamed project keeps its selection as it moves
+        NSIndexPath *indexPath = [NSIndexPath indexPathForRow:[dataManager indexOfProjectUUID:self.lastShownProjectUUID] inSection:TableSectionProjectList];
+        [self.tableView selectRowAtIndexPath:indexPath animated:NO scrollPosition:UITableViewScrollPositionNone];
+    }
+}
+
+
+- (NSArray<NSIndexPath *> *)indexPathsForIndexes:(NSIndexSet *)indexes {
+    NSMutableArray<NSIndexPath *> *indexPaths = [NSMutableArray arrayWithCapacity:indexes.count];
+
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *__nonnull stop) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:index inSection:TableSectionProjectList]];
+    }];
+
+    return indexPaths;
 }
 
 
@@ -256,16 +313,15 @@ typedef NS_ENUM(NSInteger, TableSection) {
     [self.tableView beginUpdates];
 
     BLMProject *project = (BLMProject *)notification.object;
-    NSUInteger UUIDIndex = [self.projectUUIDs indexOfObject:project.UUID];
+    NSUInteger UUIDIndex = [[BLMDataManager sharedManager] indexForProjectName:project.name]; // Already removed from the order, so this is where it was
 
-    assert(UUIDIndex != NSNotFound);
-    [self.projectUUIDs removeObjectAtIndex:UUIDIndex];
+    assert([[BLMDataManager sharedManager] indexOfProjectUUID:project.UUID] == NSNotFound);
 
     [self.tableView deleteRowsAtIndexPaths:@[[NSIndexPath indexPathForItem:UUIDIndex inSection:TableSectionProjectList]] withRowAnimation:UITableViewRowAnimationNone];
     [self.tableView endUpdates];
 
     if ([BLMUtils isObject:project.UUID equalToObject:self.lastShownProjectUUID]) {
-        [self showDetailsForProjectUUID:self.projectUUIDs.firstObject];
+        [self showDetailsForProjectUUID:[self firstProjectUUID]];
     }
 }
 
@@ -273,11 +329,8 @@ typedef NS_ENUM(NSInteger, TableSection) {
 - (void)handleDataModelProjectUpdated:(NSNotification *)notification {
     assert([NSThread isMainThread]);
 
-    BLMProject *project = (BLMProject *)notification.object;
-    NSInteger UUIDIndex = [self.projectUUIDs indexOfObject:project.UUID];
-
-    assert(UUIDIndex != NSNotFound);
-    [self.tableView reloadRowsAtIndexPaths:@[[NSIndexPath indexPathForItem:UUIDIndex inSection:TableSectionProjectList]] withRowAnimation:UITableViewRowAnimationNone];
+    BLMProject *original = notification.userInfo[BLMProjectOriginalProjectUserInfoKey];
+    [self updateRowsForCreatedProjectUUIDs:@[] originalProjects:@[original]];
 }
 
 #pragma mark UITableViewDataSource
@@ -290,7 +343,7 @@ typedef NS_ENUM(NSInteger, TableSection) {
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
     switch ((TableSection)section) {
         case TableSectionProjectList:
-            return self.projectUUIDs.count;
+            return [BLMDataManager sharedManager].projectCount;
 
         case TableSectionCreateProject:
             return 1;
@@ -307,7 +360,7 @@ typedef NS_ENUM(NSInteger, TableSection) {
     switch ((TableSection)indexPath.section) {
         case TableSectionProjectList: {
             ProjectCell *projectCell = [tableView dequeueReusableCellWithIdentifier:NSStringFromClass([ProjectCell class])];
-            BLMProject *project = [[BLMDataManager sharedManager] projectForUUID:self.projectUUIDs[indexPath.row]];
+            BLMProject *project = [[BLMDataManager sharedManager] projectForUUID:[[BLMDataManager sharedManager] projectUUIDAtIndex:indexPath.row]];
 
             projectCell.textLabel.text = project.name;
 
@@ -331,7 +384,7 @@ typedef NS_ENUM(NSInteger, TableSection) {
 
     switch ((TableSection)indexPath.section) {
         case TableSectionProjectList:
-            [self showDetailsForProjectUUID:self.projectUUIDs[indexPath.row]];
+            [self showDetailsForProjectUUID:[[BLMDataManager sharedManager] projectUUIDAtIndex:indexPath.row]];
             break;
 
         case TableSectionCreateProject:
@@ -348,7 +401,7 @@ typedef NS_ENUM(NSInteger, TableSection) {
 #pragma mark BLMCreateProjectControllerDelegate
 
 - (void)createProjectController:(BLMCreateProjectController *)controller didCreateProject:(BLMProject *)project {
-    assert([self.projectUUIDs indexOfObject:project.UUID] != NSNotFound);
+    assert([[BLMDataManager sharedManager] indexOfProjectUUID:project.UUID] != NSNotFound);
     [self showDetailsForProjectUUID:project.UUID];
 }
 
@@ -0,0 +1,39 @@
+//
+//  BLMProjectOrder.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/21/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/*
+ ` Projects sorted by name, as an order-statistic tree, so inserting, removing and finding the rank of a
+ ` project are O(log n) and never touch the projects themselves. Each name is folded into a collation
+ ` key once, with the current locale's case, diacritic and width rules, and keys are then compared
+ ` literally; names that fold to the same key are ordered by their unfolded form.
+ `
+ ` All messages must be sent from the main thread.
+ */
+
+@interface BLMProjectOrder : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+- (NSUInteger)insertProjectUUID:(NSUUID *)UUID name:(NSString *)name; // Returns the project's index
+- (NSUInteger)removeProjectUUID:(NSUUID *)UUID; // Returns the index the project had
+
+- (NSUInteger)indexOfProjectUUID:(NSUUID *)UUID; // NSNotFound if the project is not in the order
+- (NSUInteger)indexForProjectName:(NSString *)name; // Number of projects ordered before name; for a removed project's name, the index it had
+- (NSUUID *)projectUUIDAtIndex:(NSUInteger)index;
+- (NSArray<NSUUID *> *)projectUUIDsInRange:(NSRange)range;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,383 @@
+//
+//  BLMProjectOrder.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/21/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMProjectOrder.h"
+
+
+#pragma mark Constants
+
+static NSUInteger const NodeNull = NSNotFound;
+static NSUInteger const InitialNodeCapacity = 64;
+
+
+typedef struct Node { // A treap node; the projects' keys, names and UUIDs are held in arrays at the same index
+    NSUInteger Left;
+    NSUInteger Right;
+    NSUInteger Size; // Nodes in this subtree, including this one
+    uint32_t Priority; // Random, so the tree stays balanced in expectation whatever order projects arrive in
+} Node;
+
+
+static inline NSString *CollationKeyForName(NSString *name) {
+    return [name stringByFoldingWithOptions:(NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch | NSWidthInsensitiveSearch) locale:[NSLocale currentLocale]];
+}
+
+
+#pragma mark
+
+@interface BLMProjectOrder ()
+
+@property (nonatomic, assign) Node *nodes;
+@property (nonatomic, assign) NSUInteger nodeCapacity;
+@property (nonatomic, assign) NSUInteger root;
+@property (nonatomic, strong, readonly) NSMutableArray *keyByNode; // NSNull for free nodes
+@property (nonatomic, strong, readonly) NSMutableArray *nameByNode;
+@property (nonatomic, strong, readonly) NSMutableArray *UUIDByNode;
+@property (nonatomic, strong, readonly) NSMutableIndexSet *freeNodes;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSUUID *, NSNumber *> *nodeByUUID;
+
+@end
+
+
+@implementation BLMProjectOrder
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _nodeCapacity = InitialNodeCapacity;
+    _nodes = malloc(_nodeCapacity * sizeof(Node));
+    _root = NodeNull;
+    _keyByNode = [NSMutableArray array];
+    _nameByNode = [NSMutableArray array];
+    _UUIDByNode = [NSMutableArray array];
+    _freeNodes = [NSMutableIndexSet indexSet];
+    _nodeByUUID = [NSMutableDictionary dictionary];
+
+    assert(_nodes != NULL);
+
+    return self;
+}
+
+
+- (void)dealloc {
+    free(_nodes);
+}
+
+
+- (NSUInteger)count {
+    return [self sizeOfNode:self.root];
+}
+
+#pragma mark Mutation
+
+- (NSUInteger)insertProjectUUID:(NSUUID *)UUID name:(NSString *)name {
+    assert([NSThread isMainThread]);
+    assert(self.nodeByUUID[UUID] == nil);
+
+    NSUInteger node = [self allocateNodeWithKey:CollationKeyForName(name) name:name UUID:UUID];
+
+    self.nodeByUUID[UUID] = @(node);
+    self.root = [self insertNode:node intoTree:self.root];
+
+    return [self rankOfNode:node];
+}
+
+
+- (NSUInteger)removeProjectUUID:(NSUUID *)UUID {
+    assert([NSThread isMainThread]);
+
+    NSNumber *node = self.nodeByUUID[UUID];
+    assert(node != nil);
+
+    NSUInteger rank = [self rankOfNode:node.unsignedIntegerValue];
+
+    self.root = [self removeNode:node.unsignedIntegerValue fromTree:self.root];
+    [self.nodeByUUID removeObjectForKey:UUID];
+    [self freeNode:node.unsignedIntegerValue];
+
+    return rank;
+}
+
+
+- (NSUInteger)allocateNodeWithKey:(NSString *)key name:(NSString *)name UUID:(NSUUID *)UUID {
+    NSUInteger node = self.freeNodes.firstIndex;
+
+    if (node == NSNotFound) {
+        node = self.keyByNode.count;
+
+        if (node == self.nodeCapacity) {
+            self.nodeCapacity *= 2;
+            self.nodes = realloc(self.nodes, self.nodeCapacity * sizeof(Node));
+
+            assert(self.nodes != NULL);
+        }
+
+        [self.keyByNode addObject:key];
+        [self.nameByNode addObject:name];
+        [self.UUIDByNode addObject:UUID];
+    } else {
+        [self.freeNodes removeIndex:node];
+
+        self.keyByNode[node] = key;
+        self.nameByNode[node] = name;
+        self.UUIDByNode[node] = UUID;
+    }
+
+    self.nodes[node] = (Node){ .Left = NodeNull, .Right = NodeNull, .Size = 1, .Priority = arc4random() };
+
+    return node;
+}
+
+
+- (void)freeNode:(NSUInteger)node {
+    self.keyByNode[node] = [NSNull null];
+    self.nameByNode[node] = [NSNull null];
+    self.UUIDByNode[node] = [NSNull null];
+
+    [self.freeNodes addIndex:node];
+}
+
+#pragma mark Treap
+
+- (NSComparisonResult)compareKey:(NSString *)key name:(NSString *)name toNode:(NSUInteger)node {
+    NSComparisonResult result = [key compare:self.keyByNode[node] options:NSLiteralSearch];
+
+    if (result == NSOrderedSame) {
+        result = [name compare:self.nameByNode[node] options:NSLiteralSearch];
+    }
+
+    return result;
+}
+
+
+- (NSComparisonResult)compareNode:(NSUInteger)node toNode:(NSUInteger)otherNode { // A total order, so every node has a unique rank
+    NSComparisonResult result = [self compareKey:self.keyByNode[node] name:self.nameByNode[node] toNode:otherNode];
+
+    if (result == NSOrderedSame) { // Project names are unique, so this is only reached for a node compared with itself
+        result = [[self.UUIDByNode[node] UUIDString] compare:[self.UUIDByNode[otherNode] UUIDString]];
+    }
+
+    return result;
+}
+
+
+- (NSUInteger)sizeOfNode:(NSUInteger)node {
+    return ((node == NodeNull) ? 0 : self.nodes[node].Size);
+}
+
+
+- (void)updateSizeOfNode:(NSUInteger)node {
+    self.nodes[node].Size = ([self sizeOfNode:self.nodes[node].Left] + [self sizeOfNode:self.nodes[node].Right] + 1);
+}
+
+
+- (void)splitTree:(NSUInteger)tree aroundNode:(NSUInteger)node left:(NSUInteger *)left right:(NSUInteger *)right { // left holds the nodes ordered before node, right the rest
+    if (tree == NodeNull) {
+        *left = NodeNull;
+        *right = NodeNull;
+        return;
+    }
+
+    if ([self compareNode:tree toNode:node] == NSOrderedAscending) {
+        NSUInteger rightOfSplit = NodeNull;
+
+        [self splitTree:self.nodes[tree].Right aroundNode:node left:&rightOfSplit right:right];
+
+        self.nodes[tree].Right = rightOfSplit;
+        *left = tree;
+    } else {
+        NSUInteger leftOfSplit = NodeNull;
+
+        [self splitTree:self.nodes[tree].Left aroundNode:node left:left right:&leftOfSplit];
+
+        self.nodes[tree].Left = leftOfSplit;
+        *right = tree;
+    }
+
+    [self updateSizeOfNode:tree];
+}
+
+
+- (NSUInteger)mergeTree:(NSUInteger)left withTree:(NSUInteger)right { // Every node in left is ordered before every node in right
+    if (left == NodeNull) {
+        return right;
+    }
+
+    if (right == NodeNull) {
+        return left;
+    }
+
+    if (self.nodes[left].Priority > self.nodes[right].Priority) {
+        self.nodes[left].Right = [self mergeTree:self.nodes[left].Right withTree:right];
+        [self updateSizeOfNode:left];
+
+        return left;
+    }
+
+    self.nodes[right].Left = [self mergeTree:left withTree:self.nodes[right].Left];
+    [self updateSizeOfNode:right];
+
+    return right;
+}
+
+
+- (NSUInteger)insertNode:(NSUInteger)node intoTree:(NSUInteger)tree {
+    if (tree == NodeNull) {
+        return node;
+    }
+
+    if (self.nodes[node].Priority > self.nodes[tree].Priority) {
+        NSUInteger left = NodeNull;
+        NSUInteger right = NodeNull;
+
+        [self splitTree:tree aroundNode:node left:&left right:&right];
+
+        self.nodes[node].Left = left;
+        self.nodes[node].Right = right;
+        [self updateSizeOfNode:node];
+
+        return node;
+    }
+
+    if ([self compareNode:node toNode:tree] == NSOrderedAscending) {
+        self.nodes[tree].Left = [self insertNode:node intoTree:self.nodes[tree].Left];
+    } else {
+        self.nodes[tree].Right = [self insertNode:node intoTree:self.nodes[tree].Right];
+    }
+
+    [self updateSizeOfNode:tree];
+
+    return tree;
+}
+
+
+- (NSUInteger)removeNode:(NSUInteger)node fromTree:(NSUInteger)tree {
+    assert(tree != NodeNull);
+
+    if (tree == node) {
+        return [self mergeTree:self.nodes[node].Left withTree:self.nodes[node].Right];
+    }
+
+    if ([self compareNode:node toNode:tree] == NSOrderedAscending) {
+        self.nodes[tree].Left = [self removeNode:node fromTree:self.nodes[tree].Left];
+    } else {
+        self.nodes[tree].Right = [self removeNode:node fromTree:self.nodes[tree].Right];
+    }
+
+    [self updateSizeOfNode:tree];
+
+    return tree;
+}
+
+
+- (NSUInteger)rankOfNode:(NSUInteger)node {
+    NSUInteger rank = 0;
+    NSUInteger tree = self.root;
+
+    while (tree != node) {
+        assert(tree != NodeNull);
+
+        if ([self compareNode:node toNode:tree] == NSOrderedAscending) {
+            tree = self.nodes[tree].Left;
+        } else {
+            rank += ([self sizeOfNode:self.nodes[tree].Left] + 1);
+            tree = self.nodes[tree].Right;
+        }
+    }
+
+    return (rank + [self sizeOfNode:self.nodes[node].Left]);
+}
+
+
+- (NSUInteger)nodeAtRank:(NSUInteger)rank {
+    assert(rank < self.count);
+
+    NSUInteger tree = self.root;
+
+    while (YES) {
+        NSUInteger leftSize = [self sizeOfNode:self.nodes[tree].Left];
+
+        if (rank < leftSize) {
+            tree = self.nodes[tree].Left;
+        } else if (rank > leftSize) {
+            rank -= (leftSize + 1);
+            tree = self.nodes[tree].Right;
+        } else {
+            return tree;
+        }
+    }
+}
+
+
+- (void)appendUUIDsFromTree:(NSUInteger)tree inRange:(NSRange)range offset:(NSUInteger)offset toArray:(NSMutableArray<NSUUID *> *)UUIDs { // offset is the rank of the tree's first node
+    if ((tree == NodeNull) || (offset >= NSMaxRange(range)) || ((offset + self.nodes[tree].Size) <= range.location)) {
+        return;
+    }
+
+    NSUInteger rank = (offset + [self sizeOfNode:self.nodes[tree].Left]);
+
+    [self appendUUIDsFromTree:self.nodes[tree].Left inRange:range offset:offset toArray:UUIDs];
+
+    if (NSLocationInRange(rank, range)) {
+        [UUIDs addObject:self.UUIDByNode[tree]];
+    }
+
+    [self appendUUIDsFromTree:self.nodes[tree].Right inRange:range offset:(rank + 1) toArray:UUIDs];
+}
+
+#pragma mark Queries
+
+- (NSUInteger)indexOfProjectUUID:(NSUUID *)UUID {
+    assert([NSThread isMainThread]);
+
+    NSNumber *node = self.nodeByUUID[UUID];
+    return ((node == nil) ? NSNotFound : [self rankOfNode:node.unsignedIntegerValue]);
+}
+
+
+- (NSUInteger)indexForProjectName:(NSString *)name {
+    assert([NSThread isMainThread]);
+
+    NSString *key = CollationKeyForName(name);
+    NSUInteger index = 0;
+    NSUInteger tree = self.root;
+
+    while (tree != NodeNull) {
+        if ([self compareKey:key name:name toNode:tree] == NSOrderedDescending) {
+            index += ([self sizeOfNode:self.nodes[tree].Left] + 1);
+            tree = self.nodes[tree].Right;
+        } else {
+            tree = self.nodes[tree].Left;
+        }
+    }
+
+    return index;
+}
+
+
+- (NSUUID *)projectUUIDAtIndex:(NSUInteger)index {
+    assert([NSThread isMainThread]);
+    return self.UUIDByNode[[self nodeAtRank:index]];
+}
+
+
+- (NSArray<NSUUID *> *)projectUUIDsInRange:(NSRange)range {
+    assert([NSThread isMainThread]);
+    assert(NSMaxRange(range) <= self.count);
+
+    NSMutableArray<NSUUID *> *UUIDs = [NSMutableArray arrayWithCapacity:range.length];
+    [self appendUUIDsFromTree:self.root inRange:range offset:0 toArray:UUIDs];
+
+    return UUIDs;
+}
+
+@end
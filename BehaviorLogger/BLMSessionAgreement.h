@@ -0,0 +1,49 @@
+//
+//  BLMSessionAgreement.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/13/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMIntervalSampler.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+typedef struct BLMBehaviorAgreement { // Each measure is a fraction from 0 to 1, and is 1 when neither observer had anything to disagree about
+    double TotalCount; // Smaller session total over larger session total
+    double ExactCountPerInterval; // Intervals in which both observers counted the same number of responses
+    double IntervalByInterval; // Intervals both observers scored or both left unscored, by partial interval sampling
+} BLMBehaviorAgreement;
+
+
+#pragma mark
+
+/*
+ ` Inter-observer agreement between two sessions recorded with the same configuration, typically by
+ ` two observers logging the same client on separate devices. Both sessions are aligned at their own
+ ` start and compared over the intervals they have in common, so the measures are unaffected by one
+ ` observer stopping a little after the other.
+ */
+
+@interface BLMSessionAgreement : NSObject
+
+@property (nonatomic, strong, readonly) NSUUID *primarySessionUUID; // The session that started first
+@property (nonatomic, strong, readonly) NSUUID *secondarySessionUUID;
+@property (nonatomic, copy, readonly) NSOrderedSet<NSUUID *> *behaviorUUIDs;
+@property (nonatomic, assign, readonly) uint64_t intervalLength; // Nanoseconds
+@property (nonatomic, assign, readonly) NSUInteger intervalCount; // Intervals compared
+
+- (instancetype)initWithPrimarySessionUUID:(NSUUID *)primarySessionUUID primarySampling:(BLMIntervalSampling *)primarySampling secondarySessionUUID:(NSUUID *)secondarySessionUUID secondarySampling:(BLMIntervalSampling *)secondarySampling behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs; // Both samplings must share a bin width
+
+- (BLMBehaviorAgreement)agreementForBehaviorIndex:(NSUInteger)behaviorIndex;
+- (BLMBehaviorAgreement)agreementForBehaviorUUID:(NSUUID *)behaviorUUID;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
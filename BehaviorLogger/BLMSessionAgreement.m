@@ -0,0 +1,103 @@
+//
+//  BLMSessionAgreement.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/13/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMSessionAgreement.h"
+
+
+#pragma mark Constants
+
+static inline double AgreementRatio(uint64_t agreements, uint64_t total) {
+    return ((total > 0) ? ((double)agreements / total) : 1.0);
+}
+
+
+static BLMBehaviorAgreement CompareIntervals(uint32_t const *primaryResponseCounts, uint8_t const *primaryScoredBins, uint32_t const *secondaryResponseCounts, uint8_t const *secondaryScoredBins, NSUInteger intervalCount) {
+    uint64_t primaryTotal = 0;
+    uint64_t secondaryTotal = 0;
+    uint64_t exactCountAgreements = 0;
+    uint64_t intervalAgreements = 0;
+
+    for (NSUInteger index = 0; index < intervalCount; index += 1) {
+        primaryTotal += primaryResponseCounts[index];
+        secondaryTotal += secondaryResponseCounts[index];
+        exactCountAgreements += (primaryResponseCounts[index] == secondaryResponseCounts[index]);
+        intervalAgreements += (primaryScoredBins[index] == secondaryScoredBins[index]);
+    }
+
+    BLMBehaviorAgreement agreement = {
+        .TotalCount = AgreementRatio(MIN(primaryTotal, secondaryTotal), MAX(primaryTotal, secondaryTotal)),
+        .ExactCountPerInterval = AgreementRatio(exactCountAgreements, intervalCount),
+        .IntervalByInterval = AgreementRatio(intervalAgreements, intervalCount)
+    };
+
+    return agreement;
+}
+
+
+#pragma mark
+
+@interface BLMSessionAgreement ()
+
+@property (nonatomic, assign, readonly) BLMBehaviorAgreement *behaviorAgreements; // One per behavior UUID
+
+@end
+
+
+@implementation BLMSessionAgreement
+
+- (instancetype)initWithPrimarySessionUUID:(NSUUID *)primarySessionUUID primarySampling:(BLMIntervalSampling *)primarySampling secondarySessionUUID:(NSUUID *)secondarySessionUUID secondarySampling:(BLMIntervalSampling *)secondarySampling behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs {
+    assert(primarySampling.binWidth == secondarySampling.binWidth);
+    assert(primarySampling.behaviorCount == behaviorUUIDs.count);
+    assert(secondarySampling.behaviorCount == behaviorUUIDs.count);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _primarySessionUUID = primarySessionUUID;
+    _secondarySessionUUID = secondarySessionUUID;
+    _behaviorUUIDs = [behaviorUUIDs copy];
+    _intervalLength = primarySampling.binWidth;
+    _intervalCount = MIN(primarySampling.binCount, secondarySampling.binCount);
+    _behaviorAgreements = calloc(MAX(_behaviorUUIDs.count, 1), sizeof(BLMBehaviorAgreement));
+
+    assert(_behaviorAgreements != NULL);
+
+    for (NSUInteger behaviorIndex = 0; behaviorIndex < _behaviorUUIDs.count; behaviorIndex += 1) {
+        _behaviorAgreements[behaviorIndex] = CompareIntervals([primarySampling responseCountsForBehaviorIndex:behaviorIndex],
+                                                              [primarySampling scoredBinsForBehaviorIndex:behaviorIndex method:BLMSamplingMethodPartialInterval],
+                                                              [secondarySampling responseCountsForBehaviorIndex:behaviorIndex],
+                                                              [secondarySampling scoredBinsForBehaviorIndex:behaviorIndex method:BLMSamplingMethodPartialInterval],
+                                                              _intervalCount);
+    }
+
+    return self;
+}
+
+
+- (void)dealloc {
+    free(_behaviorAgreements);
+}
+
+
+- (BLMBehaviorAgreement)agreementForBehaviorIndex:(NSUInteger)behaviorIndex {
+    assert(behaviorIndex < self.behaviorUUIDs.count);
+    return self.behaviorAgreements[behaviorIndex];
+}
+
+
+- (BLMBehaviorAgreement)agreementForBehaviorUUID:(NSUUID *)behaviorUUID {
+    NSUInteger behaviorIndex = [self.behaviorUUIDs indexOfObject:behaviorUUID];
+    assert(behaviorIndex != NSNotFound);
+
+    return [self agreementForBehaviorIndex:behaviorIndex];
+}
+
+@end
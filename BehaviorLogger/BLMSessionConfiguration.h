@@ -59,6 +59,7 @@ typedef NS_ENUM(NSInteger, BLMSessionConfigurationProperty) {
 
 - (instancetype)initWithUUID:(NSUUID *)UUID condition:(nullable NSString *)condition location:(nullable NSString *)location therapist:(nullable NSString *)therapist observer:(nullable NSString *)observer timeLimit:(BLMTimeInterval)timeLimit timeLimitOptions:(BLMTimeLimitOptions)timeLimitOptions behaviorUUIDs:(nullable NSOrderedSet<NSUUID *> *)behaviorUUIDs;
 - (instancetype)copyWithUpdatedValuesByProperty:(NSDictionary<NSNumber *, id> *)valuesByProperty; // @(BLMSessionConfigurationProperty) -> id
+- (BOOL)isComparableToSessionConfiguration:(BLMSessionConfiguration *)other; // Same behaviors in the same order, condition, location and time limit, so sessions recorded with either can be scored against each other; therapist and observer may differ
 
 @end
 
@@ -115,4 +115,12 @@ typedef NS_ENUM(NSInteger, ArchiveVersion) {
             && (self.timeLimitOptions == other.timeLimitOptions));
 }
 
+
+- (BOOL)isComparableToSessionConfiguration:(BLMSessionConfiguration *)other {
+    return ([BLMUtils isOrderedSet:self.behaviorUUIDs equalToOrderedSet:other.behaviorUUIDs]
+            && [BLMUtils isString:self.condition equalToString:other.condition]
+            && [BLMUtils isString:self.location equalToString:other.location]
+            && (self.timeLimit == other.timeLimit));
+}
+
 @end
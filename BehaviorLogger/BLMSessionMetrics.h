@@ -0,0 +1,58 @@
+//
+//  BLMSessionMetrics.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/11/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMEventStore.h"
+#import "BLMSessionConfiguration.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+typedef struct BLMBehaviorMetricsSummary {
+    NSUInteger Frequency; // Occurrences, or onsets for continuous behaviors
+    double RatePerMinute;
+    NSTimeInterval TotalDuration; // Continuous behaviors only, including an episode still in progress
+    NSTimeInterval MeanDuration;
+    NSTimeInterval MeanInterResponseTime; // 0 until the behavior has been observed twice
+    NSTimeInterval Latency; // From the start of the session to the first response; only meaningful when Frequency > 0
+} BLMBehaviorMetricsSummary;
+
+
+#pragma mark
+
+/*
+ ` Accumulates per-behavior metrics for one session as its events are applied, in O(1) per event, so
+ ` the same instance serves a live session and a stored one. Behaviors are identified by their index
+ ` in the session configuration's behaviorUUIDs. Events after the configuration's time limit are
+ ` ignored, and an episode still in progress at the limit is cut off there.
+ `
+ ` The metrics are not thread safe, but do not depend on the main thread, so stored sessions can be
+ ` summarized on a background queue.
+ */
+
+@interface BLMSessionMetrics : NSObject
+
+@property (nonatomic, copy, readonly) NSOrderedSet<NSUUID *> *behaviorUUIDs;
+@property (nonatomic, copy, readonly) NSSet<NSUUID *> *continuousBehaviorUUIDs; // Those of behaviorUUIDs counted as episodes rather than occurrences
+@property (nonatomic, assign, readonly) uint64_t timeLimit; // Nanoseconds; 0 if the session is not limited
+@property (nonatomic, assign, readonly) uint64_t lastTimeOffset; // Time offset of the latest event applied
+
+- (instancetype)initWithSessionConfiguration:(BLMSessionConfiguration *)sessionConfiguration continuousBehaviorUUIDs:(NSSet<NSUUID *> *)continuousBehaviorUUIDs;
+
+- (void)applyEvent:(BLMSessionEvent)event; // Events must be applied in time order
+- (void)applyEventsFromStore:(BLMEventStore *)store; // Applies every stored event to metrics that have none yet; must be sent from the store's queue
+
+- (BLMBehaviorMetricsSummary)summaryForBehaviorIndex:(NSUInteger)behaviorIndex atTimeOffset:(uint64_t)timeOffset; // timeOffset is how long the session has been observed, e.g. the recorder's current time offset, or the session's length once it has ended
+- (BLMBehaviorMetricsSummary)summaryForBehaviorUUID:(NSUUID *)behaviorUUID atTimeOffset:(uint64_t)timeOffset;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
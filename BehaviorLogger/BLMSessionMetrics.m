@@ -0,0 +1,175 @@
+//
+//  BLMSessionMetrics.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/11/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMSessionMetrics.h"
+
+
+#pragma mark Constants
+
+typedef struct BehaviorMetrics {
+    BOOL Continuous;
+    BOOL Active; // A continuous behavior's onset has been applied without a matching offset
+    NSUInteger Frequency;
+    uint64_t FirstResponseTimeOffset;
+    uint64_t LastResponseTimeOffset;
+    uint64_t ActiveOnsetTimeOffset;
+    uint64_t TotalDuration; // Completed episodes only
+    uint64_t TotalInterResponseTime;
+    NSUInteger InterResponseCount;
+} BehaviorMetrics;
+
+
+static inline NSTimeInterval TimeIntervalForNanoseconds(uint64_t nanoseconds) {
+    return ((NSTimeInterval)nanoseconds / NSEC_PER_SEC);
+}
+
+
+#pragma mark
+
+@interface BLMSessionMetrics ()
+
+@property (nonatomic, assign, readonly) BehaviorMetrics *behaviorMetrics; // One per behavior UUID
+
+@end
+
+
+@implementation BLMSessionMetrics
+
+- (instancetype)initWithSessionConfiguration:(BLMSessionConfiguration *)sessionConfiguration continuousBehaviorUUIDs:(NSSet<NSUUID *> *)continuousBehaviorUUIDs {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _behaviorUUIDs = [sessionConfiguration.behaviorUUIDs copy];
+    _continuousBehaviorUUIDs = [_behaviorUUIDs.set objectsPassingTest:^BOOL(NSUUID *__nonnull behaviorUUID, BOOL *__nonnull stop) {
+        return [continuousBehaviorUUIDs containsObject:behaviorUUID];
+    }];
+    _timeLimit = ((uint64_t)MAX(sessionConfiguration.timeLimit, 0) * NSEC_PER_SEC);
+    _behaviorMetrics = calloc(MAX(_behaviorUUIDs.count, 1), sizeof(BehaviorMetrics));
+
+    assert(_behaviorMetrics != NULL);
+
+    [_behaviorUUIDs enumerateObjectsUsingBlock:^(NSUUID *__nonnull behaviorUUID, NSUInteger index, BOOL *__nonnull stop) {
+        _behaviorMetrics[index].Continuous = [_continuousBehaviorUUIDs containsObject:behaviorUUID];
+    }];
+
+    return self;
+}
+
+
+- (void)dealloc {
+    free(_behaviorMetrics);
+}
+
+#pragma mark Accumulation
+
+- (void)applyEvent:(BLMSessionEvent)event {
+    assert(event.TimeOffset >= self.lastTimeOffset);
+
+    _lastTimeOffset = event.TimeOffset;
+
+    if (event.BehaviorIndex >= self.behaviorUUIDs.count) { // Recorded against a behavior that has since been removed from the configuration
+        return;
+    }
+
+    BehaviorMetrics *metrics = &self.behaviorMetrics[event.BehaviorIndex];
+
+    if ((self.timeLimit > 0) && (event.TimeOffset > self.timeLimit)) {
+        if ((event.Type == BLMSessionEventTypeOffset) && metrics->Active) { // Only the part of the episode within the limit counts
+            metrics->TotalDuration += (self.timeLimit - metrics->ActiveOnsetTimeOffset);
+            metrics->Active = NO;
+        }
+        return;
+    }
+
+    switch (event.Type) {
+        case BLMSessionEventTypeOccurrence:
+        case BLMSessionEventTypeOnset: {
+            if (metrics->Active) { // A repeated onset continues the current episode
+                break;
+            }
+
+            if (metrics->Frequency > 0) {
+                metrics->TotalInterResponseTime += (event.TimeOffset - metrics->LastResponseTimeOffset);
+                metrics->InterResponseCount += 1;
+            } else {
+                metrics->FirstResponseTimeOffset = event.TimeOffset;
+            }
+
+            metrics->LastResponseTimeOffset = event.TimeOffset;
+            metrics->Frequency += 1;
+
+            if ((event.Type == BLMSessionEventTypeOnset) && metrics->Continuous) {
+                metrics->ActiveOnsetTimeOffset = event.TimeOffset;
+                metrics->Active = YES;
+            }
+            break;
+        }
+
+        case BLMSessionEventTypeOffset: {
+            if (metrics->Active) {
+                metrics->TotalDuration += (event.TimeOffset - metrics->ActiveOnsetTimeOffset);
+                metrics->Active = NO;
+            }
+            break;
+        }
+
+        case BLMSessionEventTypeCount: {
+            assert(NO);
+            break;
+        }
+    }
+}
+
+
+- (void)applyEventsFromStore:(BLMEventStore *)store {
+    assert(self.lastTimeOffset == 0);
+
+    uint64_t endTimeOffset = ((self.timeLimit > 0) ? (self.timeLimit + 1) : UINT64_MAX);
+
+    [store enumerateEventsFromTimeOffset:0 toTimeOffset:endTimeOffset usingBlock:^(BLMSessionEvent event, BOOL *stop) { // Events past the limit are never decoded; episodes still open there are cut off when summarized
+        [self applyEvent:event];
+    }];
+}
+
+#pragma mark Summaries
+
+- (BLMBehaviorMetricsSummary)summaryForBehaviorIndex:(NSUInteger)behaviorIndex atTimeOffset:(uint64_t)timeOffset {
+    assert(behaviorIndex < self.behaviorUUIDs.count);
+
+    BehaviorMetrics const *metrics = &self.behaviorMetrics[behaviorIndex];
+    uint64_t observedTime = ((self.timeLimit > 0) ? MIN(timeOffset, self.timeLimit) : timeOffset);
+    uint64_t totalDuration = metrics->TotalDuration;
+
+    if (metrics->Active && (observedTime > metrics->ActiveOnsetTimeOffset)) {
+        totalDuration += (observedTime - metrics->ActiveOnsetTimeOffset);
+    }
+
+    BLMBehaviorMetricsSummary summary = {
+        .Frequency = metrics->Frequency,
+        .RatePerMinute = ((observedTime > 0) ? (metrics->Frequency / (TimeIntervalForNanoseconds(observedTime) / 60.0)) : 0.0),
+        .TotalDuration = TimeIntervalForNanoseconds(totalDuration),
+        .MeanDuration = ((metrics->Continuous && (metrics->Frequency > 0)) ? (TimeIntervalForNanoseconds(totalDuration) / metrics->Frequency) : 0.0),
+        .MeanInterResponseTime = ((metrics->InterResponseCount > 0) ? (TimeIntervalForNanoseconds(metrics->TotalInterResponseTime) / metrics->InterResponseCount) : 0.0),
+        .Latency = TimeIntervalForNanoseconds(metrics->FirstResponseTimeOffset)
+    };
+
+    return summary;
+}
+
+
+- (BLMBehaviorMetricsSummary)summaryForBehaviorUUID:(NSUUID *)behaviorUUID atTimeOffset:(uint64_t)timeOffset {
+    NSUInteger behaviorIndex = [self.behaviorUUIDs indexOfObject:behaviorUUID];
+    assert(behaviorIndex != NSNotFound);
+
+    return [self summaryForBehaviorIndex:behaviorIndex atTimeOffset:timeOffset];
+}
+
+@end
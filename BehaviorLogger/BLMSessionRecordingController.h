@@ -0,0 +1,51 @@
+//
+//  BLMSessionRecordingController.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/30/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class BLMLatencyHistogram;
+@class BLMSessionRecordingController;
+
+
+@protocol BLMSessionRecordingControllerDelegate <NSObject>
+
+- (void)sessionRecordingControllerDidFinish:(BLMSessionRecordingController *)controller; // Sent once every recorded event is in the session's event store
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Records a live session: one large target per behavior in the session's configuration, and a timer.
+ ` Tapping a discrete behavior's target records an occurrence; a continuous behavior's target toggles
+ ` between onset and offset and stays highlighted while the behavior is ongoing.
+ `
+ ` A tap is handled on touch down and only publishes the event to the recorder's ring buffer and flips
+ ` the target's state, so the touch path never waits on persistence or notifications. The session's
+ ` start and end dates are saved when recording starts and stops, outside of any tap. The time from
+ ` each touch's timestamp to its event being committed is kept in latencyHistogram.
+ */
+
+@interface BLMSessionRecordingController : UIViewController
+
+@property (nonatomic, strong, readonly) NSUUID *sessionUUID;
+@property (nonatomic, weak, readonly) id<BLMSessionRecordingControllerDelegate> delegate;
+@property (nonatomic, strong, readonly) BLMLatencyHistogram *latencyHistogram;
+@property (nonatomic, assign, readonly) NSUInteger droppedTapCount; // Taps lost because the recorder's ring buffer was full
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID delegate:(id<BLMSessionRecordingControllerDelegate>)delegate;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
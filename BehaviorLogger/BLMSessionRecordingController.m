@@ -0,0 +1,281 @@
+//
+//  BLMSessionRecordingController.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/30/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMBehavior.h"
+#import "BLMCollectionView.h"
+#import "BLMDataManager.h"
+#import "BLMLatencyHistogram.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+#import "BLMSessionRecordingController.h"
+#import "BLMViewUtils.h"
+
+#import <QuartzCore/QuartzCore.h>
+
+
+#pragma mark Constants
+
+static CGFloat const ContentInset = 20.0;
+static CGFloat const TargetSpacing = 12.0;
+static CGFloat const TargetTitleFontSize = 28.0;
+static CGFloat const TimerLabelHeight = 60.0;
+static CGFloat const TimerLabelFontSize = 44.0;
+static NSTimeInterval const TimerUpdateInterval = 0.25;
+
+
+#pragma mark
+
+@interface BLMSessionRecordingController ()
+
+@property (nonatomic, strong, readonly) BLMEventRecorder *recorder;
+@property (nonatomic, strong, readonly) NSIndexSet *continuousBehaviorIndexes;
+@property (nonatomic, copy, readonly) NSArray<UIButton *> *targetButtons;
+@property (nonatomic, strong, readonly) UILabel *timerLabel;
+@property (nonatomic, strong) NSTimer *timer;
+@property (nonatomic, assign) uint64_t timeLimit; // Nanoseconds; 0 if the session is not limited
+@property (nonatomic, assign) uint64_t displayedSeconds;
+
+@end
+
+
+@implementation BLMSessionRecordingController
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID delegate:(id<BLMSessionRecordingControllerDelegate>)delegate {
+    assert(sessionUUID != nil);
+    assert(delegate != nil);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _sessionUUID = sessionUUID;
+    _delegate = delegate;
+    _latencyHistogram = [[BLMLatencyHistogram alloc] init];
+
+    return self;
+}
+
+
+- (void)viewDidLoad {
+    [super viewDidLoad];
+
+    BLMDataManager *dataManager = [BLMDataManager sharedManager];
+    BLMSession *session = [dataManager sessionForUUID:self.sessionUUID];
+    BLMSessionConfiguration *sessionConfiguration = [dataManager sessionConfigurationForUUID:session.configurationUUID];
+
+    assert(session != nil);
+    assert(sessionConfiguration != nil);
+
+    self.navigationItem.title = session.name;
+    self.navigationItem.rightBarButtonItem = [[UIBarButtonItem alloc] initWithTitle:@"Start" style:UIBarButtonItemStyleDone target:self action:@selector(handleActionForStartStopButtonItem:)];
+
+    self.edgesForExtendedLayout = UIRectEdgeNone;
+    self.view.backgroundColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeDefaultBackground];
+    self.view.multipleTouchEnabled = YES; // Taps on different targets are recorded even when they overlap
+
+    self.timeLimit = ((uint64_t)MAX(sessionConfiguration.timeLimit, 0) * NSEC_PER_SEC);
+
+    // Timer Label
+
+    _timerLabel = [[UILabel alloc] init];
+
+    self.timerLabel.font = [UIFont monospacedDigitSystemFontOfSize:TimerLabelFontSize weight:UIFontWeightRegular];
+    self.timerLabel.textAlignment = NSTextAlignmentCenter;
+    self.timerLabel.textColor = [BLMViewUtils colorForHexCode:BLMColorHexCodeBlack];
+    self.timerLabel.backgroundColor = self.view.backgroundColor;
+    self.timerLabel.text = [BLMSessionRecordingController timerTextForSeconds:0];
+
+    [self.view addSubview:self.timerLabel];
+
+    // Targets
+
+    NSMutableArray<UIButton *> *targetButtons = [NSMutableArray array];
+    NSMutableIndexSet *continuousBehaviorIndexes = [NSMutableIndexSet indexSet];
+
+    [sessionConfiguration.behaviorUUIDs enumerateObjectsUsingBlock:^(NSUUID *__nonnull behaviorUUID, NSUInteger index, BOOL *__nonnull stop) {
+        BLMBehavior *behavior = [dataManager behaviorForUUID:behaviorUUID];
+        UIButton *targetButton = [UIButton buttonWithType:UIButtonTypeCustom];
+
+        if (behavior.isContinuous) {
+            [continuousBehaviorIndexes addIndex:index];
+        }
+
+        [targetButton addTarget:self action:@selector(handleTouchDownForTargetButton:event:) forControlEvents:UIControlEventTouchDown];
+
+        [targetButton setTitle:behavior.name forState:UIControlStateNormal];
+        [targetButton setTitleColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeBlack] forState:UIControlStateNormal];
+        [targetButton setTitleColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeWhite] forState:UIControlStateHighlighted];
+        [targetButton setTitleColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeWhite] forState:UIControlStateSelected];
+        [targetButton setTitleColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeWhite] forState:(UIControlStateSelected | UIControlStateHighlighted)];
+
+        [targetButton setBackgroundImage:[BLMViewUtils imageWithColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeDarkBackground]] forState:UIControlStateNormal];
+        [targetButton setBackgroundImage:[BLMViewUtils imageWithColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeBlue]] forState:UIControlStateHighlighted];
+        [targetButton setBackgroundImage:[BLMViewUtils imageWithColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeGreen]] forState:UIControlStateSelected];
+        [targetButton setBackgroundImage:[BLMViewUtils imageWithColor:[BLMViewUtils colorForHexCode:BLMColorHexCodeBlue]] forState:(UIControlStateSelected | UIControlStateHighlighted)];
+
+        targetButton.tag = (NSInteger)index;
+        targetButton.enabled = NO;
+        targetButton.exclusiveTouch = NO;
+        targetButton.clipsToBounds = YES;
+        targetButton.layer.cornerRadius = BLMCollectionViewRoundedCornerRadius;
+        targetButton.titleLabel.font = [UIFont boldSystemFontOfSize:TargetTitleFontSize];
+        targetButton.titleLabel.numberOfLines = 0;
+        targetButton.titleLabel.textAlignment = NSTextAlignmentCenter;
+
+        [self.view addSubview:targetButton];
+        [targetButtons addObject:targetButton];
+    }];
+
+    _targetButtons = targetButtons;
+    _continuousBehaviorIndexes = continuousBehaviorIndexes;
+}
+
+
+- (void)viewDidLayoutSubviews { // Frames are set directly, so nothing is solved when the targets change state
+    [super viewDidLayoutSubviews];
+
+    CGRect contentRect = UIEdgeInsetsInsetRect(self.view.bounds, UIEdgeInsetsMake(ContentInset, ContentInset, ContentInset, ContentInset));
+    CGRect timerLabelFrame = CGRectZero;
+    CGRect targetAreaFrame = CGRectZero;
+
+    CGRectDivide(contentRect, &timerLabelFrame, &targetAreaFrame, (TimerLabelHeight + TargetSpacing), CGRectMinYEdge);
+    timerLabelFrame.size.height = TimerLabelHeight;
+
+    self.timerLabel.frame = CGRectPixelAlign(timerLabelFrame);
+
+    NSUInteger targetCount = self.targetButtons.count;
+
+    if (targetCount == 0) {
+        return;
+    }
+
+    NSUInteger columnCount = (NSUInteger)ceil(sqrt(targetCount));
+    NSUInteger rowCount = ((targetCount + columnCount - 1) / columnCount);
+    CGFloat targetWidth = ((CGRectGetWidth(targetAreaFrame) - ((columnCount - 1) * TargetSpacing)) / columnCount);
+    CGFloat targetHeight = ((CGRectGetHeight(targetAreaFrame) - ((rowCount - 1) * TargetSpacing)) / rowCount);
+
+    [self.targetButtons enumerateObjectsUsingBlock:^(UIButton *__nonnull targetButton, NSUInteger index, BOOL *__nonnull stop) {
+        NSUInteger row = (index / columnCount);
+        NSUInteger column = (index % columnCount);
+
+        targetButton.frame = CGRectPixelAlign((CGRect) {
+            .origin = {
+                .x = CGRectGetMinX(targetAreaFrame) + (column * (targetWidth + TargetSpacing)),
+                .y = CGRectGetMinY(targetAreaFrame) + (row * (targetHeight + TargetSpacing))
+            },
+            .size = {
+                .width = targetWidth,
+                .height = targetHeight
+            }
+        });
+    }];
+}
+
+#pragma mark Recording
+
+- (void)startRecording {
+    assert([NSThread isMainThread]);
+    assert(self.recorder == nil);
+
+    BLMDataManager *dataManager = [BLMDataManager sharedManager];
+
+    _recorder = [dataManager eventRecorderForSessionUUID:self.sessionUUID];
+
+    [dataManager updateSessionForUUID:self.sessionUUID property:BLMSessionPropertyStartDate value:[NSDate date] completion:nil];
+    [self.recorder startAtTimeOffset:0];
+
+    self.timer = [NSTimer timerWithTimeInterval:TimerUpdateInterval target:self selector:@selector(handleTimerFired:) userInfo:nil repeats:YES];
+    self.timer.tolerance = (TimerUpdateInterval / 2.0);
+
+    [[NSRunLoop mainRunLoop] addTimer:self.timer forMode:NSRunLoopCommonModes];
+
+    for (UIButton *targetButton in self.targetButtons) {
+        targetButton.enabled = YES;
+    }
+
+    self.navigationItem.hidesBackButton = YES;
+    self.navigationItem.rightBarButtonItem.title = @"End";
+}
+
+
+- (void)stopRecording {
+    assert([NSThread isMainThread]);
+    assert(self.recorder.isRecording);
+
+    [self.timer invalidate];
+    self.timer = nil;
+
+    for (UIButton *targetButton in self.targetButtons) {
+        targetButton.enabled = NO;
+    }
+
+    self.navigationItem.rightBarButtonItem.enabled = NO;
+
+    [[BLMDataManager sharedManager] updateSessionForUUID:self.sessionUUID property:BLMSessionPropertyEndDate value:[NSDate date] completion:nil]; // An episode still in progress is cut off at the end of the session, so no offsets are recorded here
+
+    [self.recorder stopWithCompletion:^{
+        self.navigationItem.hidesBackButton = NO;
+        [self.delegate sessionRecordingControllerDidFinish:self];
+    }];
+}
+
+
++ (NSString *)timerTextForSeconds:(uint64_t)seconds {
+    return [NSString stringWithFormat:@"%02llu:%02llu", (seconds / 60), (seconds % 60)];
+}
+
+#pragma mark Event Handling
+
+- (void)handleTouchDownForTargetButton:(UIButton *)targetButton event:(UIEvent *)event { // Touch down rather than touch up, so the event isn't held back until the finger lifts
+    assert(self.recorder.isRecording);
+
+    NSUInteger behaviorIndex = (NSUInteger)targetButton.tag;
+    BOOL isContinuous = [self.continuousBehaviorIndexes containsIndex:behaviorIndex];
+    BLMSessionEventType type = (!isContinuous ? BLMSessionEventTypeOccurrence : (targetButton.isSelected ? BLMSessionEventTypeOffset : BLMSessionEventTypeOnset));
+
+    if (![self.recorder recordEventWithType:type behaviorIndex:(uint32_t)behaviorIndex]) {
+        _droppedTapCount += 1;
+        return;
+    }
+
+    [self.latencyHistogram recordLatency:(CACurrentMediaTime() - event.timestamp)]; // Both are seconds since boot
+
+    if (isContinuous) {
+        targetButton.selected = !targetButton.isSelected;
+    }
+}
+
+
+- (void)handleActionForStartStopButtonItem:(UIBarButtonItem *)buttonItem {
+    if (self.recorder == nil) {
+        [self startRecording];
+    } else {
+        [self stopRecording];
+    }
+}
+
+
+- (void)handleTimerFired:(NSTimer *)timer {
+    uint64_t timeOffset = self.recorder.currentTimeOffset;
+    uint64_t seconds = (timeOffset / NSEC_PER_SEC);
+
+    if (seconds == self.displayedSeconds) { // Only redraw the label when its text changes
+        return;
+    }
+
+    self.displayedSeconds = seconds;
+    self.timerLabel.text = [BLMSessionRecordingController timerTextForSeconds:seconds];
+
+    if ((self.timeLimit > 0) && (timeOffset >= self.timeLimit)) {
+        self.timerLabel.textColor = [BLMCollectionViewCell errorColor];
+    }
+}
+
+@end
@@ -0,0 +1,44 @@
+//
+//  BLMSessionSummary.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/14/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMSessionMetrics.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/*
+ ` A persisted snapshot of an ended session's metrics, so trends across many sessions can be drawn
+ ` without replaying their events. A summary describes the session as it was when the summary was
+ ` made, and must be discarded whenever the session is updated. It also records the behaviors, their
+ ` continuity and the time limit its metrics were made with, since those belong to the configuration
+ ` and its behaviors rather than the session, and can change while the summary sits on disk.
+ */
+
+@interface BLMSessionSummary : NSObject <NSCoding>
+
+@property (nonatomic, strong, readonly) NSUUID *sessionUUID;
+@property (nonatomic, copy, readonly) NSOrderedSet<NSUUID *> *behaviorUUIDs;
+@property (nonatomic, copy, readonly) NSSet<NSUUID *> *continuousBehaviorUUIDs;
+@property (nonatomic, assign, readonly) uint64_t timeLimit; // Nanoseconds; 0 if the session is not limited
+@property (nonatomic, assign, readonly) uint64_t observedTimeOffset; // Nanoseconds the metrics were summarized at
+
++ (nullable instancetype)summaryWithContentsOfFile:(NSString *)path; // nil if there is no summary or it cannot be read
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID metrics:(BLMSessionMetrics *)metrics observedTimeOffset:(uint64_t)observedTimeOffset;
+
+- (BOOL)isSummaryOfMetrics:(BLMSessionMetrics *)metrics observedTimeOffset:(uint64_t)observedTimeOffset; // NO if the metrics would now be made differently, and the summary must be recomputed
+- (BOOL)getMetricsSummary:(BLMBehaviorMetricsSummary *)metricsSummary forBehaviorUUID:(NSUUID *)behaviorUUID; // NO if the behavior was not part of the session
+- (BOOL)writeToFile:(NSString *)path;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,151 @@
+//
+//  BLMSessionSummary.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/14/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMSessionSummary.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+#pragma mark Constants
+
+static NSString *const ArchiveVersionKey = @"ArchiveVersionKey";
+
+
+typedef NS_ENUM(NSInteger, ArchiveVersion) {
+    ArchiveVersionUnknown,
+    ArchiveVersionInitial, // Without the behaviors' continuity or the time limit
+    ArchiveVersionLatest
+};
+
+
+#pragma mark
+
+@interface BLMSessionSummary ()
+
+@property (nonatomic, copy, readonly) NSData *metricsSummaries; // One BLMBehaviorMetricsSummary per behavior UUID
+
+@end
+
+
+@implementation BLMSessionSummary
+
++ (nullable instancetype)summaryWithContentsOfFile:(NSString *)path {
+    BLMSessionSummary *summary = nil;
+
+    @try {
+        summary = [NSKeyedUnarchiver unarchiveObjectWithFile:path];
+    } @catch (NSException *exception) { // A damaged summary is recomputed from the session's events
+        return nil;
+    }
+
+    return ([summary isKindOfClass:[BLMSessionSummary class]] ? summary : nil);
+}
+
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs continuousBehaviorUUIDs:(NSSet<NSUUID *> *)continuousBehaviorUUIDs timeLimit:(uint64_t)timeLimit observedTimeOffset:(uint64_t)observedTimeOffset metricsSummaries:(NSData *)metricsSummaries {
+    assert(metricsSummaries.length == (behaviorUUIDs.count * sizeof(BLMBehaviorMetricsSummary)));
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _sessionUUID = sessionUUID;
+    _behaviorUUIDs = [behaviorUUIDs copy];
+    _continuousBehaviorUUIDs = [continuousBehaviorUUIDs copy];
+    _timeLimit = timeLimit;
+    _observedTimeOffset = observedTimeOffset;
+    _metricsSummaries = [metricsSummaries copy];
+
+    return self;
+}
+
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID metrics:(BLMSessionMetrics *)metrics observedTimeOffset:(uint64_t)observedTimeOffset {
+    NSMutableData *metricsSummaries = [NSMutableData dataWithLength:(metrics.behaviorUUIDs.count * sizeof(BLMBehaviorMetricsSummary))];
+    BLMBehaviorMetricsSummary *summaries = metricsSummaries.mutableBytes;
+
+    for (NSUInteger behaviorIndex = 0; behaviorIndex < metrics.behaviorUUIDs.count; behaviorIndex += 1) {
+        summaries[behaviorIndex] = [metrics summaryForBehaviorIndex:behaviorIndex atTimeOffset:observedTimeOffset];
+    }
+
+    return [self initWithSessionUUID:sessionUUID behaviorUUIDs:metrics.behaviorUUIDs continuousBehaviorUUIDs:metrics.continuousBehaviorUUIDs timeLimit:metrics.timeLimit observedTimeOffset:observedTimeOffset metricsSummaries:metricsSummaries];
+}
+
+
+- (BOOL)isSummaryOfMetrics:(BLMSessionMetrics *)metrics observedTimeOffset:(uint64_t)observedTimeOffset {
+    return ((self.observedTimeOffset == observedTimeOffset)
+            && (self.timeLimit == metrics.timeLimit)
+            && [self.behaviorUUIDs isEqualToOrderedSet:metrics.behaviorUUIDs]
+            && [self.continuousBehaviorUUIDs isEqualToSet:metrics.continuousBehaviorUUIDs]);
+}
+
+
+- (BOOL)getMetricsSummary:(BLMBehaviorMetricsSummary *)metricsSummary forBehaviorUUID:(NSUUID *)behaviorUUID {
+    NSUInteger behaviorIndex = [self.behaviorUUIDs indexOfObject:behaviorUUID];
+
+    if (behaviorIndex == NSNotFound) {
+        return NO;
+    }
+
+    *metricsSummary = ((BLMBehaviorMetricsSummary const *)self.metricsSummaries.bytes)[behaviorIndex];
+
+    return YES;
+}
+
+
+- (BOOL)writeToFile:(NSString *)path {
+    NSError *error = nil;
+
+    if (![[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:&error]) {
+        return NO;
+    }
+
+    return [NSKeyedArchiver archiveRootObject:self toFile:path];
+}
+
+#pragma mark NSCoding
+
+- (nullable instancetype)initWithCoder:(NSCoder *)decoder {
+    if ([decoder decodeIntegerForKey:ArchiveVersionKey] != ArchiveVersionLatest) { // Summaries are a cache, so older layouts are simply recomputed
+        return nil;
+    }
+
+    NSOrderedSet<NSUUID *> *behaviorUUIDs = [decoder decodeObjectForKey:@"behaviorUUIDs"];
+    NSSet<NSUUID *> *continuousBehaviorUUIDs = [decoder decodeObjectForKey:@"continuousBehaviorUUIDs"];
+    NSData *metricsSummaries = [decoder decodeObjectForKey:@"metricsSummaries"];
+
+    if ((behaviorUUIDs == nil) || (continuousBehaviorUUIDs == nil) || (metricsSummaries.length != (behaviorUUIDs.count * sizeof(BLMBehaviorMetricsSummary)))) {
+        return nil;
+    }
+
+    return [self initWithSessionUUID:[decoder decodeObjectForKey:@"sessionUUID"]
+                       behaviorUUIDs:behaviorUUIDs
+             continuousBehaviorUUIDs:continuousBehaviorUUIDs
+                           timeLimit:(uint64_t)[decoder decodeInt64ForKey:@"timeLimit"]
+                  observedTimeOffset:(uint64_t)[decoder decodeInt64ForKey:@"observedTimeOffset"]
+                    metricsSummaries:metricsSummaries];
+}
+
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.sessionUUID forKey:@"sessionUUID"];
+    [coder encodeObject:self.behaviorUUIDs forKey:@"behaviorUUIDs"];
+    [coder encodeObject:self.continuousBehaviorUUIDs forKey:@"continuousBehaviorUUIDs"];
+    [coder encodeInt64:(int64_t)self.timeLimit forKey:@"timeLimit"];
+    [coder encodeInt64:(int64_t)self.observedTimeOffset forKey:@"observedTimeOffset"];
+    [coder encodeObject:self.metricsSummaries forKey:@"metricsSummaries"];
+    [coder encodeInteger:ArchiveVersionLatest forKey:ArchiveVersionKey];
+}
+
+@end
+
+
+NS_ASSUME_NONNULL_END
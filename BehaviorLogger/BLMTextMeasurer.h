@@ -0,0 +1,60 @@
+//
+//  BLMTextMeasurer.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/28/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+extern CGFloat const BLMTextMeasurerUnboundedWidth; // Measures text on a single line
+
+
+#pragma mark
+
+/*
+ ` Caches the sizes that text draws at, keyed by (string, font, width), rounded up the same way UILabel
+ ` rounds its intrinsic content size. Plain strings are measured with a font; attributed strings carry
+ ` their own attributes. Text expected to appear soon can be prefetched, which measures every uncached
+ ` entry on a serial background queue so that configuring and laying out cells only reads the cache.
+ `
+ ` All messages must be sent from the main thread.
+ */
+
+@interface BLMTextMeasurer : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger hitCount; // Sizes answered from the cache
+@property (nonatomic, assign, readonly) NSUInteger missCount; // Sizes measured synchronously on the main thread because they weren't prefetched
+
++ (instancetype)sharedMeasurer;
+
+- (CGSize)sizeForText:(NSString *)text font:(UIFont *)font width:(CGFloat)width; // Measured synchronously and cached on a miss
+- (CGSize)sizeForAttributedText:(NSAttributedString *)attributedText width:(CGFloat)width;
+
+- (void)prefetchSizesForTexts:(NSArray<NSString *> *)texts font:(UIFont *)font width:(CGFloat)width;
+- (void)prefetchSizesForAttributedTexts:(NSArray<NSAttributedString *> *)attributedTexts width:(CGFloat)width;
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Answers its intrinsic content size from the shared measurer instead of measuring its text during
+ ` constraint solving. Single line labels ignore preferredMaxLayoutWidth, so they never need the second
+ ` layout pass that multi-line labels take once their width is known.
+ */
+
+@interface BLMMeasuredLabel : UILabel
+
+- (BOOL)updatePreferredMaxLayoutWidth; // Matches preferredMaxLayoutWidth to the current frame; YES if the label's intrinsic size may have changed, requiring another layout pass
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,268 @@
+//
+//  BLMTextMeasurer.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/28/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMTextMeasurer.h"
+#import "BLMUtils.h"
+
+
+#pragma mark Constants
+
+CGFloat const BLMTextMeasurerUnboundedWidth = CGFLOAT_MAX;
+
+
+static NSUInteger const CacheCountLimit = 500;
+
+
+#pragma mark
+
+@interface MeasurementKey : NSObject <NSCopying>
+
+@property (nonatomic, copy, readonly) id text; // NSString or NSAttributedString
+@property (nullable, nonatomic, strong, readonly) UIFont *font; // nil for attributed text
+@property (nonatomic, assign, readonly) CGFloat width;
+
+@end
+
+
+@implementation MeasurementKey
+
+- (instancetype)initWithText:(id)text font:(UIFont *)font width:(CGFloat)width {
+    assert([text isKindOfClass:[NSString class]] ? (font != nil) : ([text isKindOfClass:[NSAttributedString class]] && (font == nil)));
+    assert(width > 0.0);
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _text = [text copy];
+    _font = font;
+    _width = width;
+
+    return self;
+}
+
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // Immutable
+}
+
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[self class]]) {
+        return NO;
+    }
+
+    MeasurementKey *other = object;
+
+    return ((self.width == other.width)
+            && [BLMUtils isObject:self.font equalToObject:other.font]
+            && [BLMUtils isObject:self.text equalToObject:other.text]);
+}
+
+
+- (NSUInteger)hash {
+    return ([self.text hash] ^ self.font.hash ^ @(self.width).hash);
+}
+
+
+- (CGSize)measure { // Safe to call from any thread
+    CGRect boundingRect = CGRectZero;
+
+    if ([self.text isKindOfClass:[NSAttributedString class]]) {
+        boundingRect = [(NSAttributedString *)self.text boundingRectWithSize:CGSizeMake(self.width, CGFLOAT_MAX) options:NSStringDrawingUsesLineFragmentOrigin context:nil];
+    } else {
+        boundingRect = [(NSString *)self.text boundingRectWithSize:CGSizeMake(self.width, CGFLOAT_MAX) options:NSStringDrawingUsesLineFragmentOrigin attributes:@{ NSFontAttributeName:self.font } context:nil];
+    }
+
+    return CGSizeMake(ceil(CGRectGetWidth(boundingRect)), ceil(CGRectGetHeight(boundingRect)));
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMTextMeasurer ()
+
+@property (nonatomic, strong, readonly) NSCache<MeasurementKey *, NSValue *> *sizeByKey; // Written from both the main thread and queue
+@property (nonatomic, strong, readonly) NSOperationQueue *queue;
+
+@end
+
+
+@implementation BLMTextMeasurer
+
++ (instancetype)sharedMeasurer {
+    assert([NSThread isMainThread]);
+
+    static BLMTextMeasurer *sharedMeasurer = nil;
+    static dispatch_once_t onceToken = 0;
+
+    dispatch_once(&onceToken, ^{
+        sharedMeasurer = [[BLMTextMeasurer alloc] init];
+    });
+
+    return sharedMeasurer;
+}
+
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _sizeByKey = [[NSCache alloc] init];
+    _queue = [[NSOperationQueue alloc] init];
+
+    self.sizeByKey.countLimit = CacheCountLimit;
+
+    self.queue.name = @"com.3bird.BehaviorLogger.TextMeasurement";
+    self.queue.maxConcurrentOperationCount = 1;
+    self.queue.qualityOfService = NSQualityOfServiceUserInitiated;
+
+    return self;
+}
+
+
+- (CGSize)sizeForText:(NSString *)text font:(UIFont *)font width:(CGFloat)width {
+    return [self sizeForKey:[[MeasurementKey alloc] initWithText:text font:font width:width]];
+}
+
+
+- (CGSize)sizeForAttributedText:(NSAttributedString *)attributedText width:(CGFloat)width {
+    return [self sizeForKey:[[MeasurementKey alloc] initWithText:attributedText font:nil width:width]];
+}
+
+
+- (CGSize)sizeForKey:(MeasurementKey *)key {
+    assert([NSThread isMainThread]);
+
+    NSValue *size = [self.sizeByKey objectForKey:key];
+
+    if (size != nil) {
+        _hitCount += 1;
+        return size.CGSizeValue;
+    }
+
+    _missCount += 1;
+
+    CGSize measuredSize = [key measure];
+    [self.sizeByKey setObject:[NSValue valueWithCGSize:measuredSize] forKey:key];
+
+    return measuredSize;
+}
+
+
+- (void)prefetchSizesForTexts:(NSArray<NSString *> *)texts font:(UIFont *)font width:(CGFloat)width {
+    NSMutableArray<MeasurementKey *> *keys = [NSMutableArray array];
+
+    for (NSString *text in texts) {
+        [keys addObject:[[MeasurementKey alloc] initWithText:text font:font width:width]];
+    }
+
+    [self prefetchSizesForKeys:keys];
+}
+
+
+- (void)prefetchSizesForAttributedTexts:(NSArray<NSAttributedString *> *)attributedTexts width:(CGFloat)width {
+    NSMutableArray<MeasurementKey *> *keys = [NSMutableArray array];
+
+    for (NSAttributedString *attributedText in attributedTexts) {
+        [keys addObject:[[MeasurementKey alloc] initWithText:attributedText font:nil width:width]];
+    }
+
+    [self prefetchSizesForKeys:keys];
+}
+
+
+- (void)prefetchSizesForKeys:(NSArray<MeasurementKey *> *)keys {
+    assert([NSThread isMainThread]);
+
+    NSMutableArray<MeasurementKey *> *uncachedKeys = [NSMutableArray array];
+
+    for (MeasurementKey *key in keys) {
+        if ([self.sizeByKey objectForKey:key] == nil) {
+            [uncachedKeys addObject:key];
+        }
+    }
+
+    if (uncachedKeys.count == 0) {
+        return;
+    }
+
+    [self.queue addOperationWithBlock:^{
+        for (MeasurementKey *key in uncachedKeys) {
+            if ([self.sizeByKey objectForKey:key] == nil) { // May have been measured on the main thread since being enqueued
+                [self.sizeByKey setObject:[NSValue valueWithCGSize:[key measure]] forKey:key];
+            }
+        }
+    }];
+}
+
+@end
+
+
+#pragma mark
+
+@interface BLMMeasuredLabel ()
+
+@property (nonatomic, assign, getter=isTextAttributed) BOOL textAttributed;
+
+@end
+
+
+@implementation BLMMeasuredLabel
+
+- (void)setText:(NSString *)text {
+    [super setText:text];
+    self.textAttributed = NO;
+}
+
+
+- (void)setAttributedText:(NSAttributedString *)attributedText {
+    [super setAttributedText:attributedText];
+    self.textAttributed = (attributedText != nil);
+}
+
+
+- (CGSize)intrinsicContentSize {
+    if ((self.text.length == 0) || ((self.numberOfLines != 0) && (self.numberOfLines != 1))) {
+        return [super intrinsicContentSize];
+    }
+
+    CGFloat width = (((self.numberOfLines == 1) || (self.preferredMaxLayoutWidth <= 0.0)) ? BLMTextMeasurerUnboundedWidth : self.preferredMaxLayoutWidth);
+
+    if (self.isTextAttributed) {
+        return [[BLMTextMeasurer sharedMeasurer] sizeForAttributedText:self.attributedText width:width];
+    }
+
+    return [[BLMTextMeasurer sharedMeasurer] sizeForText:self.text font:self.font width:width];
+}
+
+
+- (BOOL)updatePreferredMaxLayoutWidth {
+    if (self.numberOfLines == 1) {
+        return NO;
+    }
+
+    CGFloat preferredMaxLayoutWidth = CGRectGetWidth([self alignmentRectForFrame:self.frame]);
+
+    if (preferredMaxLayoutWidth == self.preferredMaxLayoutWidth) {
+        return NO;
+    }
+
+    self.preferredMaxLayoutWidth = preferredMaxLayoutWidth;
+
+    return YES;
+}
+
+@end
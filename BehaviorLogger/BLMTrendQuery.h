@@ -0,0 +1,75 @@
+//
+//  BLMTrendQuery.h
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/14/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "BLMSessionConfiguration.h"
+#import "BLMSessionMetrics.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+typedef NS_ENUM(NSInteger, BLMTrendMetric) {
+    BLMTrendMetricFrequency,
+    BLMTrendMetricRatePerMinute,
+    BLMTrendMetricTotalDuration,
+    BLMTrendMetricMeanDuration,
+    BLMTrendMetricMeanInterResponseTime,
+    BLMTrendMetricLatency,
+    BLMTrendMetricCount
+};
+
+
+typedef NS_ENUM(NSInteger, BLMTrendGrouping) {
+    BLMTrendGroupingNone,
+    BLMTrendGroupingCondition,
+    BLMTrendGroupingTherapist,
+    BLMTrendGroupingLocation
+};
+
+
+#pragma mark
+
+@interface BLMTrendPoint : NSObject
+
+@property (nonatomic, strong, readonly) NSUUID *sessionUUID;
+@property (nonatomic, strong, readonly) NSDate *startDate;
+@property (nonatomic, assign, readonly) double value;
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID startDate:(NSDate *)startDate value:(double)value;
+
+@end
+
+
+#pragma mark
+
+/*
+ ` Describes one behavior's metric across a project's ended sessions, e.g. the rate of a behavior per
+ ` session over the last month grouped by therapist. Sessions whose configuration does not include the
+ ` behavior are left out.
+ */
+
+@interface BLMTrendQuery : NSObject
+
+@property (nonatomic, strong, readonly) NSUUID *behaviorUUID;
+@property (nonatomic, assign, readonly) BLMTrendMetric metric;
+@property (nonatomic, assign, readonly) BLMTrendGrouping grouping;
+@property (nullable, nonatomic, strong, readonly) NSDate *fromDate; // Sessions starting at or after this date; nil for no lower bound
+@property (nullable, nonatomic, strong, readonly) NSDate *toDate; // Sessions starting before this date; nil for no upper bound
+
+- (instancetype)initWithBehaviorUUID:(NSUUID *)behaviorUUID metric:(BLMTrendMetric)metric grouping:(BLMTrendGrouping)grouping fromDate:(nullable NSDate *)fromDate toDate:(nullable NSDate *)toDate;
+
+- (BOOL)includesSessionStartDate:(NSDate *)startDate;
+- (NSString *)groupForSessionConfiguration:(BLMSessionConfiguration *)sessionConfiguration; // An empty string when ungrouped, or when the configuration has no value to group by
+- (double)valueForMetricsSummary:(BLMBehaviorMetricsSummary)metricsSummary;
+
+@end
+
+
+NS_ASSUME_NONNULL_END
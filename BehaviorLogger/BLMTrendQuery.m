@@ -0,0 +1,127 @@
+//
+//  BLMTrendQuery.m
+//  BehaviorLogger
+//
+//  Created by Steven Byrd on 5/14/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMTrendQuery.h"
+
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+#pragma mark
+
+@implementation BLMTrendPoint
+
+- (instancetype)initWithSessionUUID:(NSUUID *)sessionUUID startDate:(NSDate *)startDate value:(double)value {
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _sessionUUID = sessionUUID;
+    _startDate = startDate;
+    _value = value;
+
+    return self;
+}
+
+@end
+
+
+#pragma mark
+
+@implementation BLMTrendQuery
+
+- (instancetype)initWithBehaviorUUID:(NSUUID *)behaviorUUID metric:(BLMTrendMetric)metric grouping:(BLMTrendGrouping)grouping fromDate:(nullable NSDate *)fromDate toDate:(nullable NSDate *)toDate {
+    assert((metric >= 0) && (metric < BLMTrendMetricCount));
+
+    self = [super init];
+
+    if (self == nil) {
+        return nil;
+    }
+
+    _behaviorUUID = behaviorUUID;
+    _metric = metric;
+    _grouping = grouping;
+    _fromDate = fromDate;
+    _toDate = toDate;
+
+    return self;
+}
+
+
+- (BOOL)includesSessionStartDate:(NSDate *)startDate {
+    if ((self.fromDate != nil) && ([startDate compare:self.fromDate] == NSOrderedAscending)) {
+        return NO;
+    }
+
+    if ((self.toDate != nil) && ([startDate compare:self.toDate] != NSOrderedAscending)) {
+        return NO;
+    }
+
+    return YES;
+}
+
+
+- (NSString *)groupForSessionConfiguration:(BLMSessionConfiguration *)sessionConfiguration {
+    NSString *group = nil;
+
+    switch (self.grouping) {
+        case BLMTrendGroupingNone:
+            break;
+
+        case BLMTrendGroupingCondition:
+            group = sessionConfiguration.condition;
+            break;
+
+        case BLMTrendGroupingTherapist:
+            group = sessionConfiguration.therapist;
+            break;
+
+        case BLMTrendGroupingLocation:
+            group = sessionConfiguration.location;
+            break;
+    }
+
+    return (group ?: @"");
+}
+
+
+- (double)valueForMetricsSummary:(BLMBehaviorMetricsSummary)metricsSummary {
+    switch (self.metric) {
+        case BLMTrendMetricFrequency:
+            return metricsSummary.Frequency;
+
+        case BLMTrendMetricRatePerMinute:
+            return metricsSummary.RatePerMinute;
+
+        case BLMTrendMetricTotalDuration:
+            return metricsSummary.TotalDuration;
+
+        case BLMTrendMetricMeanDuration:
+            return metricsSummary.MeanDuration;
+
+        case BLMTrendMetricMeanInterResponseTime:
+            return metricsSummary.MeanInterResponseTime;
+
+        case BLMTrendMetricLatency:
+            return metricsSummary.Latency;
+
+        case BLMTrendMetricCount:
+            break;
+    }
+
+    assert(NO);
+    return 0.0;
+}
+
+@end
+
+
+NS_ASSUME_NONNULL_END
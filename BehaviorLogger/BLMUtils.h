@@ -28,6 +28,8 @@ NS_ASSUME_NONNULL_BEGIN
 + (double)doubleFromDictionary:(NSDictionary *)dictionary forKey:(id<NSCopying>)key defaultValue:(double)defaultValue;
 + (BOOL)boolFromDictionary:(NSDictionary *)dictionary forKey:(id<NSCopying>)key defaultValue:(BOOL)defaultValue;
 
++ (uint32_t)checksumForBytes:(void const *)bytes length:(NSUInteger)length; // FNV-1a; detects torn writes, not tampering
+
 @end
 
 
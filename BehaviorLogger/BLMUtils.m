@@ -138,4 +138,17 @@
     return value.boolValue;
 }
 
+
++ (uint32_t)checksumForBytes:(void const *)bytes length:(NSUInteger)length {
+    uint8_t const *byteArray = bytes;
+    uint32_t hash = 2166136261u;
+
+    for (NSUInteger index = 0; index < length; index += 1) {
+        hash ^= byteArray[index];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
 @end
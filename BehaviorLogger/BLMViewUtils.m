@@ -6,6 +6,7 @@
 //  Copyright © 2016 3Bird. All rights reserved.
 //
 
+#import "BLMImageCache.h"
 #import "BLMViewUtils.h"
 
 
@@ -63,8 +64,6 @@ CGPoint CGRectGetCenter(CGRect rect) {
 #pragma mark Images
 
 + (UIImage *)imageWithColor:(UIColor *)color {
-    CGFloat scale = [UIScreen mainScreen].scale;
-    CGRect rect = CGRectMake(0.0, 0.0, 1.0, 1.0);
     CGFloat alpha = 1.0;
     BOOL success = [color getRed:NULL green:NULL blue:NULL alpha:&alpha];
 
@@ -72,169 +71,124 @@ CGPoint CGRectGetCenter(CGRect rect) {
         alpha = 0.5;
     }
 
-    UIGraphicsBeginImageContextWithOptions(rect.size, alpha >= 1.0, scale);
+    return [[BLMImageCache sharedCache] imageForShape:@"Fill" color:color size:CGSizeMake(1.0, 1.0) opaque:(alpha >= 1.0) capInsets:UIEdgeInsetsZero drawingHandler:^(CGSize size) {
+        UIBezierPath *path = [UIBezierPath bezierPathWithRect:(CGRect){ .size = size }];
 
-    UIBezierPath *path = [UIBezierPath bezierPathWithRect:rect];
-
-    [color setFill];
-    [path fill];
-
-    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
-    UIGraphicsEndImageContext();
-
-    return image;
+        [color setFill];
+        [path fill];
+    }];
 }
 
 
 + (UIImage *)infoImageWithColor:(UIColor *)color {
-    CGFloat scale = [UIScreen mainScreen].scale;
     CGFloat inset = 0.5;
-    CGSize size = CGSizeMake(26.0 + (3.0 * inset), 26.0 + (3.0 * inset));
-
-    UIGraphicsBeginImageContextWithOptions(size, NO, scale);
-
-    CGRect circleRect = CGRectMake(0.0 + inset, 0.0 + inset, size.width - (2.0 * inset), size.height - (2.0 * inset));
-    UIBezierPath *path = [UIBezierPath bezierPathWithOvalInRect:circleRect];
-
-    path.lineWidth = 1.0;
 
-    [color setStroke];
-    [path stroke];
+    return [[BLMImageCache sharedCache] imageForShape:@"Info" color:color size:CGSizeMake(26.0 + (3.0 * inset), 26.0 + (3.0 * inset)) opaque:NO capInsets:UIEdgeInsetsZero drawingHandler:^(CGSize size) {
+        CGRect circleRect = CGRectMake(0.0 + inset, 0.0 + inset, size.width - (2.0 * inset), size.height - (2.0 * inset));
+        UIBezierPath *path = [UIBezierPath bezierPathWithOvalInRect:circleRect];
 
-    NSDictionary *attributes = @{ NSFontAttributeName : [UIFont systemFontOfSize:20.0], NSParagraphStyleAttributeName : [BLMViewUtils centerAlignedParagraphStyle], NSForegroundColorAttributeName : color};
-    NSAttributedString *styledText = [[NSAttributedString alloc] initWithString:@"i" attributes:attributes];
+        path.lineWidth = 1.0;
 
-    circleRect.origin.y = 1.0 + round(circleRect.size.height - styledText.size.height) / 2.0;
+        [color setStroke];
+        [path stroke];
 
-    [styledText drawInRect:circleRect];
+        NSDictionary *attributes = @{ NSFontAttributeName : [UIFont systemFontOfSize:20.0], NSParagraphStyleAttributeName : [BLMViewUtils centerAlignedParagraphStyle], NSForegroundColorAttributeName : color};
+        NSAttributedString *styledText = [[NSAttributedString alloc] initWithString:@"i" attributes:attributes];
 
-    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
-    UIGraphicsEndImageContext();
+        circleRect.origin.y = 1.0 + round(circleRect.size.height - styledText.size.height) / 2.0;
 
-    return image;
+        [styledText drawInRect:circleRect];
+    }];
 }
 
 
 + (UIImage *)plusSignImageWithColor:(UIColor *)color {
-    CGFloat scale = [UIScreen mainScreen].scale;
-    CGFloat lineWidth = 5.0;
-    CGFloat inset = (lineWidth / 2.0);
-    CGSize size = CGSizeMake(60.0, 60.0);
+    return [[BLMImageCache sharedCache] imageForShape:@"PlusSign" color:color size:CGSizeMake(60.0, 60.0) opaque:NO capInsets:UIEdgeInsetsZero drawingHandler:^(CGSize size) {
+        CGFloat lineWidth = 5.0;
+        CGFloat inset = (lineWidth / 2.0);
+        CGRect circleRect = CGRectMake(0.0 + inset, 0.0 + inset, size.width - (2.0 * inset), size.height - (2.0 * inset));
+        UIBezierPath *path = [UIBezierPath bezierPathWithOvalInRect:circleRect];
 
-    UIGraphicsBeginImageContextWithOptions(size, NO, scale);
+        path.lineWidth = lineWidth;
 
-    CGRect circleRect = CGRectMake(0.0 + inset, 0.0 + inset, size.width - (2.0 * inset), size.height - (2.0 * inset));
-    UIBezierPath *path = [UIBezierPath bezierPathWithOvalInRect:circleRect];
+        [color setStroke];
+        [path stroke];
 
-    path.lineWidth = lineWidth;
+        path = [UIBezierPath bezierPath];
 
-    [color setStroke];
-    [path stroke];
+        path.lineWidth = lineWidth;
 
-    path = [UIBezierPath bezierPath];
+        [path moveToPoint:CGPointMake((size.width / 4.0), (size.height / 2.0))];
+        [path addLineToPoint:CGPointMake(((3 * size.width) / 4.0), (size.height / 2.0))];
 
-    path.lineWidth = lineWidth;
+        [path moveToPoint:CGPointMake((size.width / 2.0), (size.height / 4.0))];
+        [path addLineToPoint:CGPointMake((size.width / 2.0), ((3 * size.height) / 4.0))];
 
-    [path moveToPoint:CGPointMake((size.width / 4.0), (size.height / 2.0))];
-    [path addLineToPoint:CGPointMake(((3 * size.width) / 4.0), (size.height / 2.0))];
-
-    [path moveToPoint:CGPointMake((size.width / 2.0), (size.height / 4.0))];
-    [path addLineToPoint:CGPointMake((size.width / 2.0), ((3 * size.height) / 4.0))];
-
-    [path stroke];
-
-    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
-    UIGraphicsEndImageContext();
-    
-    return image;
+        [path stroke];
+    }];
 }
 
 
 + (UIImage *)acceptImageWithColor:(UIColor *)color {
-    CGFloat scale = [UIScreen mainScreen].scale;
-    CGSize size = CGSizeMake(31.5, 21.5);
-
-    UIGraphicsBeginImageContextWithOptions(size, NO, scale);
-
-    UIBezierPath *path = [UIBezierPath bezierPath];
-
-    [path moveToPoint:CGPointMake(0.0, size.height / 2.0)];
-    [path addLineToPoint:CGPointMake(11.25, size.height - 0.5)];
-    [path addLineToPoint:CGPointMake(size.width, 0.0)];
+    return [[BLMImageCache sharedCache] imageForShape:@"Accept" color:color size:CGSizeMake(31.5, 21.5) opaque:NO capInsets:UIEdgeInsetsZero drawingHandler:^(CGSize size) {
+        UIBezierPath *path = [UIBezierPath bezierPath];
 
-    path.lineWidth = 1.0;
+        [path moveToPoint:CGPointMake(0.0, size.height / 2.0)];
+        [path addLineToPoint:CGPointMake(11.25, size.height - 0.5)];
+        [path addLineToPoint:CGPointMake(size.width, 0.0)];
 
-    [color setStroke];
-    [path stroke];
+        path.lineWidth = 1.0;
 
-    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
-
-    UIGraphicsEndImageContext();
-
-    return image;
+        [color setStroke];
+        [path stroke];
+    }];
 }
 
 
 + (UIImage *)rejectImageWithColor:(UIColor *)color {
-    CGFloat scale = [UIScreen mainScreen].scale;
-    CGSize size = CGSizeMake(22.5, 22.5);
-
-    UIGraphicsBeginImageContextWithOptions(size, NO, scale);
-
-    UIBezierPath *path = [UIBezierPath bezierPath];
-
-    [path moveToPoint:CGPointMake(0.0, 0.0)];
-    [path addLineToPoint:CGPointMake(size.width, size.height)];
-
-    [path moveToPoint:CGPointMake(size.width, 0.0)];
-    [path addLineToPoint:CGPointMake(0.0, size.height)];
+    return [[BLMImageCache sharedCache] imageForShape:@"Reject" color:color size:CGSizeMake(22.5, 22.5) opaque:NO capInsets:UIEdgeInsetsZero drawingHandler:^(CGSize size) {
+        UIBezierPath *path = [UIBezierPath bezierPath];
 
-    path.lineWidth = 1.0;
+        [path moveToPoint:CGPointMake(0.0, 0.0)];
+        [path addLineToPoint:CGPointMake(size.width, size.height)];
 
-    [color setStroke];
-    [path stroke];
+        [path moveToPoint:CGPointMake(size.width, 0.0)];
+        [path addLineToPoint:CGPointMake(0.0, size.height)];
 
-    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+        path.lineWidth = 1.0;
 
-    UIGraphicsEndImageContext();
-
-    return image;
+        [color setStroke];
+        [path stroke];
+    }];
 }
 
 
 + (UIImage *)deleteItemImageWithBackgroundColor:(UIColor *)backgroundColor diameter:(CGFloat)diameter {
-    CGSize canvasSize = CGSizeMake((diameter + 2.0), (diameter + 2.0));
-    CGRect frame = CGRectMake(((canvasSize.width - diameter) / 2.0), ((canvasSize.height - diameter) / 2.0), diameter, diameter);
-
-    UIGraphicsBeginImageContextWithOptions(canvasSize, NO, [UIScreen mainScreen].scale);
-
-    [backgroundColor setFill];
-    [[self colorForHexCode:BLMColorHexCodeWhite] setStroke];
-
-    UIBezierPath *path = [UIBezierPath bezierPath];
-
-    [path addArcWithCenter:CGPointMake(CGRectGetMidX(frame), CGRectGetMidY(frame)) radius:(diameter * 0.5) startAngle:0 endAngle:(2 * M_PI) clockwise:NO];
-    [path closePath];
-    [path fill];
+    return [[BLMImageCache sharedCache] imageForShape:@"DeleteItem" color:backgroundColor size:CGSizeMake((diameter + 2.0), (diameter + 2.0)) opaque:NO capInsets:UIEdgeInsetsZero drawingHandler:^(CGSize canvasSize) {
+        CGRect frame = CGRectMake(((canvasSize.width - diameter) / 2.0), ((canvasSize.height - diameter) / 2.0), diameter, diameter);
 
-    path.lineWidth = 1.0;
+        [backgroundColor setFill];
+        [[self colorForHexCode:BLMColorHexCodeWhite] setStroke];
 
-    CGFloat leftX = CGRectGetMinX(frame) + ((CGRectGetMaxX(frame) - CGRectGetMinX(frame)) * 0.25);
-    CGFloat rightX = CGRectGetMinX(frame) + ((CGRectGetMaxX(frame) - CGRectGetMinX(frame)) * 0.75);
-    CGFloat topY = CGRectGetMinY(frame) + ((CGRectGetMaxY(frame) - CGRectGetMinY(frame)) * 0.25);
-    CGFloat bottomY = CGRectGetMinY(frame) + ((CGRectGetMaxY(frame) - CGRectGetMinY(frame)) * 0.75);
+        UIBezierPath *path = [UIBezierPath bezierPath];
 
-    [path moveToPoint:CGPointMake(leftX, topY)];
-    [path addLineToPoint:CGPointMake(rightX, bottomY)];
-    [path moveToPoint:CGPointMake(leftX, bottomY)];
-    [path addLineToPoint:CGPointMake(rightX, topY)];
-    [path stroke];
+        [path addArcWithCenter:CGPointMake(CGRectGetMidX(frame), CGRectGetMidY(frame)) radius:(diameter * 0.5) startAngle:0 endAngle:(2 * M_PI) clockwise:NO];
+        [path closePath];
+        [path fill];
 
-    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+        path.lineWidth = 1.0;
 
-    UIGraphicsEndImageContext();
+        CGFloat leftX = CGRectGetMinX(frame) + ((CGRectGetMaxX(frame) - CGRectGetMinX(frame)) * 0.25);
+        CGFloat rightX = CGRectGetMinX(frame) + ((CGRectGetMaxX(frame) - CGRectGetMinX(frame)) * 0.75);
+        CGFloat topY = CGRectGetMinY(frame) + ((CGRectGetMaxY(frame) - CGRectGetMinY(frame)) * 0.25);
+        CGFloat bottomY = CGRectGetMinY(frame) + ((CGRectGetMaxY(frame) - CGRectGetMinY(frame)) * 0.75);
 
-    return image;
+        [path moveToPoint:CGPointMake(leftX, topY)];
+        [path addLineToPoint:CGPointMake(rightX, bottomY)];
+        [path moveToPoint:CGPointMake(leftX, bottomY)];
+        [path addLineToPoint:CGPointMake(rightX, topY)];
+        [path stroke];
+    }];
 }
 
 #pragma mark Layout Constraints
@@ -0,0 +1,224 @@
+//
+//  BLMBinaryArchiveTests.m
+//  BehaviorLoggerTests
+//
+//  Created by Steven Byrd on 5/31/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMBehavior.h"
+#import "BLMBinaryArchive.h"
+#import "BLMProject.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+
+#import <XCTest/XCTest.h>
+
+
+#pragma mark
+
+@interface BLMBinaryArchiveTests : XCTestCase
+
+@end
+
+
+@implementation BLMBinaryArchiveTests
+
+#pragma mark Utility
+
+- (NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *)emptyObjectByUUIDByKind {
+    NSMutableDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [NSMutableDictionary dictionary];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        objectByUUIDByKind[@(kind)] = [NSMutableDictionary dictionary];
+    }
+
+    return objectByUUIDByKind;
+}
+
+
+- (NSDictionary<NSUUID *, id> *)decodedObjectByUUIDForObjects:(NSArray *)objects kind:(BLMArchiveEntityKind)kind {
+    NSMutableDictionary<NSUUID *, id> *objectByUUID = [NSMutableDictionary dictionary];
+
+    for (id object in objects) {
+        objectByUUID[[object UUID]] = object;
+    }
+
+    NSData *data = [BLMBinaryArchive dataWithObjectByUUIDByKind:@{ @(kind):objectByUUID }];
+    NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *decodedObjectByUUIDByKind = [self emptyObjectByUUIDByKind];
+
+    XCTAssertTrue([BLMBinaryArchive isBinaryArchiveData:data]);
+    XCTAssertTrue([BLMBinaryArchive applyData:data toObjectByUUIDByKind:decodedObjectByUUIDByKind]);
+
+    for (BLMArchiveEntityKind otherKind = 0; otherKind < BLMArchiveEntityKindCount; otherKind += 1) {
+        if (otherKind != kind) {
+            XCTAssertEqual(decodedObjectByUUIDByKind[@(otherKind)].count, 0);
+        }
+    }
+
+    XCTAssertEqual(decodedObjectByUUIDByKind[@(kind)].count, objects.count);
+
+    return decodedObjectByUUIDByKind[@(kind)];
+}
+
+
+- (NSData *)archiveDataWithEveryKind {
+    NSUUID *behaviorUUID = [NSUUID UUID];
+    BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:behaviorUUID name:@"Hand Raise" continuous:NO];
+    BLMSessionConfiguration *sessionConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:[NSUUID UUID] condition:@"Baseline" location:nil therapist:nil observer:@"Observer" timeLimit:600 timeLimitOptions:BLMTimeLimitOptionsChangeTimerColor behaviorUUIDs:[NSOrderedSet orderedSetWithObject:behaviorUUID]];
+    BLMSession *session = [[BLMSession alloc] initWithUUID:[NSUUID UUID] name:@"Session" configurationUUID:sessionConfiguration.UUID creationDate:[NSDate dateWithTimeIntervalSinceReferenceDate:1000.0] startDate:nil endDate:nil];
+    BLMProject *project = [[BLMProject alloc] initWithUUID:[NSUUID UUID] name:@"Project" client:@"Client" sessionConfigurationUUID:sessionConfiguration.UUID sessionUUIDs:[NSOrderedSet orderedSetWithObject:session.UUID]];
+
+    return [BLMBinaryArchive dataWithObjectByUUIDByKind:@{ @(BLMArchiveEntityKindProject):@{ project.UUID:project },
+                                                           @(BLMArchiveEntityKindBehavior):@{ behavior.UUID:behavior },
+                                                           @(BLMArchiveEntityKindSession):@{ session.UUID:session },
+                                                           @(BLMArchiveEntityKindSessionConfiguration):@{ sessionConfiguration.UUID:sessionConfiguration } }];
+}
+
+#pragma mark Round Trips
+
+- (void)testProjectRoundTrip {
+    BLMProject *project = [[BLMProject alloc] initWithUUID:[NSUUID UUID] name:@"Project" client:@"Client" sessionConfigurationUUID:[NSUUID UUID] sessionUUIDs:[NSOrderedSet orderedSetWithObjects:[NSUUID UUID], [NSUUID UUID], nil]];
+    BLMProject *emptyProject = [[BLMProject alloc] initWithUUID:[NSUUID UUID] name:@"Empty Project" client:@"Client" sessionConfigurationUUID:[NSUUID UUID] sessionUUIDs:nil];
+    NSDictionary<NSUUID *, BLMProject *> *decodedProjectByUUID = [self decodedObjectByUUIDForObjects:@[project, emptyProject] kind:BLMArchiveEntityKindProject];
+
+    for (BLMProject *original in @[project, emptyProject]) {
+        BLMProject *decoded = decodedProjectByUUID[original.UUID];
+
+        XCTAssertEqualObjects(decoded, original);
+        XCTAssertEqualObjects(decoded.name, original.name);
+        XCTAssertEqualObjects(decoded.client, original.client);
+        XCTAssertEqualObjects(decoded.sessionConfigurationUUID, original.sessionConfigurationUUID);
+        XCTAssertEqualObjects(decoded.sessionUUIDs, original.sessionUUIDs);
+    }
+}
+
+
+- (void)testBehaviorRoundTrip {
+    BLMBehavior *discreteBehavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"Hand Raise" continuous:NO];
+    BLMBehavior *continuousBehavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"On Task ✓" continuous:YES referenceCount:3];
+    BLMBehavior *untrackedBehavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"Out of Seat" continuous:NO referenceCount:NSNotFound];
+    NSDictionary<NSUUID *, BLMBehavior *> *decodedBehaviorByUUID = [self decodedObjectByUUIDForObjects:@[discreteBehavior, continuousBehavior, untrackedBehavior] kind:BLMArchiveEntityKindBehavior];
+
+    for (BLMBehavior *original in @[discreteBehavior, continuousBehavior, untrackedBehavior]) {
+        BLMBehavior *decoded = decodedBehaviorByUUID[original.UUID];
+
+        XCTAssertEqualObjects(decoded, original);
+        XCTAssertEqualObjects(decoded.name, original.name);
+        XCTAssertEqual(decoded.isContinuous, original.isContinuous);
+        XCTAssertEqual(decoded.referenceCount, original.referenceCount); // Not covered by -isEqual:
+    }
+}
+
+
+- (void)testSessionRoundTrip {
+    BLMSession *recordedSession = [[BLMSession alloc] initWithUUID:[NSUUID UUID] name:@"Recorded" configurationUUID:[NSUUID UUID] creationDate:[NSDate dateWithTimeIntervalSinceReferenceDate:1000.5] startDate:[NSDate dateWithTimeIntervalSinceReferenceDate:1010.25] endDate:[NSDate dateWithTimeIntervalSinceReferenceDate:1610.75]];
+    BLMSession *unstartedSession = [[BLMSession alloc] initWithUUID:[NSUUID UUID] name:@"Unstarted" configurationUUID:[NSUUID UUID] creationDate:[NSDate dateWithTimeIntervalSinceReferenceDate:2000.0] startDate:nil endDate:nil];
+    NSDictionary<NSUUID *, BLMSession *> *decodedSessionByUUID = [self decodedObjectByUUIDForObjects:@[recordedSession, unstartedSession] kind:BLMArchiveEntityKindSession];
+
+    for (BLMSession *original in @[recordedSession, unstartedSession]) {
+        BLMSession *decoded = decodedSessionByUUID[original.UUID];
+
+        XCTAssertEqualObjects(decoded, original);
+        XCTAssertEqualObjects(decoded.name, original.name);
+        XCTAssertEqualObjects(decoded.configurationUUID, original.configurationUUID);
+        XCTAssertEqualObjects(decoded.creationDate, original.creationDate);
+        XCTAssertEqualObjects(decoded.startDate, original.startDate);
+        XCTAssertEqualObjects(decoded.endDate, original.endDate);
+    }
+}
+
+
+- (void)testSessionConfigurationRoundTrip {
+    BLMSessionConfiguration *fullConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:[NSUUID UUID] condition:@"Baseline" location:@"Classroom" therapist:@"Therapist" observer:@"Observer" timeLimit:900 timeLimitOptions:(BLMTimeLimitOptionsChangeTimerColor | BLMTimeLimitOptionsPlayBeepSound) behaviorUUIDs:[NSOrderedSet orderedSetWithObjects:[NSUUID UUID], [NSUUID UUID], [NSUUID UUID], nil]];
+    BLMSessionConfiguration *emptyConfiguration = [[BLMSessionConfiguration alloc] initWithUUID:[NSUUID UUID] condition:nil location:nil therapist:nil observer:nil timeLimit:0 timeLimitOptions:0 behaviorUUIDs:nil];
+    NSDictionary<NSUUID *, BLMSessionConfiguration *> *decodedSessionConfigurationByUUID = [self decodedObjectByUUIDForObjects:@[fullConfiguration, emptyConfiguration] kind:BLMArchiveEntityKindSessionConfiguration];
+
+    for (BLMSessionConfiguration *original in @[fullConfiguration, emptyConfiguration]) {
+        BLMSessionConfiguration *decoded = decodedSessionConfigurationByUUID[original.UUID];
+
+        XCTAssertEqualObjects(decoded, original);
+        XCTAssertEqualObjects(decoded.condition, original.condition);
+        XCTAssertEqualObjects(decoded.location, original.location);
+        XCTAssertEqualObjects(decoded.therapist, original.therapist);
+        XCTAssertEqualObjects(decoded.observer, original.observer);
+        XCTAssertEqual(decoded.timeLimit, original.timeLimit);
+        XCTAssertEqual(decoded.timeLimitOptions, original.timeLimitOptions);
+        XCTAssertEqualObjects(decoded.behaviorUUIDs, original.behaviorUUIDs);
+    }
+}
+
+
+- (void)testMutationsReplaceAndDelete {
+    BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"Hand Raise" continuous:NO];
+    BLMBehavior *deletedBehavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"Out of Seat" continuous:YES];
+    NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [self emptyObjectByUUIDByKind];
+
+    objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][behavior.UUID] = behavior;
+    objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][deletedBehavior.UUID] = deletedBehavior;
+
+    BLMBehavior *renamedBehavior = [behavior copyWithUpdatedValuesByProperty:@{ @(BLMBehaviorPropertyName):@"Raised Hand" }];
+    NSData *data = [BLMBinaryArchive dataWithMutations:@[[[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindBehavior UUID:renamedBehavior.UUID object:renamedBehavior],
+                                                         [[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindBehavior UUID:deletedBehavior.UUID object:nil]]];
+
+    XCTAssertTrue([BLMBinaryArchive applyData:data toObjectByUUIDByKind:objectByUUIDByKind]);
+    XCTAssertEqual(objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)].count, 1);
+    XCTAssertEqualObjects([objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][behavior.UUID] name], @"Raised Hand");
+}
+
+#pragma mark Malformed Data
+
+- (void)testTruncatedDataIsRejected {
+    NSData *data = [self archiveDataWithEveryKind];
+
+    XCTAssertTrue([BLMBinaryArchive applyData:data toObjectByUUIDByKind:[self emptyObjectByUUIDByKind]]);
+
+    for (NSUInteger length = 0; length < data.length; length += 1) {
+        NSData *truncatedData = [data subdataWithRange:NSMakeRange(0, length)];
+        NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [self emptyObjectByUUIDByKind];
+
+        XCTAssertFalse([BLMBinaryArchive applyData:truncatedData toObjectByUUIDByKind:objectByUUIDByKind], @"Accepted data truncated to %lu of %lu bytes", (unsigned long)length, (unsigned long)data.length);
+
+        for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) { // Bounds are checked before anything is decoded
+            XCTAssertEqual(objectByUUIDByKind[@(kind)].count, 0);
+        }
+    }
+}
+
+
+- (void)testUnknownMagicIsRejected {
+    NSMutableData *data = [[self archiveDataWithEveryKind] mutableCopy];
+    uint32_t magic = 0;
+
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(uint32_t)) withBytes:&magic];
+
+    XCTAssertFalse([BLMBinaryArchive isBinaryArchiveData:data]);
+    XCTAssertFalse([BLMBinaryArchive applyData:data toObjectByUUIDByKind:[self emptyObjectByUUIDByKind]]);
+}
+
+
+- (void)testMalformedRecordLeavesObjectsUntouched {
+    BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"Hand Raise" continuous:NO];
+    BLMBehavior *deletedBehavior = [[BLMBehavior alloc] initWithUUID:[NSUUID UUID] name:@"Out of Seat" continuous:YES];
+    NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [self emptyObjectByUUIDByKind];
+
+    objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][behavior.UUID] = behavior;
+    objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][deletedBehavior.UUID] = deletedBehavior;
+
+    BLMBehavior *renamedBehavior = [behavior copyWithUpdatedValuesByProperty:@{ @(BLMBehaviorPropertyName):@"Raised Hand" }];
+    NSMutableData *data = [[BLMBinaryArchive dataWithMutations:@[[[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindBehavior UUID:deletedBehavior.UUID object:nil],
+                                                                 [[BLMArchiveMutation alloc] initWithKind:BLMArchiveEntityKindBehavior UUID:renamedBehavior.UUID object:renamedBehavior]]] mutableCopy];
+    NSData *nameData = [renamedBehavior.name dataUsingEncoding:NSUTF8StringEncoding];
+    NSRange nameRange = [data rangeOfData:nameData options:0 range:NSMakeRange(0, data.length)];
+    uint8_t const invalidByte = 0xFF; // Never valid in UTF-8, so the name fails to decode after the deletion has been read
+
+    XCTAssertNotEqual(nameRange.location, NSNotFound);
+    [data replaceBytesInRange:NSMakeRange(nameRange.location, 1) withBytes:&invalidByte];
+
+    XCTAssertFalse([BLMBinaryArchive applyData:data toObjectByUUIDByKind:objectByUUIDByKind]);
+    XCTAssertEqual(objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)].count, 2);
+    XCTAssertEqualObjects(objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][behavior.UUID], behavior);
+    XCTAssertEqualObjects(objectByUUIDByKind[@(BLMArchiveEntityKindBehavior)][deletedBehavior.UUID], deletedBehavior);
+}
+
+@end
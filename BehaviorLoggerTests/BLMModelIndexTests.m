@@ -0,0 +1,276 @@
+//
+//  BLMModelIndexTests.m
+//  BehaviorLoggerTests
+//
+//  Created by Steven Byrd on 6/2/16.
+//  Copyright © 2016 3Bird. All rights reserved.
+//
+
+#import "BLMBehavior.h"
+#import "BLMModelIndex.h"
+#import "BLMProject.h"
+#import "BLMSession.h"
+#import "BLMSessionConfiguration.h"
+
+#import <XCTest/XCTest.h>
+
+
+static long const RandomMutationSeed = 20160602;
+static NSUInteger const RandomMutationCount = 2000;
+
+
+#pragma mark
+
+@interface BLMModelIndexTests : XCTestCase
+
+@property (nonatomic, strong) BLMModelIndex *modelIndex;
+@property (nonatomic, strong) NSDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind;
+@property (nonatomic, assign) NSUInteger createdUUIDCount;
+
+@end
+
+
+@implementation BLMModelIndexTests
+
+- (void)setUp {
+    [super setUp];
+
+    NSMutableDictionary<NSNumber *, NSMutableDictionary<NSUUID *, id> *> *objectByUUIDByKind = [NSMutableDictionary dictionary];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        objectByUUIDByKind[@(kind)] = [NSMutableDictionary dictionary];
+    }
+
+    self.modelIndex = [[BLMModelIndex alloc] init];
+    self.objectByUUIDByKind = objectByUUIDByKind;
+}
+
+#pragma mark Utility
+
+- (void)setObject:(id)object forUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind { // Mirrors the data manager, which replaces each object in the index as it changes
+    NSMutableDictionary<NSUUID *, id> *objectByUUID = self.objectByUUIDByKind[@(kind)];
+
+    [self.modelIndex replaceObject:objectByUUID[UUID] withObject:object kind:kind];
+    objectByUUID[UUID] = object;
+}
+
+
+- (id)objectForUUID:(NSUUID *)UUID kind:(BLMArchiveEntityKind)kind {
+    return self.objectByUUIDByKind[@(kind)][UUID];
+}
+
+
+- (BLMModelIndex *)rebuiltModelIndex {
+    BLMModelIndex *rebuiltIndex = [[BLMModelIndex alloc] init];
+
+    for (BLMArchiveEntityKind kind = 0; kind < BLMArchiveEntityKindCount; kind += 1) {
+        for (id object in self.objectByUUIDByKind[@(kind)].objectEnumerator) {
+            [rebuiltIndex replaceObject:nil withObject:object kind:kind];
+        }
+    }
+
+    return rebuiltIndex;
+}
+
+
+- (NSUUID *)nextUUID { // Sequential, so a seed always produces the same mutations
+    self.createdUUIDCount += 1;
+    return [[NSUUID alloc] initWithUUIDString:[NSString stringWithFormat:@"00000000-0000-0000-0000-%012lX", (unsigned long)self.createdUUIDCount]];
+}
+
+
+- (NSUUID *)randomUUIDForKind:(BLMArchiveEntityKind)kind { // nil if there are none
+    NSArray<NSUUID *> *UUIDs = [self.objectByUUIDByKind[@(kind)].allKeys sortedArrayUsingComparator:^NSComparisonResult(NSUUID *UUID1, NSUUID *UUID2) { // Sorted, since dictionary order isn't stable
+        return [UUID1.UUIDString compare:UUID2.UUIDString];
+    }];
+
+    return ((UUIDs.count == 0) ? nil : UUIDs[(NSUInteger)lrand48() % UUIDs.count]);
+}
+
+
+- (NSOrderedSet<NSUUID *> *)randomBehaviorUUIDs {
+    NSMutableOrderedSet<NSUUID *> *behaviorUUIDs = [NSMutableOrderedSet orderedSet];
+
+    for (NSUInteger count = ((NSUInteger)lrand48() % 4); count > 0; count -= 1) {
+        NSUUID *behaviorUUID = (((lrand48() % 4) == 0) ? [self nextUUID] : [self randomUUIDForKind:BLMArchiveEntityKindBehavior]); // Sometimes one that isn't indexed yet
+
+        if (behaviorUUID != nil) {
+            [behaviorUUIDs addObject:behaviorUUID];
+        }
+    }
+
+    return behaviorUUIDs;
+}
+
+
+- (NSString *)randomBehaviorName { // Several names fold to the same key
+    NSArray<NSString *> *names = @[@"Hit", @"hit", @"HIT ", @"Kick", @"kick", @"Bite", @"Out of Seat"];
+    return names[(NSUInteger)lrand48() % names.count];
+}
+
+
+- (BLMSessionConfiguration *)sessionConfigurationWithUUID:(NSUUID *)UUID behaviorUUIDs:(NSOrderedSet<NSUUID *> *)behaviorUUIDs {
+    return [[BLMSessionConfiguration alloc] initWithUUID:UUID condition:nil location:nil therapist:nil observer:nil timeLimit:0 timeLimitOptions:0 behaviorUUIDs:behaviorUUIDs];
+}
+
+
+- (void)applyRandomMutation {
+    switch (lrand48() % 9) {
+        case 0: { // Create a behavior, possibly one a configuration already references
+            NSUUID *UUID = [self nextUUID];
+            BLMSessionConfiguration *sessionConfiguration = [self objectForUUID:[self randomUUIDForKind:BLMArchiveEntityKindSessionConfiguration] kind:BLMArchiveEntityKindSessionConfiguration];
+
+            if ((sessionConfiguration.behaviorUUIDs.count > 0) && ((lrand48() % 2) == 0)) {
+                UUID = sessionConfiguration.behaviorUUIDs.lastObject;
+            }
+
+            if ([self objectForUUID:UUID kind:BLMArchiveEntityKindBehavior] == nil) {
+                [self setObject:[[BLMBehavior alloc] initWithUUID:UUID name:[self randomBehaviorName] continuous:NO] forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+            }
+            break;
+        }
+
+        case 1: { // Rename a behavior or toggle whether it is continuous
+            NSUUID *UUID = [self randomUUIDForKind:BLMArchiveEntityKindBehavior];
+            BLMBehavior *behavior = [self objectForUUID:UUID kind:BLMArchiveEntityKindBehavior];
+
+            if (behavior != nil) {
+                NSDictionary *valuesByProperty = (((lrand48() % 2) == 0) ? @{ @(BLMBehaviorPropertyName):[self randomBehaviorName] } : @{ @(BLMBehaviorPropertyContinuous):@(!behavior.isContinuous) });
+                [self setObject:[behavior copyWithUpdatedValuesByProperty:valuesByProperty] forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+            }
+            break;
+        }
+
+        case 2: { // Delete a behavior; configurations may still reference it, as sessions' do
+            NSUUID *UUID = [self randomUUIDForKind:BLMArchiveEntityKindBehavior];
+
+            if (UUID != nil) {
+                [self setObject:nil forUUID:UUID kind:BLMArchiveEntityKindBehavior];
+            }
+            break;
+        }
+
+        case 3: { // Create a configuration
+            NSUUID *UUID = [self nextUUID];
+            [self setObject:[self sessionConfigurationWithUUID:UUID behaviorUUIDs:[self randomBehaviorUUIDs]] forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            break;
+        }
+
+        case 4: { // Replace a configuration's behaviors
+            NSUUID *UUID = [self randomUUIDForKind:BLMArchiveEntityKindSessionConfiguration];
+
+            if (UUID != nil) {
+                [self setObject:[self sessionConfigurationWithUUID:UUID behaviorUUIDs:[self randomBehaviorUUIDs]] forUUID:UUID kind:BLMArchiveEntityKindSessionConfiguration];
+            }
+            break;
+        }
+
+        case 5: { // Create a project using a configuration
+            NSUUID *sessionConfigurationUUID = [self randomUUIDForKind:BLMArchiveEntityKindSessionConfiguration];
+
+            if (sessionConfigurationUUID != nil) {
+                NSUUID *UUID = [self nextUUID];
+                NSString *client = (((lrand48() % 2) == 0) ? @"Client A" : @"Client B");
+
+                [self setObject:[[BLMProject alloc] initWithUUID:UUID name:UUID.UUIDString client:client sessionConfigurationUUID:sessionConfigurationUUID sessionUUIDs:nil] forUUID:UUID kind:BLMArchiveEntityKindProject];
+            }
+            break;
+        }
+
+        case 6: { // Change a project's client or configuration
+            NSUUID *UUID = [self randomUUIDForKind:BLMArchiveEntityKindProject];
+            BLMProject *project = [self objectForUUID:UUID kind:BLMArchiveEntityKindProject];
+            NSUUID *sessionConfigurationUUID = [self randomUUIDForKind:BLMArchiveEntityKindSessionConfiguration];
+
+            if ((project != nil) && (sessionConfigurationUUID != nil)) {
+                NSString *client = (((lrand48() % 2) == 0) ? project.client : [project.client stringByAppendingString:@"+"]);
+                [self setObject:[[BLMProject alloc] initWithUUID:UUID name:project.name client:client sessionConfigurationUUID:sessionConfigurationUUID sessionUUIDs:project.sessionUUIDs] forUUID:UUID kind:BLMArchiveEntityKindProject];
+            }
+            break;
+        }
+
+        case 7: { // Add a new session to a project, with a configuration of its own; a session is never in two projects
+            NSUUID *projectUUID = [self randomUUIDForKind:BLMArchiveEntityKindProject];
+            BLMProject *project = [self objectForUUID:projectUUID kind:BLMArchiveEntityKindProject];
+
+            if (project != nil) {
+                NSUUID *sessionConfigurationUUID = [self nextUUID];
+                NSUUID *sessionUUID = [self nextUUID];
+                NSOrderedSet<NSUUID *> *sessionUUIDs = ((project.sessionUUIDs != nil) ? [project.sessionUUIDs orderedSetByAddingObject:sessionUUID] : [NSOrderedSet orderedSetWithObject:sessionUUID]);
+
+                [self setObject:[self sessionConfigurationWithUUID:sessionConfigurationUUID behaviorUUIDs:[self randomBehaviorUUIDs]] forUUID:sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+                [self setObject:[[BLMSession alloc] initWithUUID:sessionUUID name:@"Session" configurationUUID:sessionConfigurationUUID creationDate:[NSDate date] startDate:nil endDate:nil] forUUID:sessionUUID kind:BLMArchiveEntityKindSession];
+                [self setObject:[[BLMProject alloc] initWithUUID:projectUUID name:project.name client:project.client sessionConfigurationUUID:project.sessionConfigurationUUID sessionUUIDs:sessionUUIDs] forUUID:projectUUID kind:BLMArchiveEntityKindProject];
+            }
+            break;
+        }
+
+        case 8: { // Delete a project along with its sessions
+            NSUUID *projectUUID = [self randomUUIDForKind:BLMArchiveEntityKindProject];
+            BLMProject *project = [self objectForUUID:projectUUID kind:BLMArchiveEntityKindProject];
+
+            if (project != nil) {
+                [self setObject:nil forUUID:projectUUID kind:BLMArchiveEntityKindProject];
+
+                for (NSUUID *sessionUUID in project.sessionUUIDs) {
+                    [self setObject:nil forUUID:sessionUUID kind:BLMArchiveEntityKindSession];
+                }
+            }
+            break;
+        }
+    }
+}
+
+#pragma mark Incremental Updates
+
+- (void)testConfigurationIndexedBeforeItsBehaviors {
+    NSUUID *hitUUID = [NSUUID UUID];
+    NSUUID *kickUUID = [NSUUID UUID];
+    NSUUID *sessionConfigurationUUID = [NSUUID UUID];
+
+    [self setObject:[self sessionConfigurationWithUUID:sessionConfigurationUUID behaviorUUIDs:[NSOrderedSet orderedSetWithObjects:hitUUID, kickUUID, nil]] forUUID:sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+    [self setObject:[[BLMBehavior alloc] initWithUUID:hitUUID name:@"Hit" continuous:NO] forUUID:hitUUID kind:BLMArchiveEntityKindBehavior];
+    [self setObject:[[BLMBehavior alloc] initWithUUID:kickUUID name:@"Kick" continuous:YES] forUUID:kickUUID kind:BLMArchiveEntityKindBehavior];
+
+    XCTAssertEqualObjects(self.modelIndex, [self rebuiltModelIndex]);
+    XCTAssertEqualObjects([self.modelIndex behaviorUUIDsWithCaseFoldedName:BLMCaseFoldedBehaviorName(@"HIT") inSessionConfigurationUUID:sessionConfigurationUUID], [NSSet setWithObject:hitUUID]);
+    XCTAssertEqual([self.modelIndex referenceCountForUUID:hitUUID kind:BLMArchiveEntityKindBehavior], 1);
+}
+
+
+- (void)testRenameAndRemovalMatchRebuild {
+    NSUUID *behaviorUUID = [NSUUID UUID];
+    NSUUID *sessionConfigurationUUID = [NSUUID UUID];
+    BLMBehavior *behavior = [[BLMBehavior alloc] initWithUUID:behaviorUUID name:@"Hit" continuous:NO];
+
+    [self setObject:behavior forUUID:behaviorUUID kind:BLMArchiveEntityKindBehavior];
+    [self setObject:[self sessionConfigurationWithUUID:sessionConfigurationUUID behaviorUUIDs:[NSOrderedSet orderedSetWithObject:behaviorUUID]] forUUID:sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+
+    [self setObject:[behavior copyWithUpdatedValuesByProperty:@{ @(BLMBehaviorPropertyName):@"Kick" }] forUUID:behaviorUUID kind:BLMArchiveEntityKindBehavior];
+    XCTAssertEqualObjects(self.modelIndex, [self rebuiltModelIndex]);
+    XCTAssertEqual([self.modelIndex behaviorUUIDsWithCaseFoldedName:BLMCaseFoldedBehaviorName(@"Hit") inSessionConfigurationUUID:sessionConfigurationUUID].count, 0);
+
+    [self setObject:[self sessionConfigurationWithUUID:sessionConfigurationUUID behaviorUUIDs:nil] forUUID:sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+    XCTAssertEqualObjects(self.modelIndex, [self rebuiltModelIndex]);
+    XCTAssertEqual([self.modelIndex referenceCountForUUID:behaviorUUID kind:BLMArchiveEntityKindBehavior], 0);
+
+    [self setObject:nil forUUID:behaviorUUID kind:BLMArchiveEntityKindBehavior];
+    [self setObject:nil forUUID:sessionConfigurationUUID kind:BLMArchiveEntityKindSessionConfiguration];
+    XCTAssertEqualObjects(self.modelIndex, [[BLMModelIndex alloc] init]);
+}
+
+
+- (void)testRandomMutationsMatchRebuild {
+    srand48(RandomMutationSeed);
+
+    for (NSUInteger mutationIndex = 0; mutationIndex < RandomMutationCount; mutationIndex += 1) {
+        [self applyRandomMutation];
+
+        if (![self.modelIndex isEqual:[self rebuiltModelIndex]]) {
+            XCTFail(@"The index diverged from a rebuild after mutation %lu", (unsigned long)mutationIndex);
+            break;
+        }
+    }
+}
+
+@end